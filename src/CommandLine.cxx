@@ -233,6 +233,9 @@ static void version(void)
 #ifdef USE_EPOLL
 	       " epoll"
 #endif
+#ifdef USE_IO_URING
+	       " io_uring"
+#endif
 #ifdef HAVE_ICONV
 	       " iconv"
 #endif
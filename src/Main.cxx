@@ -123,10 +123,20 @@ static constexpr size_t MEGABYTE = 1024 * KILOBYTE;
 
 static constexpr size_t DEFAULT_BUFFER_SIZE = 4 * MEGABYTE;
 
+static constexpr unsigned MIN_BUFFER_CHUNKS = 32;
+
 static constexpr
-size_t MIN_BUFFER_SIZE = std::max(CHUNK_SIZE * 32,
+size_t MIN_BUFFER_SIZE = std::max(DEFAULT_CHUNK_SIZE * MIN_BUFFER_CHUNKS,
 				  64 * KILOBYTE);
 
+/**
+ * If "audio_buffer_chunk_size" is not configured, the chunk size
+ * grows with the buffer size, so the buffer consists of at least
+ * this number of chunks.
+ */
+static constexpr unsigned AUTO_BUFFER_CHUNKS = 1024;
+static constexpr size_t AUTO_MAX_CHUNK_SIZE = 256 * KILOBYTE;
+
 #ifdef ANDROID
 Context *context;
 LogListener *logListener;
@@ -269,6 +279,18 @@ glue_state_file_init(Instance &instance, const ConfigData &raw_config)
 	instance.state_file->Read();
 }
 
+gcc_const
+static size_t
+AutoChunkSize(size_t buffer_size) noexcept
+{
+	size_t chunk_size = DEFAULT_CHUNK_SIZE;
+	while (chunk_size < AUTO_MAX_CHUNK_SIZE &&
+	       buffer_size / (chunk_size * 2) >= AUTO_BUFFER_CHUNKS)
+		chunk_size *= 2;
+
+	return chunk_size;
+}
+
 /**
  * Initialize the decoder and player core, including the music pipe.
  */
@@ -300,12 +322,31 @@ initialize_decoder_and_player(Instance &instance,
 	} else
 		buffer_size = DEFAULT_BUFFER_SIZE;
 
-	const unsigned buffered_chunks = buffer_size / CHUNK_SIZE;
+	size_t chunk_size;
+	param = config.GetParam(ConfigOption::AUDIO_BUFFER_CHUNK_SIZE);
+	if (param != nullptr) {
+		chunk_size = param->With([](const char *s){
+			size_t result = ParseSize(s, KILOBYTE);
+			if (result < MIN_CHUNK_SIZE || result > MAX_CHUNK_SIZE)
+				throw FormatRuntimeError("chunk size \"%s\" is out of range", s);
+
+			/* keep the chunks aligned */
+			return result & ~size_t(63);
+		});
+	} else
+		chunk_size = AutoChunkSize(buffer_size);
+
+	const unsigned buffered_chunks = buffer_size / chunk_size;
 
 	if (buffered_chunks >= 1 << 15)
 		throw FormatRuntimeError("buffer size \"%lu\" is too big",
 					 (unsigned long)buffer_size);
 
+	if (buffered_chunks < MIN_BUFFER_CHUNKS)
+		throw FormatRuntimeError("chunk size %lu is too big for buffer size %lu",
+					 (unsigned long)chunk_size,
+					 (unsigned long)buffer_size);
+
 	const unsigned max_length =
 		config.GetPositive(ConfigOption::MAX_PLAYLIST_LENGTH,
 				   DEFAULT_PLAYLIST_MAX_LENGTH);
@@ -320,7 +361,7 @@ initialize_decoder_and_player(Instance &instance,
 	instance.partitions.emplace_back(instance,
 					 "default",
 					 max_length,
-					 buffered_chunks,
+					 buffered_chunks, chunk_size,
 					 configured_audio_format,
 					 replay_gain_config);
 	auto &partition = instance.partitions.back();
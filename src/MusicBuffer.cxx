@@ -20,33 +20,163 @@
 #include "MusicBuffer.hxx"
 #include "MusicChunk.hxx"
 
+#include <new>
+
 #include <assert.h>
 
-MusicBuffer::MusicBuffer(unsigned num_chunks)
-	:buffer(num_chunks) {
+MusicBuffer::MusicBuffer(unsigned num_chunks, size_t _chunk_size)
+	:chunk_size(_chunk_size),
+	 buffer(num_chunks * chunk_size),
+	 n_chunks(buffer.size() / chunk_size),
+	 free_next(std::make_unique<std::atomic<uint32_t>[]>(n_chunks)) {
+	assert(chunk_size >= MIN_CHUNK_SIZE);
+	assert(chunk_size <= MAX_CHUNK_SIZE);
+	assert(chunk_size % 64 == 0);
+
+	buffer.ForkCow(false);
+}
+
+MusicBuffer::~MusicBuffer() noexcept
+{
+	/* all chunks must be returned explicitly, and this
+	   assertion checks for leaks */
+	assert(n_allocated.load(std::memory_order_relaxed) == 0);
+}
+
+size_t
+MusicBuffer::GetChunkCapacity() const noexcept
+{
+	return chunk_size - sizeof(MusicChunk);
+}
+
+inline int
+MusicBuffer::Pop() noexcept
+{
+	uint64_t old = free_head.load(std::memory_order_acquire);
+	while (true) {
+		const uint32_t i = uint32_t(old);
+		if (i == 0)
+			return -1;
+
+		/* this may read a stale value if another thread pops
+		   this chunk concurrently, but then the tag has
+		   changed and the CAS fails */
+		const uint32_t next =
+			free_next[i - 1].load(std::memory_order_relaxed);
+		const uint64_t tag = (old >> 32) + 1;
+		if (free_head.compare_exchange_weak(old, (tag << 32) | next,
+						    std::memory_order_acquire,
+						    std::memory_order_acquire))
+			return i - 1;
+	}
+}
+
+inline void
+MusicBuffer::Push(unsigned i) noexcept
+{
+	uint64_t old = free_head.load(std::memory_order_relaxed);
+	uint64_t new_head;
+	do {
+		free_next[i].store(uint32_t(old), std::memory_order_relaxed);
+		const uint64_t tag = (old >> 32) + 1;
+		new_head = (tag << 32) | (i + 1);
+	} while (!free_head.compare_exchange_weak(old, new_head,
+						  std::memory_order_release,
+						  std::memory_order_relaxed));
+}
+
+inline bool
+MusicBuffer::Reserve() noexcept
+{
+	const unsigned capacity = GetSize();
+
+	unsigned n = n_allocated.load(std::memory_order_relaxed);
+	while (n > 0) {
+		if (n >= capacity)
+			return false;
+
+		if (n_allocated.compare_exchange_weak(n, n + 1,
+						      std::memory_order_acquire,
+						      std::memory_order_relaxed))
+			return true;
+	}
+
+	/* the buffer is (or was) empty: leaving this state must not
+	   overlap with DiscardMemory() */
+	const std::lock_guard<Mutex> protect(mutex);
+
+	n = n_allocated.load(std::memory_order_relaxed);
+	do {
+		if (n >= capacity)
+			return false;
+	} while (!n_allocated.compare_exchange_weak(n, n + 1,
+						    std::memory_order_acquire,
+						    std::memory_order_relaxed));
+	return true;
+}
+
+inline void *
+MusicBuffer::Obtain() noexcept
+{
+	const unsigned capacity = GetSize();
+
+	/* the reservation guarantees that a chunk is either on the
+	   free stack or has never been used; the loop only repeats
+	   while other threads modify the free stack concurrently */
+	while (true) {
+		const int i = Pop();
+		if (i >= 0)
+			return GetSlot(i);
+
+		unsigned n = n_initialized.load(std::memory_order_relaxed);
+		while (n < capacity)
+			if (n_initialized.compare_exchange_weak(n, n + 1,
+								std::memory_order_relaxed))
+				return GetSlot(n);
+	}
 }
 
 MusicChunkPtr
 MusicBuffer::Allocate() noexcept
 {
-	const std::lock_guard<Mutex> protect(mutex);
-	return MusicChunkPtr(buffer.Allocate(), MusicChunkDeleter(*this));
+	if (!Reserve())
+		return nullptr;
+
+	MusicChunk *chunk = ::new(Obtain()) MusicChunk(chunk_size);
+	return MusicChunkPtr(chunk, MusicChunkDeleter(*this));
 }
 
 void
 MusicBuffer::Return(MusicChunk *chunk) noexcept
 {
 	assert(chunk != nullptr);
+	assert((uint8_t *)chunk >= &buffer.front() &&
+	       (uint8_t *)chunk <= &buffer.back());
+	assert(chunk->next.load(std::memory_order_relaxed) == nullptr);
 
-	/* these attributes need to be cleared before locking the
-	   mutex, because they might recursively call this method,
-	   causing a deadlock */
-	chunk->next.reset();
+	/* this may recursively call this method */
 	chunk->other.reset();
 
-	const std::lock_guard<Mutex> protect(mutex);
+	const unsigned i = ((uint8_t *)chunk - &buffer.front()) / chunk_size;
+	chunk->~MusicChunk();
+
+	Push(i);
 
-	assert(!chunk->other || !chunk->other->other);
+	if (n_allocated.fetch_sub(1, std::memory_order_release) == 1) {
+		/* give memory back to the kernel when the last chunk
+		   was returned */
+		const std::lock_guard<Mutex> protect(mutex);
+		if (n_allocated.load(std::memory_order_acquire) == 0)
+			DiscardMemory();
+	}
+}
+
+void
+MusicBuffer::DiscardMemory() noexcept
+{
+	const uint64_t tag = (free_head.load(std::memory_order_relaxed) >> 32) + 1;
+	free_head.store(tag << 32, std::memory_order_relaxed);
+	n_initialized.store(0, std::memory_order_relaxed);
 
-	buffer.Free(chunk);
+	buffer.Discard();
 }
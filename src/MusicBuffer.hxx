@@ -21,17 +21,69 @@
 #define MPD_MUSIC_BUFFER_HXX
 
 #include "MusicChunkPtr.hxx"
-#include "util/SliceBuffer.hxx"
+#include "util/HugeAllocator.hxx"
 #include "thread/Mutex.hxx"
 
+#include <atomic>
+#include <memory>
+
+#include <stdint.h>
+
 /**
  * An allocator for #MusicChunk objects.
+ *
+ * Allocate() and Return() are lock-free while at least one chunk is
+ * allocated: free chunks are kept on a stack of chunk indices whose
+ * head is tagged with a modification counter (to avoid the ABA
+ * problem).  The #mutex is only used on the transition from and to
+ * the "empty" state, which gives the memory back to the kernel.
  */
 class MusicBuffer {
-	/** a mutex which protects #buffer */
-	mutable Mutex mutex;
+	/**
+	 * Protects the transition from and to "no chunk allocated",
+	 * i.e. the #n_allocated value 0, and DiscardMemory().
+	 */
+	Mutex mutex;
+
+	/**
+	 * The size of each chunk slot in #buffer, including the
+	 * #MusicChunk header.
+	 */
+	const size_t chunk_size;
+
+	HugeArray<uint8_t> buffer;
+
+	/**
+	 * The number of chunk slots in #buffer.
+	 */
+	const unsigned n_chunks;
 
-	SliceBuffer<MusicChunk> buffer;
+	/**
+	 * The "next" links of the free chunk stack: the index of the
+	 * next free chunk plus one, or 0 at the end.
+	 */
+	std::unique_ptr<std::atomic<uint32_t>[]> free_next;
+
+	/**
+	 * The head of the free chunk stack: the low 32 bits are the
+	 * chunk index plus one (0 if the stack is empty), the high 32
+	 * bits are incremented on each modification.
+	 */
+	std::atomic<uint64_t> free_head{0};
+
+	/**
+	 * The number of chunks which have been touched since the
+	 * last DiscardMemory().  Chunks beyond this index are not on
+	 * the free stack, and their pages have not been faulted in.
+	 */
+	std::atomic<unsigned> n_initialized{0};
+
+	/**
+	 * The number of chunks currently allocated, including
+	 * Allocate() calls which have reserved a chunk but not yet
+	 * obtained it.
+	 */
+	std::atomic<unsigned> n_allocated{0};
 
 public:
 	/**
@@ -39,23 +91,29 @@ public:
 	 *
 	 * @param num_chunks the number of #MusicChunk reserved in
 	 * this buffer
+	 * @param chunk_size the size of each chunk including its
+	 * header; must be a multiple of 64
 	 */
-	explicit MusicBuffer(unsigned num_chunks);
+	MusicBuffer(unsigned num_chunks, size_t chunk_size);
+
+	~MusicBuffer() noexcept;
+
+	MusicBuffer(const MusicBuffer &) = delete;
+	MusicBuffer &operator=(const MusicBuffer &) = delete;
 
 #ifndef NDEBUG
 	/**
 	 * Check whether the buffer is empty.  This call is not
-	 * protected with the mutex, and may only be used while this
-	 * object is inaccessible to other threads.
+	 * synchronized, and may only be used while this object is
+	 * inaccessible to other threads.
 	 */
 	bool IsEmptyUnsafe() const {
-		return buffer.empty();
+		return n_allocated.load(std::memory_order_relaxed) == 0;
 	}
 #endif
 
 	bool IsFull() const noexcept {
-		const std::lock_guard<Mutex> protect(mutex);
-		return buffer.IsFull();
+		return n_allocated.load(std::memory_order_relaxed) >= GetSize();
 	}
 
 	/**
@@ -65,9 +123,16 @@ public:
 	 */
 	gcc_pure
 	unsigned GetSize() const noexcept {
-		return buffer.GetCapacity();
+		return n_chunks;
 	}
 
+	/**
+	 * Returns the number of data bytes in each chunk, i.e. the
+	 * value of MusicChunk::capacity.
+	 */
+	gcc_pure
+	size_t GetChunkCapacity() const noexcept;
+
 	/**
 	 * Allocates a chunk from the buffer.  When it is not used anymore,
 	 * call Return().
@@ -82,6 +147,38 @@ public:
 	 * Allocate() then.
 	 */
 	void Return(MusicChunk *chunk) noexcept;
+
+private:
+	/**
+	 * Reserve a chunk by incrementing #n_allocated.
+	 *
+	 * @return false if the buffer is full
+	 */
+	bool Reserve() noexcept;
+
+	/**
+	 * Obtain a chunk slot after Reserve() has succeeded.
+	 */
+	void *Obtain() noexcept;
+
+	void *GetSlot(unsigned i) noexcept {
+		return &buffer[i * chunk_size];
+	}
+
+	/**
+	 * Pop a chunk from the free stack.
+	 *
+	 * @return the chunk index or -1 if the stack is empty
+	 */
+	int Pop() noexcept;
+
+	void Push(unsigned i) noexcept;
+
+	/**
+	 * Give the memory back to the kernel.  Caller must hold the
+	 * mutex, and no chunk may be allocated.
+	 */
+	void DiscardMemory() noexcept;
 };
 
 #endif
@@ -29,12 +29,20 @@
 #include "AudioFormat.hxx"
 #endif
 
+#include <atomic>
 #include <memory>
 
 #include <stdint.h>
 #include <stddef.h>
 
-static constexpr size_t CHUNK_SIZE = 4096;
+/**
+ * The size of one #MusicBuffer slot, i.e. a #MusicChunk object plus
+ * its data.  The "audio_buffer_chunk_size" setting may choose any
+ * value between #MIN_CHUNK_SIZE and #MAX_CHUNK_SIZE.
+ */
+static constexpr size_t DEFAULT_CHUNK_SIZE = 4096;
+static constexpr size_t MIN_CHUNK_SIZE = 4096;
+static constexpr size_t MAX_CHUNK_SIZE = 1024 * 1024;
 
 struct AudioFormat;
 struct Tag;
@@ -44,8 +52,12 @@ struct MusicChunk;
  * Meta information for #MusicChunk.
  */
 struct MusicChunkInfo {
-	/** the next chunk in a linked list */
-	MusicChunkPtr next;
+	/**
+	 * The next chunk in the #MusicPipe.  The pipe owns the chunks
+	 * in its list.  This may be read by any thread (with acquire
+	 * semantics) while the chunk is in the pipe.
+	 */
+	std::atomic<MusicChunk *> next{nullptr};
 
 	/**
 	 * An optional chunk which should be mixed into this chunk.
@@ -66,7 +78,7 @@ struct MusicChunkInfo {
 	float mix_ratio;
 
 	/** number of bytes stored in this chunk */
-	uint16_t length = 0;
+	uint32_t length = 0;
 
 	/** current bit rate of the source file */
 	uint16_t bit_rate;
@@ -114,10 +126,23 @@ struct MusicChunkInfo {
 /**
  * A chunk of music data.  Its format is defined by the
  * MusicPipe::Push() caller.
+ *
+ * The data follows this object in the #MusicBuffer slot.
  */
 struct MusicChunk : MusicChunkInfo {
 	/** the data (probably PCM) */
-	uint8_t data[CHUNK_SIZE - sizeof(MusicChunkInfo)];
+	uint8_t *const data;
+
+	/** the size of #data in bytes */
+	const size_t capacity;
+
+	/**
+	 * @param slot_size the size of the #MusicBuffer slot this
+	 * object is constructed in
+	 */
+	explicit MusicChunk(size_t slot_size) noexcept
+		:data(reinterpret_cast<uint8_t *>(this + 1)),
+		 capacity(slot_size - sizeof(MusicChunk)) {}
 
 	/**
 	 * Prepares appending to the music chunk.  Returns a buffer
@@ -146,6 +171,6 @@ struct MusicChunk : MusicChunkInfo {
 	bool Expand(AudioFormat af, size_t length) noexcept;
 };
 
-static_assert(sizeof(MusicChunk) == CHUNK_SIZE, "Wrong size");
+static_assert(sizeof(MusicChunk) < MIN_CHUNK_SIZE / 8, "Wrong size");
 
 #endif
@@ -20,6 +20,8 @@
 #include "MusicPipe.hxx"
 #include "MusicChunk.hxx"
 
+#include <thread>
+
 #include <assert.h>
 
 #ifndef NDEBUG
@@ -27,9 +29,8 @@
 bool
 MusicPipe::Contains(const MusicChunk *chunk) const noexcept
 {
-	const std::lock_guard<Mutex> protect(mutex);
-
-	for (const MusicChunk *i = head.get(); i != nullptr; i = i->next.get())
+	for (const MusicChunk *i = head.load(std::memory_order_acquire);
+	     i != nullptr; i = i->next.load(std::memory_order_acquire))
 		if (i == chunk)
 			return true;
 
@@ -41,32 +42,53 @@ MusicPipe::Contains(const MusicChunk *chunk) const noexcept
 MusicChunkPtr
 MusicPipe::Shift() noexcept
 {
-	const std::lock_guard<Mutex> protect(mutex);
-
-	auto chunk = std::move(head);
-	if (chunk != nullptr) {
-		assert(!chunk->IsEmpty());
-
-		head = std::move(chunk->next);
-		--size;
+	MusicChunk *chunk = head.load(std::memory_order_acquire);
+	if (chunk == nullptr) {
+		if (size.load(std::memory_order_acquire) == 0)
+			return nullptr;
+
+		/* Push() has counted a chunk, but has not yet
+		   published it; callers rely on !IsEmpty() meaning
+		   that Shift() succeeds, so wait for it (this window
+		   is only a few instructions long) */
+		while ((chunk = head.load(std::memory_order_acquire)) == nullptr)
+			std::this_thread::yield();
+	}
 
-		if (head == nullptr) {
-			assert(size == 0);
-			assert(tail_r == &chunk->next);
+	assert(!chunk->IsEmpty());
 
-			tail_r = &head;
-		} else {
-			assert(size > 0);
-			assert(tail_r != &chunk->next);
+	/* copy the deleter before the tail may be released below,
+	   because Push() overwrites it when the pipe is empty */
+	const MusicChunkDeleter d = deleter;
+
+	MusicChunk *next = chunk->next.load(std::memory_order_acquire);
+	if (next == nullptr) {
+		/* this appears to be the last chunk; try to detach
+		   it from the tail */
+		head.store(nullptr, std::memory_order_relaxed);
+
+		MusicChunk *expected = chunk;
+		if (!tail.compare_exchange_strong(expected, nullptr,
+						  std::memory_order_acq_rel,
+						  std::memory_order_acquire)) {
+			/* Push() has just appended a chunk, but has
+			   not yet linked it; this window is only a
+			   few instructions long */
+			while ((next = chunk->next.load(std::memory_order_acquire)) == nullptr)
+				std::this_thread::yield();
+
+			head.store(next, std::memory_order_release);
 		}
+	} else
+		head.store(next, std::memory_order_release);
 
-#ifndef NDEBUG
-		if (size == 0)
-			audio_format.Clear();
-#endif
-	}
+	chunk->next.store(nullptr, std::memory_order_relaxed);
+
+	gcc_unused
+	const unsigned old_size = size.fetch_sub(1, std::memory_order_release);
+	assert(old_size > 0);
 
-	return chunk;
+	return MusicChunkPtr(chunk, d);
 }
 
 void
@@ -80,10 +102,24 @@ MusicPipe::Push(MusicChunkPtr chunk) noexcept
 {
 	assert(!chunk->IsEmpty());
 	assert(chunk->length == 0 || chunk->audio_format.IsValid());
+	assert(chunk->next.load(std::memory_order_relaxed) == nullptr);
+
+	/* count the chunk before it becomes visible to the
+	   consumer */
+	size.fetch_add(1, std::memory_order_relaxed);
+
+	MusicChunk *const c = chunk.get();
+	MusicChunk *const prev = tail.exchange(c, std::memory_order_acq_rel);
+	if (prev == nullptr) {
+		/* the pipe was empty: the consumer does not access
+		   the deleter until it sees the new head */
+		deleter = chunk.get_deleter();
 
-	const std::lock_guard<Mutex> protect(mutex);
+#ifndef NDEBUG
+		audio_format.Clear();
+#endif
+	}
 
-	assert(size > 0 || !audio_format.IsDefined());
 	assert(!audio_format.IsDefined() ||
 	       chunk->CheckFormat(audio_format));
 
@@ -92,9 +128,10 @@ MusicPipe::Push(MusicChunkPtr chunk) noexcept
 		audio_format = chunk->audio_format;
 #endif
 
-	chunk->next.reset();
-	*tail_r = std::move(chunk);
-	tail_r = &(*tail_r)->next;
+	chunk.release();
 
-	++size;
+	if (prev == nullptr)
+		head.store(c, std::memory_order_release);
+	else
+		prev->next.store(c, std::memory_order_release);
 }
@@ -21,35 +21,59 @@
 #define MPD_PIPE_H
 
 #include "MusicChunkPtr.hxx"
-#include "thread/Mutex.hxx"
 #include "util/Compiler.h"
 
 #ifndef NDEBUG
 #include "AudioFormat.hxx"
 #endif
 
+#include <atomic>
+
 /**
  * A queue of #MusicChunk objects.  One party appends chunks at the
  * tail, and the other consumes them from the head.
+ *
+ * This class is lock-free, but only one thread may call Push() at a
+ * time, and only one thread may call Shift() and Clear() at a time
+ * (single producer, single consumer).  If these roles move to
+ * another thread (e.g. the decoder thread clearing the pipe while
+ * the player waits for the seek to complete), the handover must be
+ * synchronized by the caller.  Peek(), GetSize() and reading
+ * MusicChunk::next may be done by any thread.
  */
 class MusicPipe {
-	/** the first chunk */
-	MusicChunkPtr head;
+	/** the first chunk; written by the consumer, and by the
+	    producer when the pipe is empty */
+	std::atomic<MusicChunk *> head{nullptr};
 
-	/** a pointer to the tail of the chunk */
-	MusicChunkPtr *tail_r = &head;
+	/** the last chunk; it is the linearization point between
+	    producer and consumer */
+	std::atomic<MusicChunk *> tail{nullptr};
 
-	/** the current number of chunks */
-	unsigned size = 0;
+	/** the current number of chunks; it is incremented before a
+	    chunk becomes visible and decremented after it has been
+	    removed, so it is never smaller than the number of chunks
+	    reachable from #head (Shift() waits for a chunk which has
+	    been counted but not yet linked) */
+	std::atomic<unsigned> size{0};
 
-	/** a mutex which protects #head and #tail_r */
-	mutable Mutex mutex;
+	/**
+	 * Returns chunks to their #MusicBuffer.  All chunks in the
+	 * pipe must come from the same buffer.  This is only written
+	 * by Push() while the pipe is empty.
+	 */
+	MusicChunkDeleter deleter;
 
 #ifndef NDEBUG
 	AudioFormat audio_format = AudioFormat::Undefined();
 #endif
 
 public:
+	MusicPipe() = default;
+
+	MusicPipe(const MusicPipe &) = delete;
+	MusicPipe &operator=(const MusicPipe &) = delete;
+
 	~MusicPipe() noexcept {
 		Clear();
 	}
@@ -57,11 +81,11 @@ public:
 #ifndef NDEBUG
 	/**
 	 * Checks if the audio format if the chunk is equal to the specified
-	 * audio_format.
+	 * audio_format.  May only be called by the producer.
 	 */
 	gcc_pure
 	bool CheckFormat(AudioFormat other) const noexcept {
-		return !audio_format.IsDefined() ||
+		return IsEmpty() || !audio_format.IsDefined() ||
 			audio_format == other;
 	}
 
@@ -78,12 +102,12 @@ public:
 	 */
 	gcc_pure
 	const MusicChunk *Peek() const noexcept {
-		const std::lock_guard<Mutex> protect(mutex);
-		return head.get();
+		return head.load(std::memory_order_acquire);
 	}
 
 	/**
 	 * Removes the first chunk from the head, and returns it.
+	 * Returns nullptr only if IsEmpty() is true.
 	 */
 	MusicChunkPtr Shift() noexcept;
 
@@ -102,8 +126,7 @@ public:
 	 */
 	gcc_pure
 	unsigned GetSize() const noexcept {
-		const std::lock_guard<Mutex> protect(mutex);
-		return size;
+		return size.load(std::memory_order_acquire);
 	}
 
 	gcc_pure
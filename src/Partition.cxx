@@ -20,20 +20,20 @@
 #include "config.h"
 #include "Partition.hxx"
 #include "Instance.hxx"
-#include "Log.hxx"
 #include "song/DetachedSong.hxx"
 #include "mixer/Volume.hxx"
 #include "IdleFlags.hxx"
 #include "client/Listener.hxx"
 #include "input/cache/Manager.hxx"
-#include "util/Domain.hxx"
 
-static constexpr Domain cache_domain("cache");
+#include <list>
+#include <string>
 
 Partition::Partition(Instance &_instance,
 		     const char *_name,
 		     unsigned max_length,
 		     unsigned buffer_chunks,
+		     size_t chunk_size,
 		     AudioFormat configured_audio_format,
 		     const ReplayGainConfig &replay_gain_config) noexcept
 	:instance(_instance),
@@ -44,7 +44,7 @@ Partition::Partition(Instance &_instance,
 	 outputs(*this),
 	 pc(*this, outputs,
 	    instance.input_cache.get(),
-	    buffer_chunks,
+	    buffer_chunks, chunk_size,
 	    configured_audio_format, replay_gain_config)
 {
 	UpdateEffectiveReplayGainMode();
@@ -58,28 +58,6 @@ Partition::EmitIdle(unsigned mask) noexcept
 	instance.EmitIdle(mask);
 }
 
-static void
-PrefetchSong(InputCacheManager &cache, const char *uri) noexcept
-{
-	if (cache.Contains(uri))
-		return;
-
-	FormatDebug(cache_domain, "Prefetch '%s'", uri);
-
-	try {
-		cache.Prefetch(uri);
-	} catch (...) {
-		FormatError(std::current_exception(),
-			    "Prefetch '%s' failed", uri);
-	}
-}
-
-static void
-PrefetchSong(InputCacheManager &cache, const DetachedSong &song) noexcept
-{
-	PrefetchSong(cache, song.GetURI());
-}
-
 inline void
 Partition::PrefetchQueue() noexcept
 {
@@ -87,12 +65,32 @@ Partition::PrefetchQueue() noexcept
 		return;
 
 	auto &cache = *instance.input_cache;
+	const auto &queue = playlist.queue;
+
+	const int next = playlist.GetNextPosition();
+	if (next < 0 || cache.GetLookahead() == 0)
+		return;
+
+	/* collect the real URIs of the next songs in playback order;
+	   the decoder uses those, not the (database-relative) URIs */
 
-	int next = playlist.GetNextPosition();
-	if (next >= 0)
-		PrefetchSong(cache, playlist.queue.Get(next));
+	std::list<std::string> uris;
+
+	const unsigned first = queue.PositionToOrder(next);
+	unsigned order = first;
+	while (true) {
+		uris.emplace_back(queue.GetOrder(order).GetRealURI());
+		if (uris.size() >= cache.GetLookahead())
+			break;
+
+		const int i = queue.GetNextOrder(order);
+		if (i < 0 || unsigned(i) == first)
+			break;
+
+		order = i;
+	}
 
-	// TODO: prefetch more songs
+	cache.SchedulePrefetch(std::move(uris));
 }
 
 void
@@ -69,6 +69,7 @@ struct Partition final : QueueListener, PlayerListener, MixerListener {
 		  const char *_name,
 		  unsigned max_length,
 		  unsigned buffer_chunks,
+		  size_t chunk_size,
 		  AudioFormat configured_audio_format,
 		  const ReplayGainConfig &replay_gain_config) noexcept;
 
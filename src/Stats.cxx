@@ -26,6 +26,11 @@
 #include "db/Selection.hxx"
 #include "db/Interface.hxx"
 #include "db/Stats.hxx"
+#include "input/cache/Manager.hxx"
+#include "tag/Pool.hxx"
+#if defined(ENABLE_SACDISO) || defined(ENABLE_DVDAISO)
+#include "lib/isocache/SectorCache.hxx"
+#endif
 #include "Log.hxx"
 #include "time/ChronoUtil.hxx"
 
@@ -36,6 +41,8 @@
 #include <chrono>
 #include <cmath>
 
+#include <inttypes.h>
+
 #ifndef _WIN32
 /**
  * The monotonic time stamp when MPD was started.  It is used to
@@ -114,6 +121,53 @@ db_stats_print(Response &r, const Database &db)
 
 #endif
 
+static void
+input_cache_stats_print(Response &r, const InputCacheManager &cache)
+{
+	const auto cs = cache.GetStats();
+
+	r.Format("input_cache_ram_hits: %lu\n"
+		 "input_cache_ram_misses: %lu\n"
+		 "input_cache_ram_bytes: %" PRIu64 "\n",
+		 cs.ram_hits, cs.ram_misses, cs.ram_bytes);
+
+	if (cache.HasDisk())
+		r.Format("input_cache_disk_hits: %lu\n"
+			 "input_cache_disk_misses: %lu\n"
+			 "input_cache_disk_bytes: %" PRIu64 "\n",
+			 cs.disk_hits, cs.disk_misses, cs.disk_bytes);
+}
+
+static void
+tag_pool_stats_print(Response &r)
+{
+	const auto ps = tag_pool_get_stats();
+
+	r.Format("tag_pool_items: %zu\n"
+		 "tag_pool_references: %zu\n"
+		 "tag_pool_bytes: %zu\n"
+		 "tag_pool_bytes_saved: %zu\n"
+		 "tag_pool_buckets: %zu\n"
+		 "tag_pool_max_chain_length: %zu\n",
+		 ps.items, ps.references, ps.bytes, ps.bytes_saved,
+		 ps.buckets, ps.max_chain_length);
+}
+
+#if defined(ENABLE_SACDISO) || defined(ENABLE_DVDAISO)
+
+static void
+iso_cache_stats_print(Response &r)
+{
+	const auto cs = SectorCache::GetTotalStats();
+
+	r.Format("iso_cache_hits: %" PRIu64 "\n"
+		 "iso_cache_misses: %" PRIu64 "\n"
+		 "iso_cache_prefetched: %" PRIu64 "\n",
+		 cs.hits, cs.misses, cs.prefetched);
+}
+
+#endif
+
 void
 stats_print(Response &r, const Partition &partition)
 {
@@ -133,4 +187,13 @@ stats_print(Response &r, const Partition &partition)
 	if (db != nullptr)
 		db_stats_print(r, *db);
 #endif
+
+	if (partition.instance.input_cache)
+		input_cache_stats_print(r, *partition.instance.input_cache);
+
+	tag_pool_stats_print(r);
+
+#if defined(ENABLE_SACDISO) || defined(ENABLE_DVDAISO)
+	iso_cache_stats_print(r);
+#endif
 }
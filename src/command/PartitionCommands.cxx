@@ -21,6 +21,7 @@
 #include "Request.hxx"
 #include "Instance.hxx"
 #include "Partition.hxx"
+#include "MusicChunk.hxx"
 #include "IdleFlags.hxx"
 #include "client/Client.hxx"
 #include "client/Response.hxx"
@@ -100,7 +101,7 @@ handle_newpartition(Client &client, Request request, Response &response)
 	instance.partitions.emplace_back(instance, name,
 					 // TODO: use real configuration
 					 16384,
-					 1024,
+					 1024, DEFAULT_CHUNK_SIZE,
 					 AudioFormat::Undefined(),
 					 ReplayGainConfig());
 	auto &partition = instance.partitions.back();
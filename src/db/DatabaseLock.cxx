@@ -19,8 +19,9 @@
 
 #include "DatabaseLock.hxx"
 
-Mutex db_mutex;
+std::shared_mutex db_mutex;
 
 #ifndef NDEBUG
 ThreadId db_mutex_holder;
+thread_local bool db_mutex_shared_holder;
 #endif
@@ -26,25 +26,54 @@
 #ifndef MPD_DB_LOCK_HXX
 #define MPD_DB_LOCK_HXX
 
-#include "thread/Mutex.hxx"
 #include "util/Compiler.h"
 
+#include <shared_mutex>
+
 #include <assert.h>
 
-extern Mutex db_mutex;
+/**
+ * The global database lock.  Threads which only read the database
+ * (e.g. to answer a client's "find" command) obtain a shared lock,
+ * and may therefore run concurrently; modifications (by the update
+ * thread, or when mounting) require an exclusive lock, which waits
+ * for all readers to finish, and which makes each modification
+ * appear atomic to them.
+ */
+extern std::shared_mutex db_mutex;
 
 #ifndef NDEBUG
 
 #include "thread/Id.hxx"
 
+/**
+ * The thread which holds the exclusive lock.
+ */
 extern ThreadId db_mutex_holder;
 
 /**
- * Does the current thread hold the database lock?
+ * Does the current thread hold a shared lock?
+ */
+extern thread_local bool db_mutex_shared_holder;
+
+/**
+ * Does the current thread hold the database lock (shared or
+ * exclusive)?  This is enough for reading.
  */
 gcc_pure
 static inline bool
 holding_db_lock() noexcept
+{
+	return db_mutex_shared_holder || db_mutex_holder.IsInside();
+}
+
+/**
+ * Does the current thread hold the exclusive database lock?  This
+ * is needed for modifying the database.
+ */
+gcc_pure
+static inline bool
+holding_exclusive_db_lock() noexcept
 {
 	return db_mutex_holder.IsInside();
 }
@@ -52,8 +81,8 @@ holding_db_lock() noexcept
 #endif
 
 /**
- * Obtain the global database lock.  This is needed before
- * dereferencing a #song or #directory.  It is not recursive.
+ * Obtain the exclusive database lock.  This is needed before
+ * modifying a #song or #directory.  It is not recursive.
  */
 static inline void
 db_lock(void)
@@ -69,12 +98,12 @@ db_lock(void)
 }
 
 /**
- * Release the global database lock.
+ * Release the exclusive database lock.
  */
 static inline void
 db_unlock(void)
 {
-	assert(holding_db_lock());
+	assert(holding_exclusive_db_lock());
 #ifndef NDEBUG
 	db_mutex_holder = ThreadId::Null();
 #endif
@@ -82,6 +111,39 @@ db_unlock(void)
 	db_mutex.unlock();
 }
 
+/**
+ * Obtain a shared database lock.  This is needed before
+ * dereferencing a #song or #directory.  It is not recursive.
+ */
+static inline void
+db_lock_shared(void)
+{
+	assert(!holding_db_lock());
+
+	db_mutex.lock_shared();
+
+#ifndef NDEBUG
+	db_mutex_shared_holder = true;
+#endif
+}
+
+/**
+ * Release a shared database lock.
+ */
+static inline void
+db_unlock_shared(void)
+{
+	assert(db_mutex_shared_holder);
+#ifndef NDEBUG
+	db_mutex_shared_holder = false;
+#endif
+
+	db_mutex.unlock_shared();
+}
+
+/**
+ * Obtain the exclusive database lock in the current scope.
+ */
 class ScopeDatabaseLock {
 	bool locked = true;
 
@@ -107,7 +169,34 @@ public:
 };
 
 /**
- * Unlock the database while in the current scope.
+ * Obtain a shared database lock in the current scope.
+ */
+class ScopeDatabaseSharedLock {
+	bool locked = true;
+
+public:
+	ScopeDatabaseSharedLock() {
+		db_lock_shared();
+	}
+
+	~ScopeDatabaseSharedLock() {
+		if (locked)
+			db_unlock_shared();
+	}
+
+	/**
+	 * Unlock the mutex now, making the destructor a no-op.
+	 */
+	void unlock() {
+		assert(locked);
+
+		db_unlock_shared();
+		locked = false;
+	}
+};
+
+/**
+ * Release the exclusive database lock while in the current scope.
  */
 class ScopeDatabaseUnlock {
 public:
@@ -120,4 +209,18 @@ public:
 	}
 };
 
+/**
+ * Release the shared database lock while in the current scope.
+ */
+class ScopeDatabaseSharedUnlock {
+public:
+	ScopeDatabaseSharedUnlock() {
+		db_unlock_shared();
+	}
+
+	~ScopeDatabaseSharedUnlock() {
+		db_lock_shared();
+	}
+};
+
 #endif
@@ -37,7 +37,7 @@ PlaylistVector::find(const char *name) noexcept
 bool
 PlaylistVector::UpdateOrInsert(PlaylistInfo &&pi) noexcept
 {
-	assert(holding_db_lock());
+	assert(holding_exclusive_db_lock());
 
 	auto i = find(pi.name.c_str());
 	if (i != end()) {
@@ -54,7 +54,7 @@ PlaylistVector::UpdateOrInsert(PlaylistInfo &&pi) noexcept
 bool
 PlaylistVector::erase(const char *name) noexcept
 {
-	assert(holding_db_lock());
+	assert(holding_exclusive_db_lock());
 
 	auto i = find(name);
 	if (i == end())
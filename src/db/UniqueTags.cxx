@@ -24,7 +24,7 @@
 #include "util/ConstBuffer.hxx"
 #include "util/RecursiveMap.hxx"
 
-static void
+void
 CollectUniqueTags(RecursiveMap<std::string> &result,
 		  const Tag &tag,
 		  ConstBuffer<TagType> tag_types) noexcept
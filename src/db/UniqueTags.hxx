@@ -26,9 +26,18 @@
 
 class Database;
 struct DatabaseSelection;
+struct Tag;
 template<typename Key> class RecursiveMap;
 template<typename T> struct ConstBuffer;
 
+/**
+ * Add the values of the given #Tag to the map.
+ */
+void
+CollectUniqueTags(RecursiveMap<std::string> &result,
+		  const Tag &tag,
+		  ConstBuffer<TagType> tag_types) noexcept;
+
 /**
  * Walk the database and collect unique tag values.
  */
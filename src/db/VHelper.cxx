@@ -23,10 +23,74 @@
 #include "song/Filter.hxx"
 
 #include <algorithm>
+#include <memory>
+#include <string>
 
 #include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
-#include <string.h>
+
+struct DatabaseVisitorHelper::SortItem {
+	/**
+	 * The numeric sort key; used for #TAG_DISC, #TAG_TRACK and
+	 * #SORT_TAG_LAST_MODIFIED.
+	 */
+	int_least64_t number;
+
+	/**
+	 * The string sort key; used for all other tags.
+	 */
+	std::string string;
+
+	/**
+	 * The position of this song in the visit order; this is the
+	 * last sort criterion, which makes the sort stable.
+	 */
+	unsigned position;
+
+	/**
+	 * The copy is allocated separately, to keep this object
+	 * small, because the sort algorithms move it around a lot.
+	 */
+	std::unique_ptr<DetachedSong> song;
+
+	SortItem(int_least64_t _number, std::string &&_string,
+		 unsigned _position, const LightSong &_song)
+		:number(_number), string(std::move(_string)),
+		 position(_position),
+		 song(std::make_unique<DetachedSong>(_song)) {}
+
+	/**
+	 * Does this item come before the other one in the result?
+	 * This is a strict total order, because two items never have
+	 * the same position.
+	 */
+	gcc_pure
+	bool Before(const SortItem &other,
+		    bool numeric, bool descending) const noexcept {
+		if (numeric) {
+			if (number != other.number)
+				return descending
+					? number > other.number
+					: number < other.number;
+		} else {
+			int cmp = string.compare(other.string);
+			if (cmp != 0)
+				return descending ? cmp > 0 : cmp < 0;
+		}
+
+		return position < other.position;
+	}
+};
+
+gcc_pure
+static bool
+IsNumericSort(TagType type) noexcept
+{
+	return type == TAG_DISC || type == TAG_TRACK ||
+		type == TagType(SORT_TAG_LAST_MODIFIED);
+}
 
 DatabaseVisitorHelper::DatabaseVisitorHelper(const DatabaseSelection &_selection,
 					     VisitSong &visit_song) noexcept
@@ -39,12 +103,14 @@ DatabaseVisitorHelper::DatabaseVisitorHelper(const DatabaseSelection &_selection
 	if (selection.sort != TAG_NUM_OF_ITEM_TYPES) {
 		/* the client has asked us to sort the result; this is
 		   pretty expensive, because instead of streaming the
-		   result to the client, we need to copy it all into
-		   this std::vector, and then sort it */
+		   result to the client, we need to copy it into this
+		   std::vector, and then sort it; if there is a
+		   "window", only the songs which can still be part of
+		   it are kept */
 
 		original_visit_song = std::move(visit_song);
 		visit_song = [this](const auto &song){
-			songs.emplace_back(song);
+			AddSorted(song);
 		};
 	} else if (selection.window != RangeArg::All()) {
 		original_visit_song = std::move(visit_song);
@@ -57,35 +123,60 @@ DatabaseVisitorHelper::DatabaseVisitorHelper(const DatabaseSelection &_selection
 
 DatabaseVisitorHelper::~DatabaseVisitorHelper() noexcept = default;
 
-gcc_pure
-static bool
-CompareNumeric(const char *a, const char *b) noexcept
+void
+DatabaseVisitorHelper::AddSorted(const LightSong &song)
 {
-	long a_value = strtol(a, nullptr, 10);
-	long b_value = strtol(b, nullptr, 10);
+	const auto sort = selection.sort;
+	const bool numeric = IsNumericSort(sort);
 
-	return a_value < b_value;
-}
+	/* calculate the sort key only once for each song, instead
+	   of doing it in each comparison */
+	int_least64_t number = 0;
+	std::string string;
+	if (sort == TagType(SORT_TAG_LAST_MODIFIED))
+		number = song.mtime.time_since_epoch().count();
+	else if (numeric)
+		number = strtol(song.tag.GetSortValue(sort), nullptr, 10);
+	else
+		string = song.tag.GetSortValue(sort);
 
-gcc_pure
-static bool
-CompareTags(TagType type, bool descending, const Tag &a, const Tag &b) noexcept
-{
-	const char *a_value = a.GetSortValue(type);
-	const char *b_value = b.GetSortValue(type);
+	const unsigned position = counter++;
 
-	if (descending) {
-		using std::swap;
-		swap(a_value, b_value);
-	}
+	const auto descending = selection.descending;
+	const auto compare = [numeric, descending](const SortItem &a,
+						   const SortItem &b){
+		return a.Before(b, numeric, descending);
+	};
 
-	switch (type) {
-	case TAG_DISC:
-	case TAG_TRACK:
-		return CompareNumeric(a_value, b_value);
+	const size_t limit = selection.window.end;
+	if (limit == 0)
+		return;
 
-	default:
-		return strcmp(a_value, b_value) < 0;
+	if (limit != RangeArg::All().end && songs.size() < position) {
+		/* songs have been dropped already (see below), and
+		   the last one kept is the worst one which can still
+		   be part of the window; a song which isn't better
+		   can be rejected without copying it (since its
+		   position is larger, it would be sorted after that
+		   one) */
+		const SortItem &worst = songs[limit - 1];
+		if (numeric
+		    ? (descending ? number <= worst.number : number >= worst.number)
+		    : (descending ? string <= worst.string : string >= worst.string))
+			return;
+	}
+
+	songs.emplace_back(number, std::move(string), position, song);
+
+	if (limit != RangeArg::All().end && songs.size() >= limit * 2) {
+		/* the window has an end: move the best "limit" songs
+		   to the front and drop all others, because they
+		   cannot be part of the result; doing this only after
+		   collecting twice as many keeps the cost linear */
+		std::nth_element(songs.begin(),
+				 std::next(songs.begin(), limit - 1),
+				 songs.end(), compare);
+		songs.erase(std::next(songs.begin(), limit), songs.end());
 	}
 }
 
@@ -99,29 +190,21 @@ DatabaseVisitorHelper::Commit()
 	assert(original_visit_song);
 
 	/* sort the song collection */
-	const auto sort = selection.sort;
+	const bool numeric = IsNumericSort(selection.sort);
 	const auto descending = selection.descending;
-
-	if (sort == TagType(SORT_TAG_LAST_MODIFIED))
-		std::stable_sort(songs.begin(), songs.end(),
-				 [descending](const DetachedSong &a, const DetachedSong &b){
-					 return descending
-						 ? a.GetLastModified() > b.GetLastModified()
-						 : a.GetLastModified() < b.GetLastModified();
-				 });
-	else
-		std::stable_sort(songs.begin(), songs.end(),
-				 [sort, descending](const DetachedSong &a,
-						    const DetachedSong &b){
-					 return CompareTags(sort, descending,
-							    a.GetTag(),
-							    b.GetTag());
-				 });
-
-	/* apply the "window" */
-	if (selection.window.end < songs.size())
-		songs.erase(std::next(songs.begin(), selection.window.end),
-			    songs.end());
+	const auto compare = [numeric, descending](const SortItem &a,
+						   const SortItem &b){
+		return a.Before(b, numeric, descending);
+	};
+
+	if (selection.window.end < songs.size()) {
+		/* apply the "window"; only the songs inside it
+		   need to be sorted */
+		const auto end = std::next(songs.begin(), selection.window.end);
+		std::partial_sort(songs.begin(), end, songs.end(), compare);
+		songs.erase(end, songs.end());
+	} else
+		std::sort(songs.begin(), songs.end(), compare);
 
 	if (selection.window.start >= songs.size())
 		return;
@@ -130,6 +213,6 @@ DatabaseVisitorHelper::Commit()
 		    std::next(songs.begin(), selection.window.start));
 
 	/* now pass all songs to the original visitor callback */
-	for (const auto &song : songs)
-		original_visit_song((LightSong)song);
+	for (const auto &i : songs)
+		original_visit_song((LightSong)*i.song);
 }
@@ -39,17 +39,24 @@ class DetachedSong;
 class DatabaseVisitorHelper {
 	const DatabaseSelection selection;
 
+	/**
+	 * A copy of a song with its precomputed sort key.
+	 */
+	struct SortItem;
+
 	/**
 	 * If the plugin can't sort, then this container will collect
 	 * all songs, sort them and report them to the visitor in
-	 * Commit().
+	 * Commit().  If the "window" has an end, songs which cannot
+	 * be part of the result are dropped from time to time.
 	 */
-	std::vector<DetachedSong> songs;
+	std::vector<SortItem> songs;
 
 	VisitSong original_visit_song;
 
 	/**
-	 * Used to emulate the "window".
+	 * Used to emulate the "window".  While sorting, it is the
+	 * position of the next song, which keeps the sort stable.
 	 */
 	unsigned counter = 0;
 
@@ -65,6 +72,9 @@ public:
 	~DatabaseVisitorHelper() noexcept;
 
 	void Commit();
+
+private:
+	void AddSorted(const LightSong &song);
 };
 
 #endif
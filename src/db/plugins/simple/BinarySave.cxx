@@ -0,0 +1,648 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "BinarySave.hxx"
+#include "Directory.hxx"
+#include "Song.hxx"
+#include "AudioFormat.hxx"
+#include "db/DatabaseLock.hxx"
+#include "fs/io/BufferedOutputStream.hxx"
+#include "fs/Charset.hxx"
+#include "tag/Tag.hxx"
+#include "tag/Pool.hxx"
+#include "tag/Settings.hxx"
+#include "time/ChronoUtil.hxx"
+#include "util/ConstBuffer.hxx"
+#include "util/StringView.hxx"
+#include "util/RuntimeError.hxx"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * File layout (native byte order, verified with the "byte_order"
+ * header field):
+ *
+ *   BinaryDatabaseHeader
+ *   BinaryDirectory (root), recursively followed by:
+ *     BinaryPlaylist[n_playlists]
+ *     (BinarySong, uint32_t item_index[n_items])[n_songs]
+ *     BinaryDirectory (child)[n_children] ...
+ *   string table (NUL-terminated strings, referenced by offset)
+ *   BinaryTagItem[n_items]
+ *   BinaryDatabaseTrailer
+ */
+
+static constexpr char BINARY_DB_MAGIC[8] = {
+	'M', 'P', 'D', 'B', 'I', 'N', 'D', 'B',
+};
+
+static constexpr uint32_t BINARY_DB_FORMAT = 1;
+
+static constexpr uint32_t BINARY_DB_BYTE_ORDER = 0x01020304;
+
+static constexpr int64_t BINARY_DB_NO_MTIME = INT64_MIN;
+
+/**
+ * Limit the recursion depth while loading; this is the most a
+ * #PATH_MAX path with single-character names can have.
+ */
+static constexpr unsigned BINARY_DB_MAX_DEPTH = 2048;
+
+static_assert(TAG_NUM_OF_ITEM_TYPES <= 64, "Too many tag types");
+
+struct BinaryDatabaseHeader {
+	char magic[8];
+	uint32_t format;
+	uint32_t byte_order;
+
+	/**
+	 * A bit mask of the #TagType values which were enabled
+	 * while this file was written.
+	 */
+	uint64_t tag_mask;
+};
+
+struct BinaryDatabaseTrailer {
+	uint64_t strings_offset, strings_size;
+	uint64_t items_offset;
+	uint32_t n_items;
+
+	/**
+	 * The filesystem charset (string table offset).
+	 */
+	uint32_t fs_charset;
+
+	char magic[8];
+};
+
+struct BinaryDirectory {
+	int64_t mtime;
+	uint32_t name;
+
+	/**
+	 * One of the DEVICE_* constants or 0.
+	 */
+	uint32_t device;
+
+	uint32_t n_children, n_songs, n_playlists;
+	uint32_t reserved;
+};
+
+struct BinaryPlaylist {
+	int64_t mtime;
+	uint32_t name;
+	uint32_t reserved;
+};
+
+struct BinarySong {
+	int64_t mtime;
+	uint32_t filename;
+
+	/**
+	 * The #Song::target string or #BINARY_DB_NO_STRING.
+	 */
+	uint32_t target;
+
+	uint32_t start_ms, end_ms;
+
+	/**
+	 * The #Tag::duration in milliseconds; negative if unknown.
+	 */
+	int32_t duration_ms;
+
+	uint32_t sample_rate;
+	uint8_t format, channels;
+	uint8_t has_playlist;
+	uint8_t reserved;
+	uint16_t n_items;
+	uint16_t reserved2;
+};
+
+struct BinaryTagItem {
+	uint32_t value;
+	uint8_t type;
+	uint8_t reserved[3];
+};
+
+static_assert(sizeof(BinaryDatabaseHeader) == 24, "Unexpected size");
+static_assert(sizeof(BinaryDatabaseTrailer) == 40, "Unexpected size");
+static_assert(sizeof(BinaryDirectory) == 32, "Unexpected size");
+static_assert(sizeof(BinaryPlaylist) == 16, "Unexpected size");
+static_assert(sizeof(BinarySong) == 40, "Unexpected size");
+static_assert(sizeof(BinaryTagItem) == 8, "Unexpected size");
+
+static constexpr uint32_t BINARY_DB_NO_STRING = UINT32_MAX;
+
+static int64_t
+ExportTime(std::chrono::system_clock::time_point t) noexcept
+{
+	return IsNegative(t)
+		? BINARY_DB_NO_MTIME
+		: int64_t(std::chrono::system_clock::to_time_t(t));
+}
+
+static std::chrono::system_clock::time_point
+ImportTime(int64_t t) noexcept
+{
+	return t == BINARY_DB_NO_MTIME
+		? std::chrono::system_clock::time_point::min()
+		: std::chrono::system_clock::from_time_t(t);
+}
+
+gcc_const
+static uint32_t
+ExportDevice(uint64_t device) noexcept
+{
+	switch (device) {
+	case DEVICE_INARCHIVE:
+	case DEVICE_CONTAINER:
+	case DEVICE_PLAYLIST:
+		return device;
+
+	default:
+		return 0;
+	}
+}
+
+namespace {
+
+class BinaryDatabaseWriter {
+	BufferedOutputStream &os;
+
+	std::string strings;
+	std::unordered_map<std::string, uint32_t> string_ids;
+
+	std::vector<BinaryTagItem> items;
+
+	/**
+	 * Maps (string id << 8 | tag type) to an index in #items.
+	 */
+	std::unordered_map<uint64_t, uint32_t> item_ids;
+
+	uint64_t position = 0;
+
+public:
+	explicit BinaryDatabaseWriter(BufferedOutputStream &_os) noexcept
+		:os(_os) {}
+
+	void WriteHeader();
+	void WriteDirectory(const Directory &directory);
+	void WriteTrailer();
+
+private:
+	template<typename T>
+	void Write(const T &value) {
+		os.Write(&value, sizeof(value));
+		position += sizeof(value);
+	}
+
+	uint32_t MakeString(const std::string &s);
+
+	uint32_t MakeString(const char *s) {
+		return MakeString(std::string(s));
+	}
+
+	uint32_t MakeItem(const TagItem &item);
+
+	void WriteSong(const Song &song);
+};
+
+}
+
+uint32_t
+BinaryDatabaseWriter::MakeString(const std::string &s)
+{
+	auto i = string_ids.emplace(s, strings.size());
+	if (i.second) {
+		if (strings.size() + s.length() + 1 >= BINARY_DB_NO_STRING)
+			throw std::runtime_error("Database too large");
+
+		strings.append(s.c_str(), s.length() + 1);
+	}
+
+	return i.first->second;
+}
+
+uint32_t
+BinaryDatabaseWriter::MakeItem(const TagItem &item)
+{
+	const uint32_t value = MakeString(item.value);
+	const uint64_t key = (uint64_t(value) << 8) | item.type;
+
+	auto i = item_ids.emplace(key, items.size());
+	if (i.second) {
+		BinaryTagItem b{};
+		b.value = value;
+		b.type = item.type;
+		items.push_back(b);
+	}
+
+	return i.first->second;
+}
+
+void
+BinaryDatabaseWriter::WriteHeader()
+{
+	BinaryDatabaseHeader header{};
+	memcpy(header.magic, BINARY_DB_MAGIC, sizeof(header.magic));
+	header.format = BINARY_DB_FORMAT;
+	header.byte_order = BINARY_DB_BYTE_ORDER;
+
+	for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i)
+		if (IsTagEnabled(i))
+			header.tag_mask |= uint64_t(1) << i;
+
+	Write(header);
+}
+
+void
+BinaryDatabaseWriter::WriteSong(const Song &song)
+{
+	const Tag &tag = song.tag;
+
+	BinarySong b{};
+	b.mtime = ExportTime(song.mtime);
+	b.filename = MakeString(song.filename);
+	b.target = song.target.empty()
+		? BINARY_DB_NO_STRING
+		: MakeString(song.target);
+	b.start_ms = song.start_time.ToMS();
+	b.end_ms = song.end_time.ToMS();
+	b.duration_ms = tag.duration.IsNegative()
+		? -1
+		: tag.duration.ToMS();
+
+	if (song.audio_format.IsDefined()) {
+		b.sample_rate = song.audio_format.sample_rate;
+		b.format = uint8_t(song.audio_format.format);
+		b.channels = song.audio_format.channels;
+	}
+
+	b.has_playlist = tag.has_playlist;
+	b.n_items = tag.num_items;
+	Write(b);
+
+	for (const auto &item : tag)
+		Write(MakeItem(item));
+}
+
+void
+BinaryDatabaseWriter::WriteDirectory(const Directory &directory)
+{
+	BinaryDirectory b{};
+	b.mtime = ExportTime(directory.mtime);
+	b.name = MakeString(directory.IsRoot() ? "" : directory.GetName());
+	b.device = ExportDevice(directory.device);
+
+	for (const auto &child : directory.children)
+		if (!child.IsMount())
+			++b.n_children;
+
+	for (gcc_unused const auto &song : directory.songs)
+		++b.n_songs;
+
+	for (gcc_unused const auto &playlist : directory.playlists)
+		++b.n_playlists;
+
+	Write(b);
+
+	for (const auto &playlist : directory.playlists) {
+		BinaryPlaylist p{};
+		p.mtime = ExportTime(playlist.mtime);
+		p.name = MakeString(playlist.name);
+		Write(p);
+	}
+
+	for (const auto &song : directory.songs)
+		WriteSong(song);
+
+	for (const auto &child : directory.children)
+		if (!child.IsMount())
+			WriteDirectory(child);
+}
+
+void
+BinaryDatabaseWriter::WriteTrailer()
+{
+	BinaryDatabaseTrailer trailer{};
+	trailer.fs_charset = MakeString(GetFSCharset());
+
+	trailer.strings_offset = position;
+	trailer.strings_size = strings.size();
+	os.Write(strings.data(), strings.size());
+	position += strings.size();
+
+	trailer.items_offset = position;
+	trailer.n_items = items.size();
+	for (const auto &item : items)
+		Write(item);
+
+	memcpy(trailer.magic, BINARY_DB_MAGIC, sizeof(trailer.magic));
+	Write(trailer);
+}
+
+void
+db_save_binary(BufferedOutputStream &os, const Directory &root)
+{
+	BinaryDatabaseWriter writer(os);
+	writer.WriteHeader();
+	writer.WriteDirectory(root);
+	writer.WriteTrailer();
+}
+
+bool
+db_is_binary(ConstBuffer<void> data) noexcept
+{
+	return data.size >= sizeof(BINARY_DB_MAGIC) &&
+		memcmp(data.data, BINARY_DB_MAGIC,
+		       sizeof(BINARY_DB_MAGIC)) == 0;
+}
+
+namespace {
+
+class BinaryDatabaseReader {
+	const uint8_t *const begin, *const end;
+
+	/**
+	 * The current read position within the directory tree.
+	 */
+	const uint8_t *p;
+
+	/**
+	 * The end of the directory tree, i.e. the beginning of the
+	 * string table.  Reading the tree never goes beyond this.
+	 */
+	const uint8_t *tree_end;
+
+	const char *strings = nullptr;
+	size_t strings_size = 0;
+
+	/**
+	 * The #TagPool references for all entries in the item
+	 * table; each #Song obtains its own reference with
+	 * tag_pool_dup_item().
+	 */
+	std::vector<TagItem *> items;
+
+public:
+	explicit BinaryDatabaseReader(ConstBuffer<void> data) noexcept
+		:begin((const uint8_t *)data.data),
+		 end(begin + data.size),
+		 p(begin), tree_end(end) {}
+
+	~BinaryDatabaseReader() noexcept;
+
+	void ReadHeader();
+	void ReadTrailer();
+	void LoadRoot(Directory &root);
+
+private:
+	[[noreturn]]
+	static void Corrupt() {
+		throw std::runtime_error("Database corrupted");
+	}
+
+	template<typename T>
+	T Read() {
+		if (size_t(tree_end - p) < sizeof(T))
+			Corrupt();
+
+		T value;
+		memcpy(&value, p, sizeof(value));
+		p += sizeof(value);
+		return value;
+	}
+
+	const char *GetString(uint32_t id) const {
+		if (id >= strings_size)
+			Corrupt();
+
+		return strings + id;
+	}
+
+	/**
+	 * Look up the name of a child directory.
+	 */
+	const char *GetDirectoryName(uint32_t id) const {
+		const char *name = GetString(id);
+		if (*name == 0 || strchr(name, '/') != nullptr)
+			Corrupt();
+
+		return name;
+	}
+
+	void LoadSong(Directory &directory);
+	void LoadDirectory(Directory &directory, const BinaryDirectory &b,
+			   unsigned depth);
+};
+
+}
+
+BinaryDatabaseReader::~BinaryDatabaseReader() noexcept
+{
+	for (auto *item : items)
+		tag_pool_put_item(item);
+}
+
+void
+BinaryDatabaseReader::ReadHeader()
+{
+	const auto header = Read<BinaryDatabaseHeader>();
+	if (memcmp(header.magic, BINARY_DB_MAGIC, sizeof(header.magic)) != 0)
+		Corrupt();
+
+	if (header.byte_order != BINARY_DB_BYTE_ORDER)
+		throw std::runtime_error("Database byte order mismatch, "
+					 "discarding database file");
+
+	if (header.format != BINARY_DB_FORMAT)
+		throw std::runtime_error("Database format mismatch, "
+					 "discarding database file");
+
+	for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i)
+		if (IsTagEnabled(i) &&
+		    (header.tag_mask & (uint64_t(1) << i)) == 0)
+			throw std::runtime_error("Tag list mismatch, "
+						 "discarding database file");
+}
+
+void
+BinaryDatabaseReader::ReadTrailer()
+{
+	if (size_t(end - begin) < sizeof(BinaryDatabaseHeader) +
+	    sizeof(BinaryDatabaseTrailer))
+		Corrupt();
+
+	BinaryDatabaseTrailer trailer;
+	memcpy(&trailer, end - sizeof(trailer), sizeof(trailer));
+	if (memcmp(trailer.magic, BINARY_DB_MAGIC, sizeof(trailer.magic)) != 0)
+		Corrupt();
+
+	const uint64_t trailer_offset = end - sizeof(trailer) - begin;
+	if (trailer.strings_offset < uint64_t(p - begin) ||
+	    trailer.strings_offset > trailer.items_offset ||
+	    trailer.strings_size > trailer.items_offset - trailer.strings_offset ||
+	    trailer.items_offset > trailer_offset ||
+	    uint64_t(trailer.n_items) * sizeof(BinaryTagItem) >
+	    trailer_offset - trailer.items_offset)
+		Corrupt();
+
+	tree_end = begin + trailer.strings_offset;
+	strings = (const char *)tree_end;
+	strings_size = trailer.strings_size;
+
+	/* the string table must be terminated, so GetString() needs
+	   to check only the start offset */
+	if (strings_size == 0 || strings[strings_size - 1] != 0)
+		Corrupt();
+
+	const char *new_charset = GetString(trailer.fs_charset);
+	const char *const old_charset = GetFSCharset();
+	if (*old_charset != 0 && strcmp(new_charset, old_charset) != 0)
+		throw FormatRuntimeError("Existing database has charset "
+					 "\"%s\" instead of \"%s\"; "
+					 "discarding database file",
+					 new_charset, old_charset);
+
+	const uint8_t *i = begin + trailer.items_offset;
+	items.reserve(trailer.n_items);
+
+	for (unsigned n = 0; n < trailer.n_items; ++n, i += sizeof(BinaryTagItem)) {
+		BinaryTagItem b;
+		memcpy(&b, i, sizeof(b));
+
+		if (b.type >= TAG_NUM_OF_ITEM_TYPES || b.value >= strings_size)
+			Corrupt();
+
+		items.push_back(tag_pool_get_item(TagType(b.type),
+						  strings + b.value));
+	}
+}
+
+inline void
+BinaryDatabaseReader::LoadSong(Directory &directory)
+{
+	const auto b = Read<BinarySong>();
+
+	auto song = std::make_unique<Song>(GetString(b.filename), directory);
+	song->mtime = ImportTime(b.mtime);
+	song->start_time = SongTime::FromMS(b.start_ms);
+	song->end_time = SongTime::FromMS(b.end_ms);
+
+	if (b.target != BINARY_DB_NO_STRING)
+		song->target = GetString(b.target);
+
+	if (b.sample_rate > 0) {
+		const auto format = SampleFormat(b.format);
+		if (!audio_valid_sample_rate(b.sample_rate) ||
+		    !audio_valid_sample_format(format) ||
+		    !audio_valid_channel_count(b.channels))
+			Corrupt();
+
+		song->audio_format = AudioFormat(b.sample_rate, format,
+						 b.channels);
+	}
+
+	Tag &tag = song->tag;
+	if (b.duration_ms >= 0)
+		tag.duration = SignedSongTime::FromMS(b.duration_ms);
+	tag.has_playlist = b.has_playlist;
+
+	if (b.n_items > 0) {
+		if (size_t(tree_end - p) < b.n_items * sizeof(uint32_t))
+			Corrupt();
+
+		tag.items = new TagItem *[b.n_items];
+
+		for (unsigned i = 0; i < b.n_items; ++i) {
+			uint32_t index;
+			memcpy(&index, p, sizeof(index));
+			p += sizeof(index);
+
+			if (index >= items.size())
+				Corrupt();
+
+			tag.items[tag.num_items++] =
+				tag_pool_dup_item(items[index]);
+		}
+	}
+
+	directory.AddSong(std::move(song));
+}
+
+void
+BinaryDatabaseReader::LoadDirectory(Directory &directory,
+				    const BinaryDirectory &b, unsigned depth)
+{
+	if (b.device != ExportDevice(b.device))
+		Corrupt();
+
+	directory.mtime = ImportTime(b.mtime);
+	directory.device = b.device;
+
+	for (unsigned i = 0; i < b.n_playlists; ++i) {
+		const auto playlist = Read<BinaryPlaylist>();
+		directory.playlists.push_back(PlaylistInfo(GetString(playlist.name),
+							   ImportTime(playlist.mtime)));
+	}
+
+	for (unsigned i = 0; i < b.n_songs; ++i)
+		LoadSong(directory);
+
+	if (b.n_children > 0 && depth >= BINARY_DB_MAX_DEPTH)
+		Corrupt();
+
+	for (unsigned i = 0; i < b.n_children; ++i) {
+		const auto child = Read<BinaryDirectory>();
+		const char *name = GetDirectoryName(child.name);
+		if (directory.FindChild(name) != nullptr)
+			/* duplicate subdirectory */
+			Corrupt();
+
+		LoadDirectory(*directory.CreateChild(name), child, depth + 1);
+	}
+}
+
+void
+BinaryDatabaseReader::LoadRoot(Directory &root)
+{
+	const auto b = Read<BinaryDirectory>();
+	LoadDirectory(root, b, 0);
+
+	if (p != tree_end)
+		Corrupt();
+	root.mtime = std::chrono::system_clock::time_point::min();
+	root.device = 0;
+}
+
+void
+db_load_binary(ConstBuffer<void> data, Directory &root)
+{
+	BinaryDatabaseReader reader(data);
+	reader.ReadHeader();
+	reader.ReadTrailer();
+
+	const ScopeDatabaseLock protect;
+	reader.LoadRoot(root);
+}
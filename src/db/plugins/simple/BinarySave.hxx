@@ -0,0 +1,52 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_DATABASE_BINARY_SAVE_HXX
+#define MPD_DATABASE_BINARY_SAVE_HXX
+
+#include "util/Compiler.h"
+
+struct Directory;
+class BufferedOutputStream;
+template<typename T> struct ConstBuffer;
+
+/**
+ * Serialize the database into the binary format.  Unlike the text
+ * format, it stores each string only once in a string table which
+ * is referenced by offset, and each distinct tag item only once in
+ * an item table, so it can be loaded from a read-only mmap() without
+ * any parsing and with one #TagPool lookup per distinct tag value.
+ */
+void
+db_save_binary(BufferedOutputStream &os, const Directory &root);
+
+/**
+ * Does the given file contents look like a binary database?
+ */
+gcc_pure
+bool
+db_is_binary(ConstBuffer<void> data) noexcept;
+
+/**
+ * Throws #std::runtime_error on error.
+ */
+void
+db_load_binary(ConstBuffer<void> data, Directory &root);
+
+#endif
@@ -18,6 +18,7 @@
  */
 
 #include "Directory.hxx"
+#include "TagIndex.hxx"
 #include "SongSort.hxx"
 #include "Song.hxx"
 #include "Mount.hxx"
@@ -50,6 +51,10 @@ Directory::~Directory() noexcept
 		mounted_database.reset();
 	}
 
+	if (tag_index != nullptr)
+		for (const auto &song : songs)
+			tag_index->Remove(song);
+
 	songs.clear_and_dispose(DeleteDisposer());
 	children.clear_and_dispose(DeleteDisposer());
 }
@@ -57,9 +62,11 @@ Directory::~Directory() noexcept
 void
 Directory::Delete() noexcept
 {
-	assert(holding_db_lock());
+	assert(holding_exclusive_db_lock());
 	assert(parent != nullptr);
 
+	parent->MarkModified();
+	parent->child_index.Erase(*this);
 	parent->children.erase_and_dispose(parent->children.iterator_to(*this),
 					   DeleteDisposer());
 }
@@ -75,7 +82,7 @@ Directory::GetName() const noexcept
 Directory *
 Directory::CreateChild(const char *name_utf8) noexcept
 {
-	assert(holding_db_lock());
+	assert(holding_exclusive_db_lock());
 	assert(name_utf8 != nullptr);
 	assert(*name_utf8 != 0);
 
@@ -84,7 +91,10 @@ Directory::CreateChild(const char *name_utf8) noexcept
 		: PathTraitsUTF8::Build(GetPath(), name_utf8);
 
 	Directory *child = new Directory(std::move(path_utf8), this);
+	child->tag_index = tag_index;
 	children.push_back(*child);
+	child_index.Insert(*child, children);
+	MarkModified();
 	return child;
 }
 
@@ -93,6 +103,9 @@ Directory::FindChild(const char *name) const noexcept
 {
 	assert(holding_db_lock());
 
+	if (child_index.IsEnabled())
+		return child_index.Find(name);
+
 	for (const auto &child : children)
 		if (strcmp(child.GetName(), name) == 0)
 			return &child;
@@ -103,16 +116,18 @@ Directory::FindChild(const char *name) const noexcept
 void
 Directory::PruneEmpty() noexcept
 {
-	assert(holding_db_lock());
+	assert(holding_exclusive_db_lock());
 
 	for (auto child = children.begin(), end = children.end();
 	     child != end;) {
 		child->PruneEmpty();
 
-		if (child->IsEmpty() && !child->IsMount())
+		if (child->IsEmpty() && !child->IsMount()) {
+			child_index.Erase(*child);
 			child = children.erase_and_dispose(child,
 							   DeleteDisposer());
-		else
+			MarkModified();
+		} else
 			++child;
 	}
 }
@@ -165,30 +180,52 @@ Directory::LookupDirectory(const char *uri) noexcept
 void
 Directory::AddSong(SongPtr song) noexcept
 {
-	assert(holding_db_lock());
+	assert(holding_exclusive_db_lock());
 	assert(song != nullptr);
 	assert(&song->parent == this);
 
-	songs.push_back(*song.release());
+	Song &s = *song.release();
+	songs.push_back(s);
+	song_index.Insert(s, songs);
+	if (tag_index != nullptr)
+		tag_index->Add(s);
+	MarkModified();
 }
 
 SongPtr
 Directory::RemoveSong(Song *song) noexcept
 {
-	assert(holding_db_lock());
+	assert(holding_exclusive_db_lock());
 	assert(song != nullptr);
 	assert(&song->parent == this);
 
+	song_index.Erase(*song);
+	if (tag_index != nullptr)
+		tag_index->Remove(*song);
 	songs.erase(songs.iterator_to(*song));
+	MarkModified();
 	return SongPtr(song);
 }
 
+void
+Directory::ReindexSong(const Song &song, const Tag &old_tag) noexcept
+{
+	assert(holding_exclusive_db_lock());
+	assert(&song.parent == this);
+
+	if (tag_index != nullptr)
+		tag_index->Update(song, old_tag);
+}
+
 const Song *
 Directory::FindSong(const char *name_utf8) const noexcept
 {
 	assert(holding_db_lock());
 	assert(name_utf8 != nullptr);
 
+	if (song_index.IsEnabled())
+		return song_index.Find(name_utf8);
+
 	for (auto &song : songs) {
 		assert(&song.parent == this);
 
@@ -207,12 +244,18 @@ directory_cmp(const Directory &a, const Directory &b) noexcept
 }
 
 void
-Directory::Sort() noexcept
+Directory::SortEntries() noexcept
 {
-	assert(holding_db_lock());
+	assert(holding_exclusive_db_lock());
 
 	children.sort(directory_cmp);
 	song_list_sort(songs);
+}
+
+void
+Directory::Sort() noexcept
+{
+	SortEntries();
 
 	for (auto &child : children)
 		child.Sort();
@@ -229,7 +272,7 @@ Directory::Walk(bool recursive, const SongFilter *filter,
 		/* TODO: eliminate this unlock/lock; it is necessary
 		   because the child's SimpleDatabasePlugin::Visit()
 		   call will lock it again */
-		const ScopeDatabaseUnlock unlock;
+		const ScopeDatabaseSharedUnlock unlock;
 		WalkMount(GetPath(), *mounted_database,
 			  "", DatabaseSelection("", recursive, filter),
 			  visit_directory, visit_song,
@@ -21,6 +21,7 @@
 #define MPD_DIRECTORY_HXX
 
 #include "Ptr.hxx"
+#include "NameIndex.hxx"
 #include "util/Compiler.h"
 #include "db/Visitor.hxx"
 #include "db/PlaylistVector.hxx"
@@ -51,6 +52,7 @@ static constexpr unsigned DEVICE_CONTAINER = -2;
 static constexpr unsigned DEVICE_PLAYLIST = -3;
 
 class SongFilter;
+class TagIndex;
 
 struct Directory {
 	static constexpr auto link_mode = boost::intrusive::normal_link;
@@ -88,10 +90,39 @@ struct Directory {
 	 */
 	SongList songs;
 
+	struct GetChildName {
+		const char *operator()(const Directory &child) const noexcept {
+			return child.GetName();
+		}
+	};
+
+	struct GetSongName {
+		const char *operator()(const Song &song) const noexcept {
+			return song.filename.c_str();
+		}
+	};
+
+	/**
+	 * Name indexes for #children and #songs, which speed up
+	 * FindChild() and FindSong() in large directories.
+	 *
+	 * This attribute is protected with the global #db_mutex.
+	 * Read access in the update thread does not need protection.
+	 */
+	NameIndex<Directory, GetChildName> child_index;
+	NameIndex<Song, GetSongName> song_index;
+
 	PlaylistVector playlists;
 
 	Directory *const parent;
 
+	/**
+	 * The #TagIndex which indexes the songs of this directory.
+	 * This is nullptr if the database has no tag index.  It is
+	 * inherited by new child directories.
+	 */
+	TagIndex *tag_index = nullptr;
+
 	std::chrono::system_clock::time_point mtime =
 		std::chrono::system_clock::time_point::min();
 
@@ -99,6 +130,18 @@ struct Directory {
 
 	const std::string path;
 
+	/**
+	 * Was this directory (its attributes, its songs, its
+	 * playlists or the set of its children) modified since the
+	 * database was last saved?  New objects start out modified.
+	 * This is used by the database journal to write only what
+	 * has changed.
+	 *
+	 * This attribute is protected with the global #db_mutex.
+	 * Read access in the update thread does not need protection.
+	 */
+	bool modified = true;
+
 	/**
 	 * If this is not nullptr, then this directory does not really
 	 * exist, but is a mount point for another #Database.
@@ -131,18 +174,25 @@ public:
 		return mounted_database != nullptr;
 	}
 
+	/**
+	 * Caller must lock the #db_mutex exclusively.
+	 */
+	void MarkModified() noexcept {
+		modified = true;
+	}
+
 	/**
 	 * Remove this #Directory object from its parent and free it.  This
 	 * must not be called with the root Directory.
 	 *
-	 * Caller must lock the #db_mutex.
+	 * Caller must lock the #db_mutex exclusively.
 	 */
 	void Delete() noexcept;
 
 	/**
 	 * Create a new #Directory object as a child of the given one.
 	 *
-	 * Caller must lock the #db_mutex.
+	 * Caller must lock the #db_mutex exclusively.
 	 *
 	 * @param name_utf8 the UTF-8 encoded name of the new sub directory
 	 */
@@ -164,7 +214,7 @@ public:
 	 * Look up a sub directory, and create the object if it does not
 	 * exist.
 	 *
-	 * Caller must lock the #db_mutex.
+	 * Caller must lock the #db_mutex exclusively.
 	 */
 	Directory *MakeChild(const char *name_utf8) noexcept {
 		Directory *child = FindChild(name_utf8);
@@ -269,14 +319,33 @@ public:
 	SongPtr RemoveSong(Song *song) noexcept;
 
 	/**
-	 * Caller must lock the #db_mutex.
+	 * Update the #tag_index after the tag of one of this
+	 * directory's songs has been modified.
+	 *
+	 * Caller must lock the #db_mutex exclusively.
+	 *
+	 * @param old_tag a copy of the song's tag before it was
+	 * modified
+	 */
+	void ReindexSong(const Song &song, const Tag &old_tag) noexcept;
+
+	/**
+	 * Caller must lock the #db_mutex exclusively.
 	 */
 	void PruneEmpty() noexcept;
 
+	/**
+	 * Sort the songs and child directories of this directory,
+	 * but not the contents of the children.
+	 *
+	 * Caller must lock the #db_mutex exclusively.
+	 */
+	void SortEntries() noexcept;
+
 	/**
 	 * Sort all directory entries recursively.
 	 *
-	 * Caller must lock the #db_mutex.
+	 * Caller must lock the #db_mutex exclusively.
 	 */
 	void Sort() noexcept;
 
@@ -39,8 +39,7 @@
 #define DIRECTORY_BEGIN "begin: "
 #define DIRECTORY_END "end: "
 
-gcc_const
-static const char *
+const char *
 DeviceToTypeString(unsigned device) noexcept
 {
 	switch (device) {
@@ -58,8 +57,7 @@ DeviceToTypeString(unsigned device) noexcept
 	}
 }
 
-gcc_pure
-static unsigned
+unsigned
 ParseTypeString(const char *type) noexcept
 {
 	if (StringIsEqual(type, "archive"))
@@ -20,10 +20,28 @@
 #ifndef MPD_DIRECTORY_SAVE_HXX
 #define MPD_DIRECTORY_SAVE_HXX
 
+#include "util/Compiler.h"
+
 struct Directory;
 class TextFile;
 class BufferedOutputStream;
 
+/**
+ * Convert one of the DEVICE_* constants to the string used in the
+ * "type" line.  Returns nullptr for regular directories.
+ */
+gcc_const
+const char *
+DeviceToTypeString(unsigned device) noexcept;
+
+/**
+ * The reverse of DeviceToTypeString().  Returns 0 if the string is
+ * not recognized.
+ */
+gcc_pure
+unsigned
+ParseTypeString(const char *type) noexcept;
+
 void
 directory_save(BufferedOutputStream &os, const Directory &directory);
 
@@ -0,0 +1,321 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Journal.hxx"
+#include "DirectorySave.hxx"
+#include "Directory.hxx"
+#include "Song.hxx"
+#include "SongSave.hxx"
+#include "PlaylistDatabase.hxx"
+#include "song/DetachedSong.hxx"
+#include "db/DatabaseLock.hxx"
+#include "fs/io/TextFile.hxx"
+#include "fs/io/BufferedOutputStream.hxx"
+#include "time/ChronoUtil.hxx"
+#include "util/StringAPI.hxx"
+#include "util/StringCompare.hxx"
+#include "util/NumberParser.hxx"
+#include "util/RuntimeError.hxx"
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <assert.h>
+#include <string.h>
+
+#define JOURNAL_BEGIN "journal_begin"
+#define JOURNAL_COMMIT "journal_commit"
+#define JOURNAL_DIRECTORY "directory_replace: "
+#define JOURNAL_DIRECTORY_END "directory_replace_end"
+#define JOURNAL_CHILD "child: "
+#define JOURNAL_TYPE "type: "
+#define JOURNAL_MTIME "mtime: "
+
+void
+journal_sort_modified(Directory &directory) noexcept
+{
+	assert(holding_exclusive_db_lock());
+
+	if (directory.modified)
+		directory.SortEntries();
+
+	for (auto &child : directory.children)
+		journal_sort_modified(child);
+}
+
+void
+journal_clear_modified(Directory &directory) noexcept
+{
+	assert(holding_exclusive_db_lock());
+
+	directory.modified = false;
+
+	for (auto &child : directory.children)
+		journal_clear_modified(child);
+}
+
+static void
+journal_save_directory(BufferedOutputStream &os, const Directory &directory)
+{
+	os.Format(JOURNAL_DIRECTORY "%s\n", directory.GetPath());
+
+	const char *type = DeviceToTypeString(directory.device);
+	if (type != nullptr)
+		os.Format(JOURNAL_TYPE "%s\n", type);
+
+	if (!IsNegative(directory.mtime))
+		os.Format(JOURNAL_MTIME "%lu\n",
+			  (unsigned long)std::chrono::system_clock::to_time_t(directory.mtime));
+
+	for (const auto &child : directory.children)
+		if (!child.IsMount())
+			os.Format(JOURNAL_CHILD "%s\n", child.GetName());
+
+	for (const auto &song : directory.songs)
+		song_save(os, song);
+
+	playlist_vector_save(os, directory.playlists);
+
+	os.Format(JOURNAL_DIRECTORY_END "\n");
+}
+
+static unsigned
+journal_save_modified(BufferedOutputStream &os, Directory &directory)
+{
+	if (directory.IsMount())
+		return 0;
+
+	unsigned n = 0;
+	if (directory.modified) {
+		journal_save_directory(os, directory);
+		directory.modified = false;
+		++n;
+	}
+
+	for (auto &child : directory.children)
+		n += journal_save_modified(os, child);
+
+	return n;
+}
+
+unsigned
+journal_save(BufferedOutputStream &os, Directory &root)
+{
+	assert(holding_exclusive_db_lock());
+
+	os.Format(JOURNAL_BEGIN "\n");
+	const unsigned n = journal_save_modified(os, root);
+	os.Format(JOURNAL_COMMIT "\n");
+	return n;
+}
+
+/**
+ * Look up a directory by its path, creating all missing path
+ * segments.
+ *
+ * Caller must lock the #db_mutex.
+ */
+static Directory &
+journal_make_directory(Directory &root, const char *path)
+{
+	Directory *directory = &root;
+
+	while (*path != 0) {
+		const char *slash = strchr(path, '/');
+		const std::string name = slash != nullptr
+			? std::string(path, slash)
+			: std::string(path);
+		if (name.empty())
+			throw FormatRuntimeError("Malformed path: %s", path);
+
+		directory = directory->MakeChild(name.c_str());
+		if (slash == nullptr)
+			break;
+
+		path = slash + 1;
+	}
+
+	return *directory;
+}
+
+struct JournalSong {
+	DetachedSong song;
+	std::string target;
+	AudioFormat audio_format;
+};
+
+/**
+ * A parsed "directory_replace" record.
+ */
+struct JournalDirectory {
+	std::string path;
+	std::chrono::system_clock::time_point mtime =
+		std::chrono::system_clock::time_point::min();
+	unsigned device = 0;
+	std::set<std::string> children;
+	std::vector<JournalSong> songs;
+	PlaylistVector playlists;
+
+	explicit JournalDirectory(const char *_path) noexcept
+		:path(_path) {}
+};
+
+/**
+ * Parse the rest of one "directory_replace" record.
+ *
+ * @return false if the file ended before the record was complete
+ */
+static bool
+journal_load_directory(TextFile &file, JournalDirectory &record)
+{
+	const char *line;
+	while (true) {
+		line = file.ReadLine();
+		if (line == nullptr)
+			return false;
+
+		if (StringIsEqual(line, JOURNAL_DIRECTORY_END))
+			return true;
+
+		const char *p;
+		if ((p = StringAfterPrefix(line, JOURNAL_MTIME))) {
+			const auto value = ParseUint64(p);
+			if (value > 0)
+				record.mtime = std::chrono::system_clock::from_time_t(value);
+		} else if ((p = StringAfterPrefix(line, JOURNAL_TYPE))) {
+			record.device = ParseTypeString(p);
+		} else if ((p = StringAfterPrefix(line, JOURNAL_CHILD))) {
+			record.children.emplace(p);
+		} else if ((p = StringAfterPrefix(line, SONG_BEGIN))) {
+			const std::string name(p);
+
+			std::string target;
+			auto audio_format = AudioFormat::Undefined();
+			auto detached_song = song_load(file, name.c_str(),
+						       &target,
+						       &audio_format);
+			record.songs.push_back({std::move(detached_song),
+						std::move(target),
+						audio_format});
+		} else if ((p = StringAfterPrefix(line, PLAYLIST_META_BEGIN))) {
+			const std::string name(p);
+			playlist_metadata_load(file, record.playlists,
+					       name.c_str());
+		} else {
+			throw FormatRuntimeError("Malformed line: %s", line);
+		}
+	}
+}
+
+/**
+ * Replace a directory with the contents of a record.
+ *
+ * Caller must lock the #db_mutex.
+ */
+static void
+journal_apply_directory(Directory &root, JournalDirectory &&record)
+{
+	Directory &directory = journal_make_directory(root,
+						      record.path.c_str());
+	directory.mtime = record.mtime;
+	directory.device = record.device;
+
+	const auto &children = record.children;
+	directory.ForEachChildSafe([&children](Directory &child){
+			if (!child.IsMount() &&
+			    children.find(child.GetName()) == children.end())
+				child.Delete();
+		});
+
+	for (const auto &name : children)
+		directory.MakeChild(name.c_str());
+
+	directory.ForEachSongSafe([&directory](Song &song){
+			directory.RemoveSong(&song);
+		});
+
+	for (auto &i : record.songs) {
+		auto song = std::make_unique<Song>(std::move(i.song),
+						   directory);
+		song->target = std::move(i.target);
+		song->audio_format = i.audio_format;
+		directory.AddSong(std::move(song));
+	}
+
+	directory.playlists = std::move(record.playlists);
+}
+
+bool
+journal_load(TextFile &file, Directory &root)
+{
+	/* the records of the current transaction; they are applied
+	   only when its "commit" line has been read, so a
+	   transaction which was interrupted (e.g. by a crash) is
+	   discarded completely */
+	std::vector<JournalDirectory> transaction;
+	bool in_transaction = false;
+
+	const char *line;
+	while ((line = file.ReadLine()) != nullptr) {
+		const char *p;
+		if (StringIsEqual(line, JOURNAL_BEGIN)) {
+			/* a "begin" without "commit" before it: the
+			   previous append has failed */
+			transaction.clear();
+			in_transaction = true;
+		} else if (StringIsEqual(line, JOURNAL_COMMIT)) {
+			if (!in_transaction)
+				throw std::runtime_error("Commit without begin");
+
+			const ScopeDatabaseLock protect;
+			for (auto &record : transaction)
+				journal_apply_directory(root,
+							std::move(record));
+
+			transaction.clear();
+			in_transaction = false;
+		} else if ((p = StringAfterPrefix(line, JOURNAL_DIRECTORY))) {
+			if (!in_transaction)
+				throw std::runtime_error("Record outside of a transaction");
+
+			transaction.emplace_back(p);
+
+			try {
+				if (!journal_load_directory(file,
+							    transaction.back()))
+					return false;
+			} catch (...) {
+				/* the last line was cut off */
+				if (file.ReadLine() == nullptr)
+					return false;
+				throw;
+			}
+		} else {
+			const auto error =
+				FormatRuntimeError("Malformed line: %s", line);
+			if (file.ReadLine() == nullptr)
+				/* the last line was cut off */
+				return false;
+			throw error;
+		}
+	}
+
+	return !in_transaction;
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_DATABASE_JOURNAL_HXX
+#define MPD_DATABASE_JOURNAL_HXX
+
+struct Directory;
+class BufferedOutputStream;
+class TextFile;
+
+/*
+ * The database journal is an append-only text file next to the
+ * database file.  Each save appends one transaction which contains
+ * a complete snapshot of every #Directory that was modified since
+ * the previous save (its attributes, songs, playlists and the names
+ * of its children).  Records replace the whole directory when
+ * replayed, therefore replaying a record twice is harmless, and the
+ * journal can be compacted into the database file at any time.
+ */
+
+/**
+ * Sort the entries of all modified directories (see
+ * Directory::modified).
+ *
+ * Caller must lock the #db_mutex.
+ */
+void
+journal_sort_modified(Directory &root) noexcept;
+
+/**
+ * Forget which directories have been modified.  This must be called
+ * after the whole tree has been saved or loaded.
+ *
+ * Caller must lock the #db_mutex.
+ */
+void
+journal_clear_modified(Directory &root) noexcept;
+
+/**
+ * Append one transaction with all modified directories and clear
+ * their "modified" flags.  To avoid disk I/O while holding the lock,
+ * #os should write to memory.
+ *
+ * Caller must lock the #db_mutex.
+ *
+ * @return the number of directory records written
+ */
+unsigned
+journal_save(BufferedOutputStream &os, Directory &root);
+
+/**
+ * Replay all records from the journal into the given tree.  The
+ * records of a transaction are applied (with the #db_mutex locked)
+ * only after its commit line has been read; an incomplete
+ * transaction at the end (including a line which was cut off) is
+ * discarded.
+ *
+ * Throws #std::runtime_error on error.
+ *
+ * @return false if the journal ends with an incomplete transaction
+ * (e.g. after a crash), which means it should be compacted soon
+ */
+bool
+journal_load(TextFile &file, Directory &root);
+
+#endif
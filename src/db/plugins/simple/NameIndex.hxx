@@ -0,0 +1,216 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_DB_SIMPLE_NAME_INDEX_HXX
+#define MPD_DB_SIMPLE_NAME_INDEX_HXX
+
+#include "util/Compiler.h"
+
+#include <memory>
+#include <string_view>
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * An index which looks up the entries of an (intrusive) list by
+ * name.  It does not own the entries; the owner of the list must
+ * call Insert() and Erase() whenever it modifies the list.
+ *
+ * Small lists are not indexed at all, because a linear search is
+ * cheaper there; the hash table is built only after the list has
+ * grown to #THRESHOLD entries, and it is freed when the list shrinks
+ * well below that.  Until then, IsEnabled() returns false and the
+ * caller is supposed to search the list.
+ *
+ * The hash table uses open addressing with linear probing and
+ * backward shift deletion, so it needs neither tombstones nor a
+ * per-entry allocation.
+ *
+ * @param T the entry type
+ * @param GetName a function object which returns the name of an
+ * entry as a null-terminated string
+ */
+template<typename T, typename GetName>
+class NameIndex {
+	struct Slot {
+		T *item;
+		size_t hash;
+	};
+
+	std::unique_ptr<Slot[]> slots;
+
+	/**
+	 * The number of slots minus one (the number of slots is
+	 * always a power of two).  Only valid if #slots is set.
+	 */
+	size_t mask = 0;
+
+	/**
+	 * The number of entries in the list.  This is maintained
+	 * even while the index is disabled, to decide when to build
+	 * it.
+	 */
+	size_t n_items = 0;
+
+public:
+	static constexpr size_t THRESHOLD = 32;
+
+	NameIndex() noexcept = default;
+
+	NameIndex(const NameIndex &) = delete;
+	NameIndex &operator=(const NameIndex &) = delete;
+
+	bool IsEnabled() const noexcept {
+		return slots != nullptr;
+	}
+
+	size_t GetItemCount() const noexcept {
+		return n_items;
+	}
+
+	/**
+	 * Notify the index that an entry was added to the list.
+	 *
+	 * @param list the list which already contains the new entry;
+	 * it is used to build the index when #THRESHOLD is reached
+	 */
+	template<typename L>
+	void Insert(T &item, L &list) noexcept {
+		++n_items;
+
+		if (IsEnabled()) {
+			if (n_items * 4 > (mask + 1) * 3)
+				Resize((mask + 1) * 2);
+
+			Add(item, Hash(GetName()(item)));
+		} else if (n_items >= THRESHOLD)
+			Build(list);
+	}
+
+	/**
+	 * Notify the index that an entry is about to be removed from
+	 * the list.
+	 */
+	void Erase(const T &item) noexcept {
+		assert(n_items > 0);
+
+		--n_items;
+
+		if (!IsEnabled())
+			return;
+
+		if (n_items < THRESHOLD / 2) {
+			slots.reset();
+			return;
+		}
+
+		size_t i = Hash(GetName()(item)) & mask;
+		while (slots[i].item != &item) {
+			assert(slots[i].item != nullptr);
+			i = (i + 1) & mask;
+		}
+
+		/* close the gap by moving back all following entries
+		   of this probe sequence which are allowed to live
+		   here */
+		for (size_t j = i;;) {
+			j = (j + 1) & mask;
+			if (slots[j].item == nullptr)
+				break;
+
+			const size_t k = slots[j].hash & mask;
+			if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+				/* its home slot is after the gap */
+				continue;
+
+			slots[i] = slots[j];
+			i = j;
+		}
+
+		slots[i].item = nullptr;
+	}
+
+	/**
+	 * Look up an entry by its name.  May only be called if
+	 * IsEnabled() returns true.
+	 */
+	gcc_pure
+	T *Find(const char *name) const noexcept {
+		assert(IsEnabled());
+
+		const size_t hash = Hash(name);
+		for (size_t i = hash & mask;; i = (i + 1) & mask) {
+			const Slot &slot = slots[i];
+			if (slot.item == nullptr)
+				return nullptr;
+
+			if (slot.hash == hash &&
+			    strcmp(GetName()(*slot.item), name) == 0)
+				return slot.item;
+		}
+	}
+
+private:
+	gcc_pure
+	static size_t Hash(const char *name) noexcept {
+		return std::hash<std::string_view>()(name);
+	}
+
+	void Add(T &item, size_t hash) noexcept {
+		size_t i = hash & mask;
+		while (slots[i].item != nullptr)
+			i = (i + 1) & mask;
+
+		slots[i] = {&item, hash};
+	}
+
+	void Allocate(size_t n_slots) noexcept {
+		assert((n_slots & (n_slots - 1)) == 0);
+
+		slots.reset(new Slot[n_slots]());
+		mask = n_slots - 1;
+	}
+
+	void Resize(size_t n_slots) noexcept {
+		const auto old_slots = std::move(slots);
+		const size_t old_n_slots = mask + 1;
+
+		Allocate(n_slots);
+
+		for (size_t i = 0; i < old_n_slots; ++i)
+			if (old_slots[i].item != nullptr)
+				Add(*old_slots[i].item, old_slots[i].hash);
+	}
+
+	template<typename L>
+	void Build(L &list) noexcept {
+		size_t n_slots = THRESHOLD * 2;
+		while (n_slots < n_items * 2)
+			n_slots *= 2;
+
+		Allocate(n_slots);
+
+		for (auto &i : list)
+			Add(i, Hash(GetName()(i)));
+	}
+};
+
+#endif
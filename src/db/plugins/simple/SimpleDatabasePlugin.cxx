@@ -31,15 +31,25 @@
 #include "Directory.hxx"
 #include "Song.hxx"
 #include "DatabaseSave.hxx"
+#include "TagIndex.hxx"
+#include "BinarySave.hxx"
+#include "Journal.hxx"
 #include "db/DatabaseLock.hxx"
 #include "db/DatabaseError.hxx"
+#include "song/Filter.hxx"
 #include "fs/io/TextFile.hxx"
+#include "fs/io/FileReader.hxx"
+#include "fs/io/MappedFile.hxx"
 #include "fs/io/BufferedOutputStream.hxx"
 #include "fs/io/FileOutputStream.hxx"
+#include "fs/io/StringOutputStream.hxx"
 #include "fs/FileInfo.hxx"
 #include "config/Block.hxx"
 #include "fs/FileSystem.hxx"
+#include "fs/Traits.hxx"
 #include "util/CharUtil.hxx"
+#include "util/StringAPI.hxx"
+#include "util/RuntimeError.hxx"
 #include "util/Domain.hxx"
 #include "util/ConstBuffer.hxx"
 #include "util/RecursiveMap.hxx"
@@ -61,29 +71,48 @@ inline SimpleDatabase::SimpleDatabase(const ConfigBlock &block)
 #ifdef ENABLE_ZLIB
 	 compress(block.GetBlockValue("compress", true)),
 #endif
+	 journal_path(nullptr),
 	 cache_path(block.GetPath("cache_directory"))
 {
 	if (path.IsNull())
 		throw std::runtime_error("No \"path\" parameter specified");
 
 	path_utf8 = path.ToUTF8();
+
+	const char *format = block.GetBlockValue("format", "text");
+	if (StringIsEqual(format, "binary"))
+		binary = true;
+	else if (!StringIsEqual(format, "text"))
+		throw FormatRuntimeError("Unsupported database format: %s",
+					 format);
+
+	journal = block.GetBlockValue("journal", false);
+	index_tags = block.GetBlockValue("tag_index", false);
+	if (journal)
+		journal_path = AllocatedPath::FromFS(PathTraitsFS::string(path.c_str()) +
+						     PATH_LITERAL(".journal"));
 }
 
 inline SimpleDatabase::SimpleDatabase(AllocatedPath &&_path,
 #ifndef ENABLE_ZLIB
 				      gcc_unused
 #endif
-				      bool _compress) noexcept
+				      bool _compress,
+				      bool _binary) noexcept
 	:Database(simple_db_plugin),
 	 path(std::move(_path)),
 	 path_utf8(path.ToUTF8()),
 #ifdef ENABLE_ZLIB
 	 compress(_compress),
 #endif
+	 binary(_binary),
+	 journal_path(nullptr),
 	 cache_path(nullptr),
 	 prefixed_light_song(nullptr) {
 }
 
+SimpleDatabase::~SimpleDatabase() noexcept = default;
+
 DatabasePtr
 SimpleDatabase::Create(EventLoop &, EventLoop &,
 		       gcc_unused DatabaseListener &listener,
@@ -145,21 +174,78 @@ SimpleDatabase::Check() const
 #endif
 }
 
+/**
+ * Does the file start with the binary database header?  Only those
+ * files are mapped into memory; text (and gzipped text) files are
+ * read with #TextFile.
+ */
+static bool
+IsBinaryFile(Path path)
+{
+	FileReader reader(path);
+
+	char buffer[64];
+	const size_t nbytes = reader.Read(buffer, sizeof(buffer));
+	return db_is_binary({buffer, nbytes});
+}
+
 void
 SimpleDatabase::Load()
 {
 	assert(!path.IsNull());
 	assert(root != nullptr);
 
-	TextFile file(path);
-
 	LogDebug(simple_db_domain, "reading DB");
 
-	db_load_internal(file, *root);
+	if (IsBinaryFile(path)) {
+		/* decoded straight from the read-only mapping */
+		const MappedFile mapped(path);
+		db_load_binary(mapped.GetData(), *root);
+	} else {
+		TextFile file(path);
+		db_load_internal(file, *root);
+	}
 
 	FileInfo fi;
 	if (GetFileInfo(path, fi))
 		mtime = fi.GetModificationTime();
+
+	if (journal)
+		LoadJournal();
+}
+
+void
+SimpleDatabase::LoadJournal()
+{
+	assert(journal);
+
+	FileInfo fi;
+	if (GetFileInfo(journal_path, fi)) {
+		LogDebug(simple_db_domain, "replaying DB journal");
+
+		/* records are applied only after they have been parsed
+		   completely, so a damaged journal leaves the tree in a
+		   consistent state; compact it at the next save */
+		try {
+			TextFile file(journal_path);
+			if (!journal_load(file, *root)) {
+				LogWarning(simple_db_domain,
+					   "DB journal is incomplete");
+				journal_compact = true;
+			}
+		} catch (...) {
+			LogError(std::current_exception(),
+				 "Failed to replay DB journal");
+			journal_compact = true;
+		}
+
+		if (fi.GetModificationTime() > mtime)
+			mtime = fi.GetModificationTime();
+	}
+
+	const ScopeDatabaseLock protect;
+	journal_sort_modified(*root);
+	journal_clear_modified(*root);
 }
 
 void
@@ -185,6 +271,15 @@ SimpleDatabase::Open()
 
 		root = Directory::NewRoot();
 	}
+
+	n_mounts = 0;
+
+	if (index_tags) {
+		tag_index = std::make_unique<TagIndex>(TagIndex::DefaultMask());
+
+		const ScopeDatabaseLock protect;
+		tag_index->Build(*root);
+	}
 }
 
 void
@@ -194,7 +289,12 @@ SimpleDatabase::Close() noexcept
 	assert(prefixed_light_song == nullptr);
 	assert(borrowed_song_count == 0);
 
+	if (tag_index != nullptr)
+		/* don't bother removing each song from the index */
+		tag_index->Clear();
+
 	delete root;
+	tag_index.reset();
 }
 
 const LightSong *
@@ -204,7 +304,7 @@ SimpleDatabase::GetSong(const char *uri) const
 	assert(prefixed_light_song == nullptr);
 	assert(borrowed_song_count == 0);
 
-	ScopeDatabaseLock protect;
+	ScopeDatabaseSharedLock protect;
 
 	auto r = root->LookupDirectory(uri);
 
@@ -282,7 +382,7 @@ SimpleDatabase::Visit(const DatabaseSelection &selection,
 		      VisitSong visit_song,
 		      VisitPlaylist visit_playlist) const
 {
-	ScopeDatabaseLock protect;
+	ScopeDatabaseSharedLock protect;
 
 	auto r = root->LookupDirectory(selection.uri.c_str());
 
@@ -305,6 +405,15 @@ SimpleDatabase::Visit(const DatabaseSelection &selection,
 		if (selection.recursive && visit_directory)
 			visit_directory(r.directory->Export());
 
+		if (tag_index != nullptr && n_mounts == 0 &&
+		    selection.recursive && selection.filter != nullptr &&
+		    !visit_directory && !visit_playlist && visit_song &&
+		    tag_index->VisitSongs(*r.directory, *selection.filter,
+					  visit_song)) {
+			helper.Commit();
+			return;
+		}
+
 		r.directory->Walk(selection.recursive, selection.filter,
 				  visit_directory, visit_song,
 				  visit_playlist);
@@ -334,6 +443,23 @@ RecursiveMap<std::string>
 SimpleDatabase::CollectUniqueTags(const DatabaseSelection &selection,
 				  ConstBuffer<TagType> tag_types) const
 {
+	if (tag_index != nullptr && selection.recursive &&
+	    selection.window.IsAll() &&
+	    (selection.uri.empty() ||
+	     /* the base URI was copied from the filter, which
+		checks it anyway */
+	     (selection.filter != nullptr &&
+	      selection.filter->GetBase() != nullptr &&
+	      selection.uri == selection.filter->GetBase()))) {
+		const ScopeDatabaseSharedLock protect;
+
+		RecursiveMap<std::string> result;
+		if (n_mounts == 0 &&
+		    tag_index->CollectUniqueTags(result, *root, tag_types,
+						 selection.filter))
+			return result;
+	}
+
 	return ::CollectUniqueTags(*this, selection, tag_types);
 }
 
@@ -343,8 +469,65 @@ SimpleDatabase::GetStats(const DatabaseSelection &selection) const
 	return ::GetStats(*this, selection);
 }
 
+/**
+ * The journal gets compacted into the database file when it grows
+ * larger than this fraction of the database file.
+ */
+static constexpr unsigned JOURNAL_COMPACT_RATIO = 4;
+
+bool
+SimpleDatabase::SaveJournal()
+{
+	assert(journal);
+
+	FileInfo db_info, journal_info;
+	if (!GetFileInfo(path, db_info))
+		/* no database file yet */
+		return false;
+
+	if (GetFileInfo(journal_path, journal_info) &&
+	    journal_info.GetSize() > db_info.GetSize() / JOURNAL_COMPACT_RATIO)
+		return false;
+
+	/* serialize the transaction into memory while holding the
+	   lock, and write it afterwards */
+	StringOutputStream sos;
+	unsigned n;
+
+	{
+		const ScopeDatabaseLock protect;
+
+		root->PruneEmpty();
+		journal_sort_modified(*root);
+
+		BufferedOutputStream bos(sos);
+		n = journal_save(bos, *root);
+		bos.Flush();
+	}
+
+	LogDebug(simple_db_domain, "appending to DB journal");
+
+	const auto &transaction = sos.GetValue();
+
+	try {
+		FileOutputStream fos(journal_path,
+				     FileOutputStream::Mode::APPEND_OR_CREATE);
+		fos.Write(transaction.data(), transaction.size());
+		fos.Commit();
+	} catch (...) {
+		/* the "modified" flags are gone; only a full save
+		   can recover from this */
+		journal_compact = true;
+		throw;
+	}
+
+	FormatDebug(simple_db_domain, "appended %u directories to DB journal",
+		    n);
+	return true;
+}
+
 void
-SimpleDatabase::Save()
+SimpleDatabase::SaveFull()
 {
 	{
 		const ScopeDatabaseLock protect;
@@ -360,33 +543,62 @@ SimpleDatabase::Save()
 
 	FileOutputStream fos(path);
 
-	OutputStream *os = &fos;
+	if (binary) {
+		BufferedOutputStream bos(fos);
+		db_save_binary(bos, *root);
+		bos.Flush();
+	} else {
+		OutputStream *os = &fos;
 
 #ifdef ENABLE_ZLIB
-	std::unique_ptr<GzipOutputStream> gzip;
-	if (compress) {
-		gzip.reset(new GzipOutputStream(*os));
-		os = gzip.get();
-	}
+		std::unique_ptr<GzipOutputStream> gzip;
+		if (compress) {
+			gzip.reset(new GzipOutputStream(*os));
+			os = gzip.get();
+		}
 #endif
 
-	BufferedOutputStream bos(*os);
+		BufferedOutputStream bos(*os);
 
-	db_save_internal(bos, *root);
+		db_save_internal(bos, *root);
 
-	bos.Flush();
+		bos.Flush();
 
 #ifdef ENABLE_ZLIB
-	if (gzip != nullptr) {
-		gzip->Flush();
-		gzip.reset();
-	}
+		if (gzip != nullptr) {
+			gzip->Flush();
+			gzip.reset();
+		}
 #endif
+	}
 
 	fos.Commit();
 
+	if (journal) {
+		/* the database file now contains everything from
+		   the journal; replaying it again would be harmless,
+		   but it would be a waste of time */
+		if (::FileExists(journal_path))
+			RemoveFile(journal_path);
+
+		journal_compact = false;
+
+		const ScopeDatabaseLock protect;
+		journal_clear_modified(*root);
+	}
+}
+
+void
+SimpleDatabase::Save()
+{
+	Path saved_path = path;
+	if (journal && !journal_compact && SaveJournal())
+		saved_path = journal_path;
+	else
+		SaveFull();
+
 	FileInfo fi;
-	if (GetFileInfo(path, fi))
+	if (GetFileInfo(saved_path, fi))
 		mtime = fi.GetModificationTime();
 }
 
@@ -413,6 +625,7 @@ SimpleDatabase::Mount(const char *uri, DatabasePtr db)
 
 	Directory *mnt = r.directory->CreateChild(r.uri);
 	mnt->mounted_database = std::move(db);
+	++n_mounts;
 }
 
 static constexpr bool
@@ -443,7 +656,7 @@ SimpleDatabase::Mount(const char *local_uri, const char *storage_uri)
 	constexpr bool compress = false;
 #endif
 	auto db = std::make_unique<SimpleDatabase>(cache_path / name_fs,
-						   compress);
+						   compress, binary);
 	db->Open();
 
 	// TODO: update the new database instance?
@@ -468,6 +681,9 @@ SimpleDatabase::LockUmountSteal(const char *uri) noexcept
 	auto db = std::move(r.directory->mounted_database);
 	r.directory->Delete();
 
+	assert(n_mounts > 0);
+	--n_mounts;
+
 	return db;
 }
 
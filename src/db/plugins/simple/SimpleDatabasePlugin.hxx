@@ -29,9 +29,11 @@
 #include "config.h"
 
 #include <cassert>
+#include <memory>
 
 struct ConfigBlock;
 struct Directory;
+class TagIndex;
 struct DatabasePlugin;
 class EventLoop;
 class DatabaseListener;
@@ -45,13 +47,56 @@ class SimpleDatabase : public Database {
 	bool compress;
 #endif
 
+	/**
+	 * Write the database file in the binary format (see
+	 * BinarySave.hxx) instead of the text format?
+	 */
+	bool binary = false;
+
+	/**
+	 * Append changes to #journal_path instead of rewriting the
+	 * whole database file on every save?
+	 */
+	bool journal = false;
+
+	/**
+	 * Set if the journal is in a state which must not be
+	 * appended to (e.g. it ends with an incomplete transaction);
+	 * the next Save() will then rewrite the database file.
+	 */
+	bool journal_compact = false;
+
+	/**
+	 * The journal file (see Journal.hxx), located next to the
+	 * database file.
+	 */
+	AllocatedPath journal_path;
+
 	/**
 	 * The path where cache files for Mount() are located.
 	 */
 	AllocatedPath cache_path;
 
+	/**
+	 * Build a #TagIndex in Open()?
+	 */
+	bool index_tags = false;
+
 	Directory *root;
 
+	/**
+	 * An optional index which speeds up searches and
+	 * CollectUniqueTags().  It is attached to the #root tree.
+	 */
+	std::unique_ptr<TagIndex> tag_index;
+
+	/**
+	 * The number of mount points in the #root tree.  The
+	 * #tag_index can only be used if there are none, because it
+	 * does not know the contents of mounted databases.
+	 */
+	unsigned n_mounts = 0;
+
 	std::chrono::system_clock::time_point mtime;
 
 	/**
@@ -71,7 +116,9 @@ class SimpleDatabase : public Database {
 
 public:
 	SimpleDatabase(const ConfigBlock &block);
-	SimpleDatabase(AllocatedPath &&_path, bool _compress) noexcept;
+	SimpleDatabase(AllocatedPath &&_path, bool _compress,
+		       bool _binary) noexcept;
+	~SimpleDatabase() noexcept override;
 
 	static DatabasePtr Create(EventLoop &main_event_loop,
 				  EventLoop &io_event_loop,
@@ -85,6 +132,12 @@ public:
 		return *root;
 	}
 
+	/**
+	 * Save the database.  If the journal is enabled, this
+	 * usually appends only the modified directories to it;
+	 * once the journal has grown too large, it is compacted by
+	 * rewriting the database file.
+	 */
 	void Save();
 
 	/**
@@ -141,6 +194,26 @@ private:
 	 */
 	void Load();
 
+	/**
+	 * Replay the journal after Load().
+	 *
+	 * Throws #std::runtime_error on error.
+	 */
+	void LoadJournal();
+
+	/**
+	 * Append all modified directories to the journal.
+	 *
+	 * @return false if the journal is too large and needs to be
+	 * compacted instead
+	 */
+	bool SaveJournal();
+
+	/**
+	 * Rewrite the whole database file and discard the journal.
+	 */
+	void SaveFull();
+
 	DatabasePtr LockUmountSteal(const char *uri) noexcept;
 };
 
@@ -0,0 +1,426 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "TagIndex.hxx"
+#include "Directory.hxx"
+#include "Song.hxx"
+#include "db/DatabaseLock.hxx"
+#include "db/UniqueTags.hxx"
+#include "song/Filter.hxx"
+#include "song/TagSongFilter.hxx"
+#include "song/LightSong.hxx"
+#include "tag/Tag.hxx"
+#include "tag/Fallback.hxx"
+#include "tag/VisitFallback.hxx"
+#include "util/ConstBuffer.hxx"
+#include "util/RecursiveMap.hxx"
+
+#include <algorithm>
+#include <memory>
+#include <unordered_set>
+
+#include <assert.h>
+
+inline void
+TagIndex::BuildDirectory(Directory &directory) noexcept
+{
+	directory.tag_index = this;
+
+	for (const auto &song : directory.songs)
+		Add(song);
+
+	for (auto &child : directory.children)
+		BuildDirectory(child);
+}
+
+void
+TagIndex::Build(Directory &root) noexcept
+{
+	assert(holding_exclusive_db_lock());
+
+	building = true;
+	BuildDirectory(root);
+	building = false;
+
+	for (auto &map : maps) {
+		for (auto &i : map) {
+			auto &songs = i.second;
+			std::sort(songs.begin(), songs.end());
+
+			/* a song may have the same value twice */
+			songs.erase(std::unique(songs.begin(), songs.end()),
+				    songs.end());
+			songs.shrink_to_fit();
+		}
+	}
+}
+
+void
+TagIndex::Clear() noexcept
+{
+	enabled = false;
+
+	for (auto &map : maps)
+		map.clear();
+}
+
+inline void
+TagIndex::Add(const Song &song, const Tag &tag) noexcept
+{
+	if (!enabled)
+		/* after Clear(), the tree may be freed without
+		   holding the lock */
+		return;
+
+	assert(holding_exclusive_db_lock());
+
+	for (const auto &item : tag) {
+		if (!mask.Test(item.type))
+			continue;
+
+		auto &songs = maps[item.type][item.value];
+		if (building) {
+			songs.push_back(&song);
+			continue;
+		}
+
+		auto i = std::lower_bound(songs.begin(), songs.end(), &song);
+		if (i == songs.end() || *i != &song)
+			songs.insert(i, &song);
+	}
+}
+
+inline void
+TagIndex::Remove(const Song &song, const Tag &tag) noexcept
+{
+	if (!enabled)
+		/* after Clear(), the tree may be freed without
+		   holding the lock */
+		return;
+
+	assert(holding_exclusive_db_lock());
+
+	for (const auto &item : tag) {
+		if (!mask.Test(item.type))
+			continue;
+
+		auto &map = maps[item.type];
+		auto i = map.find(item.value);
+		if (i == map.end())
+			/* a duplicate value which has already been
+			   removed */
+			continue;
+
+		auto &songs = i->second;
+		auto j = std::lower_bound(songs.begin(), songs.end(), &song);
+		if (j == songs.end() || *j != &song)
+			/* a duplicate value which has already been
+			   removed */
+			continue;
+
+		songs.erase(j);
+		if (songs.empty())
+			map.erase(i);
+	}
+}
+
+void
+TagIndex::Add(const Song &song) noexcept
+{
+	Add(song, song.tag);
+}
+
+void
+TagIndex::Remove(const Song &song) noexcept
+{
+	Remove(song, song.tag);
+}
+
+void
+TagIndex::Update(const Song &song, const Tag &old_tag) noexcept
+{
+	Remove(song, old_tag);
+	Add(song, song.tag);
+}
+
+bool
+TagIndex::IsIndexed(TagType type) const noexcept
+{
+	if (!mask.Test(type))
+		return false;
+
+	bool result = true;
+	ApplyTagFallback(type, [this, &result](TagType fallback){
+			if (!mask.Test(fallback))
+				result = false;
+			return false;
+		});
+
+	return result;
+}
+
+bool
+TagIndex::FindCandidates(const SongFilter &filter, SongSet &result) const
+{
+	/* look for the exact tag comparison with the smallest
+	   number of candidates */
+	const TagSongFilter *best = nullptr;
+	size_t best_size = 0;
+
+	for (const auto &i : filter.GetItems()) {
+		const auto *f = dynamic_cast<const TagSongFilter *>(i.get());
+		if (f == nullptr || !f->IsExactMatch() ||
+		    /* an empty value matches songs which don't have
+		       this tag, and these are not indexed */
+		    f->GetValue().empty())
+			continue;
+
+		const TagType type = f->GetTagType();
+		if (type == TAG_NUM_OF_ITEM_TYPES || !IsIndexed(type))
+			continue;
+
+		size_t size = 0;
+		ApplyTagWithFallback(type, [this, f, &size](TagType t){
+				const auto &map = maps[t];
+				auto j = map.find(f->GetValue());
+				if (j != map.end())
+					size += j->second.size();
+				return false;
+			});
+
+		if (best == nullptr || size < best_size) {
+			best = f;
+			best_size = size;
+		}
+	}
+
+	if (best == nullptr)
+		return false;
+
+	/* a song which doesn't have the tag is compared with its
+	   fallback tags, therefore those are candidates, too */
+	result.reserve(best_size);
+	ApplyTagWithFallback(best->GetTagType(), [this, best, &result](TagType t){
+			const auto &map = maps[t];
+			auto j = map.find(best->GetValue());
+			if (j != map.end()) {
+				const auto middle = result.size();
+				result.insert(result.end(),
+					      j->second.begin(),
+					      j->second.end());
+				std::inplace_merge(result.begin(),
+						   result.begin() + middle,
+						   result.end());
+			}
+			return false;
+		});
+
+	result.erase(std::unique(result.begin(), result.end()),
+		     result.end());
+	return true;
+}
+
+/**
+ * @param candidates a sorted list
+ */
+static void
+VisitCandidates(const Directory &directory,
+		const std::unordered_set<const Directory *> &directories,
+		const std::vector<const Song *> &candidates,
+		const SongFilter &filter, const VisitSong &visit_song)
+{
+	for (const auto &song : directory.songs) {
+		if (!std::binary_search(candidates.begin(), candidates.end(),
+					&song))
+			continue;
+
+		const LightSong song2 = song.Export();
+		if (filter.Match(song2))
+			visit_song(song2);
+	}
+
+	for (const auto &child : directory.children)
+		if (directories.find(&child) != directories.end())
+			VisitCandidates(child, directories, candidates,
+					filter, visit_song);
+}
+
+bool
+TagIndex::VisitSongs(const Directory &directory, const SongFilter &filter,
+		     const VisitSong &visit_song) const
+{
+	assert(holding_db_lock());
+
+	SongSet candidates;
+	if (!FindCandidates(filter, candidates))
+		return false;
+
+	/* determine which directories contain candidates, so the
+	   walk below can skip all others, while still visiting the
+	   songs in the usual order */
+	std::unordered_set<const Directory *> directories;
+	for (const Song *song : candidates)
+		for (const Directory *i = &song->parent;
+		     i != nullptr && directories.insert(i).second;
+		     i = i->parent) {}
+
+	if (directories.find(&directory) != directories.end())
+		VisitCandidates(directory, directories, candidates,
+				filter, visit_song);
+
+	return true;
+}
+
+gcc_pure
+static bool
+HasAnyTagType(const Tag &tag, TagMask types) noexcept
+{
+	for (const auto &item : tag)
+		if (types.Test(item.type))
+			return true;
+
+	return false;
+}
+
+/**
+ * Collects the remaining tag types of songs below one value of the
+ * first tag type.  For the last tag type, values which have been
+ * seen already are skipped by comparing the (interned) pointers,
+ * which avoids most of the std::map lookups.
+ */
+class ValueCollector {
+	RecursiveMap<std::string> &result;
+	const ConstBuffer<TagType> tag_types;
+	std::unordered_set<const char *> seen;
+
+public:
+	ValueCollector(RecursiveMap<std::string> &_result,
+		       ConstBuffer<TagType> _tag_types) noexcept
+		:result(_result), tag_types(_tag_types) {}
+
+	void operator()(const Tag &tag) noexcept {
+		if (tag_types.size != 1) {
+			::CollectUniqueTags(result, tag, tag_types);
+			return;
+		}
+
+		VisitTagWithFallbackOrEmpty(tag, tag_types.front(), [this](const char *value){
+				if (seen.insert(value).second)
+					result[value];
+			});
+	}
+};
+
+/**
+ * Collect the songs which have none of the given tag types below
+ * the empty value.
+ */
+static void
+CollectMissing(RecursiveMap<std::string> *&result,
+	       RecursiveMap<std::string> &parent,
+	       const Directory &directory, TagMask types,
+	       ConstBuffer<TagType> tag_types) noexcept
+{
+	for (const auto &song : directory.songs) {
+		if (HasAnyTagType(song.tag, types))
+			continue;
+
+		if (result == nullptr)
+			result = &parent[std::string()];
+
+		CollectUniqueTags(*result, song.tag, tag_types);
+	}
+
+	for (const auto &child : directory.children)
+		CollectMissing(result, parent, child, types, tag_types);
+}
+
+bool
+TagIndex::CollectUniqueTags(RecursiveMap<std::string> &result,
+			    const Directory &root,
+			    ConstBuffer<TagType> tag_types,
+			    const SongFilter *filter) const
+{
+	assert(holding_db_lock());
+	assert(root.IsRoot());
+
+	if (tag_types.empty())
+		return false;
+
+	if (filter != nullptr) {
+		SongSet candidates;
+		if (!FindCandidates(*filter, candidates))
+			return false;
+
+		for (const Song *song : candidates)
+			if (filter->Match(song->Export()))
+				::CollectUniqueTags(result, song->tag,
+						    tag_types);
+
+		return true;
+	}
+
+	/* without a filter, all songs are collected; the index
+	   allows collecting the first tag type without looking at
+	   each song */
+
+	const TagType type = tag_types.shift();
+	if (!IsIndexed(type))
+		return false;
+
+	for (const auto &i : maps[type]) {
+		auto &sub = result[i.first];
+		if (!tag_types.empty()) {
+			ValueCollector collector(sub, tag_types);
+			for (const Song *song : i.second)
+				collector(song->tag);
+		}
+	}
+
+	/* songs which don't have this tag type are collected below
+	   the values of the first fallback tag type they have (see
+	   VisitTagWithFallback()) */
+	TagMask preceding = type;
+	ApplyTagFallback(type, [this, &result, &preceding, tag_types](TagType fallback){
+			for (const auto &i : maps[fallback]) {
+				std::unique_ptr<ValueCollector> collector;
+
+				for (const Song *song : i.second) {
+					if (HasAnyTagType(song->tag, preceding))
+						continue;
+
+					if (collector == nullptr)
+						collector = std::make_unique<ValueCollector>(result[i.first],
+											     tag_types);
+
+					(*collector)(song->tag);
+				}
+			}
+
+			preceding |= fallback;
+			return false;
+		});
+
+	/* songs which have none of these are collected below the
+	   empty string (see VisitTagWithFallbackOrEmpty()) */
+	RecursiveMap<std::string> *missing = nullptr;
+	CollectMissing(missing, result, root, preceding, tag_types);
+
+	return true;
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_DB_SIMPLE_TAG_INDEX_HXX
+#define MPD_DB_SIMPLE_TAG_INDEX_HXX
+
+#include "db/Visitor.hxx"
+#include "tag/Mask.hxx"
+#include "util/Compiler.h"
+
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct Tag;
+struct Song;
+struct Directory;
+class SongFilter;
+template<typename Key> class RecursiveMap;
+template<typename T> struct ConstBuffer;
+
+/**
+ * An inverted index which maps tag values to the songs containing
+ * them, for some of the tag types.  It allows answering exact
+ * "find" queries and "list" requests without walking the whole
+ * directory tree.
+ *
+ * The index is attached to all #Directory objects of a tree (see
+ * Directory::tag_index), which update it whenever songs are added
+ * or removed.
+ *
+ * All methods must be called while holding the #db_mutex.
+ */
+class TagIndex {
+	/**
+	 * The songs with one tag value, sorted by address.  This
+	 * needs one pointer per song, much less than a hash set.
+	 */
+	typedef std::vector<const Song *> SongSet;
+	typedef std::unordered_map<std::string, SongSet> Map;
+
+	/**
+	 * The tag types which are indexed.
+	 */
+	const TagMask mask;
+
+	std::array<Map, TAG_NUM_OF_ITEM_TYPES> maps;
+
+	/**
+	 * Cleared by Clear().  After that, all modifications are
+	 * ignored, which allows disposing the whole tree quickly.
+	 */
+	bool enabled = true;
+
+	/**
+	 * Set by Build() while it appends songs without keeping the
+	 * #SongSet sorted; they are sorted at the end.
+	 */
+	bool building = false;
+
+public:
+	explicit TagIndex(TagMask _mask) noexcept
+		:mask(_mask) {}
+
+	TagIndex(const TagIndex &) = delete;
+	TagIndex &operator=(const TagIndex &) = delete;
+
+	/**
+	 * The tag types which are indexed by default: those which
+	 * are commonly used for browsing the database.
+	 */
+	static constexpr TagMask DefaultMask() noexcept {
+		return TagMask(TAG_ARTIST) | TAG_ARTIST_SORT |
+			TAG_ALBUM | TAG_ALBUM_SORT |
+			TAG_ALBUM_ARTIST | TAG_ALBUM_ARTIST_SORT |
+			TAG_GENRE | TAG_DATE |
+			TAG_COMPOSER | TAG_PERFORMER;
+	}
+
+	/**
+	 * Attach this index to all directories of the given tree and
+	 * add all of its songs.
+	 */
+	void Build(Directory &root) noexcept;
+
+	/**
+	 * Empty the index and ignore all further modifications.
+	 * This must be called before the tree is freed.
+	 */
+	void Clear() noexcept;
+
+	void Add(const Song &song) noexcept;
+	void Remove(const Song &song) noexcept;
+
+	/**
+	 * Update the index after the tag of the given song has been
+	 * modified.
+	 *
+	 * @param old_tag a copy of the previous tag
+	 */
+	void Update(const Song &song, const Tag &old_tag) noexcept;
+
+	/**
+	 * Visit all songs within the given directory (recursively)
+	 * which match the filter, in the same order as
+	 * Directory::Walk() does.  This is only possible if the
+	 * filter contains an exact comparison with an indexed tag
+	 * type; the index reduces the number of songs which need to
+	 * be checked, but the whole filter is still applied to each
+	 * of them.
+	 *
+	 * The tree must not contain mount points.
+	 *
+	 * @return false if the index cannot be used for this filter
+	 * (and nothing was visited)
+	 */
+	bool VisitSongs(const Directory &directory, const SongFilter &filter,
+			const VisitSong &visit_song) const;
+
+	/**
+	 * An indexed implementation of CollectUniqueTags() for the
+	 * whole database.  The tree must not contain mount points.
+	 *
+	 * @param filter an optional filter
+	 * @return false if the index cannot be used for this request
+	 * (and the #result was not modified)
+	 */
+	bool CollectUniqueTags(RecursiveMap<std::string> &result,
+			       const Directory &root,
+			       ConstBuffer<TagType> tag_types,
+			       const SongFilter *filter) const;
+
+private:
+	void BuildDirectory(Directory &directory) noexcept;
+
+	void Add(const Song &song, const Tag &tag) noexcept;
+	void Remove(const Song &song, const Tag &tag) noexcept;
+
+	/**
+	 * Are the given tag type and all of its fallbacks indexed?
+	 */
+	gcc_pure
+	bool IsIndexed(TagType type) const noexcept;
+
+	/**
+	 * Find songs which may match the given filter.  The result
+	 * is sorted by address and has no duplicates.
+	 *
+	 * @return false if the filter does not contain a condition
+	 * which can be looked up in the index
+	 */
+	bool FindCandidates(const SongFilter &filter, SongSet &result) const;
+};
+
+#endif
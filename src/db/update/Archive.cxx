@@ -47,7 +47,7 @@ LockMakeChild(Directory &directory, const char *name) noexcept
 static Song *
 LockFindSong(Directory &directory, const char *name) noexcept
 {
-	const ScopeDatabaseLock protect;
+	const ScopeDatabaseSharedLock protect;
 	return directory.FindSong(name);
 }
 
@@ -87,11 +87,19 @@ UpdateWalk::UpdateArchiveTree(ArchiveFile &archive, Directory &directory,
 					      directory.GetPath(), name);
 			}
 		} else {
+			/* the tag index needs the old tag to remove
+			   its values */
+			const Tag old_tag(song->tag);
+
 			if (!song->UpdateFileInArchive(archive)) {
 				FormatDebug(update_domain,
 					    "deleting unrecognized file %s/%s",
 					    directory.GetPath(), name);
 				editor.LockDeleteSong(directory, song);
+			} else {
+				const ScopeDatabaseLock protect;
+				directory.ReindexSong(*song, old_tag);
+				directory.MarkModified();
 			}
 		}
 	}
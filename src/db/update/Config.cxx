@@ -23,6 +23,11 @@
 
 UpdateConfig::UpdateConfig(const ConfigData &config)
 {
+	threads = config.GetPositive(ConfigOption::UPDATE_THREADS,
+				     DEFAULT_THREADS);
+
+	scan_cache_file = config.GetPath(ConfigOption::SCAN_CACHE_FILE);
+
 #ifndef _WIN32
 	follow_inside_symlinks =
 		config.GetBool(ConfigOption::FOLLOW_INSIDE_SYMLINKS,
@@ -31,7 +36,5 @@ UpdateConfig::UpdateConfig(const ConfigData &config)
 	follow_outside_symlinks =
 		config.GetBool(ConfigOption::FOLLOW_OUTSIDE_SYMLINKS,
 			       DEFAULT_FOLLOW_OUTSIDE_SYMLINKS);
-#else
-	(void)config;
 #endif
 }
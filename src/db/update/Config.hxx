@@ -20,9 +20,24 @@
 #ifndef MPD_UPDATE_CONFIG_HXX
 #define MPD_UPDATE_CONFIG_HXX
 
+#include "fs/AllocatedPath.hxx"
+
 struct ConfigData;
 
 struct UpdateConfig {
+	static constexpr unsigned DEFAULT_THREADS = 1;
+
+	/**
+	 * The number of threads which load song files.  If this is
+	 * 1, the update thread does it by itself.
+	 */
+	unsigned threads = DEFAULT_THREADS;
+
+	/**
+	 * The path of the #ScanCache file; nullptr if disabled.
+	 */
+	AllocatedPath scan_cache_file = nullptr;
+
 #ifndef _WIN32
 	static constexpr bool DEFAULT_FOLLOW_INSIDE_SYMLINKS = true;
 	static constexpr bool DEFAULT_FOLLOW_OUTSIDE_SYMLINKS = true;
@@ -0,0 +1,327 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "ScanCache.hxx"
+#include "UpdateDomain.hxx"
+#include "db/plugins/simple/Song.hxx"
+#include "storage/FileInfo.hxx"
+#include "song/DetachedSong.hxx"
+#include "SongSave.hxx"
+#include "TagSave.hxx"
+#include "fs/FileSystem.hxx"
+#include "fs/io/TextFile.hxx"
+#include "fs/io/FileOutputStream.hxx"
+#include "fs/io/BufferedOutputStream.hxx"
+#include "tag/ParseName.hxx"
+#include "tag/Settings.hxx"
+#include "util/StringBuffer.hxx"
+#include "util/StringCompare.hxx"
+#include "util/RuntimeError.hxx"
+#include "Log.hxx"
+
+#include <algorithm>
+
+#include <assert.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+
+#define SCAN_CACHE_FORMAT_PREFIX "scan_cache: "
+#define SCAN_CACHE_TAG_PREFIX "tag: "
+#define SCAN_CACHE_ENTRY_PREFIX "entry: "
+
+static constexpr unsigned SCAN_CACHE_FORMAT = 1;
+
+/**
+ * Rewrite the file instead of appending to it when it would contain
+ * this number of records per live entry.
+ */
+static constexpr size_t SCAN_CACHE_MAX_RECORDS_PER_ENTRY = 2;
+
+bool
+ScanCache::Lookup(const StorageFileInfo &info, Song &song) noexcept
+{
+	if (info.inode == 0)
+		return false;
+
+	if (!loaded)
+		Load();
+
+	auto i = map.find(Key{info.device, info.inode});
+	if (i == map.end() || i->second.size != info.size ||
+	    i->second.mtime != std::chrono::system_clock::to_time_t(info.mtime)) {
+		++n_misses;
+		return false;
+	}
+
+	++n_hits;
+
+	song.tag = Tag(i->second.tag);
+	song.audio_format = i->second.audio_format;
+	song.mtime = info.mtime;
+	return true;
+}
+
+void
+ScanCache::Put(const StorageFileInfo &info, const Song &song) noexcept
+{
+	if (info.inode == 0)
+		return;
+
+	if (!loaded)
+		Load();
+
+	auto &entry = map[Key{info.device, info.inode}];
+	entry.size = info.size;
+	entry.mtime = std::chrono::system_clock::to_time_t(info.mtime);
+	entry.tag = Tag(song.tag);
+	entry.audio_format = song.audio_format;
+
+	if (!entry.dirty) {
+		entry.dirty = true;
+		++n_dirty;
+	}
+}
+
+void
+ScanCache::Touch(const StorageFileInfo &info) noexcept
+{
+	if (info.inode != 0)
+		seen.push_back(Key{info.device, info.inode});
+}
+
+void
+ScanCache::Prune() noexcept
+{
+	if (!loaded || seen.empty())
+		return;
+
+	std::sort(seen.begin(), seen.end(), KeyLess());
+
+	size_t n_removed = 0;
+	for (auto i = map.begin(); i != map.end();) {
+		const Key &key = i->first;
+
+		/* is there any file on this device? */
+		const auto d = std::lower_bound(seen.begin(), seen.end(),
+						Key{key.device, 0}, KeyLess());
+		if (d == seen.end() || d->device != key.device ||
+		    std::binary_search(d, seen.end(), key, KeyLess())) {
+			++i;
+			continue;
+		}
+
+		if (i->second.dirty)
+			--n_dirty;
+
+		i = map.erase(i);
+		++n_removed;
+	}
+
+	if (n_removed > 0) {
+		FormatDebug(update_domain,
+			    "removed %zu entries from the scan cache",
+			    n_removed);
+		rewrite = true;
+	}
+}
+
+void
+ScanCache::Flush() noexcept
+{
+	if (!loaded) {
+		seen = {};
+		return;
+	}
+
+	if (!rewrite &&
+	    n_records + n_dirty >= map.size() * SCAN_CACHE_MAX_RECORDS_PER_ENTRY)
+		/* most of the file is obsolete */
+		rewrite = true;
+
+	try {
+		if (rewrite) {
+			FormatDebug(update_domain,
+				    "writing scan cache (%zu entries)",
+				    map.size());
+
+			FileOutputStream fos(path);
+			BufferedOutputStream bos(fos);
+			Save(bos);
+			bos.Flush();
+			fos.Commit();
+		} else if (n_dirty > 0) {
+			FormatDebug(update_domain,
+				    "appending %zu entries to scan cache",
+				    n_dirty);
+
+			FileOutputStream fos(path,
+					     FileOutputStream::Mode::APPEND_EXISTING);
+			BufferedOutputStream bos(fos);
+			Append(bos);
+			bos.Flush();
+			fos.Commit();
+		}
+	} catch (...) {
+		LogError(std::current_exception(),
+			 "Failed to save scan cache");
+	}
+
+	map = {};
+	seen = {};
+	loaded = rewrite = false;
+	n_records = n_dirty = 0;
+}
+
+void
+ScanCache::Load() noexcept
+{
+	assert(map.empty());
+
+	loaded = true;
+
+	if (!FileExists(path)) {
+		rewrite = true;
+		return;
+	}
+
+	try {
+		TextFile file(path);
+		Load(file);
+	} catch (...) {
+		LogError(std::current_exception(),
+			 "Failed to load scan cache");
+		map.clear();
+		n_records = 0;
+		rewrite = true;
+		return;
+	}
+
+	FormatDebug(update_domain, "loaded scan cache (%zu entries)",
+		    map.size());
+}
+
+void
+ScanCache::Load(TextFile &file)
+{
+	const char *line = file.ReadLine();
+	const char *p;
+	if (line == nullptr ||
+	    (p = StringAfterPrefix(line, SCAN_CACHE_FORMAT_PREFIX)) == nullptr)
+		throw std::runtime_error("Scan cache corrupted");
+
+	if (unsigned(atoi(p)) != SCAN_CACHE_FORMAT)
+		throw std::runtime_error("Scan cache format mismatch, "
+					 "discarding scan cache");
+
+	bool tags[TAG_NUM_OF_ITEM_TYPES];
+	memset(tags, false, sizeof(tags));
+
+	while ((line = file.ReadLine()) != nullptr &&
+	       (p = StringAfterPrefix(line, SCAN_CACHE_TAG_PREFIX)) != nullptr) {
+		TagType tag = tag_name_parse(p);
+		if (tag == TAG_NUM_OF_ITEM_TYPES)
+			throw FormatRuntimeError("Unrecognized tag '%s', "
+						 "discarding scan cache",
+						 p);
+
+		tags[tag] = true;
+	}
+
+	/* entries lack tag types which were disabled when they were
+	   scanned */
+	for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i)
+		if (IsTagEnabled(i) && !tags[i])
+			throw std::runtime_error("Tag list mismatch, "
+						 "discarding scan cache");
+
+	for (; line != nullptr; line = file.ReadLine()) {
+		p = StringAfterPrefix(line, SCAN_CACHE_ENTRY_PREFIX);
+		if (p == nullptr)
+			throw FormatRuntimeError("Malformed line: %s", line);
+
+		char *endptr;
+		Key key;
+		key.device = strtoull(p, &endptr, 10);
+		key.inode = strtoull(endptr, &endptr, 10);
+		const uint64_t size = strtoull(endptr, &endptr, 10);
+		const time_t mtime = strtoll(endptr, &endptr, 10);
+		if (*endptr != 0 || key.inode == 0)
+			throw FormatRuntimeError("Malformed line: %s", line);
+
+		AudioFormat audio_format = AudioFormat::Undefined();
+		auto song = song_load(file, "", nullptr, &audio_format);
+
+		/* a later entry replaces an earlier one */
+		auto &entry = map[key];
+		entry.size = size;
+		entry.mtime = mtime;
+		entry.tag = std::move(song.WritableTag());
+		entry.audio_format = audio_format;
+		entry.dirty = false;
+
+		++n_records;
+	}
+}
+
+void
+ScanCache::SaveHeader(BufferedOutputStream &os) const
+{
+	os.Format(SCAN_CACHE_FORMAT_PREFIX "%u\n", SCAN_CACHE_FORMAT);
+
+	for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i)
+		if (IsTagEnabled(i))
+			os.Format(SCAN_CACHE_TAG_PREFIX "%s\n",
+				  tag_item_names[i]);
+}
+
+void
+ScanCache::SaveEntry(BufferedOutputStream &os,
+		     const Key &key, const Entry &entry)
+{
+	os.Format(SCAN_CACHE_ENTRY_PREFIX "%" PRIu64 " %" PRIu64
+		  " %" PRIu64 " %" PRId64 "\n",
+		  key.device, key.inode,
+		  entry.size, int64_t(entry.mtime));
+
+	tag_save(os, entry.tag);
+
+	if (entry.audio_format.IsDefined())
+		os.Format("Format: %s\n",
+			  ToString(entry.audio_format).c_str());
+
+	os.Write("song_end\n");
+}
+
+void
+ScanCache::Save(BufferedOutputStream &os) const
+{
+	SaveHeader(os);
+
+	for (const auto &i : map)
+		SaveEntry(os, i.first, i.second);
+}
+
+void
+ScanCache::Append(BufferedOutputStream &os) const
+{
+	for (const auto &i : map)
+		if (i.second.dirty)
+			SaveEntry(os, i.first, i.second);
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_UPDATE_SCAN_CACHE_HXX
+#define MPD_UPDATE_SCAN_CACHE_HXX
+
+#include "tag/Tag.hxx"
+#include "AudioFormat.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "util/Compiler.h"
+
+#include <unordered_map>
+#include <vector>
+
+#include <stdint.h>
+#include <time.h>
+
+struct StorageFileInfo;
+struct Song;
+class BufferedOutputStream;
+class TextFile;
+
+/**
+ * A persistent cache of scanned song files, which survives the loss
+ * of the database file.  Entries are keyed by device and inode
+ * number and are only used if the file size and modification time
+ * are unchanged, so rebuilding the database needs only stat() calls
+ * for files which have been scanned before.
+ *
+ * Files on storages which do not provide inode numbers (e.g. remote
+ * storages) are not cached.
+ *
+ * The file is loaded on the first Lookup() and is kept in memory
+ * only until Flush().  Flush() appends new and changed entries to
+ * the file (later entries replace earlier ones when it is loaded),
+ * and rewrites it only if entries were removed or most of it is
+ * obsolete.  This class is not thread-safe; it is only used by the
+ * update thread.
+ */
+class ScanCache final {
+	struct Key {
+		uint64_t device, inode;
+
+		bool operator==(const Key &other) const noexcept {
+			return device == other.device && inode == other.inode;
+		}
+	};
+
+	struct KeyLess {
+		gcc_pure
+		bool operator()(const Key &a, const Key &b) const noexcept {
+			return a.device != b.device
+				? a.device < b.device
+				: a.inode < b.inode;
+		}
+	};
+
+	struct KeyHash {
+		gcc_pure
+		size_t operator()(const Key &key) const noexcept {
+			return std::hash<uint64_t>()(key.inode) ^
+				std::hash<uint64_t>()(key.device << 1);
+		}
+	};
+
+	struct Entry {
+		uint64_t size;
+		time_t mtime;
+
+		Tag tag;
+		AudioFormat audio_format;
+
+		/**
+		 * Has this entry been added or changed since the file
+		 * was loaded?
+		 */
+		bool dirty = false;
+	};
+
+	const AllocatedPath path;
+
+	std::unordered_map<Key, Entry, KeyHash> map;
+
+	/**
+	 * The files which were visited by the walk; see Touch().
+	 */
+	std::vector<Key> seen;
+
+	bool loaded = false;
+
+	/**
+	 * Must the file be rewritten instead of appending to it?
+	 * This is set if it could not be loaded, or if entries have
+	 * been removed.
+	 */
+	bool rewrite = false;
+
+	/**
+	 * The number of entries in the file, including obsolete
+	 * ones which have been replaced by later entries.
+	 */
+	size_t n_records = 0;
+
+	/**
+	 * The number of entries with the "dirty" flag.
+	 */
+	size_t n_dirty = 0;
+
+	unsigned n_hits = 0, n_misses = 0;
+
+public:
+	explicit ScanCache(AllocatedPath &&_path) noexcept
+		:path(std::move(_path)) {}
+
+	ScanCache(const ScanCache &) = delete;
+	ScanCache &operator=(const ScanCache &) = delete;
+
+	/**
+	 * Look up the given file, and copy the cached tag, audio
+	 * format and modification time to the #Song.
+	 *
+	 * @return true on success, false if the file is not in the
+	 * cache or has been modified
+	 */
+	bool Lookup(const StorageFileInfo &info, Song &song) noexcept;
+
+	/**
+	 * Add (or replace) a cache entry for the given file.
+	 */
+	void Put(const StorageFileInfo &info, const Song &song) noexcept;
+
+	/**
+	 * Remember that the walk has found this file.  This is cheap
+	 * and does not load the cache.
+	 */
+	void Touch(const StorageFileInfo &info) noexcept;
+
+	/**
+	 * Remove the entries of files which were not passed to
+	 * Touch(), but only on devices where Touch() has seen at
+	 * least one file, so entries of other storages survive.  This
+	 * must only be called after a walk over a whole storage.
+	 *
+	 * Does nothing if the cache has not been loaded, to avoid
+	 * loading it for an update which did not scan any file.
+	 */
+	void Prune() noexcept;
+
+	/**
+	 * Write the modifications to the file, and free the memory.
+	 * Errors are logged.
+	 */
+	void Flush() noexcept;
+
+	unsigned GetHits() const noexcept {
+		return n_hits;
+	}
+
+	unsigned GetMisses() const noexcept {
+		return n_misses;
+	}
+
+private:
+	void Load() noexcept;
+	void Load(TextFile &file);
+	void SaveHeader(BufferedOutputStream &os) const;
+	static void SaveEntry(BufferedOutputStream &os,
+			      const Key &key, const Entry &entry);
+	void Save(BufferedOutputStream &os) const;
+	void Append(BufferedOutputStream &os) const;
+};
+
+#endif
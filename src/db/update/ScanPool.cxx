@@ -0,0 +1,186 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "ScanPool.hxx"
+#include "db/plugins/simple/Song.hxx"
+#include "db/plugins/simple/Directory.hxx"
+#include "thread/Name.hxx"
+#include "thread/Util.hxx"
+
+#include <assert.h>
+
+ScanPool::ScanPool(Storage &_storage, unsigned n_threads)
+	:storage(_storage), max_jobs(n_threads * 4)
+{
+	assert(n_threads > 0);
+
+	try {
+		for (unsigned i = 0; i < n_threads; ++i) {
+			threads.emplace_front(BIND_THIS_METHOD(Run));
+			threads.front().Start();
+		}
+	} catch (...) {
+		/* the Thread which failed to start is not defined;
+		   remove it, and stop the others */
+		threads.pop_front();
+		Stop();
+		throw;
+	}
+}
+
+ScanPool::~ScanPool() noexcept
+{
+	Stop();
+}
+
+void
+ScanPool::Stop() noexcept
+{
+	{
+		const std::lock_guard<Mutex> protect(mutex);
+		quit = true;
+		job_cond.notify_all();
+	}
+
+	for (auto &thread : threads)
+		thread.Join();
+
+	threads.clear();
+}
+
+void
+ScanPool::Submit(Directory &directory, Song *song, const char *name,
+		 const StorageFileInfo &info)
+{
+	std::unique_lock<Mutex> lock(mutex);
+	done_cond.wait(lock, [this]{ return n_jobs < max_jobs; });
+
+	queue.emplace_back(directory, song, name, info);
+	++n_jobs;
+	job_cond.notify_one();
+}
+
+ScanPool::JobList
+ScanPool::TakeDone() noexcept
+{
+	const std::lock_guard<Mutex> protect(mutex);
+
+	JobList result;
+	result.swap(done);
+	return result;
+}
+
+ScanPool::JobList
+ScanPool::WaitAll() noexcept
+{
+	std::unique_lock<Mutex> lock(mutex);
+	done_cond.wait(lock, [this]{ return n_jobs == 0; });
+
+	JobList result;
+	result.swap(done);
+	return result;
+}
+
+#ifndef NDEBUG
+
+gcc_pure
+static bool
+IsReferenced(const ScanPool::JobList &jobs,
+	     const Directory &directory) noexcept
+{
+	for (const auto &job : jobs)
+		for (const Directory *i = &job.directory; i != nullptr;
+		     i = i->parent)
+			if (i == &directory)
+				return true;
+
+	return false;
+}
+
+bool
+ScanPool::IsReferenced(const Directory &directory) const noexcept
+{
+	const std::lock_guard<Mutex> protect(mutex);
+	return ::IsReferenced(queue, directory) ||
+		::IsReferenced(running, directory) ||
+		::IsReferenced(done, directory);
+}
+
+gcc_pure
+static bool
+IsReferenced(const ScanPool::JobList &jobs, const Song &song) noexcept
+{
+	for (const auto &job : jobs)
+		if (job.song == &song)
+			return true;
+
+	return false;
+}
+
+bool
+ScanPool::IsReferenced(const Song &song) const noexcept
+{
+	const std::lock_guard<Mutex> protect(mutex);
+	return ::IsReferenced(queue, song) ||
+		::IsReferenced(running, song) ||
+		::IsReferenced(done, song);
+}
+
+#endif
+
+void
+ScanPool::Run() noexcept
+{
+	SetThreadName("update_scan");
+	SetThreadIdlePriority();
+
+	std::unique_lock<Mutex> lock(mutex);
+
+	while (true) {
+		job_cond.wait(lock, [this]{ return quit || !queue.empty(); });
+		if (quit)
+			break;
+
+		/* move the job out of the queue; the list node (and
+		   the iterator) stays valid while the lock is
+		   released */
+		const auto i = queue.begin();
+		running.splice(running.end(), queue, i);
+		Job &job = *i;
+
+		lock.unlock();
+
+		const auto start = std::chrono::steady_clock::now();
+
+		try {
+			job.result = Song::LoadFile(storage, job.name.c_str(),
+						    job.directory);
+		} catch (...) {
+			job.error = std::current_exception();
+		}
+
+		job.duration = std::chrono::steady_clock::now() - start;
+
+		lock.lock();
+
+		done.splice(done.end(), running, i);
+		--n_jobs;
+		done_cond.notify_all();
+	}
+}
@@ -0,0 +1,190 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_UPDATE_SCAN_POOL_HXX
+#define MPD_UPDATE_SCAN_POOL_HXX
+
+#include "db/plugins/simple/Ptr.hxx"
+#include "storage/FileInfo.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Thread.hxx"
+#include "util/Compiler.h"
+
+#include <chrono>
+#include <exception>
+#include <forward_list>
+#include <list>
+#include <string>
+
+struct Directory;
+struct Song;
+class Storage;
+
+/**
+ * A pool of threads which load song files (i.e. scan their tags) on
+ * behalf of the update thread.  It does not modify the database; the
+ * update thread collects the finished jobs and merges their results
+ * into the #Directory tree.
+ *
+ * Only Song::LoadFile() runs here.  Directory enumeration and the
+ * StorageDirectoryReader::GetInfo() calls stay in the update thread:
+ * the NFS and SMB readers return attributes collected by the
+ * directory listing (READDIRPLUS), so they cost no extra round trip,
+ * and the walk order determines the tree modifications.
+ */
+class ScanPool final {
+public:
+	/**
+	 * The #directory and #song references are used by the worker
+	 * thread without holding the database lock.  They stay valid
+	 * because only the update thread modifies the tree (mounting
+	 * and unmounting cancel and join it first), and it deletes a
+	 * directory's songs and children only before enumerating that
+	 * directory (see UpdateWalk::PurgeDeletedFromDirectory()), i.e.
+	 * before submitting jobs for them.  In debug builds, this is
+	 * checked with IsReferenced().
+	 */
+	struct Job {
+		Directory &directory;
+
+		/**
+		 * The existing song which shall be updated, or nullptr
+		 * if this is a new file.
+		 */
+		Song *const song;
+
+		const std::string name;
+
+		/**
+		 * The file information obtained by the walker.
+		 */
+		const StorageFileInfo info;
+
+		/**
+		 * The new song object; nullptr if the file was not
+		 * recognized (or on error).
+		 */
+		SongPtr result;
+
+		/**
+		 * The error which occurred while loading the file.
+		 */
+		std::exception_ptr error;
+
+		/**
+		 * How long it took to load the file.
+		 */
+		std::chrono::steady_clock::duration duration;
+
+		Job(Directory &_directory, Song *_song, const char *_name,
+		    const StorageFileInfo &_info)
+			:directory(_directory), song(_song), name(_name),
+			 info(_info) {}
+	};
+
+	typedef std::list<Job> JobList;
+
+private:
+	Storage &storage;
+
+	/**
+	 * The number of jobs which may be queued or running at a
+	 * time.  Submit() blocks when this is reached.
+	 */
+	const unsigned max_jobs;
+
+	mutable Mutex mutex;
+
+	/**
+	 * Signalled when a job is submitted, or when the threads
+	 * shall quit.
+	 */
+	Cond job_cond;
+
+	/**
+	 * Signalled when a job is finished.
+	 */
+	Cond done_cond;
+
+	JobList queue, running, done;
+
+	/**
+	 * The number of jobs which are queued or running.
+	 */
+	unsigned n_jobs = 0;
+
+	bool quit = false;
+
+	std::forward_list<Thread> threads;
+
+public:
+	/**
+	 * Throws on error.
+	 */
+	ScanPool(Storage &_storage, unsigned n_threads);
+	~ScanPool() noexcept;
+
+	ScanPool(const ScanPool &) = delete;
+	ScanPool &operator=(const ScanPool &) = delete;
+
+	/**
+	 * Queue a file for loading.  Blocks while too many jobs are
+	 * pending.
+	 */
+	void Submit(Directory &directory, Song *song, const char *name,
+		    const StorageFileInfo &info);
+
+	/**
+	 * Collect all jobs which are finished, without waiting.
+	 */
+	JobList TakeDone() noexcept;
+
+	/**
+	 * Wait until all jobs are finished, and collect them.
+	 */
+	JobList WaitAll() noexcept;
+
+#ifndef NDEBUG
+	/**
+	 * Does a job which has not been collected yet refer to the
+	 * given directory or one of its descendants?
+	 */
+	gcc_pure
+	bool IsReferenced(const Directory &directory) const noexcept;
+
+	/**
+	 * Does a job which has not been collected yet refer to the
+	 * given song?
+	 */
+	gcc_pure
+	bool IsReferenced(const Song &song) const noexcept;
+#endif
+
+private:
+	/**
+	 * Stop and join all threads.  Jobs which have not been
+	 * started yet are discarded.
+	 */
+	void Stop() noexcept;
+
+	void Run() noexcept;
+};
+
+#endif
@@ -25,6 +25,7 @@
 #include "db/plugins/simple/SimpleDatabasePlugin.hxx"
 #include "db/plugins/simple/Directory.hxx"
 #include "storage/CompositeStorage.hxx"
+#include "tag/Pool.hxx"
 #include "protocol/Ack.hxx"
 #include "Idle.hxx"
 #include "Log.hxx"
@@ -77,7 +78,7 @@ UpdateService::CancelMount(const char *uri) noexcept
 
 	Directory::LookupResult lr;
 	{
-		const ScopeDatabaseLock protect;
+		const ScopeDatabaseSharedLock protect;
 		lr = db.GetRoot().LookupDirectory(uri);
 	}
 
@@ -138,6 +139,13 @@ UpdateService::Task() noexcept
 	else
 		LogDebug(update_domain, "finished");
 
+	const auto pool = tag_pool_get_stats();
+	FormatDebug(update_domain,
+		    "tag pool: %zu items, %zu references, %zu bytes, "
+		    "%zu bytes saved, %zu buckets, longest chain %zu",
+		    pool.items, pool.references, pool.bytes,
+		    pool.bytes_saved, pool.buckets, pool.max_chain_length);
+
 	defer.Schedule();
 }
 
@@ -151,7 +159,7 @@ UpdateService::StartThread(UpdateQueueItem &&i)
 
 	next = std::move(i);
 	walk = std::make_unique<UpdateWalk>(config, GetEventLoop(), listener,
-					    *next.storage);
+					    *next.storage, next.db == &db);
 
 	update_thread.Start();
 
@@ -180,7 +188,7 @@ UpdateService::Enqueue(const char *path, bool discard)
 
 	Directory::LookupResult lr;
 	{
-		const ScopeDatabaseLock protect;
+		const ScopeDatabaseSharedLock protect;
 		lr = db.GetRoot().LookupDirectory(path);
 	}
 
@@ -27,8 +27,122 @@
 #include "storage/FileInfo.hxx"
 #include "Log.hxx"
 
+#include <assert.h>
 #include <unistd.h>
 
+void
+UpdateWalk::CommitSongFile(Directory &directory, Song *song,
+			   const char *name, SongPtr new_song) noexcept
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	if (!new_song) {
+		if (song == nullptr) {
+			FormatDebug(update_domain,
+				    "ignoring unrecognized file %s/%s",
+				    directory.GetPath(), name);
+			return;
+		}
+
+		FormatDebug(update_domain,
+			    "deleting unrecognized file %s/%s",
+			    directory.GetPath(), name);
+		editor.LockDeleteSong(directory, song);
+	} else if (song == nullptr) {
+		{
+			const ScopeDatabaseLock protect;
+			directory.AddSong(std::move(new_song));
+		}
+
+		FormatDefault(update_domain, "added %s/%s",
+			      directory.GetPath(), name);
+	} else {
+		const ScopeDatabaseLock protect;
+
+		/* the tag index needs the old tag to remove its
+		   values */
+		const Tag old_tag(std::move(song->tag));
+
+		song->tag = std::move(new_song->tag);
+		song->mtime = new_song->mtime;
+		song->audio_format = new_song->audio_format;
+
+		directory.ReindexSong(*song, old_tag);
+		directory.MarkModified();
+	}
+
+	modified = true;
+	merge_duration += std::chrono::steady_clock::now() - start;
+}
+
+void
+UpdateWalk::CommitScanJobs(ScanPool::JobList &&jobs) noexcept
+{
+	for (auto &job : jobs) {
+		++n_scanned;
+		scan_duration += job.duration;
+
+		if (job.error) {
+			FormatError(job.error,
+				    "error reading file %s/%s",
+				    job.directory.GetPath(), job.name.c_str());
+			continue;
+		}
+
+		if (job.result && scan_cache != nullptr)
+			scan_cache->Put(job.info, *job.result);
+
+		CommitSongFile(job.directory, job.song, job.name.c_str(),
+			       std::move(job.result));
+	}
+}
+
+void
+UpdateWalk::ScanSongFile(Directory &directory, Song *song,
+			 const char *name, const StorageFileInfo &info) noexcept
+{
+	/* "discard" forces reading files which are already in the
+	   database, but new files may still come from the cache */
+	if (scan_cache != nullptr && (song == nullptr || !walk_discard)) {
+		auto new_song = std::make_unique<Song>(name, directory);
+		if (scan_cache->Lookup(info, *new_song)) {
+			CommitSongFile(directory, song, name,
+				       std::move(new_song));
+			return;
+		}
+	}
+
+	if (scan_pool != nullptr) {
+		const auto start = std::chrono::steady_clock::now();
+		scan_pool->Submit(directory, song, name, info);
+		wait_duration += std::chrono::steady_clock::now() - start;
+
+		CommitScanJobs(scan_pool->TakeDone());
+		return;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	++n_scanned;
+
+	SongPtr new_song;
+	try {
+		new_song = Song::LoadFile(storage, name, directory);
+	} catch (...) {
+		scan_duration += std::chrono::steady_clock::now() - start;
+		FormatError(std::current_exception(),
+			    "error reading file %s/%s",
+			    directory.GetPath(), name);
+		return;
+	}
+
+	scan_duration += std::chrono::steady_clock::now() - start;
+
+	if (new_song && scan_cache != nullptr)
+		scan_cache->Put(info, *new_song);
+
+	CommitSongFile(directory, song, name, std::move(new_song));
+}
+
 inline void
 UpdateWalk::UpdateSongFile2(Directory &directory,
 			    const char *name, const char *suffix,
@@ -36,7 +150,7 @@ UpdateWalk::UpdateSongFile2(Directory &directory,
 try {
 	Song *song;
 	{
-		const ScopeDatabaseLock protect;
+		const ScopeDatabaseSharedLock protect;
 		song = directory.FindSong(name);
 	}
 
@@ -44,16 +158,23 @@ try {
 		FormatError(update_domain,
 			    "no read permissions on %s/%s",
 			    directory.GetPath(), name);
-		if (song != nullptr)
+		if (song != nullptr) {
+			assert(!IsScanning(*song));
 			editor.LockDeleteSong(directory, song);
+		}
 
 		return;
 	}
 
+	if (scan_cache != nullptr)
+		scan_cache->Touch(info);
+
 	if (!(song != nullptr && info.mtime == song->mtime && !walk_discard) &&
 	    UpdateContainerFile(directory, name, suffix, info)) {
-		if (song != nullptr)
+		if (song != nullptr) {
+			assert(!IsScanning(*song));
 			editor.LockDeleteSong(directory, song);
+		}
 
 		return;
 	}
@@ -61,34 +182,11 @@ try {
 	if (song == nullptr) {
 		FormatDebug(update_domain, "reading %s/%s",
 			    directory.GetPath(), name);
-
-		auto new_song = Song::LoadFile(storage, name, directory);
-		if (!new_song) {
-			FormatDebug(update_domain,
-				    "ignoring unrecognized file %s/%s",
-				    directory.GetPath(), name);
-			return;
-		}
-
-		{
-			const ScopeDatabaseLock protect;
-			directory.AddSong(std::move(new_song));
-		}
-
-		modified = true;
-		FormatDefault(update_domain, "added %s/%s",
-			      directory.GetPath(), name);
+		ScanSongFile(directory, nullptr, name, info);
 	} else if (info.mtime != song->mtime || walk_discard) {
 		FormatDefault(update_domain, "updating %s/%s",
 			      directory.GetPath(), name);
-		if (!song->UpdateFile(storage)) {
-			FormatDebug(update_domain,
-				    "deleting unrecognized file %s/%s",
-				    directory.GetPath(), name);
-			editor.LockDeleteSong(directory, song);
-		}
-
-		modified = true;
+		ScanSongFile(directory, song, name, info);
 	}
 } catch (...) {
 	FormatError(std::current_exception(),
@@ -48,11 +48,13 @@
 
 UpdateWalk::UpdateWalk(const UpdateConfig &_config,
 		       EventLoop &_loop, DatabaseListener &_listener,
-		       Storage &_storage) noexcept
-	:config(_config), cancel(false),
+		       Storage &_storage, bool _root_storage) noexcept
+	:config(_config), root_storage(_root_storage), cancel(false),
 	 storage(_storage),
 	 editor(_loop, _listener)
 {
+	if (!config.scan_cache_file.IsNull())
+		scan_cache = std::make_unique<ScanCache>(AllocatedPath(config.scan_cache_file));
 }
 
 static void
@@ -73,6 +75,7 @@ UpdateWalk::RemoveExcludedFromDirectory(Directory &directory,
 				AllocatedPath::FromUTF8(child.GetName());
 
 			if (name_fs.IsNull() || exclude_list.Check(name_fs)) {
+				assert(!IsScanning(child));
 				editor.DeleteDirectory(&child);
 				modified = true;
 			}
@@ -83,6 +86,7 @@ UpdateWalk::RemoveExcludedFromDirectory(Directory &directory,
 
 			const auto name_fs = AllocatedPath::FromUTF8(song.filename.c_str());
 			if (name_fs.IsNull() || exclude_list.Check(name_fs)) {
+				assert(!IsScanning(song));
 				editor.DeleteSong(directory, &song);
 				modified = true;
 			}
@@ -96,6 +100,7 @@ UpdateWalk::PurgeDeletedFromDirectory(Directory &directory) noexcept
 			if (child.IsMount() || DirectoryExists(storage, child))
 				return;
 
+			assert(!IsScanning(child));
 			editor.LockDeleteDirectory(&child);
 
 			modified = true;
@@ -104,6 +109,7 @@ UpdateWalk::PurgeDeletedFromDirectory(Directory &directory) noexcept
 	directory.ForEachSongSafe([&](Song &song){
 			if (!directory_child_is_regular(storage, directory,
 							song.filename.c_str())) {
+				assert(!IsScanning(song));
 				editor.LockDeleteSong(directory, &song);
 
 				modified = true;
@@ -117,6 +123,7 @@ UpdateWalk::PurgeDeletedFromDirectory(Directory &directory) noexcept
 						i->name.c_str())) {
 			const ScopeDatabaseLock protect;
 			i = directory.playlists.erase(i);
+			directory.MarkModified();
 		} else
 			++i;
 	}
@@ -209,8 +216,10 @@ try {
 
 		assert(&directory == subdir->parent);
 
-		if (!UpdateDirectory(*subdir, exclude_list, info))
+		if (!UpdateDirectory(*subdir, exclude_list, info)) {
+			assert(!IsScanning(*subdir));
 			editor.LockDeleteDirectory(subdir);
+		}
 	} else {
 		FormatDebug(update_domain,
 			    "%s is not a directory, archive or music", name);
@@ -362,7 +371,11 @@ UpdateWalk::UpdateDirectory(Directory &directory,
 		UpdateDirectoryChild(directory, child_exclude_list, name_utf8, info2);
 	}
 
-	directory.mtime = info.mtime;
+	if (directory.mtime != info.mtime) {
+		const ScopeDatabaseLock protect;
+		directory.mtime = info.mtime;
+		directory.MarkModified();
+	}
 
 	return true;
 }
@@ -374,7 +387,7 @@ UpdateWalk::DirectoryMakeChildChecked(Directory &parent,
 {
 	Directory *directory;
 	{
-		const ScopeDatabaseLock protect;
+		const ScopeDatabaseSharedLock protect;
 		directory = parent.FindChild(name_utf8);
 	}
 
@@ -462,29 +475,95 @@ try {
 	LogError(std::current_exception());
 }
 
-bool
-UpdateWalk::Walk(Directory &root, const char *path, bool discard) noexcept
+static double
+ToSeconds(std::chrono::steady_clock::duration d) noexcept
 {
-	walk_discard = discard;
-	modified = false;
+	return std::chrono::duration_cast<std::chrono::duration<double>>(d).count();
+}
 
+inline void
+UpdateWalk::WalkRoot(Directory &root, const char *path) noexcept
+{
 	if (path != nullptr && !isRootDirectory(path)) {
 		UpdateUri(root, path);
 	} else {
 		StorageFileInfo info;
 		if (!GetInfo(storage, "", info))
-			return false;
+			return;
 
 		if (!info.IsDirectory()) {
 			FormatError(update_domain, "Not a directory: %s",
 				    storage.MapUTF8("").c_str());
-			return false;
+			return;
 		}
 
 		ExcludeList exclude_list;
 
 		UpdateDirectory(root, exclude_list, info);
 	}
+}
+
+bool
+UpdateWalk::Walk(Directory &root, const char *path, bool discard) noexcept
+{
+	walk_discard = discard;
+	modified = false;
+
+	scan_duration = merge_duration = wait_duration = {};
+	n_scanned = 0;
+
+	if (config.threads > 1) {
+		try {
+			scan_pool = std::make_unique<ScanPool>(storage,
+							       config.threads);
+		} catch (...) {
+			LogError(std::current_exception(),
+				 "Failed to start update threads");
+		}
+	}
+
+	const bool parallel = scan_pool != nullptr;
+	const auto start = std::chrono::steady_clock::now();
+
+	WalkRoot(root, path);
+
+	if (parallel) {
+		/* wait for the files which are still being loaded,
+		   and merge them */
+		const auto wait_start = std::chrono::steady_clock::now();
+		auto jobs = scan_pool->WaitAll();
+		wait_duration += std::chrono::steady_clock::now() - wait_start;
+
+		CommitScanJobs(std::move(jobs));
+		scan_pool.reset();
+	}
+
+	/* the walk phase is what's left after subtracting the
+	   other phases which happened in this thread */
+	const auto total_duration = std::chrono::steady_clock::now() - start;
+	auto walk_duration = total_duration - merge_duration - wait_duration;
+	if (!parallel)
+		walk_duration -= scan_duration;
+
+	FormatDebug(update_domain,
+		    "update took %.3fs: walk %.3fs, "
+		    "scan %u files %.3fs (%u threads), "
+		    "merge %.3fs, wait %.3fs",
+		    ToSeconds(total_duration), ToSeconds(walk_duration),
+		    n_scanned, ToSeconds(scan_duration),
+		    parallel ? config.threads : 1,
+		    ToSeconds(merge_duration), ToSeconds(wait_duration));
+
+	if (scan_cache != nullptr) {
+		FormatDebug(update_domain, "scan cache: %u hits, %u misses",
+			    scan_cache->GetHits(), scan_cache->GetMisses());
+		if (root_storage && *path == 0 && !cancel)
+			/* the walk has seen all files; drop the
+			   entries of files which have been deleted */
+			scan_cache->Prune();
+
+		scan_cache->Flush();
+	}
 
 	return modified;
 }
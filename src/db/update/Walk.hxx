@@ -22,10 +22,14 @@
 
 #include "Config.hxx"
 #include "Editor.hxx"
+#include "ScanPool.hxx"
+#include "ScanCache.hxx"
 #include "util/Compiler.h"
 #include "config.h"
 
 #include <atomic>
+#include <chrono>
+#include <memory>
 
 struct StorageFileInfo;
 struct Directory;
@@ -45,6 +49,13 @@ class UpdateWalk final {
 	bool walk_discard;
 	bool modified;
 
+	/**
+	 * Is #storage the root storage (and not a mounted one)?  Only
+	 * a walk over the whole root storage prunes the #scan_cache,
+	 * because a mounted storage may share a device with it.
+	 */
+	const bool root_storage;
+
 	/**
 	 * Set to true by the main thread when the update thread shall
 	 * cancel as quickly as possible.  Access to this flag is
@@ -56,10 +67,30 @@ class UpdateWalk final {
 
 	DatabaseEditor editor;
 
+	/**
+	 * Loads song files in other threads; nullptr if
+	 * UpdateConfig::threads is 1.
+	 */
+	std::unique_ptr<ScanPool> scan_pool;
+
+	/**
+	 * Provides tags of files which have been scanned before;
+	 * nullptr if UpdateConfig::scan_cache_file is not set.
+	 */
+	std::unique_ptr<ScanCache> scan_cache;
+
+	/**
+	 * Statistics for the log message at the end of Walk().  The
+	 * scan duration is the sum over all threads.
+	 */
+	std::chrono::steady_clock::duration scan_duration, merge_duration,
+		wait_duration;
+	unsigned n_scanned;
+
 public:
 	UpdateWalk(const UpdateConfig &_config,
 		   EventLoop &_loop, DatabaseListener &_listener,
-		   Storage &_storage) noexcept;
+		   Storage &_storage, bool _root_storage) noexcept;
 
 	/**
 	 * Cancel the current update and quit the Walk() method as
@@ -84,6 +115,44 @@ private:
 
 	void PurgeDeletedFromDirectory(Directory &directory) noexcept;
 
+#ifndef NDEBUG
+	/**
+	 * Is the given directory (or one of its descendants) still
+	 * being loaded by the #scan_pool?  Such a directory must not
+	 * be deleted.  For assertions.
+	 */
+	gcc_pure
+	bool IsScanning(const Directory &directory) const noexcept {
+		return scan_pool != nullptr &&
+			scan_pool->IsReferenced(directory);
+	}
+
+	gcc_pure
+	bool IsScanning(const Song &song) const noexcept {
+		return scan_pool != nullptr && scan_pool->IsReferenced(song);
+	}
+#endif
+
+	/**
+	 * Load the given song file, either from the #scan_cache, now
+	 * or in the #scan_pool, and merge the result into the
+	 * database.
+	 *
+	 * @param song the existing song object, or nullptr if this is
+	 * a new file
+	 */
+	void ScanSongFile(Directory &directory, Song *song,
+			  const char *name,
+			  const StorageFileInfo &info) noexcept;
+
+	/**
+	 * Merge the result of loading a song file into the database.
+	 */
+	void CommitSongFile(Directory &directory, Song *song,
+			    const char *name, SongPtr new_song) noexcept;
+
+	void CommitScanJobs(ScanPool::JobList &&jobs) noexcept;
+
 	void UpdateSongFile2(Directory &directory,
 			     const char *name, const char *suffix,
 			     const StorageFileInfo &info) noexcept;
@@ -168,6 +237,8 @@ private:
 						 const char *uri) noexcept;
 
 	void UpdateUri(Directory &root, const char *uri) noexcept;
+
+	void WalkRoot(Directory &root, const char *path) noexcept;
 };
 
 #endif
@@ -381,6 +381,20 @@ DecoderBridge::OpenUri(const char *uri)
 	Mutex &mutex = dc.mutex;
 	Cond &cond = dc.cond;
 
+	if (dc.input_cache != nullptr) {
+		/* remote streams are never added to the cache here
+		   (only by the prefetcher), because opening a stream
+		   which turns out to be not eligible (e.g. a radio
+		   station) would waste time */
+		auto lease = dc.input_cache->Get(uri, false);
+		if (lease) {
+			auto is = std::make_unique<CacheInputStream>(std::move(lease),
+								     mutex);
+			is->SetHandler(&dc);
+			return is;
+		}
+	}
+
 	auto is = InputStream::Open(uri, mutex);
 	is->SetHandler(&dc);
 
@@ -440,18 +454,14 @@ DecoderBridge::SubmitTimestamp(FloatDuration t) noexcept
 }
 
 DecoderCommand
-DecoderBridge::SubmitData(InputStream *is,
-			  const void *data, size_t length,
-			  uint16_t kbit_rate) noexcept
+DecoderBridge::PrepareSubmit(InputStream *is) noexcept
 {
 	assert(dc.state == DecoderState::DECODE);
 	assert(dc.pipe != nullptr);
-	assert(length % dc.in_audio_format.GetFrameSize() == 0);
 
 	DecoderCommand cmd = LockGetVirtualCommand();
 
-	if (cmd == DecoderCommand::STOP || cmd == DecoderCommand::SEEK ||
-	    length == 0)
+	if (cmd == DecoderCommand::STOP || cmd == DecoderCommand::SEEK)
 		return cmd;
 
 	assert(!initial_seek_pending);
@@ -472,29 +482,56 @@ DecoderBridge::SubmitData(InputStream *is,
 			return cmd;
 	}
 
-	cmd = DecoderCommand::NONE;
-
-	const size_t frame_size = dc.in_audio_format.GetFrameSize();
-	size_t data_frames = length / frame_size;
+	return DecoderCommand::NONE;
+}
 
-	if (dc.end_time.IsPositive()) {
-		/* enforce the given end time */
+DecoderCommand
+DecoderBridge::ClipEndTime(size_t &n_frames) const noexcept
+{
+	if (!dc.end_time.IsPositive())
+		return DecoderCommand::NONE;
 
-		const uint64_t end_frame =
-			dc.end_time.ToScale<uint64_t>(dc.in_audio_format.sample_rate);
-		if (absolute_frame >= end_frame)
-			return DecoderCommand::STOP;
+	const uint64_t end_frame =
+		dc.end_time.ToScale<uint64_t>(dc.in_audio_format.sample_rate);
+	if (absolute_frame >= end_frame) {
+		n_frames = 0;
+		return DecoderCommand::STOP;
+	}
 
-		const uint64_t remaining_frames = end_frame - absolute_frame;
-		if (data_frames >= remaining_frames) {
-			/* past the end of the range: truncate this
-			   data submission and stop the decoder */
-			data_frames = remaining_frames;
-			length = data_frames * frame_size;
-			cmd = DecoderCommand::STOP;
-		}
+	const uint64_t remaining_frames = end_frame - absolute_frame;
+	if (n_frames >= remaining_frames) {
+		/* past the end of the range: truncate this data
+		   submission and stop the decoder */
+		n_frames = remaining_frames;
+		return DecoderCommand::STOP;
 	}
 
+	return DecoderCommand::NONE;
+}
+
+DecoderCommand
+DecoderBridge::SubmitData(InputStream *is,
+			  const void *data, size_t length,
+			  uint16_t kbit_rate) noexcept
+{
+	assert(length % dc.in_audio_format.GetFrameSize() == 0);
+
+	if (length == 0)
+		return LockGetVirtualCommand();
+
+	DecoderCommand cmd = PrepareSubmit(is);
+	if (cmd != DecoderCommand::NONE)
+		return cmd;
+
+	/* enforce the given end time */
+
+	const size_t frame_size = dc.in_audio_format.GetFrameSize();
+	size_t data_frames = length / frame_size;
+	cmd = ClipEndTime(data_frames);
+	length = data_frames * frame_size;
+	if (length == 0)
+		return cmd;
+
 	if (convert != nullptr) {
 		assert(dc.in_audio_format != dc.out_audio_format);
 
@@ -558,6 +595,77 @@ DecoderBridge::SubmitData(InputStream *is,
 	return cmd;
 }
 
+WritableBuffer<void>
+DecoderBridge::GetWriteBuffer(InputStream *is) noexcept
+{
+	if (convert != nullptr)
+		/* the data must be converted before it can be
+		   stored in the chunk; SubmitData() does that */
+		return DecoderClient::GetWriteBuffer(is);
+
+	assert(dc.in_audio_format == dc.out_audio_format);
+
+	if (PrepareSubmit(is) != DecoderCommand::NONE)
+		return nullptr;
+
+	while (true) {
+		auto *chunk = GetChunk();
+		if (chunk == nullptr) {
+			assert(dc.command != DecoderCommand::NONE);
+			return nullptr;
+		}
+
+		const auto dest =
+			chunk->Write(dc.out_audio_format,
+				     SongTime::Cast(timestamp) -
+				     dc.song->GetStartTime(),
+				     0);
+		if (!dest.empty())
+			return dest;
+
+		/* the chunk is full, flush it */
+		FlushChunk();
+	}
+}
+
+DecoderCommand
+DecoderBridge::CommitWrite(InputStream *is, size_t length,
+			   uint16_t kbit_rate) noexcept
+{
+	if (convert != nullptr)
+		return DecoderClient::CommitWrite(is, length, kbit_rate);
+
+	const size_t frame_size = dc.out_audio_format.GetFrameSize();
+	assert(length % frame_size == 0);
+
+	size_t data_frames = length / frame_size;
+	const DecoderCommand cmd = ClipEndTime(data_frames);
+	length = data_frames * frame_size;
+
+	/* the data has already been written to the chunk by the
+	   decoder plugin; all that's left to do is to expand it */
+
+	auto *chunk = current_chunk.get();
+	assert(chunk != nullptr);
+
+	gcc_unused
+	const auto dest =
+		chunk->Write(dc.out_audio_format,
+			     SongTime::Cast(timestamp) -
+			     dc.song->GetStartTime(),
+			     kbit_rate);
+	assert(length <= dest.size);
+
+	if (chunk->Expand(dc.out_audio_format, length))
+		/* the chunk is full, flush it */
+		FlushChunk();
+
+	timestamp += dc.out_audio_format.SizeToTime<FloatDuration>(length);
+	absolute_frame += data_frames;
+
+	return cmd;
+}
+
 DecoderCommand
 DecoderBridge::SubmitTag(InputStream *is, Tag &&tag) noexcept
 {
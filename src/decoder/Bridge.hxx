@@ -174,6 +174,9 @@ public:
 	DecoderCommand SubmitData(InputStream *is,
 				  const void *data, size_t length,
 				  uint16_t kbit_rate) noexcept override;
+	WritableBuffer<void> GetWriteBuffer(InputStream *is) noexcept override;
+	DecoderCommand CommitWrite(InputStream *is, size_t length,
+				   uint16_t kbit_rate) noexcept override;
 	DecoderCommand SubmitTag(InputStream *is, Tag &&tag) noexcept override;
 	void SubmitReplayGain(const ReplayGainInfo *replay_gain_info) noexcept override;
 	void SubmitMixRamp(MixRampInfo &&mix_ramp) noexcept override;
@@ -200,6 +203,23 @@ private:
 	DecoderCommand DoSendTag(const Tag &tag) noexcept;
 
 	bool UpdateStreamTag(InputStream *is) noexcept;
+
+	/**
+	 * Common code for SubmitData() and GetWriteBuffer(): check
+	 * for commands and send the stream tag.
+	 *
+	 * @return DecoderCommand::NONE if data may be submitted
+	 */
+	DecoderCommand PrepareSubmit(InputStream *is) noexcept;
+
+	/**
+	 * Enforce DecoderControl::end_time: truncate the given
+	 * number of frames.
+	 *
+	 * @return DecoderCommand::STOP if the end has been reached
+	 * (after submitting the remaining frames)
+	 */
+	DecoderCommand ClipEndTime(size_t &n_frames) const noexcept;
 };
 
 #endif
@@ -23,8 +23,11 @@
 #include "Command.hxx"
 #include "Chrono.hxx"
 #include "input/Ptr.hxx"
+#include "util/WritableBuffer.hxx"
 #include "util/Compiler.h"
 
+#include <memory>
+
 #include <stdint.h>
 
 struct AudioFormat;
@@ -36,6 +39,14 @@ class MixRampInfo;
  * An interface between the decoder plugin and the MPD core.
  */
 class DecoderClient {
+	static constexpr size_t DEFAULT_WRITE_BUFFER_SIZE = 16384;
+
+	/**
+	 * The buffer returned by the default implementation of
+	 * GetWriteBuffer(); allocated on demand.
+	 */
+	std::unique_ptr<uint8_t[]> write_buffer;
+
 public:
 	/**
 	 * Notify the client that it has finished initialization and
@@ -139,6 +150,46 @@ public:
 		return SubmitData(&is, data, length, kbit_rate);
 	}
 
+	/**
+	 * Obtain a buffer where the decoder plugin can write PCM data
+	 * (in the format passed to Ready()) which is submitted by the
+	 * following CommitWrite() call.  If possible, this points
+	 * into the #MusicChunk, which saves the copy done by
+	 * SubmitData().  No other method may be called until
+	 * CommitWrite().
+	 *
+	 * The decoder plugin must write whole frames; the buffer is
+	 * large enough for at least one frame, but its size may not
+	 * be a multiple of the frame size.
+	 *
+	 * @param is an input stream which is buffering while we are waiting
+	 * for the player
+	 * @return the buffer, or an empty buffer if a command is
+	 * pending (see GetCommand())
+	 */
+	virtual WritableBuffer<void> GetWriteBuffer(InputStream *is) noexcept {
+		(void)is;
+
+		if (!write_buffer)
+			write_buffer = std::make_unique<uint8_t[]>(DEFAULT_WRITE_BUFFER_SIZE);
+
+		return {write_buffer.get(), DEFAULT_WRITE_BUFFER_SIZE};
+	}
+
+	/**
+	 * Submit the data which was written to the buffer returned by
+	 * GetWriteBuffer().
+	 *
+	 * @param length the number of bytes which were written (may
+	 * be 0)
+	 * @return the current command, or DecoderCommand::NONE if there is no
+	 * command pending
+	 */
+	virtual DecoderCommand CommitWrite(InputStream *is, size_t length,
+					   uint16_t kbit_rate) noexcept {
+		return SubmitData(is, write_buffer.get(), length, kbit_rate);
+	}
+
 	/**
 	 * This function is called by the decoder plugin when it has
 	 * successfully decoded a tag.
@@ -22,6 +22,7 @@
 #include <sacd_reader.h>
 #include <sacd_dsdiff.h>
 #include <dst_decoder_mpd.h>
+#include <dst_decoder_pool.h>
 #undef MAX_CHANNELS
 #include "DffDecoderPlugin.hxx"
 #include "../DecoderAPI.hxx"
@@ -175,6 +176,8 @@ dsdiff_scan_info(unsigned track, TagHandler& handler) {
 static bool
 dsdiff_init(const ConfigBlock& block) {
 	param_dstdec_threads = block.GetBlockValue("dstdec_threads", DST_DECODER_THREADS);
+	dst_decoder_pool_t::configure(block.GetBlockValue("dstdec_max_threads", 0U),
+				      block.GetBlockValue("dstdec_pin_threads", false));
 	param_edited_master  = block.GetBlockValue("edited_master", false);
 	param_single_track   = block.GetBlockValue("single_track", false);
 	param_lsbitfirst     = block.GetBlockValue("lsbitfirst", false);
@@ -28,6 +28,8 @@
 #include "../DecoderAPI.hxx"
 #include "input/InputStream.hxx"
 #include "CheckAudioFormat.hxx"
+#include "config/Block.hxx"
+#include "config/Parser.hxx"
 #include "tag/Handler.hxx"
 #include "tag/Builder.hxx"
 #include "song/DetachedSong.hxx"
@@ -54,6 +56,7 @@ using namespace std;
 static const char* DVDA_TRACKXXX_FMT = "AUDIO_TS__TRACK%03u%c.%3s";
 
 static constexpr double SHORT_TRACK_SEC = 2.0;
+static constexpr size_t DEFAULT_READ_AHEAD_SIZE = 4 * 1024 * 1024;
 static constexpr Domain dvdaiso_domain("dvdaiso");
 
 static bool     param_no_downmixes;
@@ -62,6 +65,7 @@ static chmode_t param_playable_area;
 static string   param_tags_path;
 static bool     param_tags_with_iso;
 static bool     param_use_stdio;
+static size_t   param_read_ahead_size;
 
 static string           dvda_uri;
 static dvda_media_t*    dvda_media    = nullptr;
@@ -140,6 +144,9 @@ dvdaiso_update_ifo(const char* path) {
 		else {
 			dvda_media = new dvda_media_stream_t();
 		}
+		if (param_read_ahead_size > 0) {
+			dvda_media = new dvda_media_cache_t(dvda_media, param_read_ahead_size);
+		}
 		if (!dvda_media) {
 			LogError(dvdaiso_domain, "new dvda_media_t() failed");
 			dvda_uri.clear();
@@ -207,6 +214,13 @@ dvdaiso_init(const ConfigBlock& block) {
 	param_tags_path = block.GetBlockValue("tags_path", "");
 	param_tags_with_iso = block.GetBlockValue("tags_with_iso", false);
 	param_use_stdio = block.GetBlockValue("use_stdio", false);
+	param_read_ahead_size = DEFAULT_READ_AHEAD_SIZE;
+	const auto* read_ahead_size = block.GetBlockParam("read_ahead_size");
+	if (read_ahead_size != nullptr) {
+		param_read_ahead_size = read_ahead_size->With([](const char* s) {
+			return ParseSize(s);
+		});
+	}
 	return true;
 }
 
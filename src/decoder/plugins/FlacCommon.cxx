@@ -26,8 +26,11 @@
 #include "Log.hxx"
 #include "input/InputStream.hxx"
 
+#include <algorithm>
 #include <exception>
 
+#include <assert.h>
+
 bool
 FlacDecoder::Initialize(unsigned sample_rate, unsigned bits_per_sample,
 			unsigned channels, FLAC__uint64 total_frames)
@@ -142,10 +145,50 @@ FlacDecoder::OnWrite(const FLAC__Frame &frame,
 	if (!initialized && !OnFirstFrame(frame.header))
 		return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
 
-	chunk = pcm_import.Import(buf, frame.header.blocksize);
-
 	kbit_rate = nbytes * 8 * frame.header.sample_rate /
 		(1000 * frame.header.blocksize);
 
+	if (tag.IsEmpty() && command == DecoderCommand::NONE)
+		/* skip the internal buffer, unless a tag needs to
+		   be submitted first */
+		SubmitFrame(buf, frame.header.blocksize);
+	else
+		chunk = pcm_import.Import(buf, frame.header.blocksize);
+
 	return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
 }
+
+void
+FlacDecoder::SubmitFrame(const FLAC__int32 *const buf[], size_t n_frames)
+{
+	DecoderClient &client = *GetClient();
+	InputStream &is = GetInputStream();
+	const size_t frame_size = pcm_import.GetAudioFormat().GetFrameSize();
+
+	for (size_t offset = 0; offset < n_frames;) {
+		const auto dest = client.GetWriteBuffer(&is);
+		if (dest.empty()) {
+			if (offset == 0)
+				/* a command is pending (e.g. we are
+				   being called by
+				   FLAC__stream_decoder_seek_absolute());
+				   keep the frame for the decoder loop */
+				chunk = pcm_import.Import(buf, n_frames);
+
+			/* else the command makes SubmitData()
+			   discard the rest of this frame anyway */
+			break;
+		}
+
+		const size_t n = std::min(dest.size / frame_size,
+					  n_frames - offset);
+		assert(n > 0);
+
+		pcm_import.ImportTo(dest.data, buf, offset, n);
+		offset += n;
+
+		command = client.CommitWrite(&is, n * frame_size, kbit_rate);
+		if (command != DecoderCommand::NONE)
+			break;
+	}
+}
@@ -61,10 +61,18 @@ struct FlacDecoder : public FlacInput {
 	/**
 	 * Decoded PCM data obtained by our libFLAC write callback.
 	 * If this is non-empty, then DecoderBridge::SubmitData()
-	 * should be called.
+	 * should be called.  This is only used if the data could not
+	 * be written to DecoderClient::GetWriteBuffer() directly.
 	 */
 	ConstBuffer<void> chunk = nullptr;
 
+	/**
+	 * The command returned by DecoderClient::CommitWrite() in
+	 * our libFLAC write callback; to be handled by the decoder
+	 * loop.
+	 */
+	DecoderCommand command = DecoderCommand::NONE;
+
 	FlacDecoder(DecoderClient &_client, InputStream &_input_stream)
 		:FlacInput(_input_stream, &_client) {}
 
@@ -87,6 +95,11 @@ struct FlacDecoder : public FlacInput {
 	FLAC__uint64 GetDeltaPosition(const FLAC__StreamDecoder &sd);
 
 private:
+	/**
+	 * Write the frame directly to DecoderClient::GetWriteBuffer().
+	 */
+	void SubmitFrame(const FLAC__int32 *const buf[], size_t n_frames);
+
 	void OnStreamInfo(const FLAC__StreamMetadata_StreamInfo &stream_info);
 	void OnVorbisComment(const FLAC__StreamMetadata_VorbisComment &vc);
 
@@ -140,6 +140,10 @@ flac_decoder_initialize(FlacDecoder *data, FLAC__StreamDecoder *sd)
 static DecoderCommand
 FlacSubmitToClient(DecoderClient &client, FlacDecoder &d) noexcept
 {
+	if (d.command != DecoderCommand::NONE)
+		/* returned by DecoderClient::CommitWrite() */
+		return std::exchange(d.command, DecoderCommand::NONE);
+
 	if (d.tag.IsEmpty() && d.chunk.empty())
 		return client.GetCommand();
 
@@ -106,3 +106,36 @@ FlacPcmImport::Import(const FLAC__int32 *const src[], size_t n_frames)
 	assert(false);
 	gcc_unreachable();
 }
+
+void
+FlacPcmImport::ImportTo(void *dest, const FLAC__int32 *const src[],
+			size_t offset, size_t n_frames) const noexcept
+{
+	const unsigned n_channels = audio_format.channels;
+	assert(n_channels <= MAX_CHANNELS);
+
+	const FLAC__int32 *src_offset[MAX_CHANNELS];
+	for (unsigned c = 0; c < n_channels; ++c)
+		src_offset[c] = src[c] + offset;
+
+	switch (audio_format.format) {
+	case SampleFormat::S16:
+		FlacImport((int16_t *)dest, src_offset, n_frames, n_channels);
+		break;
+
+	case SampleFormat::S24_P32:
+	case SampleFormat::S32:
+		FlacImport((int32_t *)dest, src_offset, n_frames, n_channels);
+		break;
+
+	case SampleFormat::S8:
+		FlacImport((int8_t *)dest, src_offset, n_frames, n_channels);
+		break;
+
+	case SampleFormat::FLOAT:
+	case SampleFormat::DSD:
+	case SampleFormat::UNDEFINED:
+		assert(false);
+		gcc_unreachable();
+	}
+}
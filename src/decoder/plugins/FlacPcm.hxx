@@ -49,6 +49,16 @@ public:
 
 	ConstBuffer<void> Import(const FLAC__int32 *const src[],
 				 size_t n_frames);
+
+	/**
+	 * Like Import(), but write to the given buffer (e.g. obtained
+	 * from DecoderClient::GetWriteBuffer()) instead of the
+	 * internal one.
+	 *
+	 * @param offset the first frame in #src to be imported
+	 */
+	void ImportTo(void *dest, const FLAC__int32 *const src[],
+		      size_t offset, size_t n_frames) const noexcept;
 };
 
 #endif
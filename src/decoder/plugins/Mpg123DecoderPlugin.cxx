@@ -225,36 +225,46 @@ mpd_mpg123_file_decode(DecoderClient &client, Path path_fs)
 		info.bitrate = 0;
 	}
 
+	const size_t frame_size = audio_format.GetFrameSize();
+
 	/* the decoder main loop */
 	DecoderCommand cmd;
 	do {
 		/* read metadata */
 		mpd_mpg123_meta(client, handle);
 
-		/* decode */
-
-		unsigned char buffer[8192];
-		size_t nbytes;
-		error = mpg123_read(handle, buffer, sizeof(buffer), &nbytes);
-		if (error != MPG123_OK) {
-			if (error != MPG123_DONE)
-				FormatWarning(mpg123_domain,
-					      "mpg123_read() failed: %s",
-					      mpg123_plain_strerror(error));
-			break;
-		}
+		/* decode directly into MPD's buffer */
+
+		const auto dest = client.GetWriteBuffer(nullptr);
+		if (dest.empty()) {
+			/* a command is pending */
+			cmd = client.GetCommand();
+		} else {
+			size_t nbytes;
+			error = mpg123_read(handle, (unsigned char *)dest.data,
+					    dest.size - dest.size % frame_size,
+					    &nbytes);
+			if (error != MPG123_OK) {
+				if (error != MPG123_DONE)
+					FormatWarning(mpg123_domain,
+						      "mpg123_read() failed: %s",
+						      mpg123_plain_strerror(error));
+				break;
+			}
 
-		/* update bitrate for ABR/VBR */
-		if (info.vbr != MPG123_CBR) {
-			/* FIXME: maybe skip, as too expensive? */
-			/* FIXME: maybe, (info.vbr == MPG123_VBR) ? */
-			if (mpg123_info (handle, &info) != MPG123_OK)
-				info.bitrate = 0;
-		}
+			/* update bitrate for ABR/VBR */
+			if (info.vbr != MPG123_CBR) {
+				/* FIXME: maybe skip, as too expensive? */
+				/* FIXME: maybe, (info.vbr == MPG123_VBR) ? */
+				if (mpg123_info (handle, &info) != MPG123_OK)
+					info.bitrate = 0;
+			}
 
-		/* send to MPD */
+			/* send to MPD */
 
-		cmd = client.SubmitData(nullptr, buffer, nbytes, info.bitrate);
+			cmd = client.CommitWrite(nullptr, nbytes,
+						 info.bitrate);
+		}
 
 		if (cmd == DecoderCommand::SEEK) {
 			off_t c = client.GetSeekFrame();
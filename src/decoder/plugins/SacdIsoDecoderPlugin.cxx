@@ -23,11 +23,14 @@
 #include <sacd_disc.h>
 #include <sacd_metabase.h>
 #include <dst_decoder_mpd.h>
+#include <dst_decoder_pool.h>
 #undef MAX_CHANNELS
 #include "SacdIsoDecoderPlugin.hxx"
 #include "../DecoderAPI.hxx"
 #include "input/InputStream.hxx"
 #include "CheckAudioFormat.hxx"
+#include "config/Block.hxx"
+#include "config/Parser.hxx"
 #include "tag/Handler.hxx"
 #include "tag/Builder.hxx"
 #include "song/DetachedSong.hxx"
@@ -56,6 +59,7 @@ static const char* SACD_TRACKXXX_FMT = "%cC_AUDIO__TRACK%03u.%3s";
 static constexpr Domain sacdiso_domain("sacdiso");
 
 static constexpr unsigned DST_DECODER_THREADS = 8;
+static constexpr size_t DEFAULT_READ_AHEAD_SIZE = 4 * 1024 * 1024;
 
 static unsigned  param_dstdec_threads;
 static bool      param_edited_master;
@@ -64,6 +68,7 @@ static area_id_e param_playable_area;
 static string    param_tags_path;
 static bool      param_tags_with_iso;
 static bool      param_use_stdio;
+static size_t    param_read_ahead_size;
 
 static string           sacd_uri;
 static sacd_media_t*    sacd_media    = nullptr;
@@ -143,6 +148,9 @@ sacdiso_update_toc(const char* path) {
 		else {
 			sacd_media = new sacd_media_stream_t();
 		}
+		if (param_read_ahead_size > 0) {
+			sacd_media = new sacd_media_cache_t(sacd_media, param_read_ahead_size);
+		}
 		if (!sacd_media) {
 			LogError(sacdiso_domain, "new sacd_media_t() failed");
 			sacd_uri.clear();
@@ -195,6 +203,8 @@ sacdiso_scan_info(unsigned track, unsigned track_index, TagHandler& handler) {
 static bool
 sacdiso_init(const ConfigBlock& block) {
 	param_dstdec_threads = block.GetBlockValue("dstdec_threads", DST_DECODER_THREADS);
+	dst_decoder_pool_t::configure(block.GetBlockValue("dstdec_max_threads", 0U),
+				      block.GetBlockValue("dstdec_pin_threads", false));
 	param_edited_master  = block.GetBlockValue("edited_master", false);
 	param_lsbitfirst     = block.GetBlockValue("lsbitfirst", false);
 	const char* playable_area = block.GetBlockValue("playable_area", nullptr);
@@ -210,6 +220,13 @@ sacdiso_init(const ConfigBlock& block) {
 	param_tags_path = block.GetBlockValue("tags_path", "");
 	param_tags_with_iso = block.GetBlockValue("tags_with_iso", false);
 	param_use_stdio = block.GetBlockValue("use_stdio", false);
+	param_read_ahead_size = DEFAULT_READ_AHEAD_SIZE;
+	const auto* read_ahead_size = block.GetBlockParam("read_ahead_size");
+	if (read_ahead_size != nullptr) {
+		param_read_ahead_size = read_ahead_size->With([](const char* s) {
+			return ParseSize(s);
+		});
+	}
 	return true;
 }
 
@@ -23,6 +23,11 @@
 
 #include <stdexcept>
 
+/**
+ * The maximum number of reads in one OnSocketReady() call.
+ */
+static constexpr unsigned MAX_READ_ROUNDS = 8;
+
 BufferedSocket::ssize_t
 BufferedSocket::DirectRead(void *data, size_t length) noexcept
 {
@@ -46,7 +51,7 @@ BufferedSocket::DirectRead(void *data, size_t length) noexcept
 	return -1;
 }
 
-bool
+BufferedSocket::ssize_t
 BufferedSocket::ReadToBuffer() noexcept
 {
 	assert(IsDefined());
@@ -58,7 +63,7 @@ BufferedSocket::ReadToBuffer() noexcept
 	if (nbytes > 0)
 		input.Append(nbytes);
 
-	return nbytes >= 0;
+	return nbytes;
 }
 
 bool
@@ -110,8 +115,24 @@ BufferedSocket::OnSocketReady(unsigned flags) noexcept
 	if (flags & READ) {
 		assert(!input.IsFull());
 
-		if (!ReadToBuffer() || !ResumeInput())
-			return false;
+		/* if a read fills all of the buffer space, there is
+		   probably more data in the socket (e.g. a client
+		   which pipelines many commands): after handling the
+		   buffer, read again right away instead of going
+		   through the event loop; the number of rounds is
+		   limited to be fair to other sockets */
+		for (unsigned i = 0;; ++i) {
+			const size_t space = input.Write().size;
+
+			const auto nbytes = ReadToBuffer();
+			if (nbytes < 0 || !ResumeInput())
+				return false;
+
+			if (size_t(nbytes) < space || i + 1 >= MAX_READ_ROUNDS ||
+			    input.IsFull() ||
+			    (GetScheduledFlags() & READ) == 0)
+				break;
+		}
 
 		if (!input.IsFull())
 			ScheduleRead();
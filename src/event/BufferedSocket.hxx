@@ -57,9 +57,11 @@ private:
 	/**
 	 * Receive data from the socket to the input buffer.
 	 *
-	 * @return false if the socket has been closed
+	 * @return the number of bytes read from the socket, 0 if the
+	 * socket isn't ready for reading, -1 if the socket has been
+	 * closed
 	 */
-	bool ReadToBuffer() noexcept;
+	ssize_t ReadToBuffer() noexcept;
 
 protected:
 	/**
@@ -19,37 +19,64 @@
 
 #include "FullyBufferedSocket.hxx"
 #include "net/SocketError.hxx"
+#include "util/WritableBuffer.hxx"
 #include "util/Compiler.h"
 
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
+
 #include <assert.h>
 #include <string.h>
 
+FullyBufferedSocket::ssize_t
+FullyBufferedSocket::HandleWriteError() noexcept
+{
+	const auto code = GetSocketError();
+	if (IsSocketErrorAgain(code))
+		return 0;
+
+	IdleMonitor::Cancel();
+	BufferedSocket::Cancel();
+
+	if (IsSocketErrorClosed(code))
+		OnSocketClosed();
+	else
+		OnSocketError(std::make_exception_ptr(MakeSocketError(code, "Failed to send to socket")));
+
+	return -1;
+}
+
 FullyBufferedSocket::ssize_t
 FullyBufferedSocket::DirectWrite(const void *data, size_t length) noexcept
 {
 	const auto nbytes = GetSocket().Write((const char *)data, length);
-	if (gcc_unlikely(nbytes < 0)) {
-		const auto code = GetSocketError();
-		if (IsSocketErrorAgain(code))
-			return 0;
+	if (gcc_unlikely(nbytes < 0))
+		return HandleWriteError();
 
-		IdleMonitor::Cancel();
-		BufferedSocket::Cancel();
+	return nbytes;
+}
 
-		if (IsSocketErrorClosed(code))
-			OnSocketClosed();
-		else
-			OnSocketError(std::make_exception_ptr(MakeSocketError(code, "Failed to send to socket")));
-	}
+#ifndef _WIN32
+
+FullyBufferedSocket::ssize_t
+FullyBufferedSocket::DirectWrite(const struct iovec *v, size_t n) noexcept
+{
+	const auto nbytes = GetSocket().Write(v, n);
+	if (gcc_unlikely(nbytes < 0))
+		return HandleWriteError();
 
 	return nbytes;
 }
 
+#endif
+
 bool
 FullyBufferedSocket::Flush() noexcept
 {
 	assert(IsDefined());
 
+#ifdef _WIN32
 	const auto data = output.Read();
 	if (data.empty()) {
 		IdleMonitor::Cancel();
@@ -58,6 +85,30 @@ FullyBufferedSocket::Flush() noexcept
 	}
 
 	auto nbytes = DirectWrite(data.data, data.size);
+#else
+	/* send the normal and the peak buffer with one system
+	   call */
+	const auto data = output.ReadAll();
+
+	struct iovec v[2];
+	size_t n = 0;
+	for (const auto &i : data) {
+		if (i.empty())
+			continue;
+
+		v[n].iov_base = i.data;
+		v[n].iov_len = i.size;
+		++n;
+	}
+
+	if (n == 0) {
+		IdleMonitor::Cancel();
+		CancelWrite();
+		return true;
+	}
+
+	auto nbytes = DirectWrite(v, n);
+#endif
 	if (gcc_unlikely(nbytes <= 0))
 		return nbytes == 0;
 
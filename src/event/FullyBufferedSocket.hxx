@@ -24,6 +24,8 @@
 #include "IdleMonitor.hxx"
 #include "util/PeakBuffer.hxx"
 
+struct iovec;
+
 /**
  * A #BufferedSocket specialization that adds an output buffer.
  */
@@ -53,6 +55,21 @@ private:
 	 */
 	ssize_t DirectWrite(const void *data, size_t length) noexcept;
 
+#ifndef _WIN32
+	/**
+	 * Like DirectWrite(), but gather data from several buffers.
+	 */
+	ssize_t DirectWrite(const struct iovec *v, size_t n) noexcept;
+#endif
+
+	/**
+	 * Handle a failed send() call.
+	 *
+	 * @return 0 if the socket isn't ready for writing, -1 if the
+	 * socket has been closed
+	 */
+	ssize_t HandleWriteError() noexcept;
+
 protected:
 	/**
 	 * Send data from the output buffer to the socket.
@@ -0,0 +1,295 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "config.h"
+
+#ifdef USE_IO_URING
+
+#include "PollGroupUring.hxx"
+
+#include <assert.h>
+#include <endian.h>
+#include <errno.h>
+
+/**
+ * The number of entries in the submission ring.  If more changes are
+ * queued, they are submitted early.
+ */
+static constexpr unsigned URING_ENTRIES = 256;
+
+/**
+ * The number of entries in the completion ring, i.e. the maximum
+ * number of events returned by one ReadEvents() call (the kernel
+ * keeps the rest for the next call).
+ */
+static constexpr unsigned URING_CQ_ENTRIES = 4096;
+
+/**
+ * The user_data of requests whose completions are ignored
+ * (i.e. IORING_OP_POLL_REMOVE).
+ */
+static constexpr uint64_t IGNORE_USER_DATA = 0;
+
+/**
+ * How often GetSqe() tries to make room in a full submission queue
+ * before giving up.
+ */
+static constexpr unsigned MAX_SUBMIT_RETRIES = 16;
+
+/**
+ * How long ReadEvents() waits after io_uring_enter() has failed
+ * before trying again.
+ */
+static constexpr int RETRY_DELAY_MS = 100;
+
+static constexpr uint64_t
+MakeUserData(int fd, uint32_t generation) noexcept
+{
+	return (uint64_t(generation) << 32) | uint32_t(fd);
+}
+
+static constexpr int
+UserDataToFD(uint64_t user_data) noexcept
+{
+	return int(uint32_t(user_data));
+}
+
+PollGroupUring::PollGroupUring()
+	:ring(URING_ENTRIES, URING_CQ_ENTRIES) {}
+
+PollGroupUring::~PollGroupUring() noexcept = default;
+
+struct io_uring_sqe *
+PollGroupUring::GetSqe() noexcept
+{
+	auto *sqe = ring.GetSqe();
+
+	for (unsigned i = 0; sqe == nullptr && i < MAX_SUBMIT_RETRIES; ++i) {
+		/* the submission ring is full: pass its contents to
+		   the kernel now to make room */
+		const int result = ring.Submit();
+		if (result == -EBUSY)
+			/* the completion queue has overflowed, and the
+			   kernel refuses new submissions until it
+			   has room for its backlog */
+			Reap();
+		else if (result < 0 && result != -EINTR && result != -EAGAIN)
+			/* a permanent error */
+			return nullptr;
+
+		sqe = ring.GetSqe();
+	}
+
+	return sqe;
+}
+
+void
+PollGroupUring::Reap() noexcept
+{
+	const struct io_uring_cqe *cqe;
+	while ((cqe = ring.PeekCqe()) != nullptr) {
+		if (cqe->user_data != IGNORE_USER_DATA)
+			reaped.push_back({cqe->user_data, cqe->res});
+		ring.SeenCqe();
+	}
+}
+
+void
+PollGroupUring::Disarm(Item &item) noexcept
+{
+	if (item.armed == 0)
+		return;
+
+	auto *sqe = GetSqe();
+	if (sqe != nullptr) {
+		sqe->opcode = IORING_OP_POLL_REMOVE;
+		sqe->fd = -1;
+		sqe->addr = item.armed;
+		sqe->user_data = IGNORE_USER_DATA;
+	}
+
+	/* if the request could not be cancelled, its completion
+	   will be ignored because it does not match "armed" */
+	item.armed = 0;
+}
+
+void
+PollGroupUring::Enqueue(int fd, Item &item) noexcept
+{
+	if (!item.queued) {
+		item.queued = true;
+		disarmed.push_back(fd);
+	}
+}
+
+bool
+PollGroupUring::Arm(int fd, Item &item) noexcept
+{
+	assert(item.armed == 0);
+
+	auto *sqe = GetSqe();
+	if (sqe == nullptr)
+		return false;
+
+	/* skip generation 0 which would collide with
+	   IGNORE_USER_DATA for fd 0 */
+	if (++generation == 0)
+		++generation;
+
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = fd;
+	sqe->poll32_events = item.events;
+#if __BYTE_ORDER == __BIG_ENDIAN
+	sqe->poll32_events = (sqe->poll32_events << 16) |
+		(sqe->poll32_events >> 16);
+#endif
+	sqe->user_data = item.armed = MakeUserData(fd, generation);
+	return true;
+}
+
+void
+PollGroupUring::ArmAll() noexcept
+{
+	/* file descriptors which could not be armed stay in the
+	   list for the next attempt */
+	size_t n_failed = 0;
+
+	for (const int fd : disarmed) {
+		auto i = items.find(fd);
+		if (i == items.end())
+			continue;
+
+		auto &item = i->second;
+		if (item.armed == 0 && item.events != 0 && !Arm(fd, item)) {
+			disarmed[n_failed++] = fd;
+			continue;
+		}
+
+		item.queued = false;
+	}
+
+	disarmed.resize(n_failed);
+}
+
+bool
+PollGroupUring::Add(int fd, unsigned events, void *obj) noexcept
+{
+	auto i = items.emplace(std::piecewise_construct,
+			       std::forward_as_tuple(fd),
+			       std::forward_as_tuple(obj, events));
+	if (!i.second)
+		return false;
+
+	Enqueue(fd, i.first->second);
+	return true;
+}
+
+bool
+PollGroupUring::Modify(int fd, unsigned events, void *obj) noexcept
+{
+	auto i = items.find(fd);
+	if (i == items.end())
+		return false;
+
+	auto &item = i->second;
+	item.obj = obj;
+
+	if (events != item.events) {
+		item.events = events;
+		Disarm(item);
+		Enqueue(fd, item);
+	}
+
+	return true;
+}
+
+bool
+PollGroupUring::Remove(int fd) noexcept
+{
+	auto i = items.find(fd);
+	if (i == items.end())
+		return false;
+
+	Disarm(i->second);
+	items.erase(i);
+	return true;
+}
+
+inline void
+PollGroupUring::HandleCompletion(PollResultGeneric &result,
+				 uint64_t user_data, int res) noexcept
+{
+	if (user_data == IGNORE_USER_DATA)
+		return;
+
+	const int fd = UserDataToFD(user_data);
+	auto i = items.find(fd);
+	if (i == items.end() || i->second.armed != user_data)
+		/* a cancelled request */
+		return;
+
+	auto &item = i->second;
+	item.armed = 0;
+	Enqueue(fd, item);
+
+	if (res > 0)
+		result.Add(res, item.obj);
+	else if (res < 0 && res != -ECANCELED)
+		result.Add(ERROR, item.obj);
+}
+
+void
+PollGroupUring::ReadEvents(PollResultGeneric &result, int timeout_ms) noexcept
+{
+	ArmAll();
+
+	if (!reaped.empty())
+		/* there are already events; don't wait */
+		timeout_ms = 0;
+
+	const int wait_result = ring.Wait(timeout_ms);
+	if (wait_result < 0 && wait_result != -EINTR &&
+	    wait_result != -EBUSY)
+		/* io_uring_enter() has failed (e.g. ENOMEM); instead
+		   of letting the EventLoop spin, sleep until a
+		   completion arrives or the timeout expires, but not
+		   longer than RETRY_DELAY_MS because the submissions
+		   (including the EventLoop's wakeup) are still
+		   pending.  (EINTR is a signal, and EBUSY is resolved
+		   by consuming the completions below.) */
+		ring.Poll(timeout_ms < 0 || timeout_ms > RETRY_DELAY_MS
+			  ? RETRY_DELAY_MS
+			  : timeout_ms);
+
+	for (const auto &c : reaped)
+		HandleCompletion(result, c.user_data, c.res);
+	reaped.clear();
+
+	const struct io_uring_cqe *cqe;
+	while ((cqe = ring.PeekCqe()) != nullptr) {
+		const uint64_t user_data = cqe->user_data;
+		const int res = cqe->res;
+		ring.SeenCqe();
+
+		HandleCompletion(result, user_data, res);
+	}
+}
+
+#endif
@@ -0,0 +1,149 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_EVENT_POLLGROUP_URING_HXX
+#define MPD_EVENT_POLLGROUP_URING_HXX
+
+#include "PollResultGeneric.hxx"
+#include "system/IoUring.hxx"
+
+#include <unordered_map>
+#include <vector>
+
+#include <stdint.h>
+#include <poll.h>
+
+/**
+ * A #PollGroup implementation which uses one-shot poll requests on
+ * a Linux io_uring.  Registering, modifying and removing file
+ * descriptors does not need a system call; all changes are queued
+ * in the submission ring and passed to the kernel together with
+ * waiting for new events, in one io_uring_enter() call.
+ *
+ * Each poll request completes only once; it is re-armed before the
+ * next wait, which gives the same level-triggered semantics as
+ * poll() and epoll.
+ */
+class PollGroupUring
+{
+	struct Item {
+		void *obj;
+
+		unsigned events;
+
+		/**
+		 * The user_data of the poll request which is
+		 * currently submitted, or 0 if there is none.
+		 */
+		uint64_t armed = 0;
+
+		/**
+		 * Is this file descriptor in #disarmed?
+		 */
+		bool queued = false;
+
+		Item(void *_obj, unsigned _events) noexcept
+			:obj(_obj), events(_events) {}
+	};
+
+	IoUring ring;
+
+	std::unordered_map<int, Item> items;
+
+	/**
+	 * File descriptors whose poll request needs to be (re-)armed
+	 * before the next wait.
+	 */
+	std::vector<int> disarmed;
+
+	struct Completion {
+		uint64_t user_data;
+		int res;
+	};
+
+	/**
+	 * Completions which have been moved out of the completion
+	 * queue by GetSqe() (to let the kernel flush its overflow
+	 * backlog), to be handled by the next ReadEvents() call.
+	 */
+	std::vector<Completion> reaped;
+
+	/**
+	 * Incremented for each poll request to tell completions of
+	 * cancelled requests apart from current ones.
+	 */
+	uint32_t generation = 0;
+
+	PollGroupUring(PollGroupUring &) = delete;
+	PollGroupUring &operator=(PollGroupUring &) = delete;
+public:
+	static constexpr unsigned READ = POLLIN;
+	static constexpr unsigned WRITE = POLLOUT;
+	static constexpr unsigned ERROR = POLLERR;
+	static constexpr unsigned HANGUP = POLLHUP;
+
+	/**
+	 * Throws on error.
+	 */
+	PollGroupUring();
+	~PollGroupUring() noexcept;
+
+	void ReadEvents(PollResultGeneric &result, int timeout_ms) noexcept;
+	bool Add(int fd, unsigned events, void *obj) noexcept;
+	bool Modify(int fd, unsigned events, void *obj) noexcept;
+	bool Remove(int fd) noexcept;
+
+	bool Abandon(int fd) noexcept {
+		/* the pending poll request holds a reference on the
+		   file, so it must be cancelled even though the file
+		   descriptor has already been closed */
+		return Remove(fd);
+	}
+
+private:
+	/**
+	 * Obtain a submission queue entry, submitting the queued
+	 * ones to make room if necessary.
+	 *
+	 * @return nullptr if the kernel does not accept submissions
+	 */
+	struct io_uring_sqe *GetSqe() noexcept;
+
+	/**
+	 * Move all completions to #reaped.
+	 */
+	void Reap() noexcept;
+
+	void Disarm(Item &item) noexcept;
+	void Enqueue(int fd, Item &item) noexcept;
+
+	/**
+	 * @return false if no submission queue entry was available;
+	 * the caller should try again later
+	 */
+	bool Arm(int fd, Item &item) noexcept;
+
+	void ArmAll() noexcept;
+
+	void HandleCompletion(PollResultGeneric &result,
+			      uint64_t user_data, int res) noexcept;
+};
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "MappedFile.hxx"
+#include "FileReader.hxx"
+#include "fs/Path.hxx"
+
+#ifdef _WIN32
+#include <stdexcept>
+#else
+#include "system/Error.hxx"
+
+#include <sys/mman.h>
+#endif
+
+#include <stdint.h>
+
+MappedFile::MappedFile(Path path)
+{
+	FileReader reader(path);
+	size = reader.GetSize();
+
+	if (size == 0) {
+		data = nullptr;
+		return;
+	}
+
+#ifdef _WIN32
+	auto *buffer = new uint8_t[size];
+	try {
+		for (size_t position = 0; position < size;) {
+			size_t nbytes = reader.Read(buffer + position,
+						    size - position);
+			if (nbytes == 0)
+				throw std::runtime_error("Unexpected end of file");
+			position += nbytes;
+		}
+	} catch (...) {
+		delete[] buffer;
+		throw;
+	}
+
+	data = buffer;
+#else
+	void *p = mmap(nullptr, size, PROT_READ, MAP_SHARED,
+		       reader.GetFD().Get(), 0);
+	if (p == MAP_FAILED)
+		throw FormatErrno("Failed to map %s", path.ToUTF8().c_str());
+
+	data = p;
+#endif
+}
+
+MappedFile::~MappedFile() noexcept
+{
+	if (data == nullptr)
+		return;
+
+#ifdef _WIN32
+	delete[] (const uint8_t *)data;
+#else
+	munmap(const_cast<void *>(data), size);
+#endif
+}
@@ -94,6 +94,13 @@ private:
 	 */
 	std::string mime;
 
+	/**
+	 * An opaque string which changes whenever the resource is
+	 * modified (e.g. the HTTP "ETag" or "Last-Modified" header),
+	 * or empty if unknown.
+	 */
+	std::string validator;
+
 public:
 	InputStream(const char *_uri, Mutex &_mutex) noexcept
 		:uri(_uri),
@@ -213,6 +220,19 @@ public:
 		mime = std::move(_mime);
 	}
 
+	gcc_pure
+	const std::string &GetValidator() const noexcept {
+		assert(ready);
+
+		return validator;
+	}
+
+	void SetValidator(std::string &&_validator) noexcept {
+		assert(!ready);
+
+		validator = std::move(_validator);
+	}
+
 	gcc_pure
 	bool KnownSize() const noexcept {
 		assert(ready);
@@ -59,6 +59,9 @@ ProxyInputStream::CopyAttributes()
 			if (input->HasMimeType())
 				SetMimeType(input->GetMimeType());
 
+			if (!input->GetValidator().empty())
+				SetValidator(std::string(input->GetValidator()));
+
 			size = input->KnownSize()
 				? input->GetSize()
 				: UNKNOWN_SIZE;
@@ -23,8 +23,10 @@
 
 static constexpr size_t KILOBYTE = 1024;
 static constexpr size_t MEGABYTE = 1024 * KILOBYTE;
+static constexpr uint64_t GIGABYTE = 1024 * MEGABYTE;
 
 InputCacheConfig::InputCacheConfig(const ConfigBlock &block)
+	:directory(block.GetPath("directory"))
 {
 	size = 256 * MEGABYTE;
 	const auto *size_param = block.GetBlockParam("size");
@@ -32,4 +34,13 @@ InputCacheConfig::InputCacheConfig(const ConfigBlock &block)
 		size = size_param->With([](const char *s){
 			return ParseSize(s);
 		});
+
+	lookahead = block.GetBlockValue("lookahead", 1U);
+
+	disk_size = 4 * GIGABYTE;
+	const auto *disk_size_param = block.GetBlockParam("disk_size");
+	if (disk_size_param != nullptr)
+		disk_size = disk_size_param->With([](const char *s){
+			return ParseSize(s);
+		});
 }
@@ -20,13 +20,29 @@
 #ifndef MPD_INPUT_CACHE_CONFIG_HXX
 #define MPD_INPUT_CACHE_CONFIG_HXX
 
+#include "fs/AllocatedPath.hxx"
+
 #include <stddef.h>
+#include <stdint.h>
 
 struct ConfigBlock;
 
 struct InputCacheConfig {
 	size_t size;
 
+	/**
+	 * The number of queued songs to be prefetched.
+	 */
+	unsigned lookahead;
+
+	/**
+	 * The directory of the on-disk tier; nullptr if it is
+	 * disabled.
+	 */
+	AllocatedPath directory = nullptr;
+
+	uint64_t disk_size;
+
 	explicit InputCacheConfig(const ConfigBlock &block);
 };
 
@@ -0,0 +1,289 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "Disk.hxx"
+#include "fs/FileSystem.hxx"
+#include "fs/FileInfo.hxx"
+#include "fs/io/TextFile.hxx"
+#include "fs/io/FileOutputStream.hxx"
+#include "util/Domain.hxx"
+#include "util/StringCompare.hxx"
+#include "util/RuntimeError.hxx"
+#include "util/StringFormat.hxx"
+#include "Log.hxx"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INDEX_FORMAT_PREFIX "input_cache: "
+#define INDEX_ENTRY_PREFIX "entry: "
+#define INDEX_VALIDATOR_PREFIX "validator: "
+
+static constexpr unsigned INDEX_FORMAT = 2;
+
+static constexpr Domain cache_domain("cache");
+
+/**
+ * Calculate a file name from the URI (64 bit FNV-1a).  Collisions
+ * are possible, but harmless: the older entry is replaced.
+ */
+gcc_pure
+static std::string
+UriToName(const char *uri) noexcept
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (const char *p = uri; *p != 0; ++p) {
+		hash ^= (uint8_t)*p;
+		hash *= 1099511628211ULL;
+	}
+
+	char buffer[17];
+	snprintf(buffer, sizeof(buffer), "%016" PRIx64, hash);
+	return buffer;
+}
+
+InputCacheDisk::InputCacheDisk(AllocatedPath &&_directory,
+			       uint64_t _max_size) noexcept
+	:directory(std::move(_directory)), max_size(_max_size)
+{
+	const auto path = GetIndexPath();
+	if (!FileExists(path))
+		return;
+
+	try {
+		TextFile file(path);
+		Load(file);
+	} catch (...) {
+		LogError(std::current_exception(),
+			 "Failed to load the input cache index");
+	}
+
+	FormatDebug(cache_domain, "loaded input cache index (%zu entries)",
+		    entries.size());
+}
+
+InputCacheDisk::~InputCacheDisk() noexcept
+{
+	if (dirty)
+		WriteIndex(ExportIndex());
+}
+
+AllocatedPath
+InputCacheDisk::GetIndexPath() const noexcept
+{
+	return AllocatedPath::Build(directory, PATH_LITERAL("index"));
+}
+
+AllocatedPath
+InputCacheDisk::MakePath(const char *uri) const noexcept
+{
+	return AllocatedPath::Build(directory,
+				    AllocatedPath::FromUTF8(UriToName(uri).c_str()));
+}
+
+bool
+InputCacheDisk::Contains(const char *uri) const noexcept
+{
+	return by_uri.find(uri) != by_uri.end();
+}
+
+InputCacheDisk::LookupResult
+InputCacheDisk::Lookup(const char *uri) noexcept
+{
+	LookupResult result;
+
+	auto i = by_uri.find(uri);
+	if (i == by_uri.end())
+		return result;
+
+	/* refresh */
+	entries.splice(entries.end(), entries, i->second);
+	dirty = true;
+
+	const auto &e = *i->second;
+	result.path = AllocatedPath::Build(directory,
+					   AllocatedPath::FromUTF8(e.name.c_str()));
+	result.size = e.size;
+	result.validator = e.validator;
+	return result;
+}
+
+void
+InputCacheDisk::Add(const char *uri, uint64_t size,
+		    std::string &&validator) noexcept
+{
+	std::string name = UriToName(uri);
+
+	if (!IsEligible(size) || strchr(uri, '\n') != nullptr ||
+	    validator.empty() ||
+	    validator.find('\n') != std::string::npos) {
+		/* can't be stored in the index */
+		try {
+			RemoveFile(MakePath(uri));
+		} catch (...) {
+			LogError(std::current_exception());
+		}
+
+		return;
+	}
+
+	auto i = by_uri.find(uri);
+	if (i != by_uri.end())
+		Erase(i->second, false);
+
+	i = by_name.find(name);
+	if (i != by_name.end())
+		/* hash collision: the file has already been replaced */
+		Erase(i->second, false);
+
+	entries.emplace_back(uri, std::move(name), size,
+			     std::move(validator));
+	auto e = std::prev(entries.end());
+	by_uri.emplace(e->uri, e);
+	by_name.emplace(e->name, e);
+	total_size += size;
+
+	while (total_size > max_size)
+		Erase(entries.begin(), true);
+
+	dirty = true;
+}
+
+void
+InputCacheDisk::Remove(const char *uri) noexcept
+{
+	auto i = by_uri.find(uri);
+	if (i == by_uri.end())
+		return;
+
+	Erase(i->second, true);
+}
+
+void
+InputCacheDisk::Erase(List::iterator i, bool delete_file) noexcept
+{
+	if (delete_file) {
+		try {
+			RemoveFile(AllocatedPath::Build(directory,
+							AllocatedPath::FromUTF8(i->name.c_str())));
+		} catch (...) {
+			LogError(std::current_exception());
+		}
+	}
+
+	total_size -= i->size;
+	by_uri.erase(i->uri);
+	by_name.erase(i->name);
+	entries.erase(i);
+	dirty = true;
+}
+
+void
+InputCacheDisk::Load(TextFile &file)
+{
+	const char *line = file.ReadLine();
+	const char *p;
+	if (line == nullptr ||
+	    (p = StringAfterPrefix(line, INDEX_FORMAT_PREFIX)) == nullptr)
+		throw std::runtime_error("Input cache index corrupted");
+
+	if (unsigned(atoi(p)) != INDEX_FORMAT)
+		throw std::runtime_error("Input cache index format mismatch");
+
+	while ((line = file.ReadLine()) != nullptr) {
+		p = StringAfterPrefix(line, INDEX_ENTRY_PREFIX);
+		if (p == nullptr)
+			throw FormatRuntimeError("Malformed line: %s", line);
+
+		char *endptr;
+		const uint64_t size = strtoull(p, &endptr, 10);
+		if (*endptr != ' ')
+			throw FormatRuntimeError("Malformed line: %s", line);
+
+		std::string uri(endptr + 1);
+		std::string name = UriToName(uri.c_str());
+
+		line = file.ReadLine();
+		if (line == nullptr ||
+		    (p = StringAfterPrefix(line, INDEX_VALIDATOR_PREFIX)) == nullptr ||
+		    *p == 0)
+			throw FormatRuntimeError("Missing validator for %s",
+						 uri.c_str());
+
+		std::string validator(p);
+
+		/* skip files which have been deleted or truncated
+		   behind our back */
+		const auto path = AllocatedPath::Build(directory,
+						       AllocatedPath::FromUTF8(name.c_str()));
+		FileInfo info;
+		if (!GetFileInfo(path, info) || !info.IsRegular() ||
+		    info.GetSize() != size ||
+		    by_uri.find(uri) != by_uri.end() ||
+		    by_name.find(name) != by_name.end()) {
+			dirty = true;
+			continue;
+		}
+
+		entries.emplace_back(std::move(uri), std::move(name), size,
+				     std::move(validator));
+		auto e = std::prev(entries.end());
+		by_uri.emplace(e->uri, e);
+		by_name.emplace(e->name, e);
+		total_size += size;
+	}
+
+	while (total_size > max_size)
+		Erase(entries.begin(), true);
+}
+
+std::string
+InputCacheDisk::ExportIndex() noexcept
+{
+	std::string index = StringFormat<32>(INDEX_FORMAT_PREFIX "%u\n",
+					     INDEX_FORMAT).c_str();
+
+	for (const auto &i : entries) {
+		index += StringFormat<64>(INDEX_ENTRY_PREFIX "%" PRIu64 " ",
+					  i.size).c_str();
+		index += i.uri;
+		index += "\n" INDEX_VALIDATOR_PREFIX;
+		index += i.validator;
+		index += '\n';
+	}
+
+	dirty = false;
+	return index;
+}
+
+void
+InputCacheDisk::WriteIndex(const std::string &index) const noexcept
+{
+	try {
+		FileOutputStream fos(GetIndexPath());
+		fos.Write(index.data(), index.size());
+		fos.Commit();
+	} catch (...) {
+		LogError(std::current_exception(),
+			 "Failed to save the input cache index");
+	}
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_INPUT_CACHE_DISK_HXX
+#define MPD_INPUT_CACHE_DISK_HXX
+
+#include "fs/AllocatedPath.hxx"
+#include "util/Compiler.h"
+
+#include <list>
+#include <map>
+#include <string>
+
+#include <stdint.h>
+
+class TextFile;
+
+/**
+ * The persistent on-disk tier of the #InputCacheManager.  Files which
+ * are evicted from RAM are stored in a local directory, and an index
+ * file maps their URIs to file names.  The least recently used files
+ * are deleted when the configured size is exceeded.
+ *
+ * This class is not thread-safe; the #InputCacheManager protects it
+ * with its mutex.  Only MakePath() and WriteIndex() may be called
+ * without holding that mutex.  Modifications only mark the index
+ * "dirty"; the #InputCacheManager writes it later, without holding
+ * the mutex during the file I/O.
+ */
+class InputCacheDisk {
+	struct Entry {
+		std::string uri;
+
+		/**
+		 * The file name relative to #directory.
+		 */
+		std::string name;
+
+		uint64_t size;
+
+		/**
+		 * The InputStream::GetValidator() value of the
+		 * original resource at the time it was copied.
+		 */
+		std::string validator;
+
+		Entry(std::string &&_uri, std::string &&_name,
+		      uint64_t _size, std::string &&_validator) noexcept
+			:uri(std::move(_uri)), name(std::move(_name)),
+			 size(_size), validator(std::move(_validator)) {}
+	};
+
+	using List = std::list<Entry>;
+
+	const AllocatedPath directory;
+
+	const uint64_t max_size;
+
+	/**
+	 * All entries; the least recently used one first.
+	 */
+	List entries;
+
+	std::map<std::string, List::iterator, std::less<>> by_uri;
+	std::map<std::string, List::iterator, std::less<>> by_name;
+
+	uint64_t total_size = 0;
+
+	/**
+	 * Was the index modified since it was saved?
+	 */
+	bool dirty = false;
+
+public:
+	/**
+	 * Load the index from the given directory.  Errors are
+	 * logged.
+	 */
+	InputCacheDisk(AllocatedPath &&_directory, uint64_t _max_size) noexcept;
+
+	/**
+	 * Saves the index (if it was modified).
+	 */
+	~InputCacheDisk() noexcept;
+
+	InputCacheDisk(const InputCacheDisk &) = delete;
+	InputCacheDisk &operator=(const InputCacheDisk &) = delete;
+
+	uint64_t GetSize() const noexcept {
+		return total_size;
+	}
+
+	gcc_pure
+	bool Contains(const char *uri) const noexcept;
+
+	struct LookupResult {
+		/**
+		 * The path of the cached file or nullptr if the URI
+		 * is not in the cache.
+		 */
+		AllocatedPath path = nullptr;
+
+		/**
+		 * The size and validator of the original resource,
+		 * which must be compared with the current ones
+		 * before the file may be used.
+		 */
+		uint64_t size = 0;
+		std::string validator;
+	};
+
+	/**
+	 * Look up the given URI and mark it as "recently used".
+	 */
+	LookupResult Lookup(const char *uri) noexcept;
+
+	/**
+	 * Returns the path where the contents of the given URI shall
+	 * be written before calling Add().  This method is
+	 * thread-safe.
+	 */
+	gcc_pure
+	AllocatedPath MakePath(const char *uri) const noexcept;
+
+	/**
+	 * Can a file of the given size be stored?
+	 */
+	bool IsEligible(uint64_t size) const noexcept {
+		return size <= max_size;
+	}
+
+	/**
+	 * Register a file which has been written to MakePath().
+	 * Older entries are deleted if the cache grows too large.
+	 *
+	 * @param validator the InputStream::GetValidator() value of
+	 * the original resource; must not be empty
+	 */
+	void Add(const char *uri, uint64_t size,
+		 std::string &&validator) noexcept;
+
+	/**
+	 * Remove the entry of the given URI (if any) and delete its
+	 * file, e.g. because it has turned out to be unusable.
+	 */
+	void Remove(const char *uri) noexcept;
+
+	bool IsDirty() const noexcept {
+		return dirty;
+	}
+
+	/**
+	 * Serialize the index and clear the "dirty" flag.  Pass the
+	 * result to WriteIndex().
+	 */
+	std::string ExportIndex() noexcept;
+
+	/**
+	 * Write an index obtained from ExportIndex() to the index
+	 * file.  This method is thread-safe.  Errors are logged.
+	 */
+	void WriteIndex(const std::string &index) const noexcept;
+
+private:
+	void Erase(List::iterator i, bool delete_file) noexcept;
+
+	AllocatedPath GetIndexPath() const noexcept;
+
+	void Load(TextFile &file);
+};
+
+#endif
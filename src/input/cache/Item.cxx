@@ -25,7 +25,15 @@
 
 InputCacheItem::InputCacheItem(InputStreamPtr _input) noexcept
 	:BufferingInputStream(std::move(_input)),
-	 uri(GetInput().GetURI())
+	 uri(GetInput().GetURI()),
+	 validator(GetInput().GetValidator())
+{
+}
+
+InputCacheItem::InputCacheItem(InputStreamPtr _input, const char *_uri,
+			       std::string &&_validator) noexcept
+	:BufferingInputStream(std::move(_input)),
+	 uri(_uri), validator(std::move(_validator))
 {
 }
 
@@ -44,6 +44,12 @@ class InputCacheItem final
 {
 	const std::string uri;
 
+	/**
+	 * The InputStream::GetValidator() value of the original
+	 * resource.
+	 */
+	const std::string validator;
+
 	using LeaseList =
 		boost::intrusive::list<InputCacheLease,
 				       boost::intrusive::base_hook<boost::intrusive::list_base_hook<boost::intrusive::link_mode<boost::intrusive::normal_link>>>,
@@ -54,12 +60,24 @@ class InputCacheItem final
 
 public:
 	explicit InputCacheItem(InputStreamPtr _input) noexcept;
+
+	/**
+	 * Construct an item whose URI and validator differ from the
+	 * #InputStream's, e.g. because it reads a copy from the
+	 * on-disk cache.
+	 */
+	InputCacheItem(InputStreamPtr _input, const char *_uri,
+		       std::string &&_validator) noexcept;
 	~InputCacheItem() noexcept;
 
 	const char *GetUri() const noexcept {
 		return uri.c_str();
 	}
 
+	const std::string &GetValidator() const noexcept {
+		return validator;
+	}
+
 	using BufferingInputStream::size;
 
 	bool IsInUse() const noexcept {
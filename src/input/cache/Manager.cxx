@@ -19,14 +19,35 @@
 
 #include "Manager.hxx"
 #include "Config.hxx"
+#include "Disk.hxx"
 #include "Item.hxx"
 #include "Lease.hxx"
 #include "input/InputStream.hxx"
+#include "input/plugins/FileInputPlugin.hxx"
 #include "fs/Traits.hxx"
+#include "fs/io/FileOutputStream.hxx"
+#include "thread/Name.hxx"
 #include "util/DeleteDisposer.hxx"
+#include "util/Domain.hxx"
+#include "util/UriExtract.hxx"
+#include "Log.hxx"
+
+#include <algorithm>
 
 #include <string.h>
 
+static constexpr Domain cache_domain("cache");
+
+/**
+ * The number of entries in InputCacheManager::rejected.
+ */
+static constexpr size_t MAX_REJECTED = 64;
+
+/**
+ * The size of the buffer used to copy items to the disk.
+ */
+static constexpr size_t SPILL_BUFFER_SIZE = 64 * 1024;
+
 inline bool
 InputCacheManager::ItemCompare::operator()(const InputCacheItem &a,
 					   const char *b) const noexcept
@@ -49,12 +70,31 @@ InputCacheManager::ItemCompare::operator()(const InputCacheItem &a,
 }
 
 InputCacheManager::InputCacheManager(const InputCacheConfig &config) noexcept
-	:max_total_size(config.size)
+	:max_total_size(config.size),
+	 lookahead(config.lookahead),
+	 thread(BIND_THIS_METHOD(RunThread))
 {
+	if (!config.directory.IsNull())
+		disk = std::make_unique<InputCacheDisk>(AllocatedPath(config.directory),
+							config.disk_size);
 }
 
 InputCacheManager::~InputCacheManager() noexcept
 {
+	if (thread.IsDefined()) {
+		{
+			const std::lock_guard<Mutex> lock(items_mutex);
+			quit = true;
+			cond.notify_one();
+		}
+
+		thread.Join();
+	}
+
+	/* items which have not been written to disk yet are lost */
+	for (auto *item : spill_queue)
+		delete item;
+
 	items_by_time.clear_and_dispose(DeleteDisposer());
 }
 
@@ -74,54 +114,293 @@ InputCacheManager::Contains(const char *uri) noexcept
 	return Get(uri, false);
 }
 
+bool
+InputCacheManager::IsOnDisk(const char *uri) noexcept
+{
+	/* only remote resources are copied to the disk;
+	   DecoderBridge::OpenLocal() puts local files into this cache
+	   as well, but copying them would be pointless */
+	if (!disk || !uri_has_scheme(uri))
+		return false;
+
+	const std::lock_guard<Mutex> lock(items_mutex);
+
+	if (disk->Contains(uri))
+		return true;
+
+	++stats.disk_misses;
+	return false;
+}
+
+AllocatedPath
+InputCacheManager::LookupDisk(const char *uri,
+			      const InputStream &origin) noexcept
+{
+	const std::lock_guard<Mutex> lock(items_mutex);
+
+	auto cached = disk->Lookup(uri);
+	if (cached.path.IsNull()) {
+		/* evicted by another thread meanwhile */
+		++stats.disk_misses;
+		return nullptr;
+	}
+
+	if (!origin.KnownSize() || origin.GetSize() != cached.size ||
+	    origin.GetValidator() != cached.validator) {
+		FormatDebug(cache_domain, "Discarding stale copy of '%s'",
+			    uri);
+		disk->Remove(uri);
+		++stats.disk_misses;
+		return nullptr;
+	}
+
+	++stats.disk_hits;
+	return std::move(cached.path);
+}
+
 InputCacheLease
 InputCacheManager::Get(const char *uri, bool create)
 {
-	// TODO: allow caching remote files
-	if (!PathTraitsUTF8::IsAbsolute(uri))
+	if (!PathTraitsUTF8::IsAbsolute(uri) && !uri_has_scheme(uri))
 		return {};
 
-	auto iter = items_by_uri.find(uri, items_by_uri.key_comp());
-	if (iter != items_by_uri.end()) {
-		auto &item = *iter;
+	{
+		const std::lock_guard<Mutex> lock(items_mutex);
 
-		/* refresh */
-		items_by_time.erase(items_by_time.iterator_to(item));
-		items_by_time.push_back(item);
+		auto iter = items_by_uri.find(uri, items_by_uri.key_comp());
+		if (iter != items_by_uri.end()) {
+			auto &item = *iter;
+			++stats.ram_hits;
 
-		// TODO revalidate the cache item using the file's mtime?
-		// TODO if cache item contains error, retry now?
+			/* refresh */
+			items_by_time.erase(items_by_time.iterator_to(item));
+			items_by_time.push_back(item);
 
-		return InputCacheLease(item);
+			// TODO revalidate the cache item using the file's mtime?
+			// TODO if cache item contains error, retry now?
+
+			return InputCacheLease(item);
+		}
+
+		++stats.ram_misses;
 	}
 
-	if (!create)
+	const bool on_disk = IsOnDisk(uri);
+	if (!on_disk && !create)
 		return {};
 
+	/* open the stream without holding the lock, because this may
+	   take a while (e.g. on a remote server); this is necessary
+	   even if there is a copy on disk, because its size and
+	   validator need to be compared with the current ones */
+
 	// TODO: wait for "ready" without blocking here
-	auto is = InputStream::OpenReady(uri, mutex);
+	InputStreamPtr is = InputStream::OpenReady(uri, mutex);
 
 	if (!IsEligible(*is))
 		return {};
 
+	std::string validator = is->GetValidator();
+
+	if (on_disk) {
+		const auto disk_path = LookupDisk(uri, *is);
+		if (!disk_path.IsNull()) {
+			/* promote the item from disk to RAM */
+
+			try {
+				is = OpenFileInputStream(disk_path, mutex);
+			} catch (...) {
+				LogError(std::current_exception(),
+					 "Failed to open cached file");
+
+				const std::lock_guard<Mutex> lock(items_mutex);
+				disk->Remove(uri);
+			}
+		}
+	}
+
+	const std::lock_guard<Mutex> lock(items_mutex);
+
+	auto iter = items_by_uri.find(uri, items_by_uri.key_comp());
+	if (iter != items_by_uri.end())
+		/* another thread was quicker */
+		return InputCacheLease(*iter);
+
 	const size_t size = is->GetSize();
 	total_size += size;
 
 	while (total_size > max_total_size && EvictOldestUnused()) {}
 
-	auto *item = new InputCacheItem(std::move(is));
+	auto *item = new InputCacheItem(std::move(is), uri,
+					std::move(validator));
 	items_by_uri.insert(*item);
 	items_by_time.push_back(*item);
 
 	return InputCacheLease(*item);
 }
 
+InputCacheStats
+InputCacheManager::GetStats() const noexcept
+{
+	const std::lock_guard<Mutex> lock(items_mutex);
+
+	InputCacheStats result = stats;
+	result.ram_bytes = total_size;
+	if (disk)
+		result.disk_bytes = disk->GetSize();
+	return result;
+}
+
 void
 InputCacheManager::Prefetch(const char *uri)
 {
 	Get(uri, true);
 }
 
+void
+InputCacheManager::SchedulePrefetch(std::list<std::string> &&uris) noexcept
+{
+	const std::lock_guard<Mutex> lock(items_mutex);
+
+	prefetch_queue.clear();
+
+	for (auto &uri : uris) {
+		if (items_by_uri.find(uri.c_str(),
+				      items_by_uri.key_comp()) != items_by_uri.end() ||
+		    IsRejected(uri))
+			continue;
+
+		prefetch_queue.emplace_back(std::move(uri));
+	}
+
+	if (!prefetch_queue.empty())
+		WakeThread();
+}
+
+void
+InputCacheManager::WakeThread() noexcept
+{
+	if (!thread.IsDefined())
+		thread.Start();
+	else
+		cond.notify_one();
+}
+
+bool
+InputCacheManager::IsRejected(const std::string &uri) const noexcept
+{
+	return std::find(rejected.begin(), rejected.end(), uri) != rejected.end();
+}
+
+void
+InputCacheManager::Reject(std::string &&uri) noexcept
+{
+	if (rejected.size() >= MAX_REJECTED)
+		rejected.pop_front();
+
+	rejected.emplace_back(std::move(uri));
+}
+
+void
+InputCacheManager::Spill(InputCacheItem &item) noexcept
+{
+	const char *const uri = item.GetUri();
+	const size_t size = item.size();
+
+	try {
+		FileOutputStream fos(disk->MakePath(uri));
+
+		std::unique_ptr<uint8_t[]> buffer(new uint8_t[SPILL_BUFFER_SIZE]);
+
+		std::unique_lock<Mutex> lock(item.mutex);
+		for (size_t offset = 0; offset < size;) {
+			/* this waits until the item's thread has
+			   buffered the data */
+			size_t nbytes = item.Read(lock, offset, buffer.get(),
+						  SPILL_BUFFER_SIZE);
+
+			{
+				const ScopeUnlock unlock(item.mutex);
+				fos.Write(buffer.get(), nbytes);
+			}
+
+			offset += nbytes;
+		}
+
+		lock.unlock();
+
+		fos.Commit();
+	} catch (...) {
+		FormatError(std::current_exception(),
+			    "Failed to copy '%s' to the cache directory", uri);
+		return;
+	}
+
+	FormatDebug(cache_domain, "Moved '%s' to disk", uri);
+
+	const std::lock_guard<Mutex> lock(items_mutex);
+	disk->Add(uri, size, std::string(item.GetValidator()));
+}
+
+void
+InputCacheManager::RunThread() noexcept
+{
+	SetThreadName("input_cache");
+
+	std::unique_lock<Mutex> lock(items_mutex);
+
+	while (!quit) {
+		if (!spill_queue.empty()) {
+			/* spilling has priority, because the evicted
+			   items still occupy memory */
+			auto *item = spill_queue.front();
+			spill_queue.pop_front();
+
+			const ScopeUnlock unlock(items_mutex);
+			Spill(*item);
+			delete item;
+			continue;
+		}
+
+		if (prefetch_queue.empty()) {
+			if (disk && disk->IsDirty()) {
+				/* write the index without holding the
+				   lock, because this does disk I/O */
+				const auto index = disk->ExportIndex();
+				const ScopeUnlock unlock(items_mutex);
+				disk->WriteIndex(index);
+				continue;
+			}
+
+			cond.wait(lock);
+			continue;
+		}
+
+		std::string uri = std::move(prefetch_queue.front());
+		prefetch_queue.pop_front();
+
+		bool success = false;
+
+		{
+			const ScopeUnlock unlock(items_mutex);
+
+			FormatDebug(cache_domain, "Prefetch '%s'",
+				    uri.c_str());
+
+			try {
+				success = Get(uri.c_str(), true);
+			} catch (...) {
+				FormatError(std::current_exception(),
+					    "Prefetch '%s' failed",
+					    uri.c_str());
+			}
+		}
+
+		if (!success)
+			Reject(std::move(uri));
+	}
+}
+
 void
 InputCacheManager::Remove(InputCacheItem &item) noexcept
 {
@@ -133,10 +412,21 @@ InputCacheManager::Remove(InputCacheItem &item) noexcept
 }
 
 void
-InputCacheManager::Delete(InputCacheItem *item) noexcept
+InputCacheManager::Evict(InputCacheItem *item) noexcept
 {
 	Remove(*item);
-	delete item;
+
+	/* local files are never copied to the disk (see
+	   IsOnDisk()), and copies of resources without a validator
+	   could never be used */
+	if (disk && uri_has_scheme(item->GetUri()) &&
+	    !item->GetValidator().empty() &&
+	    !disk->Contains(item->GetUri()) &&
+	    disk->IsEligible(item->size())) {
+		spill_queue.push_back(item);
+		WakeThread();
+	} else
+		delete item;
 }
 
 InputCacheItem *
@@ -156,6 +446,6 @@ InputCacheManager::EvictOldestUnused() noexcept
 	if (item == nullptr)
 		return false;
 
-	Delete(item);
+	Evict(item);
 	return true;
 }
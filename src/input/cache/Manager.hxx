@@ -21,27 +21,81 @@
 #define MPD_INPUT_CACHE_MANAGER_HXX
 
 #include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Thread.hxx"
 #include "util/Compiler.h"
 
 #include <boost/intrusive/set.hpp>
 #include <boost/intrusive/list.hpp>
 
+#include <list>
+#include <memory>
+#include <string>
+
+#include <stdint.h>
+
 class InputStream;
 class InputCacheItem;
 class InputCacheLease;
+class AllocatedPath;
+class InputCacheDisk;
 struct InputCacheConfig;
 
+struct InputCacheStats {
+	/**
+	 * The number of lookups which were (not) answered from RAM.
+	 */
+	unsigned long ram_hits = 0, ram_misses = 0;
+
+	/**
+	 * The number of RAM misses which were (not) answered from the
+	 * on-disk tier.
+	 */
+	unsigned long disk_hits = 0, disk_misses = 0;
+
+	/**
+	 * The number of bytes currently stored in each tier.
+	 */
+	uint64_t ram_bytes = 0, disk_bytes = 0;
+};
+
 /**
  * A class which caches files in RAM.  It is supposed to prefetch
- * files before they are played.
+ * files before they are played.  Optionally, items evicted from RAM
+ * are moved to a second, persistent tier on disk (#InputCacheDisk),
+ * and promoted back to RAM when they are accessed again.
+ *
+ * This class is thread-safe: it is used by the main thread (which
+ * schedules prefetching), the decoder threads and its own worker
+ * thread.
  */
 class InputCacheManager {
 	const size_t max_total_size;
 
+	/**
+	 * The number of queued songs to be prefetched.
+	 */
+	const unsigned lookahead;
+
+	/**
+	 * The #Mutex for all #InputStream instances owned by this
+	 * object.
+	 */
 	mutable Mutex mutex;
 
+	/**
+	 * Protects #items_by_time, #items_by_uri, #total_size, #disk,
+	 * #stats and the queues.  It may be locked before #mutex, but
+	 * not the other way round.
+	 */
+	mutable Mutex items_mutex;
+
 	size_t total_size = 0;
 
+	std::unique_ptr<InputCacheDisk> disk;
+
+	InputCacheStats stats;
+
 	struct ItemCompare {
 		gcc_pure
 		bool operator()(const InputCacheItem &a,
@@ -68,10 +122,55 @@ class InputCacheManager {
 
 	UriMap items_by_uri;
 
+	/**
+	 * The URIs which shall be prefetched by #thread, in this
+	 * order.
+	 */
+	std::list<std::string> prefetch_queue;
+
+	/**
+	 * Items which have been evicted from RAM, and shall be written
+	 * to #disk by #thread.  They are not in #items_by_uri
+	 * anymore.
+	 */
+	std::list<InputCacheItem *> spill_queue;
+
+	/**
+	 * URIs which have been found to be not eligible for caching
+	 * (or which have failed to open) recently.  They are not
+	 * prefetched again, because that would be expensive for
+	 * remote streams.
+	 */
+	std::list<std::string> rejected;
+
+	/**
+	 * Wakes up #thread.
+	 */
+	Cond cond;
+
+	/**
+	 * This thread prefetches songs and writes evicted items to
+	 * #disk.
+	 */
+	Thread thread;
+
+	bool quit = false;
+
 public:
 	explicit InputCacheManager(const InputCacheConfig &config) noexcept;
 	~InputCacheManager() noexcept;
 
+	unsigned GetLookahead() const noexcept {
+		return lookahead;
+	}
+
+	bool HasDisk() const noexcept {
+		return disk != nullptr;
+	}
+
+	gcc_pure
+	InputCacheStats GetStats() const noexcept;
+
 	gcc_pure
 	bool Contains(const char *uri) noexcept;
 
@@ -91,7 +190,49 @@ public:
 	 */
 	void Prefetch(const char *uri);
 
+	/**
+	 * Prefetch the given URIs (in this order) in a background
+	 * thread.  This replaces the URIs from the previous call
+	 * which have not yet been prefetched.
+	 */
+	void SchedulePrefetch(std::list<std::string> &&uris) noexcept;
+
 private:
+	gcc_pure
+	bool IsRejected(const std::string &uri) const noexcept;
+
+	void Reject(std::string &&uri) noexcept;
+
+	/**
+	 * Start #thread or wake it up.  Caller must lock
+	 * #items_mutex.
+	 */
+	void WakeThread() noexcept;
+
+	/**
+	 * Is there a copy of the given URI in #disk?  Counts a miss
+	 * if not.  Caller must not hold #items_mutex.
+	 */
+	bool IsOnDisk(const char *uri) noexcept;
+
+	/**
+	 * Look up the given URI in #disk, compare its size and
+	 * validator with the freshly opened original resource and
+	 * update the counters.  Stale copies are deleted.  Caller
+	 * must not hold #items_mutex.
+	 *
+	 * @return the path of the cached file or nullptr
+	 */
+	AllocatedPath LookupDisk(const char *uri,
+				 const InputStream &origin) noexcept;
+
+	/**
+	 * Write the contents of the given item to #disk.
+	 */
+	void Spill(InputCacheItem &item) noexcept;
+
+	void RunThread() noexcept;
+
 	/**
 	 * Check whether the given #InputStream can be stored in this
 	 * cache.
@@ -99,7 +240,12 @@ private:
 	bool IsEligible(const InputStream &input) noexcept;
 
 	void Remove(InputCacheItem &item) noexcept;
-	void Delete(InputCacheItem *item) noexcept;
+
+	/**
+	 * Remove the item from RAM, and move it to the #spill_queue
+	 * (if it is eligible for #disk) or delete it.
+	 */
+	void Evict(InputCacheItem *item) noexcept;
 
 	InputCacheItem *FindOldestUnused() noexcept;
 
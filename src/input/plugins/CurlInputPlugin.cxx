@@ -254,6 +254,12 @@ CurlInputStream::OnHeaders(unsigned status,
 	if (i != headers.end())
 		SetMimeType(std::move(i->second));
 
+	i = headers.find("etag");
+	if (i == headers.end())
+		i = headers.find("last-modified");
+	if (i != headers.end())
+		SetValidator(std::move(i->second));
+
 	i = headers.find("icy-name");
 	if (i == headers.end()) {
 		i = headers.find("ice-name");
@@ -40,6 +40,7 @@ public:
 		 ctx(_ctx), fd(_fd) {
 		seekable = true;
 		size = st.st_size;
+		SetValidator(std::to_string(st.st_mtime));
 		SetReady();
 	}
 
@@ -22,6 +22,9 @@
 #include <unistd.h>
 
 #include "dvda_media.h"
+#include "util/Domain.hxx"
+
+static constexpr Domain dvda_media_domain("dvda_media");
 
 dvda_media_file_t::dvda_media_file_t() {
 	fd = -1;
@@ -168,3 +171,88 @@ int64_t dvda_media_stream_t::skip(int64_t bytes) {
 	}
 	return position;
 }
+
+dvda_media_cache_t::dvda_media_cache_t(dvda_media_t* _media, size_t cache_size) : media(_media), cache(*this, cache_size) {
+	position = 0;
+	is_open = false;
+}
+
+dvda_media_cache_t::~dvda_media_cache_t() {
+	close();
+	delete media;
+}
+
+const char* dvda_media_cache_t::get_name() {
+	return media->get_name();
+}
+
+int64_t dvda_media_cache_t::get_position() {
+	return position;
+}
+
+int64_t dvda_media_cache_t::get_size() {
+	return media->get_size();
+}
+
+bool dvda_media_cache_t::open(const char* path) {
+	if (!media->open(path)) {
+		return false;
+	}
+	position = 0;
+	try {
+		int64_t size = media->get_size();
+		cache.Start(size >= 0 ? (uint64_t)size : UINT64_MAX);
+		is_open = true;
+	}
+	catch (const std::exception &e) {
+		LogError(e);
+		media->close();
+		return false;
+	}
+	return true;
+}
+
+bool dvda_media_cache_t::close() {
+	if (is_open) {
+		cache.Stop();
+		is_open = false;
+		auto stats = cache.GetStats();
+		FormatDebug(dvda_media_domain, "read-ahead: %.1f%% hit ratio (%llu hits, %llu misses, %llu blocks prefetched)",
+			100 * stats.GetHitRatio(), (unsigned long long)stats.hits, (unsigned long long)stats.misses, (unsigned long long)stats.prefetched);
+	}
+	return media->close();
+}
+
+bool dvda_media_cache_t::seek(int64_t _position) {
+	if (_position < 0) {
+		return false;
+	}
+	position = _position;
+	return true;
+}
+
+size_t dvda_media_cache_t::read(void* data, size_t size) {
+	size_t read_bytes = cache.Read(position, data, size);
+	position += read_bytes;
+	return read_bytes;
+}
+
+int64_t dvda_media_cache_t::skip(int64_t bytes) {
+	position += bytes;
+	return position;
+}
+
+size_t dvda_media_cache_t::OnSectorCacheRead(uint64_t offset, void* dest, size_t size) noexcept {
+	if (!media->seek(offset)) {
+		return 0;
+	}
+	size_t read_bytes = 0;
+	while (read_bytes < size) {
+		size_t n = media->read((uint8_t*)dest + read_bytes, size - read_bytes);
+		if (n == 0 || n == (size_t)-1) {
+			break;
+		}
+		read_bytes += n;
+	}
+	return read_bytes;
+}
@@ -0,0 +1,343 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "SectorCache.hxx"
+#include "thread/Name.hxx"
+
+#include <algorithm>
+#include <atomic>
+
+#include <assert.h>
+#include <string.h>
+
+/**
+ * After this number of reads of the respective following block,
+ * the access is considered sequential and the read-ahead starts.
+ */
+static constexpr unsigned SEQUENTIAL_THRESHOLD = 2;
+
+/**
+ * The statistics of all #SectorCache instances, for the "stats"
+ * command.
+ */
+static struct {
+	std::atomic<uint64_t> hits{0}, misses{0}, prefetched{0};
+} total_stats;
+
+SectorCache::Stats
+SectorCache::GetTotalStats() noexcept
+{
+	Stats result;
+	result.hits = total_stats.hits.load(std::memory_order_relaxed);
+	result.misses = total_stats.misses.load(std::memory_order_relaxed);
+	result.prefetched = total_stats.prefetched.load(std::memory_order_relaxed);
+	return result;
+}
+
+SectorCache::SectorCache(SectorCacheHandler &_handler, size_t size) noexcept
+	:handler(_handler),
+	 n_blocks(std::max<size_t>(size / BLOCK_SIZE, 4)),
+	 /* read in chunks of up to 128 kB, and leave room for one
+	    chunk behind the reader */
+	 max_batch(std::min<size_t>(n_blocks / 4, 64)),
+	 window(n_blocks - max_batch),
+	 data(new uint8_t[n_blocks * BLOCK_SIZE]),
+	 blocks(new Block[n_blocks]),
+	 thread(BIND_THIS_METHOD(ThreadFunc))
+{
+}
+
+SectorCache::~SectorCache() noexcept
+{
+	Stop();
+}
+
+void
+SectorCache::Start(uint64_t _file_size)
+{
+	assert(!thread.IsDefined());
+
+	file_size = _file_size;
+	eof_block = (file_size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+	quit = false;
+	thread.Start();
+}
+
+void
+SectorCache::Stop() noexcept
+{
+	if (thread.IsDefined()) {
+		{
+			const std::lock_guard<Mutex> lock(mutex);
+			quit = true;
+			wake_cond.notify_one();
+		}
+
+		thread.Join();
+	}
+
+	for (size_t i = 0; i < n_blocks; ++i)
+		blocks[i].state = BlockState::EMPTY;
+
+	last_block = UINT64_MAX;
+	sequential = 0;
+	prefetch_next = prefetch_end = 0;
+}
+
+size_t
+SectorCache::CountLoadable(uint64_t first, uint64_t end) const noexcept
+{
+	/* don't wrap around the end of the ring, because the
+	   handler reads into one contiguous buffer */
+	end = std::min<uint64_t>({end, eof_block,
+				  first + max_batch,
+				  first + n_blocks - GetSlot(first)});
+
+	size_t count = 0;
+	for (uint64_t i = first; i < end; ++i) {
+		const auto &b = blocks[GetSlot(i)];
+		if (b.state == BlockState::LOADING ||
+		    (b.number == i && b.state == BlockState::READY))
+			break;
+
+		++count;
+	}
+
+	return count;
+}
+
+bool
+SectorCache::LoadBlocks(std::unique_lock<Mutex> &lock,
+			uint64_t first, size_t count) noexcept
+{
+	assert(count > 0);
+
+	for (size_t i = 0; i < count; ++i) {
+		auto &b = blocks[GetSlot(first + i)];
+		b.number = first + i;
+		b.state = BlockState::LOADING;
+	}
+
+	size_t nbytes;
+
+	{
+		const ScopeUnlock unlock(mutex);
+		const std::lock_guard<Mutex> io_lock(io_mutex);
+		nbytes = handler.OnSectorCacheRead(first * BLOCK_SIZE,
+						   GetData(first),
+						   count * BLOCK_SIZE);
+	}
+
+	/* only the last block of the file may be shorter than
+	   BLOCK_SIZE; any other short read is an I/O error, and the
+	   incomplete blocks are not cached */
+	bool complete = true;
+	for (size_t i = 0; i < count; ++i) {
+		auto &b = blocks[GetSlot(first + i)];
+		const uint64_t offset = (first + i) * BLOCK_SIZE;
+		const size_t expected = file_size > offset
+			? std::min<uint64_t>(file_size - offset, BLOCK_SIZE)
+			: 0;
+		const size_t start = i * BLOCK_SIZE;
+		const size_t length = nbytes > start
+			? std::min(nbytes - start, BLOCK_SIZE)
+			: 0;
+
+		if (length == expected) {
+			b.length = length;
+			b.state = BlockState::READY;
+		} else {
+			b.state = BlockState::EMPTY;
+			complete = false;
+		}
+	}
+
+	loaded_cond.notify_all();
+	lock.unlock();
+	wake_cond.notify_one();
+	lock.lock();
+
+	return complete;
+}
+
+bool
+SectorCache::IsPrefetchDue() const noexcept
+{
+	if (prefetch_next >= eof_block)
+		return false;
+
+	/* wait until a whole chunk can be loaded, unless the end of
+	   the file is near */
+	return prefetch_end >= eof_block ||
+		prefetch_next + max_batch <= prefetch_end;
+}
+
+void
+SectorCache::OnRead(uint64_t number) noexcept
+{
+	if (number == last_block)
+		return;
+
+	if (number == last_block + 1) {
+		++sequential;
+	} else {
+		/* random access: cancel the read-ahead */
+		sequential = 0;
+		prefetch_next = prefetch_end = 0;
+	}
+
+	last_block = number;
+
+	if (sequential < SEQUENTIAL_THRESHOLD)
+		return;
+
+	prefetch_next = std::max(prefetch_next, number + 1);
+	prefetch_end = number + 1 + window;
+	if (IsPrefetchDue())
+		wake_cond.notify_one();
+}
+
+size_t
+SectorCache::Read(uint64_t offset, void *_dest, size_t size) noexcept
+{
+	auto *dest = (uint8_t *)_dest;
+	size_t result = 0;
+
+	std::unique_lock<Mutex> lock(mutex);
+
+	bool counted = false, failed = false;
+	while (size > 0) {
+		const uint64_t number = offset / BLOCK_SIZE;
+		const size_t position = offset % BLOCK_SIZE;
+
+		if (number >= eof_block)
+			break;
+
+		auto &b = blocks[GetSlot(number)];
+
+		if (b.state == BlockState::LOADING) {
+			/* wait for the read-ahead thread, or for the
+			   slot to become available */
+			if (!counted && b.number == number) {
+				++stats.hits;
+				++total_stats.hits;
+				counted = true;
+			}
+
+			loaded_cond.wait(lock);
+			continue;
+		}
+
+		if (b.number != number || b.state != BlockState::READY) {
+			/* load all blocks of this request at once; if
+			   the read-ahead thread is behind a sequential
+			   reader, load a whole chunk */
+			uint64_t end = (offset + size + BLOCK_SIZE - 1)
+				/ BLOCK_SIZE;
+			if (sequential >= SEQUENTIAL_THRESHOLD &&
+			    number == last_block + 1)
+				end = std::max<uint64_t>(end, number + max_batch);
+
+			const size_t count = CountLoadable(number, end);
+			assert(count > 0);
+
+			if (!counted) {
+				++stats.misses;
+				++total_stats.misses;
+				counted = true;
+			}
+
+			if (!LoadBlocks(lock, number, count) &&
+			    !IsPresent(number)) {
+				/* retry once, then report the error
+				   with a short read */
+				if (failed)
+					break;
+
+				failed = true;
+			}
+
+			continue;
+		}
+
+		if (!counted) {
+			++stats.hits;
+			++total_stats.hits;
+		}
+
+		counted = false;
+		failed = false;
+
+		OnRead(number);
+
+		if (position >= b.length)
+			break;
+
+		const size_t nbytes = std::min(b.length - position, size);
+		memcpy(dest, GetData(number) + position, nbytes);
+		dest += nbytes;
+		offset += nbytes;
+		size -= nbytes;
+		result += nbytes;
+
+		if (b.length < BLOCK_SIZE && size > 0)
+			/* end of file */
+			break;
+	}
+
+	return result;
+}
+
+inline void
+SectorCache::ThreadFunc() noexcept
+{
+	SetThreadName("sector_cache");
+
+	std::unique_lock<Mutex> lock(mutex);
+
+	while (!quit) {
+		const uint64_t end = std::min(prefetch_end, eof_block);
+		while (prefetch_next < end && IsPresent(prefetch_next))
+			++prefetch_next;
+
+		if (!IsPrefetchDue()) {
+			wake_cond.wait(lock);
+			continue;
+		}
+
+		const uint64_t first = prefetch_next;
+		const size_t count = CountLoadable(first, end);
+		if (count == 0) {
+			/* the slot is being loaded by the reader */
+			wake_cond.wait(lock);
+			continue;
+		}
+
+		prefetch_next = first + count;
+		stats.prefetched += count;
+		total_stats.prefetched += count;
+		if (!LoadBlocks(lock, first, count)) {
+			/* I/O error: stop the read-ahead; the reader
+			   will retry and report it */
+			sequential = 0;
+			prefetch_next = prefetch_end = 0;
+		}
+	}
+}
@@ -0,0 +1,263 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_SECTOR_CACHE_HXX
+#define MPD_SECTOR_CACHE_HXX
+
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Thread.hxx"
+#include "util/Compiler.h"
+
+#include <memory>
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * The backend of a #SectorCache.
+ */
+class SectorCacheHandler {
+public:
+	/**
+	 * Read from the underlying file.  This is called by the
+	 * read-ahead thread and by SectorCache::Read(), but never
+	 * concurrently.
+	 *
+	 * @return the number of bytes read; this must be less than
+	 * the requested size only at the end of the file or on error
+	 * (which is retried once by SectorCache::Read())
+	 */
+	virtual size_t OnSectorCacheRead(uint64_t offset,
+					 void *dest, size_t size) noexcept = 0;
+};
+
+/**
+ * A ring of 2048 byte blocks in front of a slow file (e.g. a SACD or
+ * DVD-Audio ISO image on a network share).  Sequential access is
+ * detected, and the blocks ahead of the reader are loaded by a
+ * background thread in large chunks, so the reader mostly copies
+ * from memory instead of doing one round trip per sector.
+ */
+class SectorCache {
+public:
+	static constexpr size_t BLOCK_SIZE = 2048;
+
+	struct Stats {
+		/**
+		 * Block reads which were served from the cache
+		 * (including blocks which were still being loaded
+		 * by the read-ahead thread).
+		 */
+		uint64_t hits = 0;
+
+		/**
+		 * Block reads which had to be loaded synchronously.
+		 */
+		uint64_t misses = 0;
+
+		/**
+		 * Blocks loaded by the read-ahead thread.
+		 */
+		uint64_t prefetched = 0;
+
+		double GetHitRatio() const noexcept {
+			const uint64_t total = hits + misses;
+			return total > 0 ? double(hits) / total : 0;
+		}
+	};
+
+private:
+	enum class BlockState : uint8_t {
+		EMPTY,
+
+		/**
+		 * The block is being loaded (outside of the mutex);
+		 * wait for #loaded_cond.
+		 */
+		LOADING,
+
+		READY,
+	};
+
+	struct Block {
+		uint64_t number;
+		size_t length;
+		BlockState state = BlockState::EMPTY;
+	};
+
+	SectorCacheHandler &handler;
+
+	const size_t n_blocks;
+
+	/**
+	 * The maximum number of blocks loaded with one
+	 * SectorCacheHandler::OnSectorCacheRead() call.
+	 */
+	const size_t max_batch;
+
+	/**
+	 * How many blocks are read ahead of the reader?
+	 */
+	const size_t window;
+
+	const std::unique_ptr<uint8_t[]> data;
+	const std::unique_ptr<Block[]> blocks;
+
+	Thread thread;
+
+	mutable Mutex mutex;
+
+	/**
+	 * Serializes all SectorCacheHandler calls.
+	 */
+	Mutex io_mutex;
+
+	/**
+	 * Wakes up the read-ahead thread.
+	 */
+	Cond wake_cond;
+
+	/**
+	 * Signalled when a block has been loaded.
+	 */
+	Cond loaded_cond;
+
+	/**
+	 * The most recently read block number.
+	 */
+	uint64_t last_block = UINT64_MAX;
+
+	/**
+	 * The number of consecutive reads of the following block.
+	 */
+	unsigned sequential = 0;
+
+	/**
+	 * The range of blocks the read-ahead thread shall load.
+	 */
+	uint64_t prefetch_next = 0, prefetch_end = 0;
+
+	/**
+	 * The size of the file, as passed to Start().
+	 */
+	uint64_t file_size = UINT64_MAX;
+
+	/**
+	 * The first block number after the end of the file.
+	 */
+	uint64_t eof_block = UINT64_MAX;
+
+	Stats stats;
+
+	bool quit = false;
+
+public:
+	/**
+	 * @param size the size of the ring in bytes; it is rounded
+	 * down to a multiple of #BLOCK_SIZE
+	 */
+	SectorCache(SectorCacheHandler &_handler, size_t size) noexcept;
+	~SectorCache() noexcept;
+
+	SectorCache(const SectorCache &) = delete;
+	SectorCache &operator=(const SectorCache &) = delete;
+
+	/**
+	 * Start the read-ahead thread.
+	 *
+	 * @param _file_size the size of the file; a shorter read
+	 * from the #SectorCacheHandler is an error, not the end of
+	 * the file
+	 */
+	void Start(uint64_t _file_size);
+
+	/**
+	 * Stop the read-ahead thread and discard all blocks.  The
+	 * statistics are kept.
+	 */
+	void Stop() noexcept;
+
+	/**
+	 * Read from the given offset, which needs not be aligned.
+	 *
+	 * @return the number of bytes read; less than requested only
+	 * at the end of the file or on error
+	 */
+	size_t Read(uint64_t offset, void *dest, size_t size) noexcept;
+
+	Stats GetStats() const noexcept {
+		const std::lock_guard<Mutex> lock(mutex);
+		return stats;
+	}
+
+	/**
+	 * Returns the sum of the statistics of all instances since
+	 * MPD was started.
+	 */
+	gcc_pure
+	static Stats GetTotalStats() noexcept;
+
+private:
+	size_t GetSlot(uint64_t number) const noexcept {
+		return number % n_blocks;
+	}
+
+	uint8_t *GetData(uint64_t number) const noexcept {
+		return data.get() + GetSlot(number) * BLOCK_SIZE;
+	}
+
+	bool IsPresent(uint64_t number) const noexcept {
+		const auto &b = blocks[GetSlot(number)];
+		return b.number == number && b.state != BlockState::EMPTY;
+	}
+
+	/**
+	 * Count the blocks starting at the given one which are
+	 * neither present nor being loaded and which can be loaded
+	 * with one handler call.
+	 */
+	size_t CountLoadable(uint64_t first, uint64_t end) const noexcept;
+
+	/**
+	 * Load the given (contiguous) blocks.  The mutex is released
+	 * while the handler runs.
+	 *
+	 * @return false if the handler returned less than expected;
+	 * the blocks which were not read completely remain empty
+	 */
+	bool LoadBlocks(std::unique_lock<Mutex> &lock,
+			uint64_t first, size_t count) noexcept;
+
+	/**
+	 * Shall the read-ahead thread load more blocks?
+	 */
+	gcc_pure
+	bool IsPrefetchDue() const noexcept;
+
+	/**
+	 * Update the sequential access detection after a read of
+	 * the given block, and wake up the read-ahead thread.
+	 */
+	void OnRead(uint64_t number) noexcept;
+
+	void ThreadFunc() noexcept;
+};
+
+#endif
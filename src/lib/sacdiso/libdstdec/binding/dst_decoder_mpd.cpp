@@ -17,53 +17,37 @@
 * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
 */
 
-#include <malloc.h>
 #include <memory.h>
-#include <stdio.h>
-#include <stdarg.h>
-//#include "stddef.h"
 #include "dst_decoder_mpd.h"
-#include <sched.h>
-#include <unistd.h>
+#include "dst_decoder_pool.h"
 
 using namespace std;
 
 #define DSD_SILENCE_BYTE 0x69
 
-#define LOG_ERROR ("ERROR: ")
-#define LOG(p1, p2)
-
-void dst_run_thread(frame_slot_t* slot) {
-	while (slot->run_slot) {
-		slot->dst_semaphore.wait();
-		if (slot->run_slot) {
-			slot->state = SLOT_RUNNING;
-			slot->D.decode(slot->dst_data, slot->inp_size * 8, slot->dsd_data);
-			slot->state = SLOT_READY;
-		}
-		else {
-			slot->dsd_data = nullptr;
-			slot->inp_size = 0;
-		}
-		slot->dsd_semaphore.notify();
-	}
+void frame_slot_t::run() {
+	error = D.decode(dst_data, inp_size * 8, dsd_data) != 0;
+	dsd_semaphore.notify();
 }
 
-dst_decoder_t::dst_decoder_t(int threads) {
-	frame_slots.resize(threads);
+dst_decoder_t::dst_decoder_t(int slots) {
+	slot_count    = slots > 0 ? slots : 1;
+	frame_slots.reset(new frame_slot_t[slot_count]);
 	slot_nr       = 0;
+	frame_nr      = 0;
 	channel_count = 0;
 	samplerate    = 0;
 	framerate     = 0;
 }
 
 dst_decoder_t::~dst_decoder_t() {
-	for (auto& slot : frame_slots) {
-		slot.state = SLOT_TERMINATING;
+	/* Wait for the frames which are still in flight */
+	for (int i = 0; i < slot_count; i++) {
+		frame_slot_t& slot = frame_slots[i];
+		if (slot.state == SLOT_LOADED && !pool->cancel(&slot)) {
+			slot.dsd_semaphore.wait();
+		}
 		slot.D.close();
-		slot.run_slot = false;
-		slot.dst_semaphore.notify(); // Release worker (decoding) thread for exit
-		slot.run_thread.join(); // Wait until worker (decoding) thread exit
 	}
 }
 
@@ -72,34 +56,12 @@ int dst_decoder_t::get_slot_nr() {
 }
 
 int dst_decoder_t::init(int channel_count, int samplerate, int framerate) {
-	unsigned num_cpus = std::thread::hardware_concurrency();
-	unsigned num_threads = 0;
-
-	for (auto& slot : frame_slots)	{
-		if (slot.D.init(channel_count, (samplerate / 44100) / (framerate / 75)) == 0) {
-			slot.channel_count = channel_count;
-			slot.samplerate = samplerate;
-			slot.framerate = framerate;
-			slot.dsd_size = (size_t)(samplerate / 8 / framerate * channel_count);
-			slot.run_slot = true;
-			slot.run_thread = thread(dst_run_thread, &slot);
-
-                        cpu_set_t cpuset;
-                        CPU_ZERO(&cpuset);
-                        CPU_SET(num_threads % num_cpus, &cpuset);
-                        num_threads ++;
-                        pthread_setaffinity_np(slot.run_thread.native_handle(), sizeof(cpu_set_t), &cpuset);
-
-			if (!slot.run_thread.joinable()) {
-				LOG(LOG_ERROR, ("Could not start decoder thread"));
-				return -1;
-			}
-		}
-		else {
-			LOG(LOG_ERROR, ("Could not initialize decoder slot"));
+	for (int i = 0; i < slot_count; i++) {
+		if (frame_slots[i].D.init(channel_count, (samplerate / 44100) / (framerate / 75)) != 0) {
 			return -1;
 		}
 	}
+	pool = dst_decoder_pool_t::get();
 	this->channel_count = channel_count;
 	this->samplerate = samplerate;
 	this->framerate = framerate;
@@ -118,23 +80,26 @@ int dst_decoder_t::decode(uint8_t* dst_data, size_t dst_size, uint8_t** dsd_data
 	slot_set.inp_size = dst_size;
 	slot_set.frame_nr = frame_nr;
 
-	/* Release worker (decoding) thread on the loaded slot */
+	/* Queue the loaded slot, any idle worker will pick it up */
 	if (dst_size > 0)	{
 		slot_set.state = SLOT_LOADED;
-		slot_set.dst_semaphore.notify();
+		pool->submit(&slot_set);
 	}
 	else {
 		slot_set.state = SLOT_EMPTY;
 	}
 
 	/* Move to the oldest slot */
-	slot_nr = (slot_nr + 1) % frame_slots.size();
+	slot_nr = (slot_nr + 1) % slot_count;
 	frame_slot_t& slot_get = frame_slots[slot_nr];
 
-	/* Dump decoded frame */
-	if (slot_get.state != SLOT_EMPTY) {
+	/* Wait until it is decoded */
+	if (slot_get.state == SLOT_LOADED) {
 		slot_get.dsd_semaphore.wait();
+		slot_get.state = slot_get.error ? SLOT_READY_WITH_ERROR : SLOT_READY;
 	}
+
+	/* Dump decoded frame */
 	switch (slot_get.state) {
 	case SLOT_READY:
 		*dsd_data = slot_get.dsd_data;
@@ -150,8 +115,7 @@ int dst_decoder_t::decode(uint8_t* dst_data, size_t dst_size, uint8_t** dsd_data
 		*dsd_size = 0;
 		break;
 	}
+	slot_get.state = SLOT_EMPTY;
 	frame_nr++;
 	return 0;
 }
-
-
@@ -20,59 +20,67 @@
 #ifndef _DST_DECODER_H_INCLUDED
 #define _DST_DECODER_H_INCLUDED
 
-#include <thread>
+#include <memory>
 #include <vector>
 #include <semaphore.h>
 #include "DSTDecoder.h"
 
-using std::thread;
 using std::vector;
 
-enum slot_state_t {SLOT_EMPTY, SLOT_LOADED, SLOT_RUNNING, SLOT_READY, SLOT_READY_WITH_ERROR, SLOT_TERMINATING};
+class dst_decoder_pool_t;
 
+enum slot_state_t {SLOT_EMPTY, SLOT_LOADED, SLOT_READY, SLOT_READY_WITH_ERROR};
+
+/*
+* One frame in flight.  The state is only accessed by the thread
+* which owns the dst_decoder_t; a pool worker only runs the decoder
+* and reports the result through "error" and dsd_semaphore.
+*/
 class frame_slot_t {
 public:
-	bool         run_slot;
-	thread       run_thread;
 	semaphore    dsd_semaphore;
-	semaphore    dst_semaphore;
 
 	slot_state_t state;
+	bool         error;
 	int          frame_nr;
 	uint8_t*     dsd_data;
-	int          dsd_size;
 	uint8_t*     dst_data;
 	int          inp_size;
-	int          channel_count;
-	int          samplerate;
-	int          framerate;
 	CDSTDecoder  D;
 
 	frame_slot_t() {
-		run_slot = false;
 		state = SLOT_EMPTY;
+		error = false;
 		frame_nr = -1;
 		dsd_data = nullptr;
-		dsd_size = 0;
 		dst_data = nullptr;
 		inp_size = 0;
-		channel_count = 0;
-		samplerate = 0;
-		framerate = 0;
-	}
-	frame_slot_t(const frame_slot_t& slot) {
 	}
+	frame_slot_t(const frame_slot_t& slot) = delete;
+
+	/*
+	* Decode the frame; called by a pool worker.
+	*/
+	void run();
 };
 
+/*
+* Decodes a DST stream frame by frame on the shared
+* dst_decoder_pool_t.  Up to "slots" frames are in flight; decode()
+* returns the frames in their original order, with a latency of
+* "slots" - 1 frames.
+*/
 class dst_decoder_t {
-	vector<frame_slot_t> frame_slots;
+	std::shared_ptr<dst_decoder_pool_t> pool;
+	std::unique_ptr<frame_slot_t[]> frame_slots;
+	int slot_count;
 	int slot_nr;
 	int frame_nr;
 	int channel_count;
 	int samplerate;
 	int framerate;
 public:
-	dst_decoder_t(int threads);
+	dst_decoder_t(int slots);
 	~dst_decoder_t();
 	int get_slot_nr();
 	int init(int channel_count, int samplerate, int framerate);
@@ -0,0 +1,134 @@
+/*
+* MPD SACD Decoder plugin
+* Copyright (c) 2014-2019 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "dst_decoder_pool.h"
+#include "dst_decoder_mpd.h"
+
+#include <algorithm>
+
+#include <pthread.h>
+#include <sched.h>
+
+using namespace std;
+
+mutex                        dst_decoder_pool_t::instance_mtx;
+weak_ptr<dst_decoder_pool_t> dst_decoder_pool_t::instance;
+unsigned                     dst_decoder_pool_t::max_threads = 0;
+bool                         dst_decoder_pool_t::pin_threads = false;
+
+dst_decoder_pool_t::~dst_decoder_pool_t() {
+	{
+		lock_guard<mutex> lock(mtx);
+		quit = true;
+		cv.notify_all();
+	}
+	for (auto& t : threads) {
+		t.join();
+	}
+}
+
+void dst_decoder_pool_t::configure(unsigned _max_threads, bool _pin_threads) {
+	lock_guard<mutex> lock(instance_mtx);
+	max_threads = _max_threads;
+	pin_threads = _pin_threads;
+}
+
+shared_ptr<dst_decoder_pool_t> dst_decoder_pool_t::get() {
+	lock_guard<mutex> lock(instance_mtx);
+	auto pool = instance.lock();
+	if (!pool) {
+		pool = make_shared<dst_decoder_pool_t>();
+		instance = pool;
+	}
+	return pool;
+}
+
+unsigned dst_decoder_pool_t::get_max_threads() {
+	lock_guard<mutex> lock(instance_mtx);
+	if (max_threads > 0) {
+		return max_threads;
+	}
+	return max(thread::hardware_concurrency(), 1u);
+}
+
+void dst_decoder_pool_t::submit(frame_slot_t* slot) {
+	unique_lock<mutex> lock(mtx);
+	queue.push_back(slot);
+	if (idle_threads > 0) {
+		cv.notify_one();
+		return;
+	}
+	lock.unlock();
+
+	/* all workers are busy: start another one if the limit allows */
+	const unsigned limit = get_max_threads();
+	bool pin;
+	{
+		lock_guard<mutex> instance_lock(instance_mtx);
+		pin = pin_threads;
+	}
+
+	lock.lock();
+	if (threads.size() >= limit) {
+		return;
+	}
+	threads.emplace_back(&dst_decoder_pool_t::run, this);
+	if (pin) {
+		unsigned num_cpus = max(thread::hardware_concurrency(), 1u);
+		cpu_set_t cpuset;
+		CPU_ZERO(&cpuset);
+		CPU_SET((threads.size() - 1) % num_cpus, &cpuset);
+		pthread_setaffinity_np(threads.back().native_handle(), sizeof(cpu_set_t), &cpuset);
+	}
+}
+
+bool dst_decoder_pool_t::cancel(frame_slot_t* slot) {
+	lock_guard<mutex> lock(mtx);
+	auto i = find(queue.begin(), queue.end(), slot);
+	if (i == queue.end()) {
+		return false;
+	}
+	queue.erase(i);
+	return true;
+}
+
+unsigned dst_decoder_pool_t::get_thread_count() {
+	lock_guard<mutex> lock(mtx);
+	return threads.size();
+}
+
+void dst_decoder_pool_t::run() {
+	unique_lock<mutex> lock(mtx);
+	for (;;) {
+		if (queue.empty()) {
+			if (quit) {
+				break;
+			}
+			idle_threads++;
+			cv.wait(lock);
+			idle_threads--;
+			continue;
+		}
+		frame_slot_t* slot = queue.front();
+		queue.pop_front();
+		lock.unlock();
+		slot->run();
+		lock.lock();
+	}
+}
@@ -0,0 +1,93 @@
+/*
+* MPD SACD Decoder plugin
+* Copyright (c) 2014-2019 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef _DST_DECODER_POOL_H_INCLUDED
+#define _DST_DECODER_POOL_H_INCLUDED
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class frame_slot_t;
+
+/*
+* Process-wide pool of DST decoding threads, shared by all
+* dst_decoder_t instances (e.g. several partitions playing DST
+* streams at the same time).  Frames are queued in submission order
+* and any idle worker takes the oldest one; each dst_decoder_t
+* restores the frame order of its own stream.
+*
+* Worker threads are started on demand, up to the configured limit,
+* and exit when the last dst_decoder_t releases the pool.
+*/
+class dst_decoder_pool_t {
+	std::mutex                mtx;
+	std::condition_variable   cv;
+	std::deque<frame_slot_t*> queue;
+	std::vector<std::thread>  threads;
+	unsigned                  idle_threads = 0;
+	bool                      quit = false;
+
+	static std::mutex                        instance_mtx;
+	static std::weak_ptr<dst_decoder_pool_t> instance;
+	static unsigned                          max_threads;
+	static bool                              pin_threads;
+public:
+	dst_decoder_pool_t() = default;
+	~dst_decoder_pool_t();
+
+	dst_decoder_pool_t(const dst_decoder_pool_t&) = delete;
+	dst_decoder_pool_t& operator=(const dst_decoder_pool_t&) = delete;
+
+	/*
+	* Set the maximum number of worker threads (0 means one per
+	* CPU) and whether they are pinned to a CPU each.  Applies to
+	* threads started after this call.
+	*/
+	static void configure(unsigned max_threads, bool pin_threads);
+
+	/*
+	* Obtain a reference to the pool, creating it if necessary.
+	*/
+	static std::shared_ptr<dst_decoder_pool_t> get();
+
+	/*
+	* Queue a loaded slot.  Its dsd_semaphore is notified when the
+	* frame has been decoded.
+	*/
+	void submit(frame_slot_t* slot);
+
+	/*
+	* Remove a slot from the queue if no worker has taken it yet.
+	*
+	* @return true if the slot was removed, false if it is being
+	* (or has been) decoded and the caller must wait for it
+	*/
+	bool cancel(frame_slot_t* slot);
+
+	unsigned get_thread_count();
+private:
+	static unsigned get_max_threads();
+	void run();
+};
+
+#endif
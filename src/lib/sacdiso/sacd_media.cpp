@@ -22,6 +22,9 @@
 #include <unistd.h>
 
 #include "sacd_media.h"
+#include "util/Domain.hxx"
+
+static constexpr Domain sacd_media_domain("sacd_media");
 
 sacd_media_file_t::sacd_media_file_t() {
 	fd = -1;
@@ -157,3 +160,84 @@ int64_t sacd_media_stream_t::skip(int64_t bytes) {
 	}
 	return position;
 }
+
+sacd_media_cache_t::sacd_media_cache_t(sacd_media_t* _media, size_t cache_size) : media(_media), cache(*this, cache_size) {
+	position = 0;
+	is_open = false;
+}
+
+sacd_media_cache_t::~sacd_media_cache_t() {
+	close();
+	delete media;
+}
+
+bool sacd_media_cache_t::open(const char* path) {
+	if (!media->open(path)) {
+		return false;
+	}
+	position = 0;
+	try {
+		int64_t size = media->get_size();
+		cache.Start(size >= 0 ? (uint64_t)size : UINT64_MAX);
+		is_open = true;
+	}
+	catch (const std::runtime_error &e) {
+		LogError(e);
+		media->close();
+		return false;
+	}
+	return true;
+}
+
+bool sacd_media_cache_t::close() {
+	if (is_open) {
+		cache.Stop();
+		is_open = false;
+		auto stats = cache.GetStats();
+		FormatDebug(sacd_media_domain, "read-ahead: %.1f%% hit ratio (%llu hits, %llu misses, %llu blocks prefetched)",
+			100 * stats.GetHitRatio(), (unsigned long long)stats.hits, (unsigned long long)stats.misses, (unsigned long long)stats.prefetched);
+	}
+	return media->close();
+}
+
+bool sacd_media_cache_t::seek(int64_t _position) {
+	if (_position < 0) {
+		return false;
+	}
+	position = _position;
+	return true;
+}
+
+int64_t sacd_media_cache_t::get_position() {
+	return position;
+}
+
+int64_t sacd_media_cache_t::get_size() {
+	return media->get_size();
+}
+
+size_t sacd_media_cache_t::read(void* data, size_t size) {
+	size_t read_bytes = cache.Read(position, data, size);
+	position += read_bytes;
+	return read_bytes;
+}
+
+int64_t sacd_media_cache_t::skip(int64_t bytes) {
+	position += bytes;
+	return position;
+}
+
+size_t sacd_media_cache_t::OnSectorCacheRead(uint64_t offset, void* dest, size_t size) noexcept {
+	if (!media->seek(offset)) {
+		return 0;
+	}
+	size_t read_bytes = 0;
+	while (read_bytes < size) {
+		size_t n = media->read((uint8_t*)dest + read_bytes, size - read_bytes);
+		if (n == 0 || n == (size_t)-1) {
+			break;
+		}
+		read_bytes += n;
+	}
+	return read_bytes;
+}
@@ -26,6 +26,7 @@
 #include "thread/Mutex.hxx"
 #include "thread/Cond.hxx"
 #include "input/InputStream.hxx"
+#include "lib/isocache/SectorCache.hxx"
 #include "Log.hxx"
 
 class sacd_media_t {
@@ -70,4 +71,31 @@ public:
 	int64_t skip(int64_t bytes);
 };
 
+/*
+* Wraps another sacd_media_t with a SectorCache: reads are served from
+* a ring of blocks, which is filled ahead of sequential reads by a
+* background thread.  Takes ownership of the wrapped media.
+*/
+class sacd_media_cache_t : public sacd_media_t, SectorCacheHandler {
+	sacd_media_t* media;
+	SectorCache   cache;
+	int64_t       position;
+	bool          is_open;
+public:
+	sacd_media_cache_t(sacd_media_t* media, size_t cache_size);
+	~sacd_media_cache_t();
+	bool    open(const char* path);
+	bool    close();
+	bool    seek(int64_t position);
+	int64_t get_position();
+	int64_t get_size();
+	size_t  read(void* data, size_t size);
+	int64_t skip(int64_t bytes);
+	SectorCache::Stats get_stats() const {
+		return cache.GetStats();
+	}
+private:
+	size_t  OnSectorCacheRead(uint64_t offset, void* dest, size_t size) noexcept override;
+};
+
 #endif
@@ -76,6 +76,12 @@ AudioOutputControl::GetMixer() const noexcept
 	return output->mixer;
 }
 
+int
+AudioOutputControl::GetReplayGainClass() const noexcept
+{
+	return output->replay_gain_class;
+}
+
 const std::map<std::string, std::string>
 AudioOutputControl::GetAttributes() const noexcept
 {
@@ -375,6 +375,21 @@ public:
 		source.SetReplayGainMode(_mode);
 	}
 
+	/**
+	 * @see FilteredAudioOutput::replay_gain_class
+	 */
+	gcc_pure
+	int GetReplayGainClass() const noexcept;
+
+	/**
+	 * Share ReplayGain and cross-fade results with other outputs
+	 * of the same GetReplayGainClass().  Must be called before
+	 * the output is opened.
+	 */
+	void SetSharedFilterResults(SharedFilterResults *results) noexcept {
+		source.SetSharedFilterResults(results);
+	}
+
 	/**
 	 * Caller must lock the mutex.
 	 *
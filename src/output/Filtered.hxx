@@ -114,6 +114,15 @@ public:
 	 */
 	std::unique_ptr<PreparedFilter> prepared_other_replay_gain_filter;
 
+	/**
+	 * Outputs with the same non-negative value have identical
+	 * ReplayGain filters and may therefore share their results
+	 * (see #SharedFilterResults).  -1 means this output's
+	 * ReplayGain filter is unique, e.g. because it controls a
+	 * hardware mixer.
+	 */
+	int replay_gain_class = -1;
+
 	/**
 	 * The convert_filter_plugin instance of this audio output.
 	 * It is the last item in the filter chain, and is responsible
@@ -257,6 +257,11 @@ FilteredAudioOutput::Setup(EventLoop &event_loop,
 		throw std::runtime_error("Invalid \"replay_gain_handler\" value");
 	}
 
+	if (prepared_replay_gain_filter == nullptr)
+		replay_gain_class = 0;
+	else if (StringIsEqual(replay_gain_handler, "software"))
+		replay_gain_class = mixer_type == MixerType::SOFTWARE ? 2 : 1;
+
 	/* the "convert" filter must be the last one in the chain */
 
 	filter_chain_append(*prepared_filter, "convert",
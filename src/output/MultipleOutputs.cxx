@@ -22,6 +22,7 @@
 #include "Defaults.hxx"
 #include "MusicPipe.hxx"
 #include "MusicChunk.hxx"
+#include "SharedFilterResults.hxx"
 #include "filter/Factory.hxx"
 #include "config/Block.hxx"
 #include "config/Data.hxx"
@@ -29,6 +30,7 @@
 #include "util/RuntimeError.hxx"
 #include "util/StringAPI.hxx"
 
+#include <map>
 #include <stdexcept>
 
 #include <assert.h>
@@ -114,6 +116,8 @@ MultipleOutputs::Configure(EventLoop &event_loop,
 						       client, empty, defaults,
 						       nullptr));
 	}
+
+	ShareFilterResults();
 }
 
 void
@@ -132,6 +136,44 @@ MultipleOutputs::AddNullOutput(EventLoop &event_loop,
 					       nullptr));
 }
 
+void
+MultipleOutputs::ShareFilterResults() noexcept
+{
+	std::map<int, unsigned> n_outputs;
+	for (const auto &ao : outputs)
+		++n_outputs[ao->GetReplayGainClass()];
+
+	std::map<int, SharedFilterResults *> groups;
+	for (const auto &ao : outputs) {
+		const int c = ao->GetReplayGainClass();
+		if (c < 0 || n_outputs[c] < 2)
+			/* nothing to share with */
+			continue;
+
+		auto &results = groups[c];
+		if (results == nullptr) {
+			shared_filter_results.emplace_back(std::make_unique<SharedFilterResults>());
+			results = shared_filter_results.back().get();
+		}
+
+		ao->SetSharedFilterResults(results);
+	}
+}
+
+void
+MultipleOutputs::ForgetFilterResults(const MusicChunk &chunk) noexcept
+{
+	for (const auto &i : shared_filter_results)
+		i->Forget(chunk);
+}
+
+void
+MultipleOutputs::ClearFilterResults() noexcept
+{
+	for (const auto &i : shared_filter_results)
+		i->Clear();
+}
+
 AudioOutputControl *
 MultipleOutputs::FindByName(const char *name) noexcept
 {
@@ -287,6 +329,8 @@ MultipleOutputs::CheckPipe() noexcept
 			   provides a defined value */
 			elapsed_time = chunk->time;
 
+		ForgetFilterResults(*chunk);
+
 		const bool is_tail = chunk->next == nullptr;
 		if (is_tail)
 			/* this is the tail of the pipe - clear the
@@ -341,6 +385,8 @@ MultipleOutputs::Cancel() noexcept
 
 	WaitAll();
 
+	ClearFilterResults();
+
 	/* clear the music pipe and return all chunks to the buffer */
 
 	if (pipe != nullptr)
@@ -362,6 +408,7 @@ MultipleOutputs::Close() noexcept
 	for (const auto &ao : outputs)
 		ao->LockCloseWait();
 
+	ClearFilterResults();
 	pipe.reset();
 
 	input_audio_format.Clear();
@@ -375,6 +422,7 @@ MultipleOutputs::Release() noexcept
 	for (const auto &ao : outputs)
 		ao->LockRelease();
 
+	ClearFilterResults();
 	pipe.reset();
 
 	input_audio_format.Clear();
@@ -40,6 +40,7 @@
 #include <assert.h>
 
 class MusicPipe;
+class SharedFilterResults;
 class EventLoop;
 class MixerListener;
 class AudioOutputClient;
@@ -49,6 +50,14 @@ struct ReplayGainConfig;
 class MultipleOutputs final : public PlayerOutputs {
 	MixerListener &mixer_listener;
 
+	/**
+	 * Memoized ReplayGain and cross-fade results, one for each
+	 * group of at least two outputs with the same
+	 * AudioOutputControl::GetReplayGainClass().  This is declared
+	 * before #outputs so it outlives them.
+	 */
+	std::vector<std::unique_ptr<SharedFilterResults>> shared_filter_results;
+
 	std::vector<std::unique_ptr<AudioOutputControl>> outputs;
 
 	AudioFormat input_audio_format = AudioFormat::Undefined();
@@ -188,6 +197,20 @@ private:
 	 */
 	bool IsChunkConsumed(const MusicChunk *chunk) const noexcept;
 
+	/**
+	 * Set up #shared_filter_results for all outputs which can
+	 * share ReplayGain and cross-fade results.
+	 */
+	void ShareFilterResults() noexcept;
+
+	/**
+	 * Remove all memoized results of this chunk, because it is
+	 * about to be returned to the #MusicBuffer.
+	 */
+	void ForgetFilterResults(const MusicChunk &chunk) noexcept;
+
+	void ClearFilterResults() noexcept;
+
 	/* virtual methods from class PlayerOutputs */
 	void EnableDisable() override;
 	void Open(const AudioFormat audio_format) override;
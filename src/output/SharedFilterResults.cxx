@@ -0,0 +1,142 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "SharedFilterResults.hxx"
+#include "MusicChunk.hxx"
+
+#include <assert.h>
+#include <string.h>
+
+SharedFilterResults::SharedFilterResults() noexcept = default;
+
+SharedFilterResults::~SharedFilterResults() noexcept
+{
+	assert(n_users == 0);
+}
+
+SharedFilterResults::Result
+SharedFilterResults::Begin(const MusicChunk &chunk,
+			   AudioFormat in_audio_format,
+			   ReplayGainMode replay_gain_mode,
+			   ConstBuffer<void> &data) noexcept
+{
+	std::unique_lock<Mutex> lock(mutex);
+
+	if (n_users < 2)
+		return Result::UNSHARED;
+
+	while (true) {
+		auto i = entries.find(&chunk);
+		if (i == entries.end()) {
+			/* nobody has computed this chunk yet (or the
+			   output which did has given up): claim it */
+			auto &entry = entries[&chunk];
+			entry.in_audio_format = in_audio_format;
+			entry.replay_gain_mode = replay_gain_mode;
+			return Result::COMPUTE;
+		}
+
+		const Entry &entry = i->second;
+		if (entry.in_audio_format != in_audio_format ||
+		    entry.replay_gain_mode != replay_gain_mode)
+			/* this can only happen during a transition
+			   (e.g. the replay gain mode has just been
+			   changed) */
+			return Result::UNSHARED;
+
+		if (!entry.pending) {
+			data = entry.data;
+			return Result::HIT;
+		}
+
+		cond.wait(lock);
+	}
+}
+
+void
+SharedFilterResults::Commit(const MusicChunk &chunk,
+			    ConstBuffer<void> data) noexcept
+{
+	const std::lock_guard<Mutex> protect(mutex);
+
+	auto i = entries.find(&chunk);
+	assert(i != entries.end());
+
+	Entry &entry = i->second;
+	assert(entry.pending);
+
+	if (data.data == chunk.data) {
+		/* the filter did not modify the data; don't copy */
+		entry.data = data;
+	} else {
+		if (entry.buffer.IsNull() && !spare_buffers.empty()) {
+			entry.buffer = std::move(spare_buffers.back());
+			spare_buffers.pop_back();
+		}
+
+		entry.buffer.GrowDiscard(data.size);
+		memcpy(entry.buffer.begin(), data.data, data.size);
+		entry.data = {entry.buffer.begin(), data.size};
+	}
+
+	entry.pending = false;
+	cond.notify_all();
+}
+
+void
+SharedFilterResults::Abort(const MusicChunk &chunk) noexcept
+{
+	const std::lock_guard<Mutex> protect(mutex);
+
+	auto i = entries.find(&chunk);
+	assert(i != entries.end());
+	assert(i->second.pending);
+
+	Remove(i);
+	cond.notify_all();
+}
+
+void
+SharedFilterResults::Forget(const MusicChunk &chunk) noexcept
+{
+	const std::lock_guard<Mutex> protect(mutex);
+
+	auto i = entries.find(&chunk);
+	if (i != entries.end())
+		Remove(i);
+}
+
+void
+SharedFilterResults::Clear() noexcept
+{
+	const std::lock_guard<Mutex> protect(mutex);
+
+	entries.clear();
+	spare_buffers.clear();
+}
+
+void
+SharedFilterResults::Remove(std::unordered_map<const MusicChunk *, Entry>::iterator i) noexcept
+{
+	if (!i->second.buffer.IsNull())
+		spare_buffers.emplace_back(std::move(i->second.buffer));
+
+	entries.erase(i);
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SHARED_FILTER_RESULTS_HXX
+#define SHARED_FILTER_RESULTS_HXX
+
+#include "AudioFormat.hxx"
+#include "ReplayGainMode.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "util/AllocatedArray.hxx"
+#include "util/ConstBuffer.hxx"
+
+#include <unordered_map>
+#include <vector>
+
+#include <stdint.h>
+
+struct MusicChunk;
+
+/**
+ * Memoizes the result of the first stage of the #AudioOutputSource
+ * filter chain (ReplayGain and cross-fading) for a group of outputs
+ * which are configured identically up to this point.  The first
+ * output to reach a #MusicChunk computes the result and publishes a
+ * copy; all others only run their own (divergent) filter chain on
+ * it.
+ *
+ * Entries are keyed by the #MusicChunk pointer; they must be removed
+ * with Forget() before the chunk is returned to the #MusicBuffer,
+ * and with Clear() after the pipe has been cleared.  Both may only
+ * be called while no output is filtering.
+ *
+ * This class is thread-safe.
+ */
+class SharedFilterResults {
+	struct Entry {
+		AudioFormat in_audio_format;
+
+		ReplayGainMode replay_gain_mode;
+
+		/**
+		 * Is an output still computing this entry?
+		 */
+		bool pending = true;
+
+		/**
+		 * The filtered data; points either into #buffer or
+		 * to the unmodified #MusicChunk data.
+		 */
+		ConstBuffer<void> data = nullptr;
+
+		AllocatedArray<uint8_t> buffer;
+	};
+
+	mutable Mutex mutex;
+	Cond cond;
+
+	std::unordered_map<const MusicChunk *, Entry> entries;
+
+	/**
+	 * Buffers of removed entries, to be reused by new ones.
+	 */
+	std::vector<AllocatedArray<uint8_t>> spare_buffers;
+
+	/**
+	 * The number of open outputs in this group.  Results are only
+	 * memoized if there are at least two of them.
+	 */
+	unsigned n_users = 0;
+
+public:
+	enum class Result {
+		/**
+		 * Sharing is disabled (or not possible for this
+		 * chunk); the caller computes the result for itself.
+		 */
+		UNSHARED,
+
+		/**
+		 * No result is available; the caller must compute it
+		 * and then call Commit() or Abort().
+		 */
+		COMPUTE,
+
+		/**
+		 * The result is available.
+		 */
+		HIT,
+	};
+
+	SharedFilterResults() noexcept;
+	~SharedFilterResults() noexcept;
+
+	SharedFilterResults(const SharedFilterResults &) = delete;
+	SharedFilterResults &operator=(const SharedFilterResults &) = delete;
+
+	void AddUser() noexcept {
+		const std::lock_guard<Mutex> protect(mutex);
+		++n_users;
+	}
+
+	void RemoveUser() noexcept {
+		const std::lock_guard<Mutex> protect(mutex);
+		--n_users;
+	}
+
+	/**
+	 * Look up the result for the given chunk.  If another output
+	 * is computing it right now, wait for it.
+	 *
+	 * @param data receives the result if #Result::HIT is
+	 * returned; it remains valid until Forget() or Clear()
+	 */
+	Result Begin(const MusicChunk &chunk, AudioFormat in_audio_format,
+		     ReplayGainMode replay_gain_mode,
+		     ConstBuffer<void> &data) noexcept;
+
+	/**
+	 * Publish the result after Begin() has returned
+	 * #Result::COMPUTE.
+	 */
+	void Commit(const MusicChunk &chunk, ConstBuffer<void> data) noexcept;
+
+	/**
+	 * Give up computing the result after Begin() has returned
+	 * #Result::COMPUTE (e.g. because the filter has failed).
+	 */
+	void Abort(const MusicChunk &chunk) noexcept;
+
+	/**
+	 * Remove the entry of the given chunk (if any).
+	 */
+	void Forget(const MusicChunk &chunk) noexcept;
+
+	/**
+	 * Remove all entries and free their buffers.
+	 */
+	void Clear() noexcept;
+
+private:
+	void Remove(std::unordered_map<const MusicChunk *, Entry>::iterator i) noexcept;
+};
+
+#endif
@@ -18,6 +18,7 @@
  */
 
 #include "Source.hxx"
+#include "SharedFilterResults.hxx"
 #include "MusicChunk.hxx"
 #include "filter/Filter.hxx"
 #include "filter/Prepared.hxx"
@@ -59,6 +60,9 @@ AudioOutputSource::Open(const AudioFormat audio_format, const MusicPipe &_pipe,
 			   prepared_other_replay_gain_filter,
 			   prepared_filter);
 
+	if (!IsOpen() && shared_results != nullptr)
+		shared_results->AddUser();
+
 	in_audio_format = audio_format;
 	return filter->GetOutAudioFormat();
 }
@@ -69,6 +73,9 @@ AudioOutputSource::Close() noexcept
 	assert(in_audio_format.IsValid());
 	in_audio_format.Clear();
 
+	if (shared_results != nullptr)
+		shared_results->RemoveUser();
+
 	Cancel();
 
 	CloseFilter();
@@ -161,7 +168,7 @@ AudioOutputSource::GetChunkData(const MusicChunk &chunk,
 }
 
 ConstBuffer<void>
-AudioOutputSource::FilterChunk(const MusicChunk &chunk)
+AudioOutputSource::FilterPrefix(const MusicChunk &chunk)
 {
 	auto data = GetChunkData(chunk, replay_gain_filter.get(),
 				 &replay_gain_serial);
@@ -206,6 +213,42 @@ AudioOutputSource::FilterChunk(const MusicChunk &chunk)
 		data.size = other_data.size;
 	}
 
+	return data;
+}
+
+ConstBuffer<void>
+AudioOutputSource::FilterChunk(const MusicChunk &chunk)
+{
+	ConstBuffer<void> data = nullptr;
+
+	const auto result = shared_results != nullptr
+		? shared_results->Begin(chunk, in_audio_format,
+					replay_gain_mode, data)
+		: SharedFilterResults::Result::UNSHARED;
+
+	switch (result) {
+	case SharedFilterResults::Result::UNSHARED:
+		data = FilterPrefix(chunk);
+		break;
+
+	case SharedFilterResults::Result::COMPUTE:
+		try {
+			data = FilterPrefix(chunk);
+		} catch (...) {
+			shared_results->Abort(chunk);
+			throw;
+		}
+
+		shared_results->Commit(chunk, data);
+		break;
+
+	case SharedFilterResults::Result::HIT:
+		break;
+	}
+
+	if (data.empty())
+		return data;
+
 	/* apply filter chain */
 
 	return filter->FilterPCM(data);
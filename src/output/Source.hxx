@@ -38,6 +38,7 @@ struct MusicChunk;
 struct Tag;
 class Filter;
 class PreparedFilter;
+class SharedFilterResults;
 
 /**
  * Source of audio data to be played by an #AudioOutput.  It receives
@@ -100,6 +101,13 @@ class AudioOutputSource {
 	 */
 	std::unique_ptr<Filter> filter;
 
+	/**
+	 * If not nullptr, then the ReplayGain and cross-fade results
+	 * are shared with other outputs which are configured
+	 * identically; only #filter is applied by this object.
+	 */
+	SharedFilterResults *shared_results = nullptr;
+
 	/**
 	 * The #MusicChunk currently being processed (see
 	 * #pending_tag, #pending_data).
@@ -126,6 +134,15 @@ public:
 		replay_gain_mode = _mode;
 	}
 
+	/**
+	 * Must be called before the first Open().
+	 */
+	void SetSharedFilterResults(SharedFilterResults *_results) noexcept {
+		assert(!IsOpen());
+
+		shared_results = _results;
+	}
+
 	bool IsOpen() const {
 		return in_audio_format.IsDefined();
 	}
@@ -211,6 +228,12 @@ private:
 				       Filter *replay_gain_filter,
 				       unsigned *replay_gain_serial_p);
 
+	/**
+	 * Apply ReplayGain and cross-fading, i.e. everything but
+	 * #filter.
+	 */
+	ConstBuffer<void> FilterPrefix(const MusicChunk &chunk);
+
 	ConstBuffer<void> FilterChunk(const MusicChunk &chunk);
 
 	void DropCurrentChunk() noexcept {
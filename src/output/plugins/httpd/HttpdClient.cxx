@@ -19,6 +19,8 @@
 
 #include "HttpdClient.hxx"
 #include "HttpdInternal.hxx"
+#include "HttpdStream.hxx"
+#include "PageRing.hxx"
 #include "util/ASCII.hxx"
 #include "util/AllocatedString.hxx"
 #include "Page.hxx"
@@ -27,10 +29,28 @@
 #include "net/UniqueSocketDescriptor.hxx"
 #include "Log.hxx"
 
+#include <algorithm>
+
 #include <assert.h>
+#include <inttypes.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdio.h>
 
+#ifdef _WIN32
+struct iovec {
+	const void *iov_base;
+	size_t iov_len;
+};
+#else
+#include <sys/uio.h>
+#endif
+
+/**
+ * The maximum number of pages sent with one system call.
+ */
+static constexpr size_t MAX_IOV = 32;
+
 HttpdClient::~HttpdClient() noexcept
 {
 	if (IsDefined())
@@ -56,10 +76,22 @@ HttpdClient::BeginResponse() noexcept
 	assert(state != State::RESPONSE);
 
 	state = State::RESPONSE;
-	current_page = nullptr;
+	position = 0;
+
+	{
+		/* start with the burst, so the player can fill its
+		   buffer right away */
+		const std::lock_guard<Mutex> lock(httpd.mutex);
+		next_seq = httpd.GetBurstStart(*stream);
+		++stream->n_clients;
+	}
 
-	if (!head_method)
+	if (!head_method) {
 		httpd.SendHeader(*this);
+
+		if (HasPendingPages())
+			ScheduleWrite();
+	}
 }
 
 /**
@@ -83,6 +115,11 @@ HttpdClient::HandleLine(const char *line) noexcept
 			return false;
 		}
 
+		/* choose the stream by the request path */
+		const size_t path_length = strcspn(line, " ");
+		stream = &httpd.FindStream(line, path_length);
+		metadata_supported = !stream->implements_tag;
+
 		/* blacklist some well-known request paths */
 		if ((strncmp(line, "favicon.ico", 11) == 0 &&
 		     (line[11] == '\0' || line[11] == ' ')) ||
@@ -151,7 +188,7 @@ HttpdClient::SendResponse() noexcept
 		allocated =
 			icy_server_metadata_header(httpd.name, httpd.genre,
 						   httpd.website,
-						   httpd.content_type,
+						   stream->content_type,
 						   metaint);
 		response = allocated.c_str();
 	} else { /* revert to a normal HTTP request */
@@ -162,7 +199,7 @@ HttpdClient::SendResponse() noexcept
 			 "Pragma: no-cache\r\n"
 			 "Cache-Control: no-cache, no-store\r\n"
 			 "\r\n",
-			 httpd.content_type);
+			 stream->content_type);
 		response = buffer;
 	}
 
@@ -180,30 +217,39 @@ HttpdClient::SendResponse() noexcept
 }
 
 HttpdClient::HttpdClient(HttpdOutput &_httpd, UniqueSocketDescriptor _fd,
-			 EventLoop &_loop,
-			 bool _metadata_supported)
+			 EventLoop &_loop)
 	:BufferedSocket(_fd.Release(), _loop),
-	 httpd(_httpd),
-	 metadata_supported(_metadata_supported)
+	 httpd(_httpd)
+{
+}
+
+bool
+HttpdClient::HasPendingPages() const noexcept
 {
+	return pending != nullptr || next_seq != stream->ring.GetHead();
 }
 
 void
-HttpdClient::ClearQueue() noexcept
+HttpdClient::SkipTo(uint64_t seq) noexcept
 {
 	assert(state == State::RESPONSE);
 
-	while (!pages.empty()) {
-#ifndef NDEBUG
-		auto &page = pages.front();
-		assert(queue_size >= page->GetSize());
-		queue_size -= page->GetSize();
-#endif
+	if (seq <= next_seq)
+		return;
+
+	const auto &ring = stream->ring;
 
-		pages.pop();
+	if (position > 0) {
+		/* finish the page before skipping, or else the
+		   client would receive a torn frame */
+		assert(pending == nullptr);
+
+		pending = ring.Get(next_seq);
+		pending_position = position;
+		position = 0;
 	}
 
-	assert(queue_size == 0);
+	next_seq = seq;
 }
 
 void
@@ -212,38 +258,109 @@ HttpdClient::CancelQueue() noexcept
 	if (state != State::RESPONSE)
 		return;
 
-	ClearQueue();
+	SkipTo(stream->ring.GetHead());
 
-	if (current_page == nullptr)
+	if (pending == nullptr)
 		CancelWrite();
 }
 
 ssize_t
-HttpdClient::TryWritePage(const Page &page, size_t position) noexcept
+HttpdClient::TryWritePage(const Page &page, size_t _position) noexcept
 {
-	assert(position < page.GetSize());
+	assert(_position < page.GetSize());
 
-	return GetSocket().Write(page.GetData() + position,
-				 page.GetSize() - position);
+	return GetSocket().Write(page.GetData() + _position,
+				 page.GetSize() - _position);
 }
 
 ssize_t
-HttpdClient::TryWritePageN(const Page &page,
-			   size_t position, ssize_t n) noexcept
+HttpdClient::WritePages() noexcept
 {
-	return n >= 0
-		? GetSocket().Write(page.GetData() + position, n)
-		: TryWritePage(page, position);
+	const auto &ring = stream->ring;
+
+	/* don't send more than fits before the next metadata
+	   block */
+	size_t limit = metadata_requested
+		? metaint - metadata_fill
+		: SIZE_MAX;
+	assert(limit > 0);
+
+	struct iovec v[MAX_IOV];
+	size_t n = 0;
+
+	auto add = [&v, &n, &limit](const Page &page, size_t offset){
+		size_t length = std::min(page.GetSize() - offset, limit);
+		v[n].iov_base = const_cast<uint8_t *>(page.GetData() + offset);
+		v[n].iov_len = length;
+		++n;
+		limit -= length;
+	};
+
+	if (pending != nullptr)
+		add(*pending, pending_position);
+
+	for (uint64_t seq = next_seq;
+	     seq != ring.GetHead() && n < MAX_IOV && limit > 0; ++seq)
+		add(*ring.Get(seq), seq == next_seq ? position : 0);
+
+	assert(n > 0);
+
+#ifdef _WIN32
+	return GetSocket().Write(v[0].iov_base, v[0].iov_len);
+#else
+	return GetSocket().Write(v, n);
+#endif
 }
 
-ssize_t
-HttpdClient::GetBytesTillMetaData() const noexcept
+void
+HttpdClient::ConsumePages(size_t nbytes) noexcept
 {
-	if (metadata_requested &&
-	    current_page->GetSize() - current_position > metaint - metadata_fill)
-		return metaint - metadata_fill;
+	if (metadata_requested)
+		metadata_fill += nbytes;
+
+	if (pending != nullptr) {
+		const size_t remaining = pending->GetSize() - pending_position;
+		if (nbytes < remaining) {
+			pending_position += nbytes;
+			return;
+		}
+
+		nbytes -= remaining;
+		pending.reset();
+		pending_position = 0;
+	}
+
+	const auto &ring = stream->ring;
+
+	while (nbytes > 0) {
+		const size_t remaining = ring.Get(next_seq)->GetSize() - position;
+		if (nbytes < remaining) {
+			position += nbytes;
+			break;
+		}
+
+		nbytes -= remaining;
+		++next_seq;
+		position = 0;
+	}
+}
+
+bool
+HttpdClient::HandleWriteError() noexcept
+{
+	auto e = GetSocketError();
+	if (IsSocketErrorAgain(e))
+		return true;
 
-	return -1;
+	if (!IsSocketErrorClosed(e)) {
+		SocketErrorMessage msg(e);
+		FormatWarning(httpd_output_domain,
+			      "failed to write to client: %s",
+			      (const char *)msg);
+	}
+
+	Close();
+	return false;
 }
 
 inline bool
@@ -253,43 +370,20 @@ HttpdClient::TryWrite() noexcept
 
 	assert(state == State::RESPONSE);
 
-	if (current_page == nullptr) {
-		if (pages.empty()) {
-			/* another thread has removed the event source
-			   while this thread was waiting for
-			   httpd.mutex */
-			CancelWrite();
-			return true;
-		}
-
-		current_page = pages.front();
-		pages.pop();
-		current_position = 0;
-
-		assert(queue_size >= current_page->GetSize());
-		queue_size -= current_page->GetSize();
+	if (!HasPendingPages()) {
+		/* another thread has removed the event source
+		   while this thread was waiting for
+		   httpd.mutex */
+		CancelWrite();
+		return true;
 	}
 
-	const ssize_t bytes_to_write = GetBytesTillMetaData();
-	if (bytes_to_write == 0) {
+	if (metadata_requested && metadata_fill >= metaint) {
 		if (!metadata_sent) {
 			ssize_t nbytes = TryWritePage(*metadata,
 						      metadata_current_position);
-			if (nbytes < 0) {
-				auto e = GetSocketError();
-				if (IsSocketErrorAgain(e))
-					return true;
-
-				if (!IsSocketErrorClosed(e)) {
-					SocketErrorMessage msg(e);
-					FormatWarning(httpd_output_domain,
-						      "failed to write to client: %s",
-						      (const char *)msg);
-				}
-
-				Close();
-				return false;
-			}
+			if (nbytes < 0)
+				return HandleWriteError();
 
 			metadata_current_position += nbytes;
 
@@ -302,80 +396,60 @@ HttpdClient::TryWrite() noexcept
 			char empty_data = 0;
 
 			ssize_t nbytes = GetSocket().Write(&empty_data, 1);
-			if (nbytes < 0) {
-				auto e = GetSocketError();
-				if (IsSocketErrorAgain(e))
-					return true;
-
-				if (!IsSocketErrorClosed(e)) {
-					SocketErrorMessage msg(e);
-					FormatWarning(httpd_output_domain,
-						      "failed to write to client: %s",
-						      (const char *)msg);
-				}
-
-				Close();
-				return false;
-			}
+			if (nbytes < 0)
+				return HandleWriteError();
 
 			metadata_fill = 0;
 			metadata_current_position = 0;
 		}
 	} else {
-		ssize_t nbytes =
-			TryWritePageN(*current_page, current_position,
-				      bytes_to_write);
-		if (nbytes < 0) {
-			auto e = GetSocketError();
-			if (IsSocketErrorAgain(e))
-				return true;
-
-			if (!IsSocketErrorClosed(e)) {
-				SocketErrorMessage msg(e);
-				FormatWarning(httpd_output_domain,
-					      "failed to write to client: %s",
-					      (const char *)msg);
-			}
+		ssize_t nbytes = WritePages();
+		if (nbytes < 0)
+			return HandleWriteError();
 
-			Close();
-			return false;
-		}
+		ConsumePages(nbytes);
 
-		current_position += nbytes;
-		assert(current_position <= current_page->GetSize());
+		if (!HasPendingPages())
+			/* all pages are sent: remove the event
+			   source */
+			CancelWrite();
+	}
 
-		if (metadata_requested)
-			metadata_fill += nbytes;
+	return true;
+}
 
-		if (current_position >= current_page->GetSize()) {
-			current_page.reset();
+void
+HttpdClient::PushHeader(PagePtr page) noexcept
+{
+	assert(state == State::RESPONSE);
+	assert(pending == nullptr);
 
-			if (pages.empty())
-				/* all pages are sent: remove the
-				   event source */
-				CancelWrite();
-		}
-	}
+	pending = std::move(page);
+	pending_position = 0;
 
-	return true;
+	ScheduleWrite();
 }
 
 void
-HttpdClient::PushPage(PagePtr page) noexcept
+HttpdClient::OnNewPages() noexcept
 {
 	if (state != State::RESPONSE)
 		/* the client is still writing the HTTP request */
 		return;
 
-	if (queue_size > 256 * 1024) {
+	const auto &ring = stream->ring;
+	if (next_seq == ring.GetHead())
+		/* no new pages in this client's stream */
+		return;
+
+	const uint64_t backlog = ring.GetDistance(next_seq) - position;
+	if (backlog > httpd.GetMaxClientBacklog()) {
 		FormatDebug(httpd_output_domain,
-			    "client is too slow, flushing its queue");
-		ClearQueue();
+			    "client is too slow, skipping %" PRIu64 " bytes",
+			    backlog);
+		SkipTo(ring.GetHead() - 1);
 	}
 
-	queue_size += page->GetSize();
-	pages.emplace(std::move(page));
-
 	ScheduleWrite();
 }
 
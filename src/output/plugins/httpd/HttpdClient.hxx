@@ -27,13 +27,12 @@
 #include <boost/intrusive/link_mode.hpp>
 #include <boost/intrusive/list_hook.hpp>
 
-#include <queue>
-#include <list>
-
 #include <stddef.h>
+#include <stdint.h>
 
 class UniqueSocketDescriptor;
 class HttpdOutput;
+class HttpdStream;
 
 class HttpdClient final
 	: BufferedSocket,
@@ -43,6 +42,12 @@ class HttpdClient final
 	 */
 	HttpdOutput &httpd;
 
+	/**
+	 * The stream requested by this client.  It is determined by
+	 * the request line.
+	 */
+	HttpdStream *stream = nullptr;
+
 	/**
 	 * The current state of the client.
 	 */
@@ -58,25 +63,28 @@ class HttpdClient final
 	} state = State::REQUEST;
 
 	/**
-	 * A queue of #Page objects to be sent to the client.
+	 * A page which is not (or no longer) in the output's
+	 * #PageRing, to be sent before the pages from the ring: the
+	 * encoder header, or a page which this client was in the
+	 * middle of when it was skipped forward.
 	 */
-	std::queue<PagePtr, std::list<PagePtr>> pages;
+	PagePtr pending;
 
 	/**
-	 * The sum of all page sizes in #pages.
+	 * The amount of bytes which were already sent from #pending.
 	 */
-	size_t queue_size = 0;
+	size_t pending_position = 0;
 
 	/**
-	 * The #page which is currently being sent to the client.
+	 * The sequence number of the next #PageRing page to be sent.
 	 */
-	PagePtr current_page;
+	uint64_t next_seq = 0;
 
 	/**
-	 * The amount of bytes which were already sent from
-	 * #current_page.
+	 * The amount of bytes which were already sent from the page
+	 * #next_seq.
 	 */
-	size_t current_position;
+	size_t position = 0;
 
 	/**
 	 * Is this a HEAD request?
@@ -92,9 +100,9 @@ class HttpdClient final
 
 	/**
 	 * Do we support sending Icy-Metadata to the client?  This is
-	 * disabled if the httpd audio output uses encoder tags.
+	 * disabled if the stream uses encoder tags.
 	 */
-	bool metadata_supported;
+	bool metadata_supported = false;
 
 	/**
 	 * If we should sent icy metadata.
@@ -136,8 +144,7 @@ public:
 	 * @param _fd the socket file descriptor
 	 */
 	HttpdClient(HttpdOutput &httpd, UniqueSocketDescriptor _fd,
-		    EventLoop &_loop,
-		    bool _metadata_supported);
+		    EventLoop &_loop);
 
 	/**
 	 * Note: this does not remove the client from the
@@ -154,11 +161,43 @@ public:
 
 	void LockClose() noexcept;
 
+	/**
+	 * Has the client sent its request, i.e. is it receiving the
+	 * stream?
+	 */
+	bool IsStreaming() const noexcept {
+		return state == State::RESPONSE;
+	}
+
+	/**
+	 * Returns the stream requested by this client.  Only valid
+	 * if IsStreaming().
+	 */
+	HttpdStream &GetStream() const noexcept {
+		return *stream;
+	}
+
+	/**
+	 * Returns the sequence number of the oldest #PageRing page
+	 * this client still needs.  Only valid if IsStreaming().
+	 */
+	uint64_t GetSequence() const noexcept {
+		return next_seq;
+	}
+
 	/**
 	 * Clears the page queue.
 	 */
 	void CancelQueue() noexcept;
 
+	/**
+	 * Skip all #PageRing pages before the given sequence number.
+	 * A page which has been sent partially is finished first.
+	 *
+	 * Caller must lock the mutex.
+	 */
+	void SkipTo(uint64_t seq) noexcept;
+
 	/**
 	 * Handle a line of the HTTP request.
 	 */
@@ -174,19 +213,24 @@ public:
 	 */
 	bool SendResponse() noexcept;
 
-	gcc_pure
-	ssize_t GetBytesTillMetaData() const noexcept;
-
 	ssize_t TryWritePage(const Page &page, size_t position) noexcept;
-	ssize_t TryWritePageN(const Page &page,
-			      size_t position, ssize_t n) noexcept;
 
 	bool TryWrite() noexcept;
 
 	/**
-	 * Appends a page to the client's queue.
+	 * Send the given page before all pages from the #PageRing.
+	 * This is used for the encoder header.
 	 */
-	void PushPage(PagePtr page) noexcept;
+	void PushHeader(PagePtr page) noexcept;
+
+	/**
+	 * New pages may have been added to the stream's #PageRing.
+	 * If this client is too far behind, it skips to the newest
+	 * page.
+	 *
+	 * Caller must lock the mutex.
+	 */
+	void OnNewPages() noexcept;
 
 	/**
 	 * Sends the passed metadata.
@@ -194,7 +238,28 @@ public:
 	void PushMetaData(PagePtr page) noexcept;
 
 private:
-	void ClearQueue() noexcept;
+	/**
+	 * Are there pages which have not yet been sent?
+	 */
+	gcc_pure
+	bool HasPendingPages() const noexcept;
+
+	/**
+	 * Write as much of the queued pages as possible with one
+	 * system call (up to the next metadata block).
+	 */
+	ssize_t WritePages() noexcept;
+
+	/**
+	 * Mark the given number of bytes as sent.
+	 */
+	void ConsumePages(size_t nbytes) noexcept;
+
+	/**
+	 * Handle a failed write.  Returns false if the client has
+	 * been closed.
+	 */
+	bool HandleWriteError() noexcept;
 
 protected:
 	/* virtual methods from class SocketMonitor */
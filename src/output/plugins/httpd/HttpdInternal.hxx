@@ -26,8 +26,10 @@
 #define MPD_OUTPUT_HTTPD_INTERNAL_H
 
 #include "HttpdClient.hxx"
+#include "HttpdStream.hxx"
 #include "output/Interface.hxx"
 #include "output/Timer.hxx"
+#include "AudioFormat.hxx"
 #include "thread/Mutex.hxx"
 #include "thread/Cond.hxx"
 #include "event/ServerSocket.hxx"
@@ -37,16 +39,17 @@
 
 #include <boost/intrusive/list.hpp>
 
-#include <queue>
-#include <list>
+#include <chrono>
+#include <map>
 #include <memory>
+#include <string>
+#include <vector>
 
 struct ConfigBlock;
 class EventLoop;
 class ServerSocket;
 class HttpdClient;
-class PreparedEncoder;
-class Encoder;
+class WorkerPool;
 struct Tag;
 
 class HttpdOutput final : AudioOutput, ServerSocket {
@@ -59,34 +62,36 @@ class HttpdOutput final : AudioOutput, ServerSocket {
 	bool pause;
 
 	/**
-	 * The configured encoder plugin.
+	 * The encoded streams.  The first one is the default
+	 * stream; the others ("variant" settings) are served at
+	 * their own URI path.
 	 */
-	std::unique_ptr<PreparedEncoder> prepared_encoder;
-	Encoder *encoder = nullptr;
+	std::vector<std::unique_ptr<HttpdStream>> streams;
 
 	/**
-	 * Number of bytes which were fed into the encoder, without
-	 * ever receiving new output.  This is used to estimate
-	 * whether MPD should manually flush the encoder, to avoid
-	 * buffer underruns in the client.
+	 * Runs the encoders of several streams in parallel.  Only
+	 * allocated while the output is open and if there is more
+	 * than one stream.
 	 */
-	size_t unflushed_input = 0;
+	std::unique_ptr<WorkerPool> encoder_pool;
 
-public:
 	/**
-	 * The MIME type produced by the #encoder.
+	 * The streams which are fed in EncodeAndPlay(); only used by
+	 * the OutputThread.  This is a member to avoid allocating it
+	 * for each chunk.
 	 */
-	const char *content_type;
+	std::vector<HttpdStream *> active_streams;
 
+public:
 	/**
-	 * This mutex protects the listener socket and the client
-	 * list.
+	 * This mutex protects the listener socket, the client list
+	 * and the #HttpdStream attributes.
 	 */
 	mutable Mutex mutex;
 
 	/**
 	 * This condition gets signalled when an item is removed from
-	 * #pages.
+	 * HttpdStream::pages.
 	 */
 	Cond cond;
 
@@ -98,22 +103,42 @@ private:
 	Timer *timer;
 
 	/**
-	 * The header page, which is sent to every client on connect.
+	 * The metadata, which is sent to every client.
 	 */
-	PagePtr header;
+	PagePtr metadata;
 
 	/**
-	 * The metadata, which is sent to every client.
+	 * If a client falls behind by more than this number of
+	 * bytes, it skips to the newest page.
 	 */
-	PagePtr metadata;
+	size_t max_client_backlog;
+
+	/**
+	 * The maximum size of the burst which is sent to new clients
+	 * right after the header; 0 disables the burst.  Pages are
+	 * kept in HttpdStream::ring for that.
+	 */
+	size_t burst_size = 0;
+
+	/**
+	 * The maximum duration of the burst; zero means only
+	 * #burst_size applies.
+	 */
+	std::chrono::steady_clock::duration burst_time;
+
+	/**
+	 * The duration of the audio data which has been fed into the
+	 * encoders since they were opened.  Together with the size
+	 * of the encoded data, this is used to convert #burst_time
+	 * to bytes.  Protected by #mutex.
+	 */
+	std::chrono::steady_clock::duration encoded_time =
+		std::chrono::steady_clock::duration::zero();
 
 	/**
-	 * The page queue, i.e. pages from the encoder to be
-	 * broadcasted to all clients.  This container is necessary to
-	 * pass pages from the OutputThread to the IOThread.  It is
-	 * protected by #mutex, and removing signals #cond.
+	 * The audio format which is fed into the encoders.
 	 */
-	std::queue<PagePtr, std::list<PagePtr>> pages;
+	AudioFormat pcm_format;
 
 	DeferEvent defer_broadcast;
 
@@ -139,12 +164,6 @@ private:
 	boost::intrusive::list<HttpdClient,
 			       boost::intrusive::constant_time_size<true>> clients;
 
-	/**
-	 * A temporary buffer for the httpd_output_read_page()
-	 * function.
-	 */
-	char buffer[32768];
-
 	/**
 	 * The maximum and current number of clients connected
 	 * at the same time.
@@ -153,6 +172,7 @@ private:
 
 public:
 	HttpdOutput(EventLoop &_loop, const ConfigBlock &block);
+	~HttpdOutput() noexcept;
 
 	static AudioOutput *Create(EventLoop &event_loop,
 				   const ConfigBlock &block) {
@@ -172,13 +192,6 @@ public:
 		Unbind();
 	}
 
-	/**
-	 * Caller must lock the mutex.
-	 *
-	 * Throws on error.
-	 */
-	void OpenEncoder(AudioFormat &audio_format);
-
 	/**
 	 * Caller must lock the mutex.
 	 */
@@ -208,6 +221,28 @@ public:
 		return HasClients();
 	}
 
+	/**
+	 * Returns the stream for the given request path (without
+	 * the leading slash).  Falls back to the default stream.
+	 */
+	gcc_pure
+	HttpdStream &FindStream(const char *path,
+				size_t length) const noexcept;
+
+	size_t GetMaxClientBacklog() const noexcept {
+		return max_client_backlog;
+	}
+
+	/**
+	 * Returns the sequence number of the first page of the
+	 * given stream to be sent to a new client (after the
+	 * header).
+	 *
+	 * Caller must lock the mutex.
+	 */
+	gcc_pure
+	uint64_t GetBurstStart(const HttpdStream &stream) const noexcept;
+
 	/**
 	 * Caller must lock the mutex.
 	 */
@@ -226,28 +261,26 @@ public:
 	 */
 	void SendHeader(HttpdClient &client) const noexcept;
 
+	const std::map<std::string, std::string> GetAttributes() const noexcept override;
+
 	gcc_pure
 	std::chrono::steady_clock::duration Delay() const noexcept override;
 
 	/**
-	 * Reads data from the encoder (as much as available) and
-	 * returns it as a new #page object.
-	 */
-	PagePtr ReadPage();
-
-	/**
-	 * Broadcasts a page struct to all clients.
+	 * Broadcasts a page struct to all clients of the given
+	 * stream.
 	 *
 	 * Mutext must not be locked.
 	 */
-	void BroadcastPage(PagePtr page) noexcept;
+	void BroadcastPage(HttpdStream &stream, PagePtr page) noexcept;
 
 	/**
-	 * Broadcasts data from the encoder to all clients.
+	 * Broadcasts data from the encoder to all clients of the
+	 * given stream.
 	 *
 	 * Mutext must not be locked.
 	 */
-	void BroadcastFromEncoder();
+	void BroadcastFromEncoder(HttpdStream &stream);
 
 	/**
 	 * Mutext must not be locked.
@@ -269,6 +302,39 @@ public:
 	bool Pause() override;
 
 private:
+	/**
+	 * Feed a chunk into one stream's encoder and queue the
+	 * resulting pages.  This may run on a worker thread;
+	 * exceptions are stored in HttpdStream::error.
+	 */
+	void EncodeStream(HttpdStream &stream,
+			  const void *chunk, size_t size) noexcept;
+
+	/**
+	 * Returns the maximum burst size in bytes, taking
+	 * #burst_time into account.
+	 *
+	 * Caller must lock the mutex.
+	 */
+	gcc_pure
+	size_t GetBurstSize(const HttpdStream &stream) const noexcept;
+
+	/**
+	 * Remove the oldest page from the stream's ring, and make
+	 * all clients which still need it skip it.
+	 *
+	 * Caller must lock the mutex.
+	 */
+	void ExpirePage(HttpdStream &stream) noexcept;
+
+	/**
+	 * Remove all pages from the stream's ring which are not
+	 * needed by any client and are not part of the burst.
+	 *
+	 * Caller must lock the mutex.
+	 */
+	void TrimPages(HttpdStream &stream) noexcept;
+
 	/* DeferEvent callback */
 	void OnDeferredBroadcast() noexcept;
 
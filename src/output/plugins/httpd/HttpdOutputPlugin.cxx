@@ -20,29 +20,84 @@
 #include "HttpdOutputPlugin.hxx"
 #include "HttpdInternal.hxx"
 #include "HttpdClient.hxx"
+#include "HttpdStream.hxx"
 #include "output/OutputAPI.hxx"
-#include "encoder/EncoderInterface.hxx"
-#include "encoder/Configured.hxx"
 #include "net/UniqueSocketDescriptor.hxx"
 #include "net/SocketAddress.hxx"
 #include "Page.hxx"
 #include "IcyMetaDataServer.hxx"
 #include "event/Call.hxx"
+#include "thread/WorkerPool.hxx"
 #include "util/Domain.hxx"
 #include "util/DeleteDisposer.hxx"
+#include "util/RuntimeError.hxx"
+#include "util/SplitString.hxx"
+#include "util/StringCompare.hxx"
 #include "config/Net.hxx"
+#include "config/Block.hxx"
+#include "config/Parser.hxx"
+#include "Log.hxx"
 
-#include <assert.h>
+#include <algorithm>
+#include <thread>
 
+#include <assert.h>
 #include <string.h>
+#include <time.h>
 
 const Domain httpd_output_domain("httpd_output");
 
+/**
+ * The maximum number of pages in HttpdStream::ring.
+ */
+static constexpr size_t PAGE_RING_CAPACITY = 1024;
+
+static constexpr size_t DEFAULT_MAX_CLIENT_BACKLOG = 256 * 1024;
+
+/**
+ * Parse a "variant" setting: a URI path followed by encoder
+ * settings, e.g. "/low.mp3 encoder=lame bitrate=128".
+ *
+ * Throws on error.
+ */
+static std::unique_ptr<HttpdStream>
+ParseVariant(const BlockParam &param)
+{
+	return param.With([&param](const char *value){
+		auto words = SplitString(value, ' ');
+		words.remove(std::string());
+
+		if (words.empty())
+			throw std::runtime_error("URI path expected");
+
+		const char *path = words.front().c_str();
+		if (*path == '/')
+			++path;
+
+		if (*path == 0)
+			throw std::runtime_error("URI path expected");
+
+		ConfigBlock block(param.line);
+		for (auto i = std::next(words.begin()); i != words.end(); ++i) {
+			const auto eq = i->find('=');
+			if (eq == std::string::npos || eq == 0)
+				throw FormatRuntimeError("Malformed encoder setting: %s",
+							 i->c_str());
+
+			block.AddBlockParam(i->substr(0, eq),
+					    i->substr(eq + 1),
+					    param.line);
+		}
+
+		return std::make_unique<HttpdStream>(path, block,
+						     PAGE_RING_CAPACITY);
+	});
+}
+
 inline
 HttpdOutput::HttpdOutput(EventLoop &_loop, const ConfigBlock &block)
 	:AudioOutput(FLAG_ENABLE_DISABLE|FLAG_PAUSE),
 	 ServerSocket(_loop),
-	 prepared_encoder(CreateConfiguredEncoder(block)),
 	 defer_broadcast(_loop, BIND_THIS_METHOD(OnDeferredBroadcast))
 {
 	/* read configuration */
@@ -52,16 +107,52 @@ HttpdOutput::HttpdOutput(EventLoop &_loop, const ConfigBlock &block)
 
 	clients_max = block.GetBlockValue("max_clients", 0u);
 
+	max_client_backlog = DEFAULT_MAX_CLIENT_BACKLOG;
+	const auto *backlog_param = block.GetBlockParam("max_client_backlog");
+	if (backlog_param != nullptr)
+		max_client_backlog = backlog_param->With([](const char *s){
+			return ParseSize(s);
+		});
+
+	const auto *burst_size_param = block.GetBlockParam("burst_size");
+	if (burst_size_param != nullptr)
+		burst_size = burst_size_param->With([](const char *s){
+			return ParseSize(s);
+		});
+
+	burst_time = std::chrono::seconds(block.GetBlockValue("burst_time",
+								0u));
+	if (burst_time > burst_time.zero() && burst_size == 0)
+		/* leave room for the pages which arrive while the
+		   new client is still receiving its burst */
+		burst_size = max_client_backlog / 2;
+
+	/* the burst counts towards the client's backlog; with a
+	   burst that large, a new client would skip it as soon as
+	   the next page arrives */
+	if (burst_size >= max_client_backlog)
+		throw std::runtime_error("burst_size must be smaller than max_client_backlog");
+
 	/* set up bind_to_address */
 
 	ServerSocketAddGeneric(*this, block.GetBlockValue("bind_to_address"), block.GetBlockValue("port", 8000u));
 
-	/* determine content type */
-	content_type = prepared_encoder->GetMimeType();
-	if (content_type == nullptr)
-		content_type = "application/octet-stream";
+	/* the default stream uses the encoder settings of this
+	   block */
+	streams.emplace_back(std::make_unique<HttpdStream>("", block,
+							   PAGE_RING_CAPACITY));
+
+	for (const auto &param : block.block_params) {
+		if (param.name != "variant")
+			continue;
+
+		param.used = true;
+		streams.emplace_back(ParseVariant(param));
+	}
 }
 
+HttpdOutput::~HttpdOutput() noexcept = default;
+
 inline void
 HttpdOutput::Bind()
 {
@@ -82,6 +173,16 @@ HttpdOutput::Unbind() noexcept
 		});
 }
 
+HttpdStream &
+HttpdOutput::FindStream(const char *path, size_t length) const noexcept
+{
+	for (const auto &stream : streams)
+		if (!stream->IsDefault() && stream->MatchPath(path, length))
+			return *stream;
+
+	return *streams.front();
+}
+
 /**
  * Creates a new #HttpdClient object and adds it into the
  * HttpdOutput.clients linked list.
@@ -89,8 +190,7 @@ HttpdOutput::Unbind() noexcept
 inline void
 HttpdOutput::AddClient(UniqueSocketDescriptor fd) noexcept
 {
-	auto *client = new HttpdClient(*this, std::move(fd), GetEventLoop(),
-				       !encoder->ImplementsTag());
+	auto *client = new HttpdClient(*this, std::move(fd), GetEventLoop());
 	clients.push_front(*client);
 
 	/* pass metadata to client */
@@ -99,85 +199,132 @@ HttpdOutput::AddClient(UniqueSocketDescriptor fd) noexcept
 }
 
 void
-HttpdOutput::OnDeferredBroadcast() noexcept
+HttpdOutput::ExpirePage(HttpdStream &stream) noexcept
 {
-	/* this method runs in the IOThread; it broadcasts pages from
-	   our own queue to all clients */
+	auto &ring = stream.ring;
+	assert(!ring.empty());
 
-	const std::lock_guard<Mutex> protect(mutex);
+	const uint64_t seq = ring.GetTail();
 
-	while (!pages.empty()) {
-		PagePtr page = std::move(pages.front());
-		pages.pop();
+	for (auto &client : clients) {
+		if (client.IsStreaming() && &client.GetStream() == &stream &&
+		    client.GetSequence() == seq) {
+			FormatDebug(httpd_output_domain,
+				    "client is too slow, skipping a page");
+			client.SkipTo(seq + 1);
+		}
+	}
 
-		for (auto &client : clients)
-			client.PushPage(page);
+	ring.PopFront();
+}
+
+size_t
+HttpdOutput::GetBurstSize(const HttpdStream &stream) const noexcept
+{
+	size_t size = burst_size;
+
+	if (burst_time > burst_time.zero() &&
+	    encoded_time > encoded_time.zero()) {
+		/* convert the time to bytes using the average bit
+		   rate of the encoder so far */
+		const double time_size = double(stream.ring.GetEndOffset()) *
+			burst_time.count() / encoded_time.count();
+		if (time_size < size)
+			size = size_t(time_size);
 	}
 
-	/* wake up the client that may be waiting for the queue to be
-	   flushed */
-	cond.notify_all();
+	return size;
+}
+
+uint64_t
+HttpdOutput::GetBurstStart(const HttpdStream &stream) const noexcept
+{
+	const auto &ring = stream.ring;
+	const size_t max_size = GetBurstSize(stream);
+
+	uint64_t seq = std::max(stream.burst_seq, ring.GetTail());
+	while (seq < ring.GetHead() && ring.GetDistance(seq) > max_size)
+		++seq;
+
+	return seq;
 }
 
 void
-HttpdOutput::OnAccept(UniqueSocketDescriptor fd,
-		      SocketAddress, gcc_unused int uid) noexcept
+HttpdOutput::TrimPages(HttpdStream &stream) noexcept
 {
-	/* the listener socket has become readable - a client has
-	   connected */
+	stream.burst_seq = GetBurstStart(stream);
 
-	const std::lock_guard<Mutex> protect(mutex);
+	uint64_t min_seq = stream.burst_seq;
+	for (const auto &client : clients)
+		if (client.IsStreaming() && &client.GetStream() == &stream &&
+		    client.GetSequence() < min_seq)
+			min_seq = client.GetSequence();
 
-	/* can we allow additional client */
-	if (open && (clients_max == 0 || clients.size() < clients_max))
-		AddClient(std::move(fd));
+	auto &ring = stream.ring;
+	while (ring.GetTail() < min_seq)
+		ring.PopFront();
 }
 
-PagePtr
-HttpdOutput::ReadPage()
+void
+HttpdOutput::OnDeferredBroadcast() noexcept
 {
-	if (unflushed_input >= 65536) {
-		/* we have fed a lot of input into the encoder, but it
-		   didn't give anything back yet - flush now to avoid
-		   buffer underruns */
-		try {
-			encoder->Flush();
-		} catch (...) {
-			/* ignore */
-		}
+	/* this method runs in the IOThread; it moves pages from the
+	   streams' queues to their rings, where all clients can see
+	   them */
 
-		unflushed_input = 0;
-	}
+	const std::lock_guard<Mutex> protect(mutex);
+
+	bool modified = false;
+
+	for (auto &i : streams) {
+		auto &stream = *i;
+		if (stream.pages.empty())
+			continue;
 
-	size_t size = 0;
-	do {
-		size_t nbytes = encoder->Read(buffer + size,
-					      sizeof(buffer) - size);
-		if (nbytes == 0)
-			break;
+		do {
+			if (stream.ring.IsFull())
+				ExpirePage(stream);
 
-		unflushed_input = 0;
+			const bool is_header =
+				stream.pages.front() == stream.header;
+			const uint64_t seq =
+				stream.ring.Push(std::move(stream.pages.front()));
+			stream.pages.pop();
 
-		size += nbytes;
-	} while (size < sizeof(buffer));
+			if (is_header)
+				/* a new stream begins; the burst must
+				   not contain pages of the old one */
+				stream.burst_seq = seq + 1;
+		} while (!stream.pages.empty());
+
+		modified = true;
+	}
+
+	if (modified) {
+		for (auto &client : clients)
+			client.OnNewPages();
 
-	if (size == 0)
-		return nullptr;
+		for (auto &stream : streams)
+			TrimPages(*stream);
+	}
 
-	return std::make_shared<Page>(buffer, size);
+	/* wake up the client that may be waiting for the queue to be
+	   flushed */
+	cond.notify_all();
 }
 
-inline void
-HttpdOutput::OpenEncoder(AudioFormat &audio_format)
+void
+HttpdOutput::OnAccept(UniqueSocketDescriptor fd,
+		      SocketAddress, gcc_unused int uid) noexcept
 {
-	encoder = prepared_encoder->Open(audio_format);
+	/* the listener socket has become readable - a client has
+	   connected */
 
-	/* we have to remember the encoder header, i.e. the first
-	   bytes of encoder output after opening it, because it has to
-	   be sent to every new client */
-	header = ReadPage();
+	const std::lock_guard<Mutex> protect(mutex);
 
-	unflushed_input = 0;
+	/* can we allow additional client */
+	if (open && (clients_max == 0 || clients.size() < clients_max))
+		AddClient(std::move(fd));
 }
 
 void
@@ -188,7 +335,34 @@ HttpdOutput::Open(AudioFormat &audio_format)
 
 	const std::lock_guard<Mutex> protect(mutex);
 
-	OpenEncoder(audio_format);
+	/* the default stream determines the audio format; the
+	   input of the other streams is converted if necessary */
+	for (auto i = streams.begin(); i != streams.end(); ++i) {
+		try {
+			(*i)->Open(audio_format, i == streams.begin());
+		} catch (...) {
+			while (i != streams.begin())
+				(*--i)->Close();
+			throw;
+		}
+	}
+
+	pcm_format = audio_format;
+	encoded_time = encoded_time.zero();
+
+	for (auto &stream : streams)
+		stream->burst_seq = stream->ring.GetHead();
+
+	if (streams.size() > 1) {
+		/* the OutputThread encodes one stream itself */
+		const unsigned n_cpus =
+			std::max(std::thread::hardware_concurrency(), 1u);
+		const unsigned n_threads =
+			std::min<unsigned>(n_cpus, streams.size()) - 1;
+		if (n_threads > 0)
+			encoder_pool = std::make_unique<WorkerPool>("httpd_encoder",
+								    n_threads);
+	}
 
 	/* initialize other attributes */
 
@@ -211,11 +385,20 @@ HttpdOutput::Close() noexcept
 			const std::lock_guard<Mutex> protect(mutex);
 			open = false;
 			clients.clear_and_dispose(DeleteDisposer());
+
+			for (auto &stream : streams) {
+				stream->n_clients = 0;
+				stream->ring.Clear();
+
+				while (!stream->pages.empty())
+					stream->pages.pop();
+			}
 		});
 
-	header.reset();
+	encoder_pool.reset();
 
-	delete encoder;
+	for (auto &stream : streams)
+		stream->Close();
 }
 
 void
@@ -223,6 +406,12 @@ HttpdOutput::RemoveClient(HttpdClient &client) noexcept
 {
 	assert(!clients.empty());
 
+	if (client.IsStreaming()) {
+		auto &stream = client.GetStream();
+		assert(stream.n_clients > 0);
+		--stream.n_clients;
+	}
+
 	clients.erase_and_dispose(clients.iterator_to(client),
 				  DeleteDisposer());
 }
@@ -230,8 +419,36 @@ HttpdOutput::RemoveClient(HttpdClient &client) noexcept
 void
 HttpdOutput::SendHeader(HttpdClient &client) const noexcept
 {
+	const auto &header = client.GetStream().header;
 	if (header != nullptr)
-		client.PushPage(header);
+		client.PushHeader(header);
+}
+
+const std::map<std::string, std::string>
+HttpdOutput::GetAttributes() const noexcept
+{
+	const std::lock_guard<Mutex> lock(mutex);
+
+	std::map<std::string, std::string> result;
+
+	size_t burst_bytes = 0, buffered_bytes = 0;
+	for (const auto &i : streams) {
+		const auto &stream = *i;
+		burst_bytes += stream.ring.GetDistance(GetBurstStart(stream));
+		buffered_bytes += stream.ring.GetSize();
+
+		/* per-stream statistics, prefixed with the URI
+		   path */
+		const std::string prefix = "/" + stream.GetPath() + ":";
+		result.emplace(prefix + "listeners",
+			       std::to_string(stream.n_clients));
+		result.emplace(prefix + "cpu_ms",
+			       std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(stream.cpu_time).count()));
+	}
+
+	result.emplace("burst_bytes", std::to_string(burst_bytes));
+	result.emplace("buffered_bytes", std::to_string(buffered_bytes));
+	return result;
 }
 
 std::chrono::steady_clock::duration
@@ -256,33 +473,33 @@ HttpdOutput::Delay() const noexcept
 }
 
 void
-HttpdOutput::BroadcastPage(PagePtr page) noexcept
+HttpdOutput::BroadcastPage(HttpdStream &stream, PagePtr page) noexcept
 {
 	assert(page != nullptr);
 
 	{
 		const std::lock_guard<Mutex> lock(mutex);
-		pages.emplace(std::move(page));
+		stream.pages.emplace(std::move(page));
 	}
 
 	defer_broadcast.Schedule();
 }
 
 void
-HttpdOutput::BroadcastFromEncoder()
+HttpdOutput::BroadcastFromEncoder(HttpdStream &stream)
 {
 	/* synchronize with the IOThread */
 	{
 		std::unique_lock<Mutex> lock(mutex);
-		cond.wait(lock, [this]{ return pages.empty(); });
+		cond.wait(lock, [&stream]{ return stream.pages.empty(); });
 	}
 
 	bool empty = true;
 
 	PagePtr page;
-	while ((page = ReadPage()) != nullptr) {
+	while ((page = stream.ReadPage()) != nullptr) {
 		const std::lock_guard<Mutex> lock(mutex);
-		pages.emplace(std::move(page));
+		stream.pages.emplace(std::move(page));
 		empty = false;
 	}
 
@@ -290,14 +507,88 @@ HttpdOutput::BroadcastFromEncoder()
 		defer_broadcast.Schedule();
 }
 
+/**
+ * Returns the CPU time consumed by the current thread.
+ */
+static std::chrono::steady_clock::duration
+GetThreadCpuTime() noexcept
+{
+#ifdef CLOCK_THREAD_CPUTIME_ID
+	struct timespec ts;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+		return std::chrono::seconds(ts.tv_sec) +
+			std::chrono::nanoseconds(ts.tv_nsec);
+#endif
+
+	return std::chrono::steady_clock::duration::zero();
+}
+
+void
+HttpdOutput::EncodeStream(HttpdStream &stream,
+			  const void *chunk, size_t size) noexcept
+{
+	const auto start = GetThreadCpuTime();
+
+	try {
+		stream.Encode(chunk, size);
+
+		PagePtr page;
+		while ((page = stream.ReadPage()) != nullptr) {
+			const std::lock_guard<Mutex> lock(mutex);
+			stream.pages.emplace(std::move(page));
+		}
+	} catch (...) {
+		stream.error = std::current_exception();
+	}
+
+	const auto cpu_time = GetThreadCpuTime() - start;
+
+	const std::lock_guard<Mutex> lock(mutex);
+	stream.cpu_time += cpu_time;
+}
+
 inline void
 HttpdOutput::EncodeAndPlay(const void *chunk, size_t size)
 {
-	encoder->Write(chunk, size);
+	active_streams.clear();
+
+	{
+		std::unique_lock<Mutex> lock(mutex);
+
+		/* synchronize with the IOThread */
+		cond.wait(lock, [this]{
+				return std::all_of(streams.begin(), streams.end(),
+						   [](const std::unique_ptr<HttpdStream> &stream){
+							   return stream->pages.empty();
+						   });
+			});
+
+		/* with a burst buffer, the encoder must run even
+		   without clients */
+		for (auto &stream : streams)
+			if (burst_size > 0 || stream->n_clients > 0)
+				active_streams.push_back(stream.get());
+
+		encoded_time += pcm_format.SizeToTime<std::chrono::steady_clock::duration>(size);
+	}
+
+	auto encode = [this, chunk, size](unsigned i){
+		EncodeStream(*active_streams[i], chunk, size);
+	};
+
+	if (encoder_pool && active_streams.size() > 1)
+		encoder_pool->ForEach(active_streams.size(), encode);
+	else
+		for (unsigned i = 0; i < active_streams.size(); ++i)
+			encode(i);
 
-	unflushed_input += size;
+	for (auto *stream : active_streams)
+		if (stream->error)
+			std::rethrow_exception(std::exchange(stream->error,
+							     std::exception_ptr()));
 
-	BroadcastFromEncoder();
+	if (!active_streams.empty())
+		defer_broadcast.Schedule();
 }
 
 size_t
@@ -305,7 +596,7 @@ HttpdOutput::Play(const void *chunk, size_t size)
 {
 	pause = false;
 
-	if (LockHasClients())
+	if (burst_size > 0 || LockHasClients())
 		EncodeAndPlay(chunk, size);
 
 	if (!timer->IsStarted())
@@ -331,39 +622,45 @@ HttpdOutput::Pause()
 void
 HttpdOutput::SendTag(const Tag &tag)
 {
-	if (encoder->ImplementsTag()) {
+	bool icy = false;
+
+	for (auto &i : streams) {
+		auto &stream = *i;
+
+		if (!stream.implements_tag) {
+			icy = true;
+			continue;
+		}
+
 		/* embed encoder tags */
 
 		/* flush the current stream, and end it */
 
-		try {
-			encoder->PreTag();
-		} catch (...) {
-			/* ignore */
-		}
+		stream.PreTag();
 
-		BroadcastFromEncoder();
+		BroadcastFromEncoder(stream);
 
 		/* send the tag to the encoder - which starts a new
 		   stream now */
 
-		try {
-			encoder->SendTag(tag);
-			encoder->Flush();
-		} catch (...) {
-			/* ignore */
-		}
+		stream.SendTag(tag);
 
 		/* the first page generated by the encoder will now be
 		   used as the new "header" page, which is sent to all
 		   new clients */
 
-		auto page = ReadPage();
+		auto page = stream.ReadPage();
 		if (page != nullptr) {
-			header = page;
-			BroadcastPage(page);
+			{
+				const std::lock_guard<Mutex> lock(mutex);
+				stream.header = page;
+			}
+
+			BroadcastPage(stream, page);
 		}
-	} else {
+	}
+
+	if (icy) {
 		/* use Icy-Metadata */
 
 		static constexpr TagType types[] = {
@@ -385,14 +682,16 @@ HttpdOutput::CancelAllClients() noexcept
 {
 	const std::lock_guard<Mutex> protect(mutex);
 
-	while (!pages.empty()) {
-		PagePtr page = std::move(pages.front());
-		pages.pop();
-	}
+	for (auto &stream : streams)
+		while (!stream->pages.empty())
+			stream->pages.pop();
 
 	for (auto &client : clients)
 		client.CancelQueue();
 
+	for (auto &stream : streams)
+		TrimPages(*stream);
+
 	cond.notify_all();
 }
 
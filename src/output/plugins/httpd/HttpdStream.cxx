@@ -0,0 +1,151 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "HttpdStream.hxx"
+#include "encoder/EncoderInterface.hxx"
+#include "encoder/Configured.hxx"
+#include "pcm/Convert.hxx"
+#include "util/ConstBuffer.hxx"
+
+HttpdStream::HttpdStream(const char *_path, const ConfigBlock &block,
+			 size_t ring_capacity)
+	:path(_path),
+	 prepared_encoder(CreateConfiguredEncoder(block)),
+	 ring(ring_capacity)
+{
+	/* determine content type */
+	content_type = prepared_encoder->GetMimeType();
+	if (content_type == nullptr)
+		content_type = "application/octet-stream";
+}
+
+HttpdStream::~HttpdStream() noexcept = default;
+
+void
+HttpdStream::Open(AudioFormat &audio_format, bool is_default)
+{
+	AudioFormat encoder_format = audio_format;
+	encoder = prepared_encoder->Open(encoder_format);
+
+	if (is_default)
+		audio_format = encoder_format;
+	else if (encoder_format != audio_format) {
+		try {
+			convert = std::make_unique<PcmConvert>(audio_format,
+							       encoder_format);
+		} catch (...) {
+			delete encoder;
+			encoder = nullptr;
+			throw;
+		}
+	}
+
+	implements_tag = encoder->ImplementsTag();
+
+	/* we have to remember the encoder header, i.e. the first
+	   bytes of encoder output after opening it, because it has to
+	   be sent to every new client */
+	header = ReadPage();
+
+	unflushed_input = 0;
+	cpu_time = cpu_time.zero();
+}
+
+void
+HttpdStream::Close() noexcept
+{
+	header.reset();
+	convert.reset();
+
+	delete encoder;
+	encoder = nullptr;
+}
+
+PagePtr
+HttpdStream::ReadPage()
+{
+	if (unflushed_input >= 65536) {
+		/* we have fed a lot of input into the encoder, but it
+		   didn't give anything back yet - flush now to avoid
+		   buffer underruns */
+		try {
+			encoder->Flush();
+		} catch (...) {
+			/* ignore */
+		}
+
+		unflushed_input = 0;
+	}
+
+	size_t size = 0;
+	do {
+		size_t nbytes = encoder->Read(buffer + size,
+					      sizeof(buffer) - size);
+		if (nbytes == 0)
+			break;
+
+		unflushed_input = 0;
+
+		size += nbytes;
+	} while (size < sizeof(buffer));
+
+	if (size == 0)
+		return nullptr;
+
+	return std::make_shared<Page>(buffer, size);
+}
+
+void
+HttpdStream::Encode(const void *chunk, size_t size)
+{
+	unflushed_input += size;
+
+	if (convert) {
+		auto dest = convert->Convert({chunk, size});
+		if (dest.empty())
+			return;
+
+		chunk = dest.data;
+		size = dest.size;
+	}
+
+	encoder->Write(chunk, size);
+}
+
+void
+HttpdStream::PreTag() noexcept
+{
+	try {
+		encoder->PreTag();
+	} catch (...) {
+		/* ignore */
+	}
+}
+
+void
+HttpdStream::SendTag(const Tag &tag) noexcept
+{
+	try {
+		encoder->SendTag(tag);
+		encoder->Flush();
+	} catch (...) {
+		/* ignore */
+	}
+}
@@ -0,0 +1,213 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_HTTPD_STREAM_HXX
+#define MPD_HTTPD_STREAM_HXX
+
+#include "Page.hxx"
+#include "PageRing.hxx"
+#include "AudioFormat.hxx"
+#include "util/Compiler.h"
+
+#include <chrono>
+#include <exception>
+#include <list>
+#include <memory>
+#include <queue>
+#include <string>
+
+struct ConfigBlock;
+struct Tag;
+class PreparedEncoder;
+class Encoder;
+class PcmConvert;
+
+/**
+ * One encoded stream of an #HttpdOutput.  Each stream has its own
+ * encoder and is served at its own URI path, but all of them are fed
+ * from the same (filtered) PCM input.
+ *
+ * Unless noted otherwise, the attributes are protected by
+ * HttpdOutput::mutex.
+ */
+class HttpdStream {
+	/**
+	 * The URI path (without the leading slash) this stream is
+	 * served at.  It is empty for the default stream, which gets
+	 * all requests not matching another stream.
+	 */
+	const std::string path;
+
+	/**
+	 * The configured encoder plugin.
+	 */
+	std::unique_ptr<PreparedEncoder> prepared_encoder;
+
+	/**
+	 * The encoder; only used by the thread which encodes.
+	 */
+	Encoder *encoder = nullptr;
+
+	/**
+	 * Converts the #HttpdOutput's audio format to the one
+	 * accepted by the encoder; nullptr if both are the same.
+	 */
+	std::unique_ptr<PcmConvert> convert;
+
+	/**
+	 * Number of bytes which were fed into the encoder, without
+	 * ever receiving new output.  This is used to estimate
+	 * whether MPD should manually flush the encoder, to avoid
+	 * buffer underruns in the client.
+	 */
+	size_t unflushed_input = 0;
+
+	/**
+	 * A temporary buffer for ReadPage().
+	 */
+	char buffer[32768];
+
+public:
+	/**
+	 * The MIME type produced by the encoder.
+	 */
+	const char *content_type;
+
+	/**
+	 * Does the encoder embed tags in the stream?  If not, Icy
+	 * metadata is used.
+	 */
+	bool implements_tag = false;
+
+	/**
+	 * The header page, which is sent to every client on connect.
+	 */
+	PagePtr header;
+
+	/**
+	 * Pages from the encoder which have not yet been moved to
+	 * the #ring.  This container is necessary to pass pages from
+	 * the OutputThread to the IOThread.
+	 */
+	std::queue<PagePtr, std::list<PagePtr>> pages;
+
+	/**
+	 * Pages which have been broadcasted to the clients of this
+	 * stream; see HttpdOutput::TrimPages().  It is only modified
+	 * in the IOThread.
+	 */
+	PageRing ring;
+
+	/**
+	 * The sequence number of the oldest #ring page which is part
+	 * of the burst.  It never points before the current header
+	 * page, because a new client gets the header anyway.
+	 */
+	uint64_t burst_seq = 0;
+
+	/**
+	 * The CPU time spent in the encoder since the output was
+	 * opened.
+	 */
+	std::chrono::steady_clock::duration cpu_time =
+		std::chrono::steady_clock::duration::zero();
+
+	/**
+	 * The number of clients receiving this stream.
+	 */
+	unsigned n_clients = 0;
+
+	/**
+	 * An error which occurred while encoding on a worker thread.
+	 * Only used during HttpdOutput::EncodeAndPlay().
+	 */
+	std::exception_ptr error;
+
+	/**
+	 * Throws on error.
+	 */
+	HttpdStream(const char *_path, const ConfigBlock &block,
+		    size_t ring_capacity);
+	~HttpdStream() noexcept;
+
+	HttpdStream(const HttpdStream &) = delete;
+	HttpdStream &operator=(const HttpdStream &) = delete;
+
+	const std::string &GetPath() const noexcept {
+		return path;
+	}
+
+	bool IsDefault() const noexcept {
+		return path.empty();
+	}
+
+	/**
+	 * Does this stream's path match the given request path
+	 * (without the leading slash)?
+	 */
+	gcc_pure
+	bool MatchPath(const char *request_path,
+		       size_t length) const noexcept {
+		return path.length() == length &&
+			path.compare(0, length, request_path, length) == 0;
+	}
+
+	/**
+	 * Open the encoder.
+	 *
+	 * Throws on error.
+	 *
+	 * @param audio_format the audio format of the #HttpdOutput;
+	 * if this is the default stream, the encoder may modify it,
+	 * else the input is converted to the format the encoder
+	 * wants
+	 */
+	void Open(AudioFormat &audio_format, bool is_default);
+
+	void Close() noexcept;
+
+	/**
+	 * Reads data from the encoder (as much as available) and
+	 * returns it as a new #Page object.
+	 */
+	PagePtr ReadPage();
+
+	/**
+	 * Feed PCM data (in the #HttpdOutput's audio format) into
+	 * the encoder.  This may be called without holding the mutex.
+	 *
+	 * Throws on error.
+	 */
+	void Encode(const void *chunk, size_t size);
+
+	/**
+	 * Flush the current stream and prepare the encoder for
+	 * SendTag().  Errors are ignored.
+	 */
+	void PreTag() noexcept;
+
+	/**
+	 * Send a tag to the encoder, which starts a new stream.
+	 * Errors are ignored.
+	 */
+	void SendTag(const Tag &tag) noexcept;
+};
+
+#endif
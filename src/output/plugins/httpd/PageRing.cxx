@@ -0,0 +1,58 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "PageRing.hxx"
+
+uint64_t
+PageRing::Push(PagePtr page) noexcept
+{
+	assert(!IsFull());
+	assert(page != nullptr);
+
+	const size_t page_size = page->GetSize();
+
+	auto &slot = GetSlot(head);
+	slot.page = std::move(page);
+	slot.offset = end_offset;
+
+	end_offset += page_size;
+	size += page_size;
+	return head++;
+}
+
+void
+PageRing::PopFront() noexcept
+{
+	assert(!empty());
+
+	auto &slot = GetSlot(tail++);
+	assert(size >= slot.page->GetSize());
+	size -= slot.page->GetSize();
+	slot.page.reset();
+}
+
+void
+PageRing::Clear() noexcept
+{
+	while (!empty())
+		PopFront();
+
+	end_offset = 0;
+}
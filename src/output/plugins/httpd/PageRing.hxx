@@ -0,0 +1,170 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_HTTPD_PAGE_RING_HXX
+#define MPD_HTTPD_PAGE_RING_HXX
+
+#include "Page.hxx"
+
+#include <memory>
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A ring buffer of #Page objects produced by the encoder.  Each page
+ * gets a sequence number, and all clients refer to the pages they
+ * still have to send by sequence number instead of keeping their
+ * own queue.  This means broadcasting a page costs just one
+ * reference for all clients together.
+ *
+ * This class is not thread-safe; it is protected by
+ * HttpdOutput::mutex.
+ */
+class PageRing {
+	struct Slot {
+		PagePtr page;
+
+		/**
+		 * The stream position (in bytes) of the start of this
+		 * page.
+		 */
+		uint64_t offset;
+	};
+
+	const size_t capacity;
+
+	const std::unique_ptr<Slot[]> slots;
+
+	/**
+	 * The sequence number of the oldest page.
+	 */
+	uint64_t tail = 0;
+
+	/**
+	 * The sequence number of the next page to be pushed.
+	 */
+	uint64_t head = 0;
+
+	/**
+	 * The stream position at the end of the newest page.
+	 */
+	uint64_t end_offset = 0;
+
+	/**
+	 * The sum of all page sizes.
+	 */
+	size_t size = 0;
+
+public:
+	explicit PageRing(size_t _capacity) noexcept
+		:capacity(_capacity), slots(new Slot[capacity]) {}
+
+	PageRing(const PageRing &) = delete;
+	PageRing &operator=(const PageRing &) = delete;
+
+	bool empty() const noexcept {
+		return head == tail;
+	}
+
+	bool IsFull() const noexcept {
+		return head - tail == capacity;
+	}
+
+	/**
+	 * Returns the sum of all page sizes.
+	 */
+	size_t GetSize() const noexcept {
+		return size;
+	}
+
+	uint64_t GetTail() const noexcept {
+		return tail;
+	}
+
+	uint64_t GetHead() const noexcept {
+		return head;
+	}
+
+	bool Contains(uint64_t seq) const noexcept {
+		return seq >= tail && seq < head;
+	}
+
+	const PagePtr &Get(uint64_t seq) const noexcept {
+		assert(Contains(seq));
+
+		return GetSlot(seq).page;
+	}
+
+	/**
+	 * Returns the stream position of the given page.  The head
+	 * sequence number is allowed, which returns the end of the
+	 * stream.
+	 */
+	uint64_t GetOffset(uint64_t seq) const noexcept {
+		assert(seq >= tail && seq <= head);
+
+		return seq == head
+			? end_offset
+			: GetSlot(seq).offset;
+	}
+
+	/**
+	 * Returns the stream position at the end of the newest page,
+	 * i.e. the number of bytes pushed since the last Clear().
+	 */
+	uint64_t GetEndOffset() const noexcept {
+		return end_offset;
+	}
+
+	/**
+	 * Returns the number of bytes from the start of the given
+	 * page to the end of the stream.
+	 */
+	uint64_t GetDistance(uint64_t seq) const noexcept {
+		return end_offset - GetOffset(seq);
+	}
+
+	/**
+	 * Append a page.  The ring must not be full.
+	 *
+	 * @return the sequence number of the new page
+	 */
+	uint64_t Push(PagePtr page) noexcept;
+
+	/**
+	 * Remove the oldest page.
+	 */
+	void PopFront() noexcept;
+
+	/**
+	 * Remove all pages and reset the stream position.  Sequence
+	 * numbers keep counting.
+	 */
+	void Clear() noexcept;
+
+private:
+	Slot &GetSlot(uint64_t seq) const noexcept {
+		return slots[seq % capacity];
+	}
+};
+
+#endif
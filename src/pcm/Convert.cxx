@@ -39,8 +39,16 @@ PcmConvert::PcmConvert(const AudioFormat _src_format,
 	assert(dest_format.IsValid());
 
 	AudioFormat format = _src_format;
-	if (format.format == SampleFormat::DSD)
+	if (format.format == SampleFormat::DSD) {
+#ifdef ENABLE_DSD
+		/* decimate as much as possible in the DSD converter,
+		   which is cheaper than resampling */
+		dsd.SetRatio(PcmDsd::FindRatio(format.sample_rate,
+					       dest_format.sample_rate));
+		format.sample_rate = dsd.GetOutputSampleRate(format.sample_rate);
+#endif
 		format.format = SampleFormat::FLOAT;
+	}
 
 	enable_resampler = format.sample_rate != dest_format.sample_rate;
 	if (enable_resampler) {
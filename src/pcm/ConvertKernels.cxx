@@ -0,0 +1,184 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "ConvertKernels.hxx"
+#include "ConvertKernelsGeneric.hxx"
+#include "ShiftConvert.hxx"
+#include "FloatConvert.hxx"
+#include "util/ByteReverse.hxx"
+#include "util/ConstBuffer.hxx"
+#include "util/TransformN.hxx"
+
+#include <assert.h>
+
+template<typename C>
+static void
+GenericConvert(typename C::DstTraits::pointer gcc_restrict dest,
+	       typename C::SrcTraits::const_pointer gcc_restrict src,
+	       size_t n) noexcept
+{
+	transform_n(src, n, dest, C::Convert);
+}
+
+void
+GenericConvertS16ToS24(int32_t *dest, const int16_t *src, size_t n) noexcept
+{
+	GenericConvert<LeftShiftSampleConvert<SampleFormat::S16,
+					      SampleFormat::S24_P32>>(dest, src, n);
+}
+
+void
+GenericConvertS16ToS32(int32_t *dest, const int16_t *src, size_t n) noexcept
+{
+	GenericConvert<LeftShiftSampleConvert<SampleFormat::S16,
+					      SampleFormat::S32>>(dest, src, n);
+}
+
+void
+GenericConvertS24ToS32(int32_t *dest, const int32_t *src, size_t n) noexcept
+{
+	GenericConvert<LeftShiftSampleConvert<SampleFormat::S24_P32,
+					      SampleFormat::S32>>(dest, src, n);
+}
+
+void
+GenericConvertS32ToS24(int32_t *dest, const int32_t *src, size_t n) noexcept
+{
+	GenericConvert<RightShiftSampleConvert<SampleFormat::S32,
+					       SampleFormat::S24_P32>>(dest, src, n);
+}
+
+void
+GenericConvertS16ToFloat(float *dest, const int16_t *src, size_t n) noexcept
+{
+	GenericConvert<IntegerToFloatSampleConvert<SampleFormat::S16>>(dest, src, n);
+}
+
+void
+GenericConvertS24ToFloat(float *dest, const int32_t *src, size_t n) noexcept
+{
+	GenericConvert<IntegerToFloatSampleConvert<SampleFormat::S24_P32>>(dest, src, n);
+}
+
+void
+GenericConvertS32ToFloat(float *dest, const int32_t *src, size_t n) noexcept
+{
+	GenericConvert<IntegerToFloatSampleConvert<SampleFormat::S32>>(dest, src, n);
+}
+
+void
+GenericConvertFloatToS16(int16_t *dest, const float *src, size_t n) noexcept
+{
+	GenericConvert<FloatToIntegerSampleConvert<SampleFormat::S16>>(dest, src, n);
+}
+
+void
+GenericConvertFloatToS24(int32_t *dest, const float *src, size_t n) noexcept
+{
+	GenericConvert<FloatToIntegerSampleConvert<SampleFormat::S24_P32>>(dest, src, n);
+}
+
+void
+GenericConvertFloatToS32(int32_t *dest, const float *src, size_t n) noexcept
+{
+	GenericConvert<FloatToIntegerSampleConvert<SampleFormat::S32>>(dest, src, n);
+}
+
+void
+GenericReverse16(uint16_t *dest, const uint16_t *src, size_t n) noexcept
+{
+	reverse_bytes_16(dest, src, src + n);
+}
+
+void
+GenericReverse32(uint32_t *dest, const uint32_t *src, size_t n) noexcept
+{
+	reverse_bytes_32(dest, src, src + n);
+}
+
+const PcmConvertKernels pcm_convert_kernels_generic = {
+	"generic",
+	GenericConvertS16ToS24,
+	GenericConvertS16ToS32,
+	GenericConvertS24ToS32,
+	GenericConvertS32ToS24,
+	GenericConvertS16ToFloat,
+	GenericConvertS24ToFloat,
+	GenericConvertS32ToFloat,
+	GenericConvertFloatToS16,
+	GenericConvertFloatToS24,
+	GenericConvertFloatToS32,
+	GenericPack24,
+	GenericUnpack24,
+	GenericReverse16,
+	GenericReverse32,
+	GenericToAlsa51S16,
+	GenericToAlsa51S32,
+	GenericToAlsa71S16,
+	GenericToAlsa71S32,
+};
+
+namespace {
+
+struct SupportedPcmConvertKernels {
+	const PcmConvertKernels *list[3];
+	size_t n = 0;
+
+	SupportedPcmConvertKernels() noexcept {
+		list[n++] = &pcm_convert_kernels_generic;
+
+#ifdef PCM_CONVERT_KERNELS_X86
+		__builtin_cpu_init();
+
+		if (__builtin_cpu_supports("sse2"))
+			list[n++] = &pcm_convert_kernels_sse2;
+
+		if (__builtin_cpu_supports("avx2"))
+			list[n++] = &pcm_convert_kernels_avx2;
+#endif
+
+#ifdef PCM_CONVERT_KERNELS_NEON
+		/* NEON is enabled at compile time, therefore no
+		   runtime check */
+		list[n++] = &pcm_convert_kernels_neon;
+#endif
+	}
+};
+
+/**
+ * Initialized by a global constructor before any thread is started;
+ * see supported_pcm_volume_kernels.
+ */
+const SupportedPcmConvertKernels supported_pcm_convert_kernels;
+
+}
+
+ConstBuffer<const PcmConvertKernels *>
+GetSupportedPcmConvertKernels() noexcept
+{
+	const auto &supported = supported_pcm_convert_kernels;
+	assert(supported.n > 0);
+	return {supported.list, supported.n};
+}
+
+const PcmConvertKernels &
+GetPcmConvertKernels() noexcept
+{
+	return *GetSupportedPcmConvertKernels().back();
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_CONVERT_KERNELS_HXX
+#define MPD_PCM_CONVERT_KERNELS_HXX
+
+#include <stddef.h>
+#include <stdint.h>
+
+template<typename T> struct ConstBuffer;
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PCM_CONVERT_KERNELS_X86
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PCM_CONVERT_KERNELS_NEON
+#endif
+
+/**
+ * A set of implementations of the sample format conversions used by
+ * pcm_convert_to_16() and friends, pcm_pack_24(), ToAlsaChannelOrder()
+ * and #PcmExport.  Each set is optimized for one instruction set;
+ * all of them produce exactly the same results as the generic one.
+ *
+ * Conversions which need a #PcmDither (24/32 bit to 16 bit) and the
+ * rarely used 8 bit conversions are not part of this table; they
+ * have only a portable implementation.
+ */
+struct PcmConvertKernels {
+	const char *name;
+
+	void (*s16_to_s24)(int32_t *dest, const int16_t *src,
+			   size_t n) noexcept;
+	void (*s16_to_s32)(int32_t *dest, const int16_t *src,
+			   size_t n) noexcept;
+
+	/**
+	 * Shift by 8 bits to the left.  This is also used by
+	 * #PcmExport's "shift8" option.
+	 */
+	void (*s24_to_s32)(int32_t *dest, const int32_t *src,
+			   size_t n) noexcept;
+	void (*s32_to_s24)(int32_t *dest, const int32_t *src,
+			   size_t n) noexcept;
+
+	void (*s16_to_float)(float *dest, const int16_t *src,
+			     size_t n) noexcept;
+	void (*s24_to_float)(float *dest, const int32_t *src,
+			     size_t n) noexcept;
+	void (*s32_to_float)(float *dest, const int32_t *src,
+			     size_t n) noexcept;
+
+	void (*float_to_s16)(int16_t *dest, const float *src,
+			     size_t n) noexcept;
+	void (*float_to_s24)(int32_t *dest, const float *src,
+			     size_t n) noexcept;
+	void (*float_to_s32)(int32_t *dest, const float *src,
+			     size_t n) noexcept;
+
+	/**
+	 * See pcm_pack_24(); works in-place.
+	 */
+	void (*pack_24)(uint8_t *dest, const int32_t *src,
+			size_t n) noexcept;
+
+	/**
+	 * See pcm_unpack_24().
+	 */
+	void (*unpack_24)(int32_t *dest, const uint8_t *src,
+			  size_t n) noexcept;
+
+	void (*reverse_16)(uint16_t *dest, const uint16_t *src,
+			   size_t n) noexcept;
+	void (*reverse_32)(uint32_t *dest, const uint32_t *src,
+			   size_t n) noexcept;
+
+	/**
+	 * Convert 5.1 and 7.1 frames to the ALSA channel order; the
+	 * size parameter is the number of frames.
+	 */
+	void (*alsa_51_16)(int16_t *dest, const int16_t *src,
+			   size_t n_frames) noexcept;
+	void (*alsa_51_32)(int32_t *dest, const int32_t *src,
+			   size_t n_frames) noexcept;
+	void (*alsa_71_16)(int16_t *dest, const int16_t *src,
+			   size_t n_frames) noexcept;
+	void (*alsa_71_32)(int32_t *dest, const int32_t *src,
+			   size_t n_frames) noexcept;
+};
+
+/**
+ * Portable C++ implementation.
+ */
+extern const PcmConvertKernels pcm_convert_kernels_generic;
+
+#ifdef PCM_CONVERT_KERNELS_X86
+extern const PcmConvertKernels pcm_convert_kernels_sse2;
+
+/**
+ * The AVX2 set also uses the SSSE3 byte shuffle (implied by AVX2).
+ */
+extern const PcmConvertKernels pcm_convert_kernels_avx2;
+#endif
+
+#ifdef PCM_CONVERT_KERNELS_NEON
+extern const PcmConvertKernels pcm_convert_kernels_neon;
+#endif
+
+/**
+ * Returns all kernel sets which are supported by this CPU, the
+ * generic one first and the fastest one last.
+ */
+ConstBuffer<const PcmConvertKernels *>
+GetSupportedPcmConvertKernels() noexcept;
+
+/**
+ * Returns the fastest kernel set supported by this CPU.
+ */
+const PcmConvertKernels &
+GetPcmConvertKernels() noexcept;
+
+#endif
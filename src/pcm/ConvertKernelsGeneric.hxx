@@ -0,0 +1,90 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * The functions of #pcm_convert_kernels_generic, for the optimized
+ * kernels which use them for the remaining samples at the end of a
+ * buffer.
+ */
+
+#ifndef MPD_PCM_CONVERT_KERNELS_GENERIC_HXX
+#define MPD_PCM_CONVERT_KERNELS_GENERIC_HXX
+
+#include <stddef.h>
+#include <stdint.h>
+
+void
+GenericConvertS16ToS24(int32_t *dest, const int16_t *src, size_t n) noexcept;
+
+void
+GenericConvertS16ToS32(int32_t *dest, const int16_t *src, size_t n) noexcept;
+
+void
+GenericConvertS24ToS32(int32_t *dest, const int32_t *src, size_t n) noexcept;
+
+void
+GenericConvertS32ToS24(int32_t *dest, const int32_t *src, size_t n) noexcept;
+
+void
+GenericConvertS16ToFloat(float *dest, const int16_t *src, size_t n) noexcept;
+
+void
+GenericConvertS24ToFloat(float *dest, const int32_t *src, size_t n) noexcept;
+
+void
+GenericConvertS32ToFloat(float *dest, const int32_t *src, size_t n) noexcept;
+
+void
+GenericConvertFloatToS16(int16_t *dest, const float *src, size_t n) noexcept;
+
+void
+GenericConvertFloatToS24(int32_t *dest, const float *src, size_t n) noexcept;
+
+void
+GenericConvertFloatToS32(int32_t *dest, const float *src, size_t n) noexcept;
+
+void
+GenericReverse16(uint16_t *dest, const uint16_t *src, size_t n) noexcept;
+
+void
+GenericReverse32(uint32_t *dest, const uint32_t *src, size_t n) noexcept;
+
+/* implemented in Pack.cxx */
+
+void
+GenericPack24(uint8_t *dest, const int32_t *src, size_t n) noexcept;
+
+void
+GenericUnpack24(int32_t *dest, const uint8_t *src, size_t n) noexcept;
+
+/* implemented in Order.cxx */
+
+void
+GenericToAlsa51S16(int16_t *dest, const int16_t *src, size_t n) noexcept;
+
+void
+GenericToAlsa51S32(int32_t *dest, const int32_t *src, size_t n) noexcept;
+
+void
+GenericToAlsa71S16(int16_t *dest, const int16_t *src, size_t n) noexcept;
+
+void
+GenericToAlsa71S32(int32_t *dest, const int32_t *src, size_t n) noexcept;
+
+#endif
@@ -0,0 +1,218 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * ARM NEON implementation of #PcmConvertKernels.  Packing and the
+ * channel order use the generic functions.
+ */
+
+#include "ConvertKernels.hxx"
+#include "ConvertKernelsGeneric.hxx"
+#include "FloatConvert.hxx"
+
+#ifdef PCM_CONVERT_KERNELS_NEON
+
+#include <arm_neon.h>
+
+static void
+NeonConvertS16ToS24(int32_t *dest, const int16_t *src, size_t n) noexcept
+{
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		vst1q_s32(dest + i, vshll_n_s16(vld1_s16(src + i), 8));
+
+	GenericConvertS16ToS24(dest + i, src + i, n - i);
+}
+
+static void
+NeonConvertS16ToS32(int32_t *dest, const int16_t *src, size_t n) noexcept
+{
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		vst1q_s32(dest + i, vshll_n_s16(vld1_s16(src + i), 16));
+
+	GenericConvertS16ToS32(dest + i, src + i, n - i);
+}
+
+static void
+NeonConvertS24ToS32(int32_t *dest, const int32_t *src, size_t n) noexcept
+{
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		vst1q_s32(dest + i, vshlq_n_s32(vld1q_s32(src + i), 8));
+
+	GenericConvertS24ToS32(dest + i, src + i, n - i);
+}
+
+static void
+NeonConvertS32ToS24(int32_t *dest, const int32_t *src, size_t n) noexcept
+{
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		vst1q_s32(dest + i, vshrq_n_s32(vld1q_s32(src + i), 8));
+
+	GenericConvertS32ToS24(dest + i, src + i, n - i);
+}
+
+static void
+NeonConvertS16ToFloat(float *dest, const int16_t *src, size_t n) noexcept
+{
+	constexpr float factor =
+		IntegerToFloatSampleConvert<SampleFormat::S16>::factor;
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		vst1q_f32(dest + i,
+			  vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vld1_s16(src + i))),
+				      factor));
+
+	GenericConvertS16ToFloat(dest + i, src + i, n - i);
+}
+
+static void
+NeonConvertS24ToFloat(float *dest, const int32_t *src, size_t n) noexcept
+{
+	constexpr float factor =
+		IntegerToFloatSampleConvert<SampleFormat::S24_P32>::factor;
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		vst1q_f32(dest + i,
+			  vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(src + i)),
+				      factor));
+
+	GenericConvertS24ToFloat(dest + i, src + i, n - i);
+}
+
+static void
+NeonConvertS32ToFloat(float *dest, const int32_t *src, size_t n) noexcept
+{
+	constexpr float factor =
+		IntegerToFloatSampleConvert<SampleFormat::S32>::factor;
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		vst1q_f32(dest + i,
+			  vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(src + i)),
+				      factor));
+
+	GenericConvertS32ToFloat(dest + i, src + i, n - i);
+}
+
+/**
+ * Scale, clamp and truncate four floats, like
+ * FloatToIntegerSampleConvert.  Not suitable for S32, because MAX is
+ * not exact in float.
+ */
+template<SampleFormat F, class Traits=SampleTraits<F>>
+static inline int32x4_t
+NeonFloatToInt(float32x4_t x) noexcept
+{
+	constexpr float factor = FloatToIntegerSampleConvert<F>::factor;
+
+	x = vmulq_n_f32(x, factor);
+	x = vmaxq_f32(x, vdupq_n_f32(Traits::MIN));
+	x = vminq_f32(x, vdupq_n_f32(Traits::MAX));
+	return vcvtq_s32_f32(x);
+}
+
+static void
+NeonConvertFloatToS16(int16_t *dest, const float *src, size_t n) noexcept
+{
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		vst1_s16(dest + i,
+			 vmovn_s32(NeonFloatToInt<SampleFormat::S16>(vld1q_f32(src + i))));
+
+	GenericConvertFloatToS16(dest + i, src + i, n - i);
+}
+
+static void
+NeonConvertFloatToS24(int32_t *dest, const float *src, size_t n) noexcept
+{
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		vst1q_s32(dest + i,
+			  NeonFloatToInt<SampleFormat::S24_P32>(vld1q_f32(src + i)));
+
+	GenericConvertFloatToS24(dest + i, src + i, n - i);
+}
+
+static void
+NeonConvertFloatToS32(int32_t *dest, const float *src, size_t n) noexcept
+{
+	constexpr float factor =
+		FloatToIntegerSampleConvert<SampleFormat::S32>::factor;
+
+	/* vcvtq_s32_f32() saturates, which is what the scalar
+	   conversion (via 64 bit and PcmClamp()) does */
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		vst1q_s32(dest + i,
+			  vcvtq_s32_f32(vmulq_n_f32(vld1q_f32(src + i),
+						    factor)));
+
+	GenericConvertFloatToS32(dest + i, src + i, n - i);
+}
+
+static void
+NeonReverse16(uint16_t *dest, const uint16_t *src, size_t n) noexcept
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+		vst1q_u16(dest + i,
+			  vreinterpretq_u16_u8(vrev16q_u8(vreinterpretq_u8_u16(vld1q_u16(src + i)))));
+
+	GenericReverse16(dest + i, src + i, n - i);
+}
+
+static void
+NeonReverse32(uint32_t *dest, const uint32_t *src, size_t n) noexcept
+{
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		vst1q_u32(dest + i,
+			  vreinterpretq_u32_u8(vrev32q_u8(vreinterpretq_u8_u32(vld1q_u32(src + i)))));
+
+	GenericReverse32(dest + i, src + i, n - i);
+}
+
+const PcmConvertKernels pcm_convert_kernels_neon = {
+	"neon",
+	NeonConvertS16ToS24,
+	NeonConvertS16ToS32,
+	NeonConvertS24ToS32,
+	NeonConvertS32ToS24,
+	NeonConvertS16ToFloat,
+	NeonConvertS24ToFloat,
+	NeonConvertS32ToFloat,
+	NeonConvertFloatToS16,
+	NeonConvertFloatToS24,
+	NeonConvertFloatToS32,
+	GenericPack24,
+	GenericUnpack24,
+	NeonReverse16,
+	NeonReverse32,
+	GenericToAlsa51S16,
+	GenericToAlsa51S32,
+	GenericToAlsa71S16,
+	GenericToAlsa71S32,
+};
+
+#endif
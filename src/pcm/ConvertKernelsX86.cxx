@@ -0,0 +1,723 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * SSE2 and AVX2 implementations of #PcmConvertKernels.  Like the
+ * volume kernels, the functions are compiled with "target"
+ * attributes, and GetPcmConvertKernels() checks the CPU before using
+ * them.  The last samples which do not fill a whole vector are
+ * passed to the generic implementation.
+ *
+ * The float to integer conversions must be bit-exact with
+ * FloatToIntegerSampleConvert, which truncates the product to an
+ * integer and then clamps it.  For S16 and S24, clamping in the float
+ * domain before truncating gives the same results for all samples
+ * below 65536 (larger ones overflow the scalar conversion).
+ */
+
+#include "ConvertKernels.hxx"
+#include "ConvertKernelsGeneric.hxx"
+#include "FloatConvert.hxx"
+
+#ifdef PCM_CONVERT_KERNELS_X86
+
+#include <immintrin.h>
+
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+template<SampleFormat F>
+static constexpr float to_float_factor =
+	IntegerToFloatSampleConvert<F>::factor;
+
+template<SampleFormat F>
+static constexpr float from_float_factor =
+	FloatToIntegerSampleConvert<F>::factor;
+
+template<SampleFormat F>
+static constexpr float float_min = SampleTraits<F>::MIN;
+
+template<SampleFormat F>
+static constexpr float float_max = SampleTraits<F>::MAX;
+
+/*
+ * SSE2
+ *
+ */
+
+/**
+ * Sign-extend the lower (or upper) four 16 bit integers to 32 bit
+ * and shift them to the left.
+ */
+template<int SHIFT>
+TARGET_SSE2
+static inline __m128i
+Sse2WidenLo16(__m128i x) noexcept
+{
+	/* the 16 bit value in the upper half is the value shifted
+	   by 16 bits; shift it back arithmetically */
+	const __m128i y = _mm_unpacklo_epi16(_mm_setzero_si128(), x);
+	return SHIFT == 16 ? y : _mm_srai_epi32(y, 16 - SHIFT);
+}
+
+template<int SHIFT>
+TARGET_SSE2
+static inline __m128i
+Sse2WidenHi16(__m128i x) noexcept
+{
+	const __m128i y = _mm_unpackhi_epi16(_mm_setzero_si128(), x);
+	return SHIFT == 16 ? y : _mm_srai_epi32(y, 16 - SHIFT);
+}
+
+template<int SHIFT>
+TARGET_SSE2
+static void
+Sse2WidenS16(int32_t *dest, const int16_t *src, size_t n) noexcept
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+		_mm_storeu_si128((__m128i *)(dest + i),
+				 Sse2WidenLo16<SHIFT>(x));
+		_mm_storeu_si128((__m128i *)(dest + i + 4),
+				 Sse2WidenHi16<SHIFT>(x));
+	}
+
+	if (SHIFT == 8)
+		GenericConvertS16ToS24(dest + i, src + i, n - i);
+	else
+		GenericConvertS16ToS32(dest + i, src + i, n - i);
+}
+
+TARGET_SSE2
+static void
+Sse2ConvertS16ToS24(int32_t *dest, const int16_t *src, size_t n) noexcept
+{
+	Sse2WidenS16<8>(dest, src, n);
+}
+
+TARGET_SSE2
+static void
+Sse2ConvertS16ToS32(int32_t *dest, const int16_t *src, size_t n) noexcept
+{
+	Sse2WidenS16<16>(dest, src, n);
+}
+
+TARGET_SSE2
+static void
+Sse2ConvertS24ToS32(int32_t *dest, const int32_t *src, size_t n) noexcept
+{
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		const __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+		_mm_storeu_si128((__m128i *)(dest + i), _mm_slli_epi32(x, 8));
+	}
+
+	GenericConvertS24ToS32(dest + i, src + i, n - i);
+}
+
+TARGET_SSE2
+static void
+Sse2ConvertS32ToS24(int32_t *dest, const int32_t *src, size_t n) noexcept
+{
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		const __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+		_mm_storeu_si128((__m128i *)(dest + i), _mm_srai_epi32(x, 8));
+	}
+
+	GenericConvertS32ToS24(dest + i, src + i, n - i);
+}
+
+TARGET_SSE2
+static void
+Sse2ConvertS16ToFloat(float *dest, const int16_t *src, size_t n) noexcept
+{
+	const __m128 factor = _mm_set1_ps(to_float_factor<SampleFormat::S16>);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+		_mm_storeu_ps(dest + i,
+			      _mm_mul_ps(_mm_cvtepi32_ps(Sse2WidenLo16<0>(x)),
+					 factor));
+		_mm_storeu_ps(dest + i + 4,
+			      _mm_mul_ps(_mm_cvtepi32_ps(Sse2WidenHi16<0>(x)),
+					 factor));
+	}
+
+	GenericConvertS16ToFloat(dest + i, src + i, n - i);
+}
+
+template<SampleFormat F>
+TARGET_SSE2
+static inline void
+Sse2ConvertS32ToFloat(float *dest, const int32_t *src, size_t n) noexcept
+{
+	const __m128 factor = _mm_set1_ps(to_float_factor<F>);
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		const __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+		_mm_storeu_ps(dest + i, _mm_mul_ps(_mm_cvtepi32_ps(x), factor));
+	}
+
+	if (F == SampleFormat::S24_P32)
+		GenericConvertS24ToFloat(dest + i, src + i, n - i);
+	else
+		GenericConvertS32ToFloat(dest + i, src + i, n - i);
+}
+
+TARGET_SSE2
+static void
+Sse2ConvertS24ToFloat(float *dest, const int32_t *src, size_t n) noexcept
+{
+	Sse2ConvertS32ToFloat<SampleFormat::S24_P32>(dest, src, n);
+}
+
+TARGET_SSE2
+static void
+Sse2ConvertS32ToFloat(float *dest, const int32_t *src, size_t n) noexcept
+{
+	Sse2ConvertS32ToFloat<SampleFormat::S32>(dest, src, n);
+}
+
+/**
+ * Scale, clamp and truncate four floats.  This is only correct for
+ * formats up to 24 bits, where MIN and MAX are exact in float.
+ */
+template<SampleFormat F>
+TARGET_SSE2
+static inline __m128i
+Sse2FloatToInt(__m128 x) noexcept
+{
+	x = _mm_mul_ps(x, _mm_set1_ps(from_float_factor<F>));
+	x = _mm_max_ps(x, _mm_set1_ps(float_min<F>));
+	x = _mm_min_ps(x, _mm_set1_ps(float_max<F>));
+	return _mm_cvttps_epi32(x);
+}
+
+TARGET_SSE2
+static void
+Sse2ConvertFloatToS16(int16_t *dest, const float *src, size_t n) noexcept
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m128i a =
+			Sse2FloatToInt<SampleFormat::S16>(_mm_loadu_ps(src + i));
+		const __m128i b =
+			Sse2FloatToInt<SampleFormat::S16>(_mm_loadu_ps(src + i + 4));
+		_mm_storeu_si128((__m128i *)(dest + i), _mm_packs_epi32(a, b));
+	}
+
+	GenericConvertFloatToS16(dest + i, src + i, n - i);
+}
+
+TARGET_SSE2
+static void
+Sse2ConvertFloatToS24(int32_t *dest, const float *src, size_t n) noexcept
+{
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		_mm_storeu_si128((__m128i *)(dest + i),
+				 Sse2FloatToInt<SampleFormat::S24_P32>(_mm_loadu_ps(src + i)));
+
+	GenericConvertFloatToS24(dest + i, src + i, n - i);
+}
+
+TARGET_SSE2
+static void
+Sse2ConvertFloatToS32(int32_t *dest, const float *src, size_t n) noexcept
+{
+	const __m128 factor =
+		_mm_set1_ps(from_float_factor<SampleFormat::S32>);
+	const __m128 max = _mm_set1_ps(float_max<SampleFormat::S32>);
+	const __m128i int_max = _mm_set1_epi32(SampleTraits<SampleFormat::S32>::MAX);
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		const __m128 x = _mm_mul_ps(_mm_loadu_ps(src + i), factor);
+
+		/* cvttps2dq returns INT32_MIN for all values out of
+		   range, which is right for the lower bound, but
+		   values from 2^31 (which is MAX rounded to float) on
+		   must be clamped explicitly */
+		const __m128i r = _mm_cvttps_epi32(x);
+		const __m128i above = _mm_castps_si128(_mm_cmpge_ps(x, max));
+		_mm_storeu_si128((__m128i *)(dest + i),
+				 _mm_or_si128(_mm_andnot_si128(above, r),
+					      _mm_and_si128(above, int_max)));
+	}
+
+	GenericConvertFloatToS32(dest + i, src + i, n - i);
+}
+
+TARGET_SSE2
+static inline __m128i
+Sse2ByteSwap16(__m128i x) noexcept
+{
+	return _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+}
+
+TARGET_SSE2
+static void
+Sse2Reverse16(uint16_t *dest, const uint16_t *src, size_t n) noexcept
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+		_mm_storeu_si128((__m128i *)(dest + i), Sse2ByteSwap16(x));
+	}
+
+	GenericReverse16(dest + i, src + i, n - i);
+}
+
+TARGET_SSE2
+static void
+Sse2Reverse32(uint32_t *dest, const uint32_t *src, size_t n) noexcept
+{
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+
+		/* swap the 16 bit halves, then the bytes within */
+		x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+		x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+		_mm_storeu_si128((__m128i *)(dest + i), Sse2ByteSwap16(x));
+	}
+
+	GenericReverse32(dest + i, src + i, n - i);
+}
+
+TARGET_SSE2
+static void
+Sse2ToAlsa51S16(int16_t *dest, const int16_t *src, size_t n) noexcept
+{
+	/* one frame is three 32 bit pairs: front, center+LFE,
+	   surround; the 16 byte store overwrites the first 4 bytes
+	   of the next frame, therefore the last frame is converted
+	   by the generic code */
+	size_t i = 0;
+	for (; i + 1 < n; ++i) {
+		const __m128i x = _mm_loadu_si128((const __m128i *)(src + i * 6));
+		_mm_storeu_si128((__m128i *)(dest + i * 6),
+				 _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 1, 2, 0)));
+	}
+
+	GenericToAlsa51S16(dest + i * 6, src + i * 6, n - i);
+}
+
+TARGET_SSE2
+static void
+Sse2ToAlsa51S32(int32_t *dest, const int32_t *src, size_t n) noexcept
+{
+	for (size_t i = 0; i < n; ++i, src += 6, dest += 6) {
+		const __m128i a = _mm_loadu_si128((const __m128i *)src);
+		const __m128i b = _mm_loadl_epi64((const __m128i *)(src + 4));
+		_mm_storeu_si128((__m128i *)dest, _mm_unpacklo_epi64(a, b));
+		_mm_storel_epi64((__m128i *)(dest + 4),
+				 _mm_unpackhi_epi64(a, a));
+	}
+}
+
+TARGET_SSE2
+static void
+Sse2ToAlsa71S16(int16_t *dest, const int16_t *src, size_t n) noexcept
+{
+	for (size_t i = 0; i < n; ++i) {
+		const __m128i x = _mm_loadu_si128((const __m128i *)(src + i * 8));
+		_mm_storeu_si128((__m128i *)(dest + i * 8),
+				 _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 1, 2, 0)));
+	}
+}
+
+TARGET_SSE2
+static void
+Sse2ToAlsa71S32(int32_t *dest, const int32_t *src, size_t n) noexcept
+{
+	for (size_t i = 0; i < n; ++i, src += 8, dest += 8) {
+		const __m128i a = _mm_loadu_si128((const __m128i *)src);
+		const __m128i b = _mm_loadu_si128((const __m128i *)(src + 4));
+		_mm_storeu_si128((__m128i *)dest, _mm_unpacklo_epi64(a, b));
+		_mm_storeu_si128((__m128i *)(dest + 4),
+				 _mm_unpackhi_epi64(a, b));
+	}
+}
+
+const PcmConvertKernels pcm_convert_kernels_sse2 = {
+	"sse2",
+	Sse2ConvertS16ToS24,
+	Sse2ConvertS16ToS32,
+	Sse2ConvertS24ToS32,
+	Sse2ConvertS32ToS24,
+	Sse2ConvertS16ToFloat,
+	Sse2ConvertS24ToFloat,
+	Sse2ConvertS32ToFloat,
+	Sse2ConvertFloatToS16,
+	Sse2ConvertFloatToS24,
+	Sse2ConvertFloatToS32,
+	GenericPack24,
+	GenericUnpack24,
+	Sse2Reverse16,
+	Sse2Reverse32,
+	Sse2ToAlsa51S16,
+	Sse2ToAlsa51S32,
+	Sse2ToAlsa71S16,
+	Sse2ToAlsa71S32,
+};
+
+/*
+ * AVX2
+ *
+ */
+
+template<int SHIFT>
+TARGET_AVX2
+static void
+Avx2WidenS16(int32_t *dest, const int16_t *src, size_t n) noexcept
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(src + i)));
+		_mm256_storeu_si256((__m256i *)(dest + i),
+				    _mm256_slli_epi32(x, SHIFT));
+	}
+
+	if (SHIFT == 8)
+		GenericConvertS16ToS24(dest + i, src + i, n - i);
+	else
+		GenericConvertS16ToS32(dest + i, src + i, n - i);
+}
+
+TARGET_AVX2
+static void
+Avx2ConvertS16ToS24(int32_t *dest, const int16_t *src, size_t n) noexcept
+{
+	Avx2WidenS16<8>(dest, src, n);
+}
+
+TARGET_AVX2
+static void
+Avx2ConvertS16ToS32(int32_t *dest, const int16_t *src, size_t n) noexcept
+{
+	Avx2WidenS16<16>(dest, src, n);
+}
+
+TARGET_AVX2
+static void
+Avx2ConvertS24ToS32(int32_t *dest, const int32_t *src, size_t n) noexcept
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+		_mm256_storeu_si256((__m256i *)(dest + i),
+				    _mm256_slli_epi32(x, 8));
+	}
+
+	GenericConvertS24ToS32(dest + i, src + i, n - i);
+}
+
+TARGET_AVX2
+static void
+Avx2ConvertS32ToS24(int32_t *dest, const int32_t *src, size_t n) noexcept
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+		_mm256_storeu_si256((__m256i *)(dest + i),
+				    _mm256_srai_epi32(x, 8));
+	}
+
+	GenericConvertS32ToS24(dest + i, src + i, n - i);
+}
+
+TARGET_AVX2
+static void
+Avx2ConvertS16ToFloat(float *dest, const int16_t *src, size_t n) noexcept
+{
+	const __m256 factor =
+		_mm256_set1_ps(to_float_factor<SampleFormat::S16>);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(src + i)));
+		_mm256_storeu_ps(dest + i,
+				 _mm256_mul_ps(_mm256_cvtepi32_ps(x), factor));
+	}
+
+	GenericConvertS16ToFloat(dest + i, src + i, n - i);
+}
+
+template<SampleFormat F>
+TARGET_AVX2
+static inline void
+Avx2ConvertS32ToFloat(float *dest, const int32_t *src, size_t n) noexcept
+{
+	const __m256 factor = _mm256_set1_ps(to_float_factor<F>);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+		_mm256_storeu_ps(dest + i,
+				 _mm256_mul_ps(_mm256_cvtepi32_ps(x), factor));
+	}
+
+	if (F == SampleFormat::S24_P32)
+		GenericConvertS24ToFloat(dest + i, src + i, n - i);
+	else
+		GenericConvertS32ToFloat(dest + i, src + i, n - i);
+}
+
+TARGET_AVX2
+static void
+Avx2ConvertS24ToFloat(float *dest, const int32_t *src, size_t n) noexcept
+{
+	Avx2ConvertS32ToFloat<SampleFormat::S24_P32>(dest, src, n);
+}
+
+TARGET_AVX2
+static void
+Avx2ConvertS32ToFloat(float *dest, const int32_t *src, size_t n) noexcept
+{
+	Avx2ConvertS32ToFloat<SampleFormat::S32>(dest, src, n);
+}
+
+/**
+ * See Sse2FloatToInt().
+ */
+template<SampleFormat F>
+TARGET_AVX2
+static inline __m256i
+Avx2FloatToInt(__m256 x) noexcept
+{
+	x = _mm256_mul_ps(x, _mm256_set1_ps(from_float_factor<F>));
+	x = _mm256_max_ps(x, _mm256_set1_ps(float_min<F>));
+	x = _mm256_min_ps(x, _mm256_set1_ps(float_max<F>));
+	return _mm256_cvttps_epi32(x);
+}
+
+TARGET_AVX2
+static void
+Avx2ConvertFloatToS16(int16_t *dest, const float *src, size_t n) noexcept
+{
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		const __m256i a =
+			Avx2FloatToInt<SampleFormat::S16>(_mm256_loadu_ps(src + i));
+		const __m256i b =
+			Avx2FloatToInt<SampleFormat::S16>(_mm256_loadu_ps(src + i + 8));
+
+		/* packs works within each 128 bit lane; restore the
+		   order of the 64 bit quarters */
+		const __m256i packed = _mm256_packs_epi32(a, b);
+		_mm256_storeu_si256((__m256i *)(dest + i),
+				    _mm256_permute4x64_epi64(packed,
+							     _MM_SHUFFLE(3, 1, 2, 0)));
+	}
+
+	GenericConvertFloatToS16(dest + i, src + i, n - i);
+}
+
+TARGET_AVX2
+static void
+Avx2ConvertFloatToS24(int32_t *dest, const float *src, size_t n) noexcept
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+		_mm256_storeu_si256((__m256i *)(dest + i),
+				    Avx2FloatToInt<SampleFormat::S24_P32>(_mm256_loadu_ps(src + i)));
+
+	GenericConvertFloatToS24(dest + i, src + i, n - i);
+}
+
+TARGET_AVX2
+static void
+Avx2ConvertFloatToS32(int32_t *dest, const float *src, size_t n) noexcept
+{
+	const __m256 factor =
+		_mm256_set1_ps(from_float_factor<SampleFormat::S32>);
+	const __m256 max = _mm256_set1_ps(float_max<SampleFormat::S32>);
+	const __m256i int_max =
+		_mm256_set1_epi32(SampleTraits<SampleFormat::S32>::MAX);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m256 x = _mm256_mul_ps(_mm256_loadu_ps(src + i), factor);
+
+		/* see Sse2ConvertFloatToS32() */
+		const __m256i r = _mm256_cvttps_epi32(x);
+		const __m256i above =
+			_mm256_castps_si256(_mm256_cmp_ps(x, max, _CMP_GE_OQ));
+		_mm256_storeu_si256((__m256i *)(dest + i),
+				    _mm256_blendv_epi8(r, int_max, above));
+	}
+
+	GenericConvertFloatToS32(dest + i, src + i, n - i);
+}
+
+TARGET_AVX2
+static void
+Avx2Pack24(uint8_t *dest, const int32_t *src, size_t n) noexcept
+{
+	/* move the lower 3 bytes of each sample to the beginning of
+	   each 128 bit lane */
+	const __m256i shuffle =
+		_mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14,
+				 -1, -1, -1, -1,
+				 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14,
+				 -1, -1, -1, -1);
+
+	/* each lane is stored with 16 bytes, i.e. 4 bytes more than
+	   needed, which are overwritten by the next store; stop
+	   early enough not to write beyond the end of the
+	   destination buffer.  Since each block is loaded before
+	   anything is stored, and the destination pointer never
+	   overtakes the source pointer, this works in-place. */
+	size_t i = 0;
+	for (; i + 10 <= n; i += 8) {
+		const __m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+		const __m256i y = _mm256_shuffle_epi8(x, shuffle);
+		_mm_storeu_si128((__m128i *)(dest + i * 3),
+				 _mm256_castsi256_si128(y));
+		_mm_storeu_si128((__m128i *)(dest + i * 3 + 12),
+				 _mm256_extracti128_si256(y, 1));
+	}
+
+	GenericPack24(dest + i * 3, src + i, n - i);
+}
+
+TARGET_AVX2
+static void
+Avx2Unpack24(int32_t *dest, const uint8_t *src, size_t n) noexcept
+{
+	/* move the 3 bytes of each sample to the upper 3 bytes of a
+	   32 bit integer; the arithmetic shift extends the sign */
+	const __m256i shuffle =
+		_mm256_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5,
+				 -1, 6, 7, 8, -1, 9, 10, 11,
+				 -1, 0, 1, 2, -1, 3, 4, 5,
+				 -1, 6, 7, 8, -1, 9, 10, 11);
+
+	/* each 16 byte load reads 4 bytes more than needed */
+	size_t i = 0;
+	for (; i + 10 <= n; i += 8) {
+		const uint8_t *p = src + i * 3;
+		const __m256i x =
+			_mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)p)),
+						_mm_loadu_si128((const __m128i *)(p + 12)),
+						1);
+		_mm256_storeu_si256((__m256i *)(dest + i),
+				    _mm256_srai_epi32(_mm256_shuffle_epi8(x, shuffle),
+						      8));
+	}
+
+	GenericUnpack24(dest + i, src + i * 3, n - i);
+}
+
+TARGET_AVX2
+static void
+Avx2Reverse16(uint16_t *dest, const uint16_t *src, size_t n) noexcept
+{
+	const __m256i shuffle =
+		_mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6,
+				 9, 8, 11, 10, 13, 12, 15, 14,
+				 1, 0, 3, 2, 5, 4, 7, 6,
+				 9, 8, 11, 10, 13, 12, 15, 14);
+
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		const __m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+		_mm256_storeu_si256((__m256i *)(dest + i),
+				    _mm256_shuffle_epi8(x, shuffle));
+	}
+
+	GenericReverse16(dest + i, src + i, n - i);
+}
+
+TARGET_AVX2
+static void
+Avx2Reverse32(uint32_t *dest, const uint32_t *src, size_t n) noexcept
+{
+	const __m256i shuffle =
+		_mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4,
+				 11, 10, 9, 8, 15, 14, 13, 12,
+				 3, 2, 1, 0, 7, 6, 5, 4,
+				 11, 10, 9, 8, 15, 14, 13, 12);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+		_mm256_storeu_si256((__m256i *)(dest + i),
+				    _mm256_shuffle_epi8(x, shuffle));
+	}
+
+	GenericReverse32(dest + i, src + i, n - i);
+}
+
+TARGET_AVX2
+static void
+Avx2ToAlsa71S16(int16_t *dest, const int16_t *src, size_t n) noexcept
+{
+	/* two frames per vector, one in each 128 bit lane */
+	size_t i = 0;
+	for (; i + 2 <= n; i += 2) {
+		const __m256i x = _mm256_loadu_si256((const __m256i *)(src + i * 8));
+		_mm256_storeu_si256((__m256i *)(dest + i * 8),
+				    _mm256_shuffle_epi32(x, _MM_SHUFFLE(3, 1, 2, 0)));
+	}
+
+	GenericToAlsa71S16(dest + i * 8, src + i * 8, n - i);
+}
+
+TARGET_AVX2
+static void
+Avx2ToAlsa71S32(int32_t *dest, const int32_t *src, size_t n) noexcept
+{
+	const __m256i permutation = _mm256_setr_epi32(0, 1, 4, 5, 2, 3, 6, 7);
+
+	for (size_t i = 0; i < n; ++i) {
+		const __m256i x = _mm256_loadu_si256((const __m256i *)(src + i * 8));
+		_mm256_storeu_si256((__m256i *)(dest + i * 8),
+				    _mm256_permutevar8x32_epi32(x, permutation));
+	}
+}
+
+const PcmConvertKernels pcm_convert_kernels_avx2 = {
+	"avx2",
+	Avx2ConvertS16ToS24,
+	Avx2ConvertS16ToS32,
+	Avx2ConvertS24ToS32,
+	Avx2ConvertS32ToS24,
+	Avx2ConvertS16ToFloat,
+	Avx2ConvertS24ToFloat,
+	Avx2ConvertS32ToFloat,
+	Avx2ConvertFloatToS16,
+	Avx2ConvertFloatToS24,
+	Avx2ConvertFloatToS32,
+	Avx2Pack24,
+	Avx2Unpack24,
+	Avx2Reverse16,
+	Avx2Reverse32,
+	Sse2ToAlsa51S16,
+	Sse2ToAlsa51S32,
+	Avx2ToAlsa71S16,
+	Avx2ToAlsa71S32,
+};
+
+#endif
@@ -25,12 +25,38 @@
 enum class SampleFormat : uint8_t;
 
 class PcmDither {
+public:
+	/**
+	 * The number of independent dither states used by the
+	 * vectorized kernels (see VolumeKernels.hxx).  Sample number
+	 * i of a buffer uses lane i % LANES, which makes the result
+	 * independent of the vector width.
+	 */
+	static constexpr unsigned LANES = 8;
+
+	struct Lanes {
+		int32_t error[3][LANES];
+		uint32_t random[LANES];
+	};
+
+private:
 	int32_t error[3];
 	int32_t random;
 
+	Lanes lanes;
+
 public:
 	constexpr PcmDither() noexcept
-		:error{0, 0, 0}, random(0) {}
+		:error{0, 0, 0}, random(0), lanes() {
+		/* different seeds, so the channels don't get the
+		   same noise */
+		for (unsigned i = 0; i < LANES; ++i)
+			lanes.random[i] = i * 0x9e3779b9u;
+	}
+
+	Lanes &GetLanes() noexcept {
+		return lanes;
+	}
 
 	/**
 	 * Shift the given sample by #SBITS-#DBITS to the right, and
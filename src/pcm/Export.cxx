@@ -18,6 +18,7 @@
  */
 
 #include "Export.hxx"
+#include "ConvertKernels.hxx"
 #include "Order.hxx"
 #include "Pack.hxx"
 #include "Silence.hxx"
@@ -307,11 +308,10 @@ PcmExport::Export(ConstBuffer<void> data) noexcept
 	} else if (shift8) {
 		const auto src = ConstBuffer<int32_t>::FromVoid(data);
 
-		uint32_t *dest = (uint32_t *)pack_buffer.Get(data.size);
+		int32_t *dest = (int32_t *)pack_buffer.Get(data.size);
 		data.data = dest;
 
-		for (auto i : src)
-			*dest++ = i << 8;
+		GetPcmConvertKernels().s24_to_s32(dest, src.data, src.size);
 	}
 
 	if (reverse_endian > 0) {
@@ -323,7 +323,24 @@ PcmExport::Export(ConstBuffer<void> data) noexcept
 		assert(dest != nullptr);
 		data.data = dest;
 
-		reverse_bytes(dest, src.begin(), src.end(), reverse_endian);
+		const auto &kernels = GetPcmConvertKernels();
+		switch (reverse_endian) {
+		case 2:
+			kernels.reverse_16((uint16_t *)dest,
+					   (const uint16_t *)src.data,
+					   src.size / 2);
+			break;
+
+		case 4:
+			kernels.reverse_32((uint32_t *)dest,
+					   (const uint32_t *)src.data,
+					   src.size / 4);
+			break;
+
+		default:
+			reverse_bytes(dest, src.begin(), src.end(),
+				      reverse_endian);
+		}
 	}
 
 	return data;
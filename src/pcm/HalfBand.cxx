@@ -0,0 +1,169 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "HalfBand.hxx"
+#include "util/Compiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <assert.h>
+
+/**
+ * The zeroth order modified Bessel function of the first kind, for
+ * the Kaiser window.
+ */
+static double
+BesselI0(double x) noexcept
+{
+	double sum = 1, term = 1;
+	for (unsigned k = 1; k < 50; ++k) {
+		term *= (x / (2 * k)) * (x / (2 * k));
+		sum += term;
+		if (term < sum * 1e-12)
+			break;
+	}
+
+	return sum;
+}
+
+HalfBandDecimator::Filter::Filter(double transition,
+				  double attenuation) noexcept
+{
+	const double beta = 0.1102 * (attenuation - 8.7);
+
+	/* Kaiser's estimate of the filter length; a half-band
+	   filter has 4*n-1 taps, where n is the number of non-zero
+	   coefficients on each side */
+	const double length = (attenuation - 7.95) / (14.36 * transition) + 1;
+	const unsigned n = unsigned(std::ceil((length + 1) / 4));
+	const double half_length = 2 * n - 1;
+
+	coefficients.resize(n);
+
+	double sum = 0;
+	for (unsigned i = 0; i < n; ++i) {
+		const double k = 2 * i + 1;
+		const double r = k / half_length;
+		const double window = BesselI0(beta * std::sqrt(1 - r * r))
+			/ BesselI0(beta);
+		const double sinc = std::sin(M_PI * k / 2) / (M_PI * k);
+		coefficients[i] = sinc * window;
+		sum += 2 * coefficients[i];
+	}
+
+	/* normalize the DC gain to 1, without touching the center
+	   coefficient */
+	for (auto &c : coefficients)
+		c *= 0.5 / sum;
+}
+
+/* these are built during static initialization, before any thread
+   exists; function-local statics would not be thread-safe, because
+   MPD is compiled with -fno-threadsafe-statics */
+static const HalfBandDecimator::Filter steep_filter(0.1, 120);
+static const HalfBandDecimator::Filter short_filter(0.3, 120);
+
+const HalfBandDecimator::Filter &
+HalfBandDecimator::GetSteepFilter() noexcept
+{
+	return steep_filter;
+}
+
+const HalfBandDecimator::Filter &
+HalfBandDecimator::GetShortFilter() noexcept
+{
+	return short_filter;
+}
+
+void
+HalfBandDecimator::Reset() noexcept
+{
+	assert(filter != nullptr);
+
+	buffer.assign(filter->GetLength() - 1 + MAX_CHUNK, 0);
+	phase = 0;
+}
+
+/**
+ * Calculate one output sample from the window centered at #center.
+ */
+gcc_pure
+static float
+Convolve(const float *h, size_t n_coefficients, const float *center) noexcept
+{
+	/* four independent sums, so the loop is not limited by the
+	   latency of the floating point addition */
+	float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+	size_t i = 0;
+	for (; i + 4 <= n_coefficients; i += 4) {
+		const float *a = center - 2 * i;
+		const float *b = center + 2 * i;
+		s0 += h[i] * (a[-1] + b[1]);
+		s1 += h[i + 1] * (a[-3] + b[3]);
+		s2 += h[i + 2] * (a[-5] + b[5]);
+		s3 += h[i + 3] * (a[-7] + b[7]);
+	}
+
+	for (; i < n_coefficients; ++i) {
+		const size_t k = 2 * i + 1;
+		s0 += h[i] * (center[-k] + center[k]);
+	}
+
+	return 0.5f * center[0] + ((s0 + s1) + (s2 + s3));
+}
+
+size_t
+HalfBandDecimator::Process(float *dest, const float *src, size_t n) noexcept
+{
+	assert(filter != nullptr);
+
+	const float *const h = filter->coefficients.data();
+	const size_t n_coefficients = filter->coefficients.size();
+	const size_t length = filter->GetLength();
+	const size_t half_length = length / 2;
+	const size_t history = length - 1;
+
+	float *const x = buffer.data();
+	size_t n_dest = 0;
+
+	while (n > 0) {
+		/* append a chunk to the history; since each chunk
+		   has been copied before its output is written, and
+		   the output is never longer than the input
+		   consumed so far, this works in-place */
+		const size_t chunk = std::min(n, MAX_CHUNK);
+		std::copy_n(src, chunk, x + history);
+		src += chunk;
+		n -= chunk;
+
+		const size_t end = history + chunk;
+		size_t p = phase;
+		for (; p + length <= end; p += 2)
+			dest[n_dest++] = Convolve(h, n_coefficients,
+						  x + p + half_length);
+
+		/* keep the last filter window (minus one sample)
+		   as history for the next chunk */
+		phase = p - chunk;
+		std::copy_n(x + chunk, history, x);
+	}
+
+	return n_dest;
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_HALF_BAND_HXX
+#define MPD_PCM_HALF_BAND_HXX
+
+#include <vector>
+
+#include <stddef.h>
+
+/**
+ * A linear-phase half-band FIR low-pass filter which decimates a
+ * floating point stream by 2.  Every other coefficient of a half-band
+ * filter is zero and the filter is symmetric, therefore one output
+ * sample costs only about a quarter as many multiplications as the
+ * filter has taps.
+ */
+class HalfBandDecimator {
+public:
+	/**
+	 * A set of filter coefficients.
+	 */
+	struct Filter {
+		/**
+		 * The non-zero coefficients for the offsets 1, 3, 5,
+		 * ... from the center; the center coefficient is
+		 * 0.5.
+		 */
+		std::vector<float> coefficients;
+
+		/**
+		 * Design a filter with a Kaiser window.
+		 *
+		 * @param transition the width of the transition band
+		 * around a quarter of the input sample rate,
+		 * relative to the input sample rate
+		 * @param attenuation the stop band attenuation [dB]
+		 */
+		Filter(double transition, double attenuation) noexcept;
+
+		/**
+		 * The number of input samples in one filter window.
+		 */
+		size_t GetLength() const noexcept {
+			return coefficients.size() * 4 - 1;
+		}
+	};
+
+	/**
+	 * A filter with a narrow transition band (from 0.4 to 0.6 of
+	 * the output sample rate), for the last stage.
+	 */
+	static const Filter &GetSteepFilter() noexcept;
+
+	/**
+	 * A short filter for the stages before the last one, which
+	 * only need to protect the pass band of the last stage.
+	 */
+	static const Filter &GetShortFilter() noexcept;
+
+private:
+	/**
+	 * The maximum number of input samples copied into #buffer at
+	 * a time; Process() splits larger blocks.
+	 */
+	static constexpr size_t MAX_CHUNK = 1024;
+
+	const Filter *filter = nullptr;
+
+	/**
+	 * The last filter length minus one input samples (the
+	 * history), followed by room for #MAX_CHUNK new samples.
+	 * This is allocated by Reset() and never resized by
+	 * Process().
+	 */
+	std::vector<float> buffer;
+
+	/**
+	 * The offset of the next filter window in the history (0 or
+	 * 1), depending on whether the input consumed so far was
+	 * odd or even.
+	 */
+	size_t phase = 0;
+
+public:
+	void Open(const Filter &_filter) noexcept {
+		filter = &_filter;
+		Reset();
+	}
+
+	bool IsDefined() const noexcept {
+		return filter != nullptr;
+	}
+
+	/**
+	 * Clear the filter history.
+	 */
+	void Reset() noexcept;
+
+	/**
+	 * Filter and decimate a block of samples.  This may be done
+	 * in-place (dest==src).
+	 *
+	 * @return the number of samples written to the destination
+	 * buffer, which is n/2 rounded up or down depending on the
+	 * previous calls
+	 */
+	size_t Process(float *dest, const float *src, size_t n) noexcept;
+};
+
+#endif
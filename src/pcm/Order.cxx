@@ -19,6 +19,8 @@
 
 #include "Order.hxx"
 #include "Buffer.hxx"
+#include "ConvertKernels.hxx"
+#include "ConvertKernelsGeneric.hxx"
 #include "util/ConstBuffer.hxx"
 
 template<typename V>
@@ -64,13 +66,16 @@ ToAlsaChannelOrder51(V *dest, const V *src, size_t n) noexcept
 		p.ToAlsa51();
 }
 
-template<typename V>
-static inline ConstBuffer<V>
-ToAlsaChannelOrder51(PcmBuffer &buffer, ConstBuffer<V> src) noexcept
+void
+GenericToAlsa51S16(int16_t *dest, const int16_t *src, size_t n) noexcept
 {
-	auto dest = buffer.GetT<V>(src.size);
-	ToAlsaChannelOrder51(dest, src.data, src.size / 6);
-	return { dest, src.size };
+	ToAlsaChannelOrder51(dest, src, n);
+}
+
+void
+GenericToAlsa51S32(int32_t *dest, const int32_t *src, size_t n) noexcept
+{
+	ToAlsaChannelOrder51(dest, src, n);
 }
 
 template<typename V>
@@ -82,26 +87,61 @@ ToAlsaChannelOrder71(V *dest, const V *src, size_t n) noexcept
 		p.ToAlsa71();
 }
 
+void
+GenericToAlsa71S16(int16_t *dest, const int16_t *src, size_t n) noexcept
+{
+	ToAlsaChannelOrder71(dest, src, n);
+}
+
+void
+GenericToAlsa71S32(int32_t *dest, const int32_t *src, size_t n) noexcept
+{
+	ToAlsaChannelOrder71(dest, src, n);
+}
+
+/**
+ * @param f the #PcmConvertKernels function which converts the frames
+ */
 template<typename V>
 static inline ConstBuffer<V>
-ToAlsaChannelOrder71(PcmBuffer &buffer, ConstBuffer<V> src) noexcept
+ToAlsaChannelOrder(PcmBuffer &buffer, ConstBuffer<V> src, unsigned channels,
+		   void (*f)(V *dest, const V *src, size_t n) noexcept) noexcept
 {
 	auto dest = buffer.GetT<V>(src.size);
-	ToAlsaChannelOrder71(dest, src.data, src.size / 8);
+	f(dest, src.data, src.size / channels);
 	return { dest, src.size };
 }
 
-template<typename V>
-static ConstBuffer<V>
-ToAlsaChannelOrderT(PcmBuffer &buffer, ConstBuffer<V> src,
+static ConstBuffer<int16_t>
+ToAlsaChannelOrderT(PcmBuffer &buffer, ConstBuffer<int16_t> src,
 		    unsigned channels) noexcept
 {
+	const auto &kernels = GetPcmConvertKernels();
+
+	switch (channels) {
+	case 6: // 5.1
+		return ToAlsaChannelOrder(buffer, src, 6, kernels.alsa_51_16);
+
+	case 8: // 7.1
+		return ToAlsaChannelOrder(buffer, src, 8, kernels.alsa_71_16);
+
+	default:
+		return src;
+	}
+}
+
+static ConstBuffer<int32_t>
+ToAlsaChannelOrderT(PcmBuffer &buffer, ConstBuffer<int32_t> src,
+		    unsigned channels) noexcept
+{
+	const auto &kernels = GetPcmConvertKernels();
+
 	switch (channels) {
 	case 6: // 5.1
-		return ToAlsaChannelOrder51(buffer, src);
+		return ToAlsaChannelOrder(buffer, src, 6, kernels.alsa_51_32);
 
 	case 8: // 7.1
-		return ToAlsaChannelOrder71(buffer, src);
+		return ToAlsaChannelOrder(buffer, src, 8, kernels.alsa_71_32);
 
 	default:
 		return src;
@@ -18,6 +18,8 @@
  */
 
 #include "Pack.hxx"
+#include "ConvertKernels.hxx"
+#include "ConvertKernelsGeneric.hxx"
 #include "util/ByteOrder.hxx"
 
 static void
@@ -34,17 +36,23 @@ pack_sample(uint8_t *dest, const int32_t *src0) noexcept
 }
 
 void
-pcm_pack_24(uint8_t *dest, const int32_t *src, const int32_t *src_end) noexcept
+GenericPack24(uint8_t *dest, const int32_t *src, size_t n) noexcept
 {
 	/* duplicate loop to help the compiler's optimizer (constant
 	   parameter to the pack_sample() inline function) */
 
-	while (src < src_end) {
+	for (size_t i = 0; i != n; ++i) {
 		pack_sample(dest, src++);
 		dest += 3;
 	}
 }
 
+void
+pcm_pack_24(uint8_t *dest, const int32_t *src, const int32_t *src_end) noexcept
+{
+	GetPcmConvertKernels().pack_24(dest, src, src_end - src);
+}
+
 /**
  * Construct a signed 24 bit integer from three bytes into a int32_t.
  */
@@ -87,15 +95,21 @@ ReadS24(const uint8_t *src) noexcept
 }
 
 void
-pcm_unpack_24(int32_t *dest,
-	      const uint8_t *src, const uint8_t *src_end) noexcept
+GenericUnpack24(int32_t *dest, const uint8_t *src, size_t n) noexcept
 {
-	while (src < src_end) {
+	for (size_t i = 0; i != n; ++i) {
 		*dest++ = ReadS24(src);
 		src += 3;
 	}
 }
 
+void
+pcm_unpack_24(int32_t *dest,
+	      const uint8_t *src, const uint8_t *src_end) noexcept
+{
+	GetPcmConvertKernels().unpack_24(dest, src, (src_end - src) / 3);
+}
+
 void
 pcm_unpack_24be(int32_t *dest,
 		const uint8_t *src, const uint8_t *src_end) noexcept
@@ -18,55 +18,144 @@
  */
 
 #include "PcmDsd.hxx"
+#include "PcmDsdPool.hxx"
+#include "thread/WorkerPool.hxx"
 #include "dsd2pcm/dsd2pcm.h"
 #include "util/ConstBuffer.hxx"
 
 #include <assert.h>
 
-PcmDsd::PcmDsd() noexcept
+/**
+ * Below this number of frames per ToFloat() call, the channels are
+ * converted serially, because waking up the worker threads would
+ * cost more than it saves.
+ */
+static constexpr size_t PARALLEL_THRESHOLD = 1024;
+
+PcmDsd::~PcmDsd() noexcept
 {
-	dsd2pcm.fill(nullptr);
+	for (auto &c : channels)
+		if (c.dsd2pcm != nullptr)
+			dsd2pcm_destroy(c.dsd2pcm);
 }
 
-PcmDsd::~PcmDsd() noexcept
+unsigned
+PcmDsd::FindRatio(unsigned dsd_sample_rate, unsigned pcm_sample_rate) noexcept
+{
+	unsigned n = 0;
+	while (n < MAX_STAGES &&
+	       (dsd_sample_rate >> (n + 1)) >= pcm_sample_rate &&
+	       dsd_sample_rate % (2u << n) == 0)
+		++n;
+
+	return MIN_RATIO << n;
+}
+
+void
+PcmDsd::SetRatio(unsigned ratio) noexcept
 {
-	for (auto i : dsd2pcm)
-		if (i != nullptr)
-			dsd2pcm_destroy(i);
+	assert(ratio >= MIN_RATIO);
+	assert(ratio <= MAX_RATIO);
+
+	n_stages = 0;
+	while ((MIN_RATIO << n_stages) < ratio)
+		++n_stages;
+
+	assert((MIN_RATIO << n_stages) == ratio);
+
+	for (auto &c : channels) {
+		for (unsigned i = 0; i < n_stages; ++i)
+			c.stages[i].Open(i == n_stages - 1
+					 ? HalfBandDecimator::GetSteepFilter()
+					 : HalfBandDecimator::GetShortFilter());
+
+		if (c.dsd2pcm != nullptr)
+			dsd2pcm_reset(c.dsd2pcm);
+	}
 }
 
 void
 PcmDsd::Reset() noexcept
 {
-	for (auto i : dsd2pcm)
-		if (i != nullptr)
-			dsd2pcm_reset(i);
+	for (auto &c : channels) {
+		if (c.dsd2pcm != nullptr)
+			dsd2pcm_reset(c.dsd2pcm);
+
+		for (unsigned i = 0; i < n_stages; ++i)
+			c.stages[i].Reset();
+	}
+}
+
+inline void
+PcmDsd::Channel::Convert(unsigned n_stages,
+			 const uint8_t *src, size_t n_frames,
+			 unsigned n_channels,
+			 float *dest) noexcept
+{
+	if (n_stages == 0) {
+		/* no decimation: write directly to the interleaved
+		   destination buffer */
+		dsd2pcm_translate(dsd2pcm, n_frames, src, n_channels,
+				  false, dest, n_channels);
+		n_output = n_frames;
+		return;
+	}
+
+	float *tmp = buffer.GetT<float>(n_frames);
+	dsd2pcm_translate(dsd2pcm, n_frames, src, n_channels,
+			  false, tmp, 1);
+
+	size_t n = n_frames;
+	for (unsigned i = 0; i < n_stages; ++i)
+		n = stages[i].Process(tmp, tmp, n);
+
+	for (size_t i = 0; i < n; ++i)
+		dest[i * n_channels] = tmp[i];
+
+	n_output = n;
 }
 
 ConstBuffer<float>
-PcmDsd::ToFloat(unsigned channels, ConstBuffer<uint8_t> src) noexcept
+PcmDsd::ToFloat(unsigned n_channels, ConstBuffer<uint8_t> src) noexcept
 {
 	assert(!src.IsNull());
 	assert(!src.empty());
-	assert(src.size % channels == 0);
-	assert(channels <= dsd2pcm.max_size());
+	assert(src.size % n_channels == 0);
+	assert(n_channels <= channels.max_size());
 
-	const unsigned num_samples = src.size;
-	const unsigned num_frames = src.size / channels;
+	const size_t num_frames = src.size / n_channels;
 
-	float *dest = buffer.GetT<float>(num_samples);
+	/* each half-band stage may return one sample more than half
+	   of its input, due to the state left over from the previous
+	   call */
+	float *dest = buffer.GetT<float>((num_frames + 1) * n_channels);
 
-	for (unsigned c = 0; c < channels; ++c) {
-		if (dsd2pcm[c] == nullptr) {
-			dsd2pcm[c] = dsd2pcm_init();
-			if (dsd2pcm[c] == nullptr)
+	/* dsd2pcm_init() is not thread-safe, therefore initialize
+	   all channels here */
+	for (unsigned c = 0; c < n_channels; ++c) {
+		if (channels[c].dsd2pcm == nullptr) {
+			channels[c].dsd2pcm = dsd2pcm_init();
+			if (channels[c].dsd2pcm == nullptr)
 				return nullptr;
 		}
-
-		dsd2pcm_translate(dsd2pcm[c], num_frames,
-				  src.data + c, channels,
-				  false, dest + c, channels);
 	}
 
-	return { dest, num_samples };
+	auto convert = [this, src, num_frames, n_channels, dest](unsigned c){
+		channels[c].Convert(n_stages, src.data + c, num_frames,
+				    n_channels, dest + c);
+	};
+
+	if (n_channels > 1 && num_frames >= PARALLEL_THRESHOLD)
+		GetPcmDsdPool().ForEach(n_channels, convert);
+	else
+		for (unsigned c = 0; c < n_channels; ++c)
+			convert(c);
+
+	/* all channels have the same state, therefore they return
+	   the same number of samples */
+	const size_t n_output = channels[0].n_output;
+	for (unsigned c = 1; c < n_channels; ++c)
+		assert(channels[c].n_output == n_output);
+
+	return { dest, n_output * n_channels };
 }
@@ -21,7 +21,9 @@
 #define MPD_PCM_DSD_HXX
 
 #include "Buffer.hxx"
+#include "HalfBand.hxx"
 #include "ChannelDefs.hxx"
+#include "util/Compiler.h"
 
 #include <array>
 
@@ -30,17 +32,92 @@
 template<typename T> struct ConstBuffer;
 
 /**
- * Wrapper for the dsd2pcm library.
+ * Convert DSD to floating point PCM.  The first stage is the 8:1
+ * table-driven FIR filter of the dsd2pcm library; it is optionally
+ * followed by a cascade of half-band filters, each of which halves
+ * the sample rate.
+ *
+ * Channels are converted in parallel on a #WorkerPool (see
+ * GetPcmDsdPool()) if the buffer is large enough.
  */
 class PcmDsd {
+public:
+	/**
+	 * The supported decimation ratios are MIN_RATIO * 2^n up to
+	 * MAX_RATIO; e.g. with 32:1, DSD64 is converted to 88.2 kHz
+	 * and DSD256 to 352.8 kHz.
+	 */
+	static constexpr unsigned MIN_RATIO = 8;
+	static constexpr unsigned MAX_RATIO = 256;
+
+private:
+	static constexpr unsigned MAX_STAGES = 5;
+	static_assert(MIN_RATIO << MAX_STAGES == MAX_RATIO, "Wrong MAX_STAGES");
+
 	PcmBuffer buffer;
 
-	std::array<struct dsd2pcm_ctx_s *, MAX_CHANNELS> dsd2pcm;
+	struct Channel {
+		struct dsd2pcm_ctx_s *dsd2pcm = nullptr;
+
+		/**
+		 * The output of dsd2pcm, which is then decimated
+		 * in-place by the half-band stages.
+		 */
+		PcmBuffer buffer;
+
+		std::array<HalfBandDecimator, MAX_STAGES> stages;
+
+		/**
+		 * The number of samples returned by the last stage
+		 * in the current ToFloat() call.
+		 */
+		size_t n_output;
+
+		void Convert(unsigned n_stages,
+			     const uint8_t *src, size_t n_frames,
+			     unsigned channels,
+			     float *dest) noexcept;
+	};
+
+	std::array<Channel, MAX_CHANNELS> channels;
+
+	/**
+	 * The number of half-band stages, i.e. log2(ratio / 8).
+	 */
+	unsigned n_stages = 0;
 
 public:
-	PcmDsd() noexcept;
+	PcmDsd() noexcept = default;
 	~PcmDsd() noexcept;
 
+	PcmDsd(const PcmDsd &) = delete;
+	PcmDsd &operator=(const PcmDsd &) = delete;
+
+	/**
+	 * Determine the largest supported decimation ratio which
+	 * converts the given DSD sample rate (in bytes per second,
+	 * i.e. the rate of #AudioFormat) to a PCM sample rate which
+	 * is not lower than the given one.
+	 */
+	gcc_const
+	static unsigned FindRatio(unsigned dsd_sample_rate,
+				  unsigned pcm_sample_rate) noexcept;
+
+	/**
+	 * Set the decimation ratio (one of the values described at
+	 * #MIN_RATIO) and reset the state.  The default is
+	 * #MIN_RATIO.
+	 */
+	void SetRatio(unsigned ratio) noexcept;
+
+	/**
+	 * Returns the PCM sample rate produced from the given DSD
+	 * sample rate (in bytes per second).
+	 */
+	unsigned GetOutputSampleRate(unsigned dsd_sample_rate) const noexcept {
+		return dsd_sample_rate >> n_stages;
+	}
+
 	void Reset() noexcept;
 
 	ConstBuffer<float> ToFloat(unsigned channels,
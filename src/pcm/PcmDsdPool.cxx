@@ -0,0 +1,51 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "PcmDsdPool.hxx"
+#include "ChannelDefs.hxx"
+#include "thread/WorkerPool.hxx"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/* the pool is created by the first DSD conversion, which may happen
+   in several output threads at the same time; a function-local static
+   is not thread-safe with -fno-threadsafe-statics, therefore these
+   (constant-initialized) globals and std::call_once */
+static std::once_flag pcm_dsd_pool_once;
+static std::unique_ptr<WorkerPool> pcm_dsd_pool;
+
+WorkerPool &
+GetPcmDsdPool() noexcept
+{
+	/* there is no point in having more threads than channels;
+	   one channel is converted by the calling thread */
+	const unsigned n_cpus = std::max(std::thread::hardware_concurrency(),
+					 1u);
+
+	std::call_once(pcm_dsd_pool_once, [n_cpus](){
+		pcm_dsd_pool.reset(new WorkerPool("dsd",
+						  std::min(n_cpus,
+							   unsigned(MAX_CHANNELS)) - 1));
+	});
+
+	return *pcm_dsd_pool;
+}
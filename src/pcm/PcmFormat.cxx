@@ -22,6 +22,7 @@
 #include "Traits.hxx"
 #include "FloatConvert.hxx"
 #include "ShiftConvert.hxx"
+#include "ConvertKernels.hxx"
 #include "util/ConstBuffer.hxx"
 #include "util/TransformN.hxx"
 
@@ -73,47 +74,6 @@ struct Convert32To16 {
 	}
 };
 
-template<SampleFormat F, class Traits=SampleTraits<F>>
-struct PortableFloatToInteger
-	: PerSampleConvert<FloatToIntegerSampleConvert<F, Traits>> {};
-
-template<SampleFormat F, class Traits=SampleTraits<F>>
-struct FloatToInteger : PortableFloatToInteger<F, Traits> {};
-
-/**
- * A template class that attempts to use the "optimized" algorithm for
- * large portions of the buffer, and calls the "portable" algorithm"
- * for the rest when the last block is not full.
- */
-template<typename Optimized, typename Portable>
-class GlueOptimizedConvert : Optimized, Portable {
-public:
-	typedef typename Portable::SrcTraits SrcTraits;
-	typedef typename Portable::DstTraits DstTraits;
-
-	void Convert(typename DstTraits::pointer out,
-		     typename SrcTraits::const_pointer in,
-		     size_t n) const {
-		Optimized::Convert(out, in, n);
-
-		/* use the "portable" algorithm for the trailing
-		   samples */
-		size_t remaining = n % Optimized::BLOCK_SIZE;
-		size_t done = n - remaining;
-		Portable::Convert(out + done, in + done, remaining);
-	}
-};
-
-#ifdef __ARM_NEON__
-#include "Neon.hxx"
-
-template<>
-struct FloatToInteger<SampleFormat::S16, SampleTraits<SampleFormat::S16>>
-	: GlueOptimizedConvert<NeonFloatTo16,
-			       PortableFloatToInteger<SampleFormat::S16>> {};
-
-#endif
-
 template<class C>
 static ConstBuffer<typename C::DstTraits::value_type>
 AllocateConvert(PcmBuffer &buffer, C convert,
@@ -124,11 +84,18 @@ AllocateConvert(PcmBuffer &buffer, C convert,
 	return { dest, src.size };
 }
 
-template<SampleFormat F, class Traits=SampleTraits<F>>
-static ConstBuffer<typename Traits::value_type>
-AllocateFromFloat(PcmBuffer &buffer, ConstBuffer<float> src)
+/**
+ * Allocate a buffer and convert with a #PcmConvertKernels function.
+ */
+template<typename D, typename S>
+static ConstBuffer<D>
+AllocateConvert(PcmBuffer &buffer,
+		void (*f)(D *dest, const S *src, size_t n) noexcept,
+		ConstBuffer<S> src)
 {
-	return AllocateConvert(buffer, FloatToInteger<F, Traits>(), src);
+	auto dest = buffer.GetT<D>(src.size);
+	f(dest, src.data, src.size);
+	return { dest, src.size };
 }
 
 static ConstBuffer<int16_t>
@@ -154,7 +121,7 @@ pcm_allocate_32_to_16(PcmBuffer &buffer, PcmDither &dither,
 static ConstBuffer<int16_t>
 pcm_allocate_float_to_16(PcmBuffer &buffer, ConstBuffer<float> src)
 {
-	return AllocateFromFloat<SampleFormat::S16>(buffer, src);
+	return AllocateConvert(buffer, GetPcmConvertKernels().float_to_s16, src);
 }
 
 ConstBuffer<int16_t>
@@ -193,10 +160,6 @@ struct Convert8To24
 	: PerSampleConvert<LeftShiftSampleConvert<SampleFormat::S8,
 						  SampleFormat::S24_P32>> {};
 
-struct Convert16To24
-	: PerSampleConvert<LeftShiftSampleConvert<SampleFormat::S16,
-						  SampleFormat::S24_P32>> {};
-
 static ConstBuffer<int32_t>
 pcm_allocate_8_to_24(PcmBuffer &buffer, ConstBuffer<int8_t> src)
 {
@@ -206,23 +169,19 @@ pcm_allocate_8_to_24(PcmBuffer &buffer, ConstBuffer<int8_t> src)
 static ConstBuffer<int32_t>
 pcm_allocate_16_to_24(PcmBuffer &buffer, ConstBuffer<int16_t> src)
 {
-	return AllocateConvert(buffer, Convert16To24(), src);
+	return AllocateConvert(buffer, GetPcmConvertKernels().s16_to_s24, src);
 }
 
-struct Convert32To24
-	: PerSampleConvert<RightShiftSampleConvert<SampleFormat::S32,
-						   SampleFormat::S24_P32>> {};
-
 static ConstBuffer<int32_t>
 pcm_allocate_32_to_24(PcmBuffer &buffer, ConstBuffer<int32_t> src)
 {
-	return AllocateConvert(buffer, Convert32To24(), src);
+	return AllocateConvert(buffer, GetPcmConvertKernels().s32_to_s24, src);
 }
 
 static ConstBuffer<int32_t>
 pcm_allocate_float_to_24(PcmBuffer &buffer, ConstBuffer<float> src)
 {
-	return AllocateFromFloat<SampleFormat::S24_P32>(buffer, src);
+	return AllocateConvert(buffer, GetPcmConvertKernels().float_to_s24, src);
 }
 
 ConstBuffer<int32_t>
@@ -261,14 +220,6 @@ struct Convert8To32
 	: PerSampleConvert<LeftShiftSampleConvert<SampleFormat::S8,
 						  SampleFormat::S32>> {};
 
-struct Convert16To32
-	: PerSampleConvert<LeftShiftSampleConvert<SampleFormat::S16,
-						  SampleFormat::S32>> {};
-
-struct Convert24To32
-	: PerSampleConvert<LeftShiftSampleConvert<SampleFormat::S24_P32,
-						  SampleFormat::S32>> {};
-
 static ConstBuffer<int32_t>
 pcm_allocate_8_to_32(PcmBuffer &buffer, ConstBuffer<int8_t> src)
 {
@@ -278,19 +229,19 @@ pcm_allocate_8_to_32(PcmBuffer &buffer, ConstBuffer<int8_t> src)
 static ConstBuffer<int32_t>
 pcm_allocate_16_to_32(PcmBuffer &buffer, ConstBuffer<int16_t> src)
 {
-	return AllocateConvert(buffer, Convert16To32(), src);
+	return AllocateConvert(buffer, GetPcmConvertKernels().s16_to_s32, src);
 }
 
 static ConstBuffer<int32_t>
 pcm_allocate_24p32_to_32(PcmBuffer &buffer, ConstBuffer<int32_t> src)
 {
-	return AllocateConvert(buffer, Convert24To32(), src);
+	return AllocateConvert(buffer, GetPcmConvertKernels().s24_to_s32, src);
 }
 
 static ConstBuffer<int32_t>
 pcm_allocate_float_to_32(PcmBuffer &buffer, ConstBuffer<float> src)
 {
-	return AllocateFromFloat<SampleFormat::S32>(buffer, src);
+	return AllocateConvert(buffer, GetPcmConvertKernels().float_to_s32, src);
 }
 
 ConstBuffer<int32_t>
@@ -328,15 +279,6 @@ pcm_convert_to_32(PcmBuffer &buffer,
 struct Convert8ToFloat
 	: PerSampleConvert<IntegerToFloatSampleConvert<SampleFormat::S8>> {};
 
-struct Convert16ToFloat
-	: PerSampleConvert<IntegerToFloatSampleConvert<SampleFormat::S16>> {};
-
-struct Convert24ToFloat
-	: PerSampleConvert<IntegerToFloatSampleConvert<SampleFormat::S24_P32>> {};
-
-struct Convert32ToFloat
-	: PerSampleConvert<IntegerToFloatSampleConvert<SampleFormat::S32>> {};
-
 static ConstBuffer<float>
 pcm_allocate_8_to_float(PcmBuffer &buffer, ConstBuffer<int8_t> src)
 {
@@ -346,19 +288,19 @@ pcm_allocate_8_to_float(PcmBuffer &buffer, ConstBuffer<int8_t> src)
 static ConstBuffer<float>
 pcm_allocate_16_to_float(PcmBuffer &buffer, ConstBuffer<int16_t> src)
 {
-	return AllocateConvert(buffer, Convert16ToFloat(), src);
+	return AllocateConvert(buffer, GetPcmConvertKernels().s16_to_float, src);
 }
 
 static ConstBuffer<float>
 pcm_allocate_24p32_to_float(PcmBuffer &buffer, ConstBuffer<int32_t> src)
 {
-	return AllocateConvert(buffer, Convert24ToFloat(), src);
+	return AllocateConvert(buffer, GetPcmConvertKernels().s24_to_float, src);
 }
 
 static ConstBuffer<float>
 pcm_allocate_32_to_float(PcmBuffer &buffer, ConstBuffer<int32_t> src)
 {
-	return AllocateConvert(buffer, Convert32ToFloat(), src);
+	return AllocateConvert(buffer, GetPcmConvertKernels().s32_to_float, src);
 }
 
 ConstBuffer<float>
@@ -0,0 +1,254 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "VolumeKernels.hxx"
+#include "VolumeKernelsGeneric.hxx"
+#include "Volume.hxx"
+#include "Traits.hxx"
+#include "util/ConstBuffer.hxx"
+
+#include <assert.h>
+
+/**
+ * Add the dither state of the given lane, shift the sample by
+ * SBITS-DBITS bits to the right and clip it.  This is the same
+ * algorithm as PcmDither::DitherShift(), but with one state per
+ * lane; the vectorized kernels must implement exactly this.
+ */
+template<typename L, unsigned SBITS, unsigned DBITS>
+static inline L
+LaneDitherShift(PcmDither::Lanes &dither, unsigned lane, L sample) noexcept
+{
+	constexpr unsigned scale_bits = SBITS - DBITS;
+	constexpr L MIN = -(L(1) << (SBITS - 1));
+	constexpr L MAX = (L(1) << (SBITS - 1)) - 1;
+	constexpr L round = L(1) << (scale_bits - 1);
+	constexpr L mask = (L(1) << scale_bits) - 1;
+
+	int32_t &e0 = dither.error[0][lane];
+	int32_t &e1 = dither.error[1][lane];
+	int32_t &e2 = dither.error[2][lane];
+	uint32_t &random = dither.random[lane];
+
+	sample += L(e0) - L(e1) + L(e2);
+
+	e2 = e1;
+	e1 = e0 / 2;
+
+	L output = sample + round;
+
+	const uint32_t rnd = random * 0x0019660du + 0x3c6ef35fu;
+	output += L(rnd & uint32_t(mask)) - L(random & uint32_t(mask));
+	random = rnd;
+
+	if (output > MAX) {
+		output = MAX;
+
+		if (sample > MAX)
+			sample = MAX;
+	} else if (output < MIN) {
+		output = MIN;
+
+		if (sample < MIN)
+			sample = MIN;
+	}
+
+	output &= ~mask;
+
+	e0 = int32_t(sample - output);
+
+	return output >> scale_bits;
+}
+
+template<SampleFormat F, class Traits=SampleTraits<F>>
+static void
+GenericVolumeT(PcmDither::Lanes &dither,
+	       typename Traits::pointer dest,
+	       typename Traits::const_pointer src, size_t n,
+	       int volume) noexcept
+{
+	typedef typename Traits::long_type L;
+
+	for (size_t i = 0; i != n; ++i)
+		dest[i] = LaneDitherShift<L, Traits::BITS + PCM_VOLUME_BITS,
+					  Traits::BITS>(dither,
+							i % PcmDither::LANES,
+							L(src[i]) * volume);
+}
+
+void
+GenericVolumeS16(PcmDither::Lanes &dither,
+		 int16_t *dest, const int16_t *src, size_t n,
+		 int volume) noexcept
+{
+	GenericVolumeT<SampleFormat::S16>(dither, dest, src, n, volume);
+}
+
+void
+GenericVolumeS24(PcmDither::Lanes &dither,
+		 int32_t *dest, const int32_t *src, size_t n,
+		 int volume) noexcept
+{
+	GenericVolumeT<SampleFormat::S24_P32>(dither, dest, src, n, volume);
+}
+
+void
+GenericVolumeS32(PcmDither::Lanes &dither,
+		 int32_t *dest, const int32_t *src, size_t n,
+		 int volume) noexcept
+{
+	GenericVolumeT<SampleFormat::S32>(dither, dest, src, n, volume);
+}
+
+void
+GenericVolumeS16ToS24(int32_t *dest, const int16_t *src, size_t n,
+		      int volume) noexcept
+{
+	/* 16 bits plus the volume bits is 2 more than 24 */
+	static_assert(16 + PCM_VOLUME_BITS == 24 + 2, "Wrong shift");
+
+	for (size_t i = 0; i != n; ++i)
+		dest[i] = (int32_t(src[i]) * volume) >> 2;
+}
+
+void
+GenericVolumeFloat(float *dest, const float *src, size_t n,
+		   float volume) noexcept
+{
+	for (size_t i = 0; i != n; ++i)
+		dest[i] = src[i] * volume;
+}
+
+template<SampleFormat F, class Traits=SampleTraits<F>>
+static void
+GenericAddVolumeT(PcmDither::Lanes &dither,
+		  typename Traits::pointer a,
+		  typename Traits::const_pointer b, size_t n,
+		  int volume1, int volume2) noexcept
+{
+	typedef typename Traits::long_type L;
+
+	for (size_t i = 0; i != n; ++i)
+		a[i] = LaneDitherShift<L, Traits::BITS + PCM_VOLUME_BITS,
+				       Traits::BITS>(dither,
+						     i % PcmDither::LANES,
+						     L(a[i]) * volume1 +
+						     L(b[i]) * volume2);
+}
+
+void
+GenericAddVolumeS16(PcmDither::Lanes &dither,
+		    int16_t *a, const int16_t *b, size_t n,
+		    int volume1, int volume2) noexcept
+{
+	GenericAddVolumeT<SampleFormat::S16>(dither, a, b, n,
+					     volume1, volume2);
+}
+
+void
+GenericAddVolumeS24(PcmDither::Lanes &dither,
+		    int32_t *a, const int32_t *b, size_t n,
+		    int volume1, int volume2) noexcept
+{
+	GenericAddVolumeT<SampleFormat::S24_P32>(dither, a, b, n,
+						 volume1, volume2);
+}
+
+void
+GenericAddVolumeS32(PcmDither::Lanes &dither,
+		    int32_t *a, const int32_t *b, size_t n,
+		    int volume1, int volume2) noexcept
+{
+	GenericAddVolumeT<SampleFormat::S32>(dither, a, b, n,
+					     volume1, volume2);
+}
+
+void
+GenericAddVolumeFloat(float *a, const float *b, size_t n,
+		      float volume1, float volume2) noexcept
+{
+	for (size_t i = 0; i != n; ++i)
+		a[i] = a[i] * volume1 + b[i] * volume2;
+}
+
+const PcmVolumeKernels pcm_volume_kernels_generic = {
+	"generic",
+	GenericVolumeS16,
+	GenericVolumeS16ToS24,
+	GenericVolumeS24,
+	GenericVolumeS32,
+	GenericVolumeFloat,
+	GenericAddVolumeS16,
+	GenericAddVolumeS24,
+	GenericAddVolumeS32,
+	GenericAddVolumeFloat,
+};
+
+namespace {
+
+struct SupportedPcmVolumeKernels {
+	const PcmVolumeKernels *list[4];
+	size_t n = 0;
+
+	SupportedPcmVolumeKernels() noexcept {
+		list[n++] = &pcm_volume_kernels_generic;
+
+#ifdef PCM_VOLUME_KERNELS_X86
+		__builtin_cpu_init();
+
+		if (__builtin_cpu_supports("sse2"))
+			list[n++] = &pcm_volume_kernels_sse2;
+
+		if (__builtin_cpu_supports("sse4.1"))
+			list[n++] = &pcm_volume_kernels_sse41;
+
+		if (__builtin_cpu_supports("avx2"))
+			list[n++] = &pcm_volume_kernels_avx2;
+#endif
+
+#ifdef PCM_VOLUME_KERNELS_NEON
+		/* NEON is enabled at compile time, therefore no
+		   runtime check */
+		list[n++] = &pcm_volume_kernels_neon;
+#endif
+	}
+};
+
+/**
+ * This is initialized by a global constructor, i.e. before main()
+ * starts any thread.  A function-local static would not be
+ * thread-safe, because MPD is built with -fno-threadsafe-statics.
+ */
+const SupportedPcmVolumeKernels supported_pcm_volume_kernels;
+
+}
+
+ConstBuffer<const PcmVolumeKernels *>
+GetSupportedPcmVolumeKernels() noexcept
+{
+	const auto &supported = supported_pcm_volume_kernels;
+	assert(supported.n > 0);
+	return {supported.list, supported.n};
+}
+
+const PcmVolumeKernels &
+GetPcmVolumeKernels() noexcept
+{
+	return *GetSupportedPcmVolumeKernels().back();
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_VOLUME_KERNELS_HXX
+#define MPD_PCM_VOLUME_KERNELS_HXX
+
+#include "Dither.hxx"
+
+#include <stddef.h>
+#include <stdint.h>
+
+template<typename T> struct ConstBuffer;
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PCM_VOLUME_KERNELS_X86
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PCM_VOLUME_KERNELS_NEON
+#endif
+
+/**
+ * A set of implementations of the inner loops of #PcmVolume and
+ * pcm_mix().  Each set is optimized for one instruction set; all of
+ * them produce the same integer results (the dither uses one state
+ * per lane, see PcmDither::LANES).
+ *
+ * The "add" functions mix the second buffer into the first one:
+ * a = a * volume1 + b * volume2.
+ */
+struct PcmVolumeKernels {
+	const char *name;
+
+	void (*s16)(PcmDither::Lanes &dither,
+		    int16_t *dest, const int16_t *src, size_t n,
+		    int volume) noexcept;
+
+	/**
+	 * Apply the volume and convert to S24_P32, without dither.
+	 */
+	void (*s16_to_s24)(int32_t *dest, const int16_t *src, size_t n,
+			   int volume) noexcept;
+
+	void (*s24)(PcmDither::Lanes &dither,
+		    int32_t *dest, const int32_t *src, size_t n,
+		    int volume) noexcept;
+
+	void (*s32)(PcmDither::Lanes &dither,
+		    int32_t *dest, const int32_t *src, size_t n,
+		    int volume) noexcept;
+
+	void (*fl)(float *dest, const float *src, size_t n,
+		   float volume) noexcept;
+
+	void (*add_s16)(PcmDither::Lanes &dither,
+			int16_t *a, const int16_t *b, size_t n,
+			int volume1, int volume2) noexcept;
+
+	void (*add_s24)(PcmDither::Lanes &dither,
+			int32_t *a, const int32_t *b, size_t n,
+			int volume1, int volume2) noexcept;
+
+	void (*add_s32)(PcmDither::Lanes &dither,
+			int32_t *a, const int32_t *b, size_t n,
+			int volume1, int volume2) noexcept;
+
+	void (*add_fl)(float *a, const float *b, size_t n,
+		       float volume1, float volume2) noexcept;
+};
+
+/**
+ * Portable C++ implementation.
+ */
+extern const PcmVolumeKernels pcm_volume_kernels_generic;
+
+#ifdef PCM_VOLUME_KERNELS_X86
+/**
+ * SSE2 for floating point; the integer kernels need the 32 bit
+ * multiplication from SSE4.1.
+ */
+extern const PcmVolumeKernels pcm_volume_kernels_sse2;
+extern const PcmVolumeKernels pcm_volume_kernels_sse41;
+extern const PcmVolumeKernels pcm_volume_kernels_avx2;
+#endif
+
+#ifdef PCM_VOLUME_KERNELS_NEON
+/**
+ * NEON for floating point and S16; S24 and S32 use the generic
+ * kernels.
+ */
+extern const PcmVolumeKernels pcm_volume_kernels_neon;
+#endif
+
+/**
+ * Returns all kernel sets which are supported by this CPU, the
+ * generic one first and the fastest one last.
+ */
+ConstBuffer<const PcmVolumeKernels *>
+GetSupportedPcmVolumeKernels() noexcept;
+
+/**
+ * Returns the fastest kernel set supported by this CPU.
+ */
+const PcmVolumeKernels &
+GetPcmVolumeKernels() noexcept;
+
+#endif
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * The functions of #pcm_volume_kernels_generic, for the optimized
+ * kernels which use them for the remaining samples at the end of a
+ * buffer.
+ */
+
+#ifndef MPD_PCM_VOLUME_KERNELS_GENERIC_HXX
+#define MPD_PCM_VOLUME_KERNELS_GENERIC_HXX
+
+#include "Dither.hxx"
+
+#include <stddef.h>
+#include <stdint.h>
+
+void
+GenericVolumeS16(PcmDither::Lanes &dither,
+		 int16_t *dest, const int16_t *src, size_t n,
+		 int volume) noexcept;
+
+void
+GenericVolumeS16ToS24(int32_t *dest, const int16_t *src, size_t n,
+		      int volume) noexcept;
+
+void
+GenericVolumeS24(PcmDither::Lanes &dither,
+		 int32_t *dest, const int32_t *src, size_t n,
+		 int volume) noexcept;
+
+void
+GenericVolumeS32(PcmDither::Lanes &dither,
+		 int32_t *dest, const int32_t *src, size_t n,
+		 int volume) noexcept;
+
+void
+GenericVolumeFloat(float *dest, const float *src, size_t n,
+		   float volume) noexcept;
+
+void
+GenericAddVolumeS16(PcmDither::Lanes &dither,
+		    int16_t *a, const int16_t *b, size_t n,
+		    int volume1, int volume2) noexcept;
+
+void
+GenericAddVolumeS24(PcmDither::Lanes &dither,
+		    int32_t *a, const int32_t *b, size_t n,
+		    int volume1, int volume2) noexcept;
+
+void
+GenericAddVolumeS32(PcmDither::Lanes &dither,
+		    int32_t *a, const int32_t *b, size_t n,
+		    int volume1, int volume2) noexcept;
+
+void
+GenericAddVolumeFloat(float *a, const float *b, size_t n,
+		      float volume1, float volume2) noexcept;
+
+#endif
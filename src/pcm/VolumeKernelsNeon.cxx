@@ -0,0 +1,224 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * ARM NEON implementation of #PcmVolumeKernels.  NEON is enabled at
+ * compile time, so there is no runtime check.
+ *
+ * The float kernels and the S16 kernels (32 bit arithmetic) are
+ * vectorized; the dither state of PcmDither::LANES consecutive
+ * samples is kept in two vectors of 4 lanes, like the SSE4.1
+ * kernels.  S24 and S32 need 64 bit arithmetic and use the generic
+ * kernels.
+ */
+
+#include "VolumeKernels.hxx"
+#include "VolumeKernelsGeneric.hxx"
+#include "Volume.hxx"
+
+#ifdef PCM_VOLUME_KERNELS_NEON
+
+#include <arm_neon.h>
+
+static_assert(PcmDither::LANES == 8, "Wrong number of lanes");
+
+static constexpr uint32_t PRNG_MUL = 0x0019660d;
+static constexpr uint32_t PRNG_ADD = 0x3c6ef35f;
+
+/**
+ * Dither state of 4 lanes with 32 bit arithmetic.
+ */
+struct NeonDither32 {
+	int32x4_t e0, e1, e2;
+	uint32x4_t random;
+
+	void Load(const PcmDither::Lanes &d, unsigned lane) noexcept {
+		e0 = vld1q_s32(d.error[0] + lane);
+		e1 = vld1q_s32(d.error[1] + lane);
+		e2 = vld1q_s32(d.error[2] + lane);
+		random = vld1q_u32(d.random + lane);
+	}
+
+	void Store(PcmDither::Lanes &d, unsigned lane) const noexcept {
+		vst1q_s32(d.error[0] + lane, e0);
+		vst1q_s32(d.error[1] + lane, e1);
+		vst1q_s32(d.error[2] + lane, e2);
+		vst1q_u32(d.random + lane, random);
+	}
+
+	/**
+	 * See LaneDitherShift().
+	 */
+	template<unsigned SBITS, unsigned DBITS>
+	int32x4_t Shift(int32x4_t sample) noexcept {
+		constexpr unsigned scale_bits = SBITS - DBITS;
+		const int32x4_t min = vdupq_n_s32(-(1 << (SBITS - 1)));
+		const int32x4_t max = vdupq_n_s32((1 << (SBITS - 1)) - 1);
+		const uint32x4_t mask = vdupq_n_u32((1u << scale_bits) - 1);
+
+		sample = vaddq_s32(sample, vaddq_s32(vsubq_s32(e0, e1), e2));
+
+		e2 = e1;
+		/* division by 2, rounding towards zero */
+		e1 = vshrq_n_s32(vaddq_s32(e0,
+					   vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(e0), 31))),
+				 1);
+
+		int32x4_t output = vaddq_s32(sample,
+					     vdupq_n_s32(1 << (scale_bits - 1)));
+
+		const uint32x4_t rnd = vmlaq_n_u32(vdupq_n_u32(PRNG_ADD),
+						   random, PRNG_MUL);
+		output = vaddq_s32(output,
+				   vsubq_s32(vreinterpretq_s32_u32(vandq_u32(rnd, mask)),
+					     vreinterpretq_s32_u32(vandq_u32(random, mask))));
+		random = rnd;
+
+		const uint32x4_t above = vcgtq_s32(output, max);
+		const uint32x4_t below = vcltq_s32(output, min);
+		sample = vbslq_s32(above, vminq_s32(sample, max), sample);
+		sample = vbslq_s32(below, vmaxq_s32(sample, min), sample);
+		output = vminq_s32(vmaxq_s32(output, min), max);
+
+		output = vbicq_s32(output, vreinterpretq_s32_u32(mask));
+
+		e0 = vsubq_s32(sample, output);
+
+		return vshrq_n_s32(output, scale_bits);
+	}
+};
+
+static void
+NeonVolumeS16(PcmDither::Lanes &dither,
+	      int16_t *dest, const int16_t *src, size_t n,
+	      int volume) noexcept
+{
+	NeonDither32 d0, d1;
+	d0.Load(dither, 0);
+	d1.Load(dither, 4);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const int16x8_t x = vld1q_s16(src + i);
+		const int32x4_t x0 = vmovl_s16(vget_low_s16(x));
+		const int32x4_t x1 = vmovl_s16(vget_high_s16(x));
+
+		const int32x4_t y0 = d0.Shift<16 + PCM_VOLUME_BITS, 16>(vmulq_n_s32(x0, volume));
+		const int32x4_t y1 = d1.Shift<16 + PCM_VOLUME_BITS, 16>(vmulq_n_s32(x1, volume));
+
+		vst1q_s16(dest + i, vcombine_s16(vqmovn_s32(y0),
+						 vqmovn_s32(y1)));
+	}
+
+	d0.Store(dither, 0);
+	d1.Store(dither, 4);
+
+	GenericVolumeS16(dither, dest + i, src + i, n - i, volume);
+}
+
+static void
+NeonAddVolumeS16(PcmDither::Lanes &dither,
+		 int16_t *a, const int16_t *b, size_t n,
+		 int volume1, int volume2) noexcept
+{
+	NeonDither32 d0, d1;
+	d0.Load(dither, 0);
+	d1.Load(dither, 4);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const int16x8_t xa = vld1q_s16(a + i);
+		const int16x8_t xb = vld1q_s16(b + i);
+
+		const int32x4_t x0 =
+			vaddq_s32(vmulq_n_s32(vmovl_s16(vget_low_s16(xa)), volume1),
+				  vmulq_n_s32(vmovl_s16(vget_low_s16(xb)), volume2));
+		const int32x4_t x1 =
+			vaddq_s32(vmulq_n_s32(vmovl_s16(vget_high_s16(xa)), volume1),
+				  vmulq_n_s32(vmovl_s16(vget_high_s16(xb)), volume2));
+
+		const int32x4_t y0 = d0.Shift<16 + PCM_VOLUME_BITS, 16>(x0);
+		const int32x4_t y1 = d1.Shift<16 + PCM_VOLUME_BITS, 16>(x1);
+
+		vst1q_s16(a + i, vcombine_s16(vqmovn_s32(y0),
+					      vqmovn_s32(y1)));
+	}
+
+	d0.Store(dither, 0);
+	d1.Store(dither, 4);
+
+	GenericAddVolumeS16(dither, a + i, b + i, n - i, volume1, volume2);
+}
+
+static void
+NeonVolumeS16ToS24(int32_t *dest, const int16_t *src, size_t n,
+		   int volume) noexcept
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const int16x8_t x = vld1q_s16(src + i);
+		const int32x4_t x0 = vmovl_s16(vget_low_s16(x));
+		const int32x4_t x1 = vmovl_s16(vget_high_s16(x));
+
+		vst1q_s32(dest + i, vshrq_n_s32(vmulq_n_s32(x0, volume), 2));
+		vst1q_s32(dest + i + 4,
+			  vshrq_n_s32(vmulq_n_s32(x1, volume), 2));
+	}
+
+	GenericVolumeS16ToS24(dest + i, src + i, n - i, volume);
+}
+
+static void
+NeonVolumeFloat(float *dest, const float *src, size_t n,
+		float volume) noexcept
+{
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		vst1q_f32(dest + i, vmulq_n_f32(vld1q_f32(src + i), volume));
+
+	GenericVolumeFloat(dest + i, src + i, n - i, volume);
+}
+
+static void
+NeonAddVolumeFloat(float *a, const float *b, size_t n,
+		   float volume1, float volume2) noexcept
+{
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		vst1q_f32(a + i,
+			  vaddq_f32(vmulq_n_f32(vld1q_f32(a + i), volume1),
+				    vmulq_n_f32(vld1q_f32(b + i), volume2)));
+
+	GenericAddVolumeFloat(a + i, b + i, n - i, volume1, volume2);
+}
+
+const PcmVolumeKernels pcm_volume_kernels_neon = {
+	"neon",
+	NeonVolumeS16,
+	NeonVolumeS16ToS24,
+	GenericVolumeS24,
+	GenericVolumeS32,
+	NeonVolumeFloat,
+	NeonAddVolumeS16,
+	GenericAddVolumeS24,
+	GenericAddVolumeS32,
+	NeonAddVolumeFloat,
+};
+
+#endif
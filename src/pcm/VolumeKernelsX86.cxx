@@ -0,0 +1,660 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * SSE2, SSE4.1 and AVX2 implementations of #PcmVolumeKernels.  The
+ * functions are compiled with "target" attributes, so they can be
+ * built without special compiler flags; GetPcmVolumeKernels() checks
+ * the CPU before using them.
+ *
+ * The dither state of PcmDither::LANES consecutive samples is kept
+ * in vector registers; the last (n % LANES) samples are passed to
+ * the generic implementation, which continues with lane 0.
+ */
+
+#include "VolumeKernels.hxx"
+#include "VolumeKernelsGeneric.hxx"
+#include "Volume.hxx"
+
+#ifdef PCM_VOLUME_KERNELS_X86
+
+#include <immintrin.h>
+
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+static_assert(PcmDither::LANES == 8, "Wrong number of lanes");
+
+static constexpr int32_t PRNG_MUL = 0x0019660d;
+static constexpr int32_t PRNG_ADD = 0x3c6ef35f;
+
+/*
+ * float (SSE2)
+ *
+ */
+
+TARGET_SSE2
+static void
+Sse2VolumeFloat(float *dest, const float *src, size_t n,
+		float volume) noexcept
+{
+	const __m128 v = _mm_set1_ps(volume);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		_mm_storeu_ps(dest + i,
+			      _mm_mul_ps(_mm_loadu_ps(src + i), v));
+		_mm_storeu_ps(dest + i + 4,
+			      _mm_mul_ps(_mm_loadu_ps(src + i + 4), v));
+	}
+
+	GenericVolumeFloat(dest + i, src + i, n - i, volume);
+}
+
+TARGET_SSE2
+static void
+Sse2AddVolumeFloat(float *a, const float *b, size_t n,
+		   float volume1, float volume2) noexcept
+{
+	const __m128 v1 = _mm_set1_ps(volume1), v2 = _mm_set1_ps(volume2);
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		_mm_storeu_ps(a + i,
+			      _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(a + i), v1),
+					 _mm_mul_ps(_mm_loadu_ps(b + i), v2)));
+
+	GenericAddVolumeFloat(a + i, b + i, n - i, volume1, volume2);
+}
+
+const PcmVolumeKernels pcm_volume_kernels_sse2 = {
+	"sse2",
+	GenericVolumeS16,
+	GenericVolumeS16ToS24,
+	GenericVolumeS24,
+	GenericVolumeS32,
+	Sse2VolumeFloat,
+	GenericAddVolumeS16,
+	GenericAddVolumeS24,
+	GenericAddVolumeS32,
+	Sse2AddVolumeFloat,
+};
+
+/*
+ * S16 (SSE4.1): 32 bit lanes, two vectors of 4 lanes each
+ *
+ */
+
+/**
+ * Dither state of 4 lanes with 32 bit arithmetic.
+ */
+struct Sse41Dither32 {
+	__m128i e0, e1, e2, random;
+
+	TARGET_SSE41
+	void Load(const PcmDither::Lanes &d, unsigned lane) noexcept {
+		e0 = _mm_loadu_si128((const __m128i *)(d.error[0] + lane));
+		e1 = _mm_loadu_si128((const __m128i *)(d.error[1] + lane));
+		e2 = _mm_loadu_si128((const __m128i *)(d.error[2] + lane));
+		random = _mm_loadu_si128((const __m128i *)(d.random + lane));
+	}
+
+	TARGET_SSE41
+	void Store(PcmDither::Lanes &d, unsigned lane) const noexcept {
+		_mm_storeu_si128((__m128i *)(d.error[0] + lane), e0);
+		_mm_storeu_si128((__m128i *)(d.error[1] + lane), e1);
+		_mm_storeu_si128((__m128i *)(d.error[2] + lane), e2);
+		_mm_storeu_si128((__m128i *)(d.random + lane), random);
+	}
+
+	/**
+	 * See LaneDitherShift().
+	 */
+	template<unsigned SBITS, unsigned DBITS>
+	TARGET_SSE41
+	__m128i Shift(__m128i sample) noexcept {
+		constexpr unsigned scale_bits = SBITS - DBITS;
+		const __m128i min = _mm_set1_epi32(-(1 << (SBITS - 1)));
+		const __m128i max = _mm_set1_epi32((1 << (SBITS - 1)) - 1);
+		const __m128i mask = _mm_set1_epi32((1 << scale_bits) - 1);
+
+		sample = _mm_add_epi32(sample,
+				       _mm_add_epi32(_mm_sub_epi32(e0, e1), e2));
+
+		e2 = e1;
+		/* division by 2, rounding towards zero */
+		e1 = _mm_srai_epi32(_mm_add_epi32(e0, _mm_srli_epi32(e0, 31)), 1);
+
+		__m128i output = _mm_add_epi32(sample,
+					       _mm_set1_epi32(1 << (scale_bits - 1)));
+
+		const __m128i rnd =
+			_mm_add_epi32(_mm_mullo_epi32(random,
+						      _mm_set1_epi32(PRNG_MUL)),
+				      _mm_set1_epi32(PRNG_ADD));
+		output = _mm_add_epi32(output,
+				       _mm_sub_epi32(_mm_and_si128(rnd, mask),
+						     _mm_and_si128(random, mask)));
+		random = rnd;
+
+		const __m128i above = _mm_cmpgt_epi32(output, max);
+		const __m128i below = _mm_cmpgt_epi32(min, output);
+		sample = _mm_blendv_epi8(sample, _mm_min_epi32(sample, max),
+					 above);
+		sample = _mm_blendv_epi8(sample, _mm_max_epi32(sample, min),
+					 below);
+		output = _mm_min_epi32(_mm_max_epi32(output, min), max);
+
+		output = _mm_andnot_si128(mask, output);
+
+		e0 = _mm_sub_epi32(sample, output);
+
+		return _mm_srai_epi32(output, scale_bits);
+	}
+};
+
+TARGET_SSE41
+static void
+Sse41VolumeS16(PcmDither::Lanes &dither,
+	       int16_t *dest, const int16_t *src, size_t n,
+	       int volume) noexcept
+{
+	const __m128i v = _mm_set1_epi32(volume);
+
+	Sse41Dither32 d0, d1;
+	d0.Load(dither, 0);
+	d1.Load(dither, 4);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+		const __m128i x0 = _mm_cvtepi16_epi32(x);
+		const __m128i x1 = _mm_cvtepi16_epi32(_mm_srli_si128(x, 8));
+
+		const __m128i y0 = d0.Shift<16 + PCM_VOLUME_BITS, 16>(_mm_mullo_epi32(x0, v));
+		const __m128i y1 = d1.Shift<16 + PCM_VOLUME_BITS, 16>(_mm_mullo_epi32(x1, v));
+
+		_mm_storeu_si128((__m128i *)(dest + i), _mm_packs_epi32(y0, y1));
+	}
+
+	d0.Store(dither, 0);
+	d1.Store(dither, 4);
+
+	GenericVolumeS16(dither, dest + i, src + i, n - i, volume);
+}
+
+TARGET_SSE41
+static void
+Sse41AddVolumeS16(PcmDither::Lanes &dither,
+		  int16_t *a, const int16_t *b, size_t n,
+		  int volume1, int volume2) noexcept
+{
+	const __m128i v1 = _mm_set1_epi32(volume1);
+	const __m128i v2 = _mm_set1_epi32(volume2);
+
+	Sse41Dither32 d0, d1;
+	d0.Load(dither, 0);
+	d1.Load(dither, 4);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m128i xa = _mm_loadu_si128((const __m128i *)(a + i));
+		const __m128i xb = _mm_loadu_si128((const __m128i *)(b + i));
+
+		const __m128i x0 =
+			_mm_add_epi32(_mm_mullo_epi32(_mm_cvtepi16_epi32(xa), v1),
+				      _mm_mullo_epi32(_mm_cvtepi16_epi32(xb), v2));
+		const __m128i x1 =
+			_mm_add_epi32(_mm_mullo_epi32(_mm_cvtepi16_epi32(_mm_srli_si128(xa, 8)), v1),
+				      _mm_mullo_epi32(_mm_cvtepi16_epi32(_mm_srli_si128(xb, 8)), v2));
+
+		const __m128i y0 = d0.Shift<16 + PCM_VOLUME_BITS, 16>(x0);
+		const __m128i y1 = d1.Shift<16 + PCM_VOLUME_BITS, 16>(x1);
+
+		_mm_storeu_si128((__m128i *)(a + i), _mm_packs_epi32(y0, y1));
+	}
+
+	d0.Store(dither, 0);
+	d1.Store(dither, 4);
+
+	GenericAddVolumeS16(dither, a + i, b + i, n - i, volume1, volume2);
+}
+
+TARGET_SSE41
+static void
+Sse41VolumeS16ToS24(int32_t *dest, const int16_t *src, size_t n,
+		    int volume) noexcept
+{
+	const __m128i v = _mm_set1_epi32(volume);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+		const __m128i x0 = _mm_cvtepi16_epi32(x);
+		const __m128i x1 = _mm_cvtepi16_epi32(_mm_srli_si128(x, 8));
+
+		_mm_storeu_si128((__m128i *)(dest + i),
+				 _mm_srai_epi32(_mm_mullo_epi32(x0, v), 2));
+		_mm_storeu_si128((__m128i *)(dest + i + 4),
+				 _mm_srai_epi32(_mm_mullo_epi32(x1, v), 2));
+	}
+
+	GenericVolumeS16ToS24(dest + i, src + i, n - i, volume);
+}
+
+const PcmVolumeKernels pcm_volume_kernels_sse41 = {
+	"sse4.1",
+	Sse41VolumeS16,
+	Sse41VolumeS16ToS24,
+	GenericVolumeS24,
+	GenericVolumeS32,
+	Sse2VolumeFloat,
+	Sse41AddVolumeS16,
+	GenericAddVolumeS24,
+	GenericAddVolumeS32,
+	Sse2AddVolumeFloat,
+};
+
+/*
+ * AVX2
+ *
+ */
+
+/**
+ * Dither state of 8 lanes with 32 bit arithmetic.
+ */
+struct Avx2Dither32 {
+	__m256i e0, e1, e2, random;
+
+	TARGET_AVX2
+	void Load(const PcmDither::Lanes &d) noexcept {
+		e0 = _mm256_loadu_si256((const __m256i *)d.error[0]);
+		e1 = _mm256_loadu_si256((const __m256i *)d.error[1]);
+		e2 = _mm256_loadu_si256((const __m256i *)d.error[2]);
+		random = _mm256_loadu_si256((const __m256i *)d.random);
+	}
+
+	TARGET_AVX2
+	void Store(PcmDither::Lanes &d) const noexcept {
+		_mm256_storeu_si256((__m256i *)d.error[0], e0);
+		_mm256_storeu_si256((__m256i *)d.error[1], e1);
+		_mm256_storeu_si256((__m256i *)d.error[2], e2);
+		_mm256_storeu_si256((__m256i *)d.random, random);
+	}
+
+	/**
+	 * See LaneDitherShift().
+	 */
+	template<unsigned SBITS, unsigned DBITS>
+	TARGET_AVX2
+	__m256i Shift(__m256i sample) noexcept {
+		constexpr unsigned scale_bits = SBITS - DBITS;
+		const __m256i min = _mm256_set1_epi32(-(1 << (SBITS - 1)));
+		const __m256i max = _mm256_set1_epi32((1 << (SBITS - 1)) - 1);
+		const __m256i mask = _mm256_set1_epi32((1 << scale_bits) - 1);
+
+		sample = _mm256_add_epi32(sample,
+					  _mm256_add_epi32(_mm256_sub_epi32(e0, e1),
+							   e2));
+
+		e2 = e1;
+		e1 = _mm256_srai_epi32(_mm256_add_epi32(e0, _mm256_srli_epi32(e0, 31)),
+				       1);
+
+		__m256i output = _mm256_add_epi32(sample,
+						  _mm256_set1_epi32(1 << (scale_bits - 1)));
+
+		const __m256i rnd =
+			_mm256_add_epi32(_mm256_mullo_epi32(random,
+							    _mm256_set1_epi32(PRNG_MUL)),
+					 _mm256_set1_epi32(PRNG_ADD));
+		output = _mm256_add_epi32(output,
+					  _mm256_sub_epi32(_mm256_and_si256(rnd, mask),
+							   _mm256_and_si256(random, mask)));
+		random = rnd;
+
+		const __m256i above = _mm256_cmpgt_epi32(output, max);
+		const __m256i below = _mm256_cmpgt_epi32(min, output);
+		sample = _mm256_blendv_epi8(sample,
+					    _mm256_min_epi32(sample, max),
+					    above);
+		sample = _mm256_blendv_epi8(sample,
+					    _mm256_max_epi32(sample, min),
+					    below);
+		output = _mm256_min_epi32(_mm256_max_epi32(output, min), max);
+
+		output = _mm256_andnot_si256(mask, output);
+
+		e0 = _mm256_sub_epi32(sample, output);
+
+		return _mm256_srai_epi32(output, scale_bits);
+	}
+};
+
+/**
+ * Arithmetic right shift of 64 bit integers, which AVX2 lacks.
+ */
+template<int bits>
+TARGET_AVX2
+static inline __m256i
+Avx2Srai64(__m256i v) noexcept
+{
+	const __m256i sign = _mm256_cmpgt_epi64(_mm256_setzero_si256(), v);
+	return _mm256_xor_si256(_mm256_srli_epi64(_mm256_xor_si256(v, sign),
+						  bits),
+				sign);
+}
+
+/**
+ * Load 4 signed 32 bit integers and sign-extend them to 64 bit.
+ */
+TARGET_AVX2
+static inline __m256i
+Avx2LoadS32ToS64(const int32_t *p) noexcept
+{
+	return _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i *)p));
+}
+
+/**
+ * Store the lower 32 bits of 4 64 bit integers.
+ */
+TARGET_AVX2
+static inline void
+Avx2StoreS64ToS32(int32_t *p, __m256i v) noexcept
+{
+	const __m256i even = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+	_mm_storeu_si128((__m128i *)p,
+			 _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(v, even)));
+}
+
+/**
+ * Dither state of 4 lanes with 64 bit arithmetic.  The errors are
+ * stored as 32 bit integers, just like LaneDitherShift() does.
+ */
+struct Avx2Dither64 {
+	__m256i e0, e1, e2, random;
+
+	TARGET_AVX2
+	void Load(const PcmDither::Lanes &d, unsigned lane) noexcept {
+		e0 = Avx2LoadS32ToS64(d.error[0] + lane);
+		e1 = Avx2LoadS32ToS64(d.error[1] + lane);
+		e2 = Avx2LoadS32ToS64(d.error[2] + lane);
+		random = _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i *)(d.random + lane)));
+	}
+
+	TARGET_AVX2
+	void Store(PcmDither::Lanes &d, unsigned lane) const noexcept {
+		Avx2StoreS64ToS32(d.error[0] + lane, e0);
+		Avx2StoreS64ToS32(d.error[1] + lane, e1);
+		Avx2StoreS64ToS32(d.error[2] + lane, e2);
+		Avx2StoreS64ToS32((int32_t *)(d.random + lane), random);
+	}
+
+	/**
+	 * See LaneDitherShift().  Only the lower 32 bits of the
+	 * return value are valid.
+	 */
+	template<unsigned SBITS, unsigned DBITS>
+	TARGET_AVX2
+	__m256i Shift(__m256i sample) noexcept {
+		constexpr unsigned scale_bits = SBITS - DBITS;
+		const __m256i min = _mm256_set1_epi64x(-(int64_t(1) << (SBITS - 1)));
+		const __m256i max = _mm256_set1_epi64x((int64_t(1) << (SBITS - 1)) - 1);
+		const __m256i mask = _mm256_set1_epi64x((1 << scale_bits) - 1);
+
+		sample = _mm256_add_epi64(sample,
+					  _mm256_add_epi64(_mm256_sub_epi64(e0, e1),
+							   e2));
+
+		e2 = e1;
+		e1 = Avx2Srai64<1>(_mm256_add_epi64(e0, _mm256_srli_epi64(e0, 63)));
+
+		__m256i output = _mm256_add_epi64(sample,
+						  _mm256_set1_epi64x(1 << (scale_bits - 1)));
+
+		/* the random numbers are zero-extended 32 bit
+		   integers */
+		const __m256i rnd =
+			_mm256_and_si256(_mm256_add_epi64(_mm256_mul_epu32(random,
+									   _mm256_set1_epi64x(PRNG_MUL)),
+							  _mm256_set1_epi64x(PRNG_ADD)),
+					 _mm256_set1_epi64x(0xffffffff));
+		output = _mm256_add_epi64(output,
+					  _mm256_sub_epi64(_mm256_and_si256(rnd, mask),
+							   _mm256_and_si256(random, mask)));
+		random = rnd;
+
+		const __m256i above = _mm256_cmpgt_epi64(output, max);
+		const __m256i below = _mm256_cmpgt_epi64(min, output);
+		sample = _mm256_blendv_epi8(sample, max,
+					    _mm256_and_si256(above,
+							     _mm256_cmpgt_epi64(sample, max)));
+		sample = _mm256_blendv_epi8(sample, min,
+					    _mm256_and_si256(below,
+							     _mm256_cmpgt_epi64(min, sample)));
+		output = _mm256_blendv_epi8(output, max, above);
+		output = _mm256_blendv_epi8(output, min, below);
+
+		output = _mm256_andnot_si256(mask, output);
+
+		e0 = _mm256_sub_epi64(sample, output);
+
+		/* the result fits in 32 bits, therefore a logical
+		   shift is good enough */
+		return _mm256_srli_epi64(output, scale_bits);
+	}
+};
+
+TARGET_AVX2
+static void
+Avx2VolumeS16(PcmDither::Lanes &dither,
+	      int16_t *dest, const int16_t *src, size_t n,
+	      int volume) noexcept
+{
+	const __m256i v = _mm256_set1_epi32(volume);
+
+	Avx2Dither32 d;
+	d.Load(dither);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m256i x =
+			_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(src + i)));
+		const __m256i y =
+			d.Shift<16 + PCM_VOLUME_BITS, 16>(_mm256_mullo_epi32(x, v));
+
+		_mm_storeu_si128((__m128i *)(dest + i),
+				 _mm_packs_epi32(_mm256_castsi256_si128(y),
+						 _mm256_extracti128_si256(y, 1)));
+	}
+
+	d.Store(dither);
+
+	GenericVolumeS16(dither, dest + i, src + i, n - i, volume);
+}
+
+TARGET_AVX2
+static void
+Avx2AddVolumeS16(PcmDither::Lanes &dither,
+		 int16_t *a, const int16_t *b, size_t n,
+		 int volume1, int volume2) noexcept
+{
+	const __m256i v1 = _mm256_set1_epi32(volume1);
+	const __m256i v2 = _mm256_set1_epi32(volume2);
+
+	Avx2Dither32 d;
+	d.Load(dither);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m256i xa =
+			_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(a + i)));
+		const __m256i xb =
+			_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(b + i)));
+		const __m256i x = _mm256_add_epi32(_mm256_mullo_epi32(xa, v1),
+						   _mm256_mullo_epi32(xb, v2));
+		const __m256i y = d.Shift<16 + PCM_VOLUME_BITS, 16>(x);
+
+		_mm_storeu_si128((__m128i *)(a + i),
+				 _mm_packs_epi32(_mm256_castsi256_si128(y),
+						 _mm256_extracti128_si256(y, 1)));
+	}
+
+	d.Store(dither);
+
+	GenericAddVolumeS16(dither, a + i, b + i, n - i, volume1, volume2);
+}
+
+TARGET_AVX2
+static void
+Avx2VolumeS16ToS24(int32_t *dest, const int16_t *src, size_t n,
+		   int volume) noexcept
+{
+	const __m256i v = _mm256_set1_epi32(volume);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m256i x =
+			_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(src + i)));
+		_mm256_storeu_si256((__m256i *)(dest + i),
+				    _mm256_srai_epi32(_mm256_mullo_epi32(x, v), 2));
+	}
+
+	GenericVolumeS16ToS24(dest + i, src + i, n - i, volume);
+}
+
+template<unsigned BITS>
+TARGET_AVX2
+static void
+Avx2Volume32(PcmDither::Lanes &dither,
+	     int32_t *dest, const int32_t *src, size_t n,
+	     int volume) noexcept
+{
+	const __m256i v = _mm256_set1_epi64x(volume);
+
+	Avx2Dither64 d0, d1;
+	d0.Load(dither, 0);
+	d1.Load(dither, 4);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m256i x0 = _mm256_mul_epi32(Avx2LoadS32ToS64(src + i), v);
+		const __m256i x1 = _mm256_mul_epi32(Avx2LoadS32ToS64(src + i + 4), v);
+
+		Avx2StoreS64ToS32(dest + i,
+				  d0.Shift<BITS + PCM_VOLUME_BITS, BITS>(x0));
+		Avx2StoreS64ToS32(dest + i + 4,
+				  d1.Shift<BITS + PCM_VOLUME_BITS, BITS>(x1));
+	}
+
+	d0.Store(dither, 0);
+	d1.Store(dither, 4);
+
+	(BITS == 24
+	 ? GenericVolumeS24
+	 : GenericVolumeS32)(dither, dest + i, src + i, n - i, volume);
+}
+
+template<unsigned BITS>
+TARGET_AVX2
+static void
+Avx2AddVolume32(PcmDither::Lanes &dither,
+		int32_t *a, const int32_t *b, size_t n,
+		int volume1, int volume2) noexcept
+{
+	const __m256i v1 = _mm256_set1_epi64x(volume1);
+	const __m256i v2 = _mm256_set1_epi64x(volume2);
+
+	Avx2Dither64 d0, d1;
+	d0.Load(dither, 0);
+	d1.Load(dither, 4);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m256i x0 =
+			_mm256_add_epi64(_mm256_mul_epi32(Avx2LoadS32ToS64(a + i), v1),
+					 _mm256_mul_epi32(Avx2LoadS32ToS64(b + i), v2));
+		const __m256i x1 =
+			_mm256_add_epi64(_mm256_mul_epi32(Avx2LoadS32ToS64(a + i + 4), v1),
+					 _mm256_mul_epi32(Avx2LoadS32ToS64(b + i + 4), v2));
+
+		Avx2StoreS64ToS32(a + i,
+				  d0.Shift<BITS + PCM_VOLUME_BITS, BITS>(x0));
+		Avx2StoreS64ToS32(a + i + 4,
+				  d1.Shift<BITS + PCM_VOLUME_BITS, BITS>(x1));
+	}
+
+	d0.Store(dither, 0);
+	d1.Store(dither, 4);
+
+	(BITS == 24
+	 ? GenericAddVolumeS24
+	 : GenericAddVolumeS32)(dither, a + i, b + i, n - i,
+				volume1, volume2);
+}
+
+TARGET_AVX2
+static void
+Avx2VolumeFloat(float *dest, const float *src, size_t n,
+		float volume) noexcept
+{
+	const __m256 v = _mm256_set1_ps(volume);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+		_mm256_storeu_ps(dest + i,
+				 _mm256_mul_ps(_mm256_loadu_ps(src + i), v));
+
+	GenericVolumeFloat(dest + i, src + i, n - i, volume);
+}
+
+TARGET_AVX2
+static void
+Avx2AddVolumeFloat(float *a, const float *b, size_t n,
+		   float volume1, float volume2) noexcept
+{
+	const __m256 v1 = _mm256_set1_ps(volume1);
+	const __m256 v2 = _mm256_set1_ps(volume2);
+
+	/* no FMA here, to get the same results as the other
+	   kernels */
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+		_mm256_storeu_ps(a + i,
+				 _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(a + i), v1),
+					       _mm256_mul_ps(_mm256_loadu_ps(b + i), v2)));
+
+	GenericAddVolumeFloat(a + i, b + i, n - i, volume1, volume2);
+}
+
+const PcmVolumeKernels pcm_volume_kernels_avx2 = {
+	"avx2",
+	Avx2VolumeS16,
+	Avx2VolumeS16ToS24,
+	Avx2Volume32<24>,
+	Avx2Volume32<32>,
+	Avx2VolumeFloat,
+	Avx2AddVolumeS16,
+	Avx2AddVolume32<24>,
+	Avx2AddVolume32<32>,
+	Avx2AddVolumeFloat,
+};
+
+#endif
@@ -121,6 +121,12 @@ class PlayerControl final : public AudioOutputClient {
 
 	const unsigned buffer_chunks;
 
+	/**
+	 * The size of each #MusicChunk including its header, see
+	 * "audio_buffer_chunk_size".
+	 */
+	const size_t chunk_size;
+
 	/**
 	 * The "audio_output_format" setting.
 	 */
@@ -239,6 +245,7 @@ public:
 		      PlayerOutputs &_outputs,
 		      InputCacheManager *_input_cache,
 		      unsigned buffer_chunks,
+		      size_t chunk_size,
 		      AudioFormat _configured_audio_format,
 		      const ReplayGainConfig &_replay_gain_config) noexcept;
 	~PlayerControl() noexcept;
@@ -23,6 +23,8 @@
 #include "Chrono.hxx"
 #include "util/Compiler.h"
 
+#include <stddef.h>
+
 struct AudioFormat;
 class SignedSongTime;
 
@@ -57,6 +59,7 @@ struct CrossFadeSettings {
 	 * @param mixramp_prev_end the last songs mixramp_end setting
 	 * @param af the audio format of the new song
 	 * @param old_format the audio format of the current song
+	 * @param chunk_capacity the number of data bytes in each chunk
 	 * @param max_chunks the maximum number of chunks
 	 * @return the number of chunks for crossfading, or 0 if cross fading
 	 * should be disabled for this song change
@@ -67,6 +70,7 @@ struct CrossFadeSettings {
 			   const char *mixramp_start,
 			   const char *mixramp_prev_end,
 			   AudioFormat af, AudioFormat old_format,
+			   size_t chunk_capacity,
 			   unsigned max_chunks) const noexcept;
 };
 
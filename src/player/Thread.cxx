@@ -529,9 +529,10 @@ Player::CheckDecoderStartup(std::unique_lock<Mutex> &lock) noexcept
 
 		const size_t buffer_before_play_size =
 			play_audio_format.TimeToSize(buffer_before_play_duration);
+		const size_t chunk_capacity = buffer.GetChunkCapacity();
 		buffer_before_play =
-			(buffer_before_play_size + sizeof(MusicChunk::data) - 1)
-			/ sizeof(MusicChunk::data);
+			(buffer_before_play_size + chunk_capacity - 1)
+			/ chunk_capacity;
 
 		idle_add(IDLE_PLAYER);
 
@@ -1039,6 +1040,7 @@ Player::Run() noexcept
 							dc.GetMixRampPreviousEnd(),
 							dc.out_audio_format,
 							play_audio_format,
+							buffer.GetChunkCapacity(),
 							buffer.GetSize() -
 							buffer_before_play);
 			if (cross_fade_chunks > 0)
@@ -1151,7 +1153,7 @@ try {
 			  replay_gain_config);
 	dc.StartThread();
 
-	MusicBuffer buffer(buffer_chunks);
+	MusicBuffer buffer(buffer_chunks, chunk_size);
 
 	std::unique_lock<Mutex> lock(mutex);
 
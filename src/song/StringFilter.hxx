@@ -94,6 +94,15 @@ public:
 		negated = !negated;
 	}
 
+	/**
+	 * Does this filter match only strings which are equal to
+	 * GetValue() (i.e. no case folding, no substring, no regular
+	 * expression and not negated)?
+	 */
+	bool IsExactMatch() const noexcept {
+		return !fold_case && !substring && !negated && !IsRegex();
+	}
+
 	const char *GetOperator() const noexcept {
 		return IsRegex()
 			? (negated ? "!~" : "=~")
@@ -58,6 +58,10 @@ public:
 		filter.ToggleNegated();
 	}
 
+	bool IsExactMatch() const noexcept {
+		return filter.IsExactMatch();
+	}
+
 	ISongFilterPtr Clone() const noexcept override {
 		return std::make_unique<TagSongFilter>(*this);
 	}
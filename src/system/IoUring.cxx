@@ -0,0 +1,215 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "IoUring.hxx"
+#include "Error.hxx"
+
+#include <stdexcept>
+
+#include <assert.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+template<typename T>
+static T *
+AtOffset(void *base, size_t offset) noexcept
+{
+	return (T *)((char *)base + offset);
+}
+
+static void *
+MapRing(int fd, size_t size, off_t offset)
+{
+	void *p = mmap(nullptr, size, PROT_READ|PROT_WRITE,
+		       MAP_SHARED|MAP_POPULATE, fd, offset);
+	if (p == MAP_FAILED)
+		throw MakeErrno("Failed to map io_uring");
+
+	return p;
+}
+
+IoUring::IoUring(unsigned entries, unsigned cq_entries)
+{
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+
+	if (cq_entries > 0) {
+		params.flags |= IORING_SETUP_CQSIZE;
+		params.cq_entries = cq_entries;
+	}
+
+	fd = UniqueFileDescriptor(syscall(__NR_io_uring_setup,
+					  entries, &params));
+	if (!fd.IsDefined())
+		throw MakeErrno("io_uring_setup() failed");
+
+	/* Wait() needs IORING_ENTER_EXT_ARG (Linux 5.11) to pass
+	   a timeout */
+	if ((params.features & IORING_FEAT_EXT_ARG) == 0)
+		throw std::runtime_error("io_uring is too old (Linux 5.11 required)");
+
+	sq_ring_size = params.sq_off.array +
+		params.sq_entries * sizeof(unsigned);
+	cq_ring_size = params.cq_off.cqes +
+		params.cq_entries * sizeof(struct io_uring_cqe);
+
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		if (cq_ring_size > sq_ring_size)
+			sq_ring_size = cq_ring_size;
+		cq_ring_size = 0;
+	}
+
+	sq_ring = MapRing(fd.Get(), sq_ring_size, IORING_OFF_SQ_RING);
+
+	if (cq_ring_size > 0) {
+		try {
+			cq_ring = MapRing(fd.Get(), cq_ring_size,
+					  IORING_OFF_CQ_RING);
+		} catch (...) {
+			munmap(sq_ring, sq_ring_size);
+			throw;
+		}
+	} else
+		cq_ring = sq_ring;
+
+	sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	try {
+		sqes = (struct io_uring_sqe *)
+			MapRing(fd.Get(), sqes_size, IORING_OFF_SQES);
+	} catch (...) {
+		if (cq_ring != sq_ring)
+			munmap(cq_ring, cq_ring_size);
+		munmap(sq_ring, sq_ring_size);
+		throw;
+	}
+
+	sq_head = AtOffset<unsigned>(sq_ring, params.sq_off.head);
+	sq_tail = AtOffset<unsigned>(sq_ring, params.sq_off.tail);
+	sq_array = AtOffset<unsigned>(sq_ring, params.sq_off.array);
+	sq_mask = *AtOffset<unsigned>(sq_ring, params.sq_off.ring_mask);
+	sq_entries = params.sq_entries;
+
+	cq_head = AtOffset<unsigned>(cq_ring, params.cq_off.head);
+	cq_tail = AtOffset<unsigned>(cq_ring, params.cq_off.tail);
+	cq_mask = *AtOffset<unsigned>(cq_ring, params.cq_off.ring_mask);
+	cqes = AtOffset<struct io_uring_cqe>(cq_ring, params.cq_off.cqes);
+
+	sqe_tail = *sq_tail;
+}
+
+IoUring::~IoUring() noexcept
+{
+	munmap(sqes, sqes_size);
+	if (cq_ring != sq_ring)
+		munmap(cq_ring, cq_ring_size);
+	munmap(sq_ring, sq_ring_size);
+}
+
+struct io_uring_sqe *
+IoUring::GetSqe() noexcept
+{
+	const unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+	if (sqe_tail - head >= sq_entries)
+		return nullptr;
+
+	auto *sqe = &sqes[sqe_tail & sq_mask];
+	memset(sqe, 0, sizeof(*sqe));
+	++sqe_tail;
+	return sqe;
+}
+
+unsigned
+IoUring::FlushSq() noexcept
+{
+	unsigned tail = *sq_tail;
+	if (tail != sqe_tail) {
+		for (; tail != sqe_tail; ++tail)
+			sq_array[tail & sq_mask] = tail & sq_mask;
+
+		__atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+	}
+
+	return tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+}
+
+int
+IoUring::Enter(unsigned to_submit, unsigned min_complete, unsigned flags,
+	       const void *arg, size_t arg_size) noexcept
+{
+	int result = syscall(__NR_io_uring_enter, fd.Get(),
+			     to_submit, min_complete, flags,
+			     arg, arg_size);
+	return result < 0 ? -errno : result;
+}
+
+int
+IoUring::Submit() noexcept
+{
+	const unsigned n = FlushSq();
+	if (n == 0)
+		return 0;
+
+	return Enter(n, 0, 0, nullptr, 0);
+}
+
+int
+IoUring::Wait(int timeout_ms) noexcept
+{
+	const unsigned n = FlushSq();
+
+	if (timeout_ms == 0)
+		return n > 0 ? Enter(n, 0, 0, nullptr, 0) : 0;
+
+	struct __kernel_timespec ts;
+	struct io_uring_getevents_arg arg;
+	memset(&arg, 0, sizeof(arg));
+	arg.sigmask_sz = _NSIG / 8;
+
+	if (timeout_ms > 0) {
+		ts.tv_sec = timeout_ms / 1000;
+		ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+		arg.ts = (uint64_t)(uintptr_t)&ts;
+	}
+
+	int result = Enter(n, 1, IORING_ENTER_GETEVENTS|IORING_ENTER_EXT_ARG,
+			   &arg, sizeof(arg));
+	if (result == -ETIME)
+		/* the timeout has expired; that is not an error */
+		result = 0;
+
+	return result;
+}
+
+void
+IoUring::Poll(int timeout_ms) noexcept
+{
+	struct pollfd pfd;
+	pfd.fd = fd.Get();
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+
+	poll(&pfd, 1, timeout_ms);
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_IO_URING_HXX
+#define MPD_IO_URING_HXX
+
+#include "UniqueFileDescriptor.hxx"
+
+#include <linux/io_uring.h>
+
+#include <stddef.h>
+
+/**
+ * A minimal wrapper for a Linux io_uring instance, talking to the
+ * kernel directly (without liburing).  It provides just what
+ * #PollGroupUring needs: queueing submissions and reaping
+ * completions.
+ *
+ * This class is not thread-safe.
+ */
+class IoUring {
+	UniqueFileDescriptor fd;
+
+	void *sq_ring, *cq_ring;
+	size_t sq_ring_size, cq_ring_size;
+
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+
+	unsigned *sq_head, *sq_tail, *sq_array;
+	unsigned sq_mask, sq_entries;
+
+	unsigned *cq_head, *cq_tail;
+	unsigned cq_mask;
+	struct io_uring_cqe *cqes;
+
+	/**
+	 * The tail of submissions which have been obtained with
+	 * GetSqe(), but have not yet been passed to the kernel.
+	 */
+	unsigned sqe_tail;
+
+public:
+	/**
+	 * Throws on error (e.g. if the kernel does not support
+	 * io_uring or if it is too old).
+	 *
+	 * @param entries the size of the submission queue
+	 * @param cq_entries the size of the completion queue; 0 for
+	 * the kernel's default (twice the submission queue)
+	 */
+	explicit IoUring(unsigned entries, unsigned cq_entries=0);
+
+	~IoUring() noexcept;
+
+	IoUring(const IoUring &) = delete;
+	IoUring &operator=(const IoUring &) = delete;
+
+	/**
+	 * Obtain a submission queue entry.  It is zeroed; the caller
+	 * fills it, and it will be passed to the kernel by the next
+	 * Submit() or Wait() call.
+	 *
+	 * @return nullptr if the submission queue is full (call
+	 * Submit() and try again)
+	 */
+	struct io_uring_sqe *GetSqe() noexcept;
+
+	/**
+	 * Pass all queued submissions to the kernel without waiting
+	 * for completions.
+	 *
+	 * @return the number of submitted entries or a negative
+	 * errno value (see Wait())
+	 */
+	int Submit() noexcept;
+
+	/**
+	 * Pass all queued submissions to the kernel and wait until
+	 * at least one completion is available, or until the timeout
+	 * expires.  Both is done with only one system call.
+	 *
+	 * @param timeout_ms the timeout in milliseconds; a negative
+	 * value means no timeout, zero means do not wait
+	 * @return a non-negative value on success (also if the
+	 * timeout has expired) or a negative errno value; -EINTR
+	 * means a signal has interrupted the wait, and -EBUSY means
+	 * the completion queue has overflowed and must be consumed
+	 * before the kernel accepts more submissions
+	 */
+	int Wait(int timeout_ms) noexcept;
+
+	/**
+	 * Wait until the completion queue becomes non-empty, using
+	 * poll() instead of io_uring_enter().  This is a fallback
+	 * for when Wait() fails.
+	 */
+	void Poll(int timeout_ms) noexcept;
+
+	/**
+	 * Returns the oldest completion or nullptr if there is none.
+	 * It must be released with SeenCqe() before the next one can
+	 * be obtained.
+	 */
+	const struct io_uring_cqe *PeekCqe() const noexcept {
+		const unsigned head = *cq_head;
+		if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))
+			return nullptr;
+
+		return &cqes[head & cq_mask];
+	}
+
+	void SeenCqe() noexcept {
+		__atomic_store_n(cq_head, *cq_head + 1, __ATOMIC_RELEASE);
+	}
+
+private:
+	/**
+	 * Publish the queued submissions to the kernel.
+	 *
+	 * @return the number of entries which the kernel has not yet
+	 * consumed
+	 */
+	unsigned FlushSq() noexcept;
+
+	int Enter(unsigned to_submit, unsigned min_complete, unsigned flags,
+		  const void *arg, size_t arg_size) noexcept;
+};
+
+#endif
@@ -36,8 +36,6 @@ TagBuilder::TagBuilder(const Tag &other) noexcept
 {
 	items.reserve(other.num_items);
 
-	const std::lock_guard<Mutex> protect(tag_pool_lock);
-
 	for (unsigned i = 0, n = other.num_items; i != n; ++i)
 		items.push_back(tag_pool_dup_item(other.items[i]));
 }
@@ -66,7 +64,6 @@ TagBuilder::operator=(const TagBuilder &other) noexcept
 	items = other.items;
 
 	/* increment the tag pool refcounters */
-	const std::lock_guard<Mutex> protect(tag_pool_lock);
 	for (auto i : items)
 		tag_pool_dup_item(i);
 
@@ -178,7 +175,6 @@ TagBuilder::Complement(const Tag &other) noexcept
 
 	items.reserve(items.size() + other.num_items);
 
-	const std::lock_guard<Mutex> protect(tag_pool_lock);
 	for (unsigned i = 0, n = other.num_items; i != n; ++i) {
 		TagItem *item = other.items[i];
 		if (!present[item->type])
@@ -189,14 +185,7 @@ TagBuilder::Complement(const Tag &other) noexcept
 void
 TagBuilder::AddItemUnchecked(TagType type, StringView value) noexcept
 {
-	TagItem *i;
-
-	{
-		const std::lock_guard<Mutex> protect(tag_pool_lock);
-		i = tag_pool_get_item(type, value);
-	}
-
-	items.push_back(i);
+	items.push_back(tag_pool_get_item(type, value));
 }
 
 inline void
@@ -242,11 +231,8 @@ TagBuilder::AddEmptyItem(TagType type) noexcept
 void
 TagBuilder::RemoveAll() noexcept
 {
-	{
-		const std::lock_guard<Mutex> protect(tag_pool_lock);
-		for (auto i : items)
-			tag_pool_put_item(i);
-	}
+	for (auto i : items)
+		tag_pool_put_item(i);
 
 	items.clear();
 }
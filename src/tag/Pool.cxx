@@ -19,75 +19,137 @@
 
 #include "Pool.hxx"
 #include "Item.hxx"
+#include "thread/Mutex.hxx"
 #include "util/Cast.hxx"
 #include "util/VarSize.hxx"
 #include "util/StringView.hxx"
 
+#include <algorithm>
 #include <limits>
+#include <memory>
+#include <mutex>
 
 #include <assert.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdint.h>
 
-Mutex tag_pool_lock;
+/**
+ * The number of bits of the hash which select the stripe.
+ */
+static constexpr unsigned STRIPE_BITS = 4;
+
+static constexpr unsigned NUM_STRIPES = 1u << STRIPE_BITS;
 
-static constexpr size_t NUM_SLOTS = 4093;
+/**
+ * The initial number of hash buckets in each stripe; the table
+ * doubles its size whenever the number of items exceeds the number
+ * of buckets.
+ */
+static constexpr size_t INITIAL_BUCKETS = 256;
 
 struct TagPoolSlot {
 	TagPoolSlot *next;
-	uint8_t ref = 1;
+
+	/**
+	 * The hash of the type and value, which avoids recalculating
+	 * it when growing the table or removing this slot.
+	 */
+	const uint32_t hash;
+
+	uint32_t ref = 1;
+
 	TagItem item;
 
 	static constexpr unsigned MAX_REF = std::numeric_limits<decltype(ref)>::max();
 
-	TagPoolSlot(TagPoolSlot *_next, TagType type,
+	TagPoolSlot(TagPoolSlot *_next, uint32_t _hash, TagType type,
 		    StringView value) noexcept
-		:next(_next) {
+		:next(_next), hash(_hash) {
 		item.type = type;
 		memcpy(item.value, value.data, value.size);
 		item.value[value.size] = 0;
 	}
 
-	static TagPoolSlot *Create(TagPoolSlot *_next, TagType type,
-				   StringView value) noexcept;
+	static TagPoolSlot *Create(TagPoolSlot *_next, uint32_t _hash,
+				   TagType type, StringView value) noexcept;
+
+	/**
+	 * The number of bytes allocated for this object.
+	 */
+	gcc_pure
+	size_t GetAllocatedSize() const noexcept {
+		return sizeof(*this) - sizeof(item.value) +
+			strlen(item.value) + 1;
+	}
 };
 
 TagPoolSlot *
-TagPoolSlot::Create(TagPoolSlot *_next, TagType type,
-		    StringView value) noexcept
+TagPoolSlot::Create(TagPoolSlot *_next, uint32_t _hash,
+		    TagType type, StringView value) noexcept
 {
 	TagPoolSlot *dummy;
 	return NewVarSize<TagPoolSlot>(sizeof(dummy->item.value),
 				       value.size + 1,
-				       _next, type,
+				       _next, _hash, type,
 				       value);
 }
 
-static TagPoolSlot *slots[NUM_SLOTS];
+/**
+ * A part of the pool with its own lock and hash table.  The stripe
+ * of an item is determined by the upper bits of its hash, and the
+ * bucket within the stripe by the lower bits.
+ */
+struct alignas(64) TagPoolStripe {
+	Mutex mutex;
+
+	std::unique_ptr<TagPoolSlot *[]> buckets;
+
+	/**
+	 * The number of buckets minus one (the number of buckets is
+	 * always a power of two).  Only valid if #buckets is set.
+	 */
+	size_t mask = 0;
+
+	size_t n_items = 0;
+
+	TagPoolSlot **GetBucket(uint32_t hash) noexcept {
+		return &buckets[hash & mask];
+	}
+
+	TagItem *Get(uint32_t hash, TagType type, StringView value) noexcept;
+	TagItem *Dup(TagPoolSlot &slot) noexcept;
+	void Put(TagPoolSlot &slot) noexcept;
+
+	void Grow() noexcept;
+
+	void CollectStats(TagPoolStats &stats) noexcept;
+};
+
+static TagPoolStripe stripes[NUM_STRIPES];
 
-static inline unsigned
+/**
+ * Calculate the 32 bit FNV-1a hash of the type and the value.  It
+ * distributes similar strings much better than the djb2 hash used
+ * previously.
+ */
+static inline uint32_t
 calc_hash(TagType type, StringView p) noexcept
 {
-	unsigned hash = 5381;
+	uint32_t hash = 2166136261u;
+
+	hash = (hash ^ uint8_t(type)) * 16777619u;
 
 	for (auto ch : p)
-		hash = (hash << 5) + hash + ch;
+		hash = (hash ^ uint8_t(ch)) * 16777619u;
 
-	return hash ^ type;
+	return hash;
 }
 
-static inline unsigned
-calc_hash(TagType type, const char *p) noexcept
+static inline TagPoolStripe &
+GetStripe(uint32_t hash) noexcept
 {
-	unsigned hash = 5381;
-
-	assert(p != nullptr);
-
-	while (*p != 0)
-		hash = (hash << 5) + hash + *p++;
-
-	return hash ^ type;
+	return stripes[hash >> (32 - STRIPE_BITS)];
 }
 
 static constexpr TagPoolSlot *
@@ -96,73 +158,159 @@ tag_item_to_slot(TagItem *item) noexcept
 	return &ContainerCast(*item, &TagPoolSlot::item);
 }
 
-static inline TagPoolSlot **
-tag_value_slot_p(TagType type, StringView value) noexcept
+void
+TagPoolStripe::Grow() noexcept
 {
-	return &slots[calc_hash(type, value) % NUM_SLOTS];
-}
+	const size_t old_n_buckets = buckets != nullptr ? mask + 1 : 0;
+	const size_t n_buckets = old_n_buckets > 0
+		? old_n_buckets * 2
+		: INITIAL_BUCKETS;
 
-static inline TagPoolSlot **
-tag_value_slot_p(TagType type, const char *value) noexcept
-{
-	return &slots[calc_hash(type, value) % NUM_SLOTS];
+	const auto old_buckets = std::move(buckets);
+	buckets.reset(new TagPoolSlot *[n_buckets]());
+	mask = n_buckets - 1;
+
+	for (size_t i = 0; i < old_n_buckets; ++i) {
+		for (auto slot = old_buckets[i]; slot != nullptr;) {
+			auto next = slot->next;
+			auto bucket = GetBucket(slot->hash);
+			slot->next = *bucket;
+			*bucket = slot;
+			slot = next;
+		}
+	}
 }
 
-TagItem *
-tag_pool_get_item(TagType type, StringView value) noexcept
+inline TagItem *
+TagPoolStripe::Get(uint32_t hash, TagType type, StringView value) noexcept
 {
-	auto slot_p = tag_value_slot_p(type, value);
-	for (auto slot = *slot_p; slot != nullptr; slot = slot->next) {
-		if (slot->item.type == type &&
-		    value.Equals(slot->item.value) &&
-		    slot->ref < TagPoolSlot::MAX_REF) {
-			assert(slot->ref > 0);
-			++slot->ref;
-			return &slot->item;
+	if (buckets != nullptr) {
+		for (auto slot = *GetBucket(hash); slot != nullptr;
+		     slot = slot->next) {
+			if (slot->hash == hash &&
+			    slot->item.type == type &&
+			    value.Equals(slot->item.value) &&
+			    slot->ref < TagPoolSlot::MAX_REF) {
+				assert(slot->ref > 0);
+				++slot->ref;
+				return &slot->item;
+			}
 		}
 	}
 
-	auto slot = TagPoolSlot::Create(*slot_p, type, value);
-	*slot_p = slot;
+	if (buckets == nullptr || n_items > mask)
+		Grow();
+
+	auto bucket = GetBucket(hash);
+	auto slot = TagPoolSlot::Create(*bucket, hash, type, value);
+	*bucket = slot;
+	++n_items;
 	return &slot->item;
 }
 
-TagItem *
-tag_pool_dup_item(TagItem *item) noexcept
+inline TagItem *
+TagPoolStripe::Dup(TagPoolSlot &slot) noexcept
 {
-	TagPoolSlot *slot = tag_item_to_slot(item);
+	assert(slot.ref > 0);
 
-	assert(slot->ref > 0);
-
-	if (slot->ref < TagPoolSlot::MAX_REF) {
-		++slot->ref;
-		return item;
+	if (slot.ref < TagPoolSlot::MAX_REF) {
+		++slot.ref;
+		return &slot.item;
 	} else {
 		/* the reference counter overflows above MAX_REF;
 		   obtain a reference to a different TagPoolSlot which
 		   isn't yet "full" */
-		return tag_pool_get_item(item->type, item->value);
+		return Get(slot.hash, slot.item.type, slot.item.value);
 	}
 }
 
-void
-tag_pool_put_item(TagItem *item) noexcept
+inline void
+TagPoolStripe::Put(TagPoolSlot &slot) noexcept
 {
-	TagPoolSlot **slot_p, *slot;
-
-	slot = tag_item_to_slot(item);
-	assert(slot->ref > 0);
-	--slot->ref;
+	assert(slot.ref > 0);
+	--slot.ref;
 
-	if (slot->ref > 0)
+	if (slot.ref > 0)
 		return;
 
-	for (slot_p = tag_value_slot_p(item->type, item->value);
-	     *slot_p != slot;
+	TagPoolSlot **slot_p;
+	for (slot_p = GetBucket(slot.hash);
+	     *slot_p != &slot;
 	     slot_p = &(*slot_p)->next) {
 		assert(*slot_p != nullptr);
 	}
 
-	*slot_p = slot->next;
-	DeleteVarSize(slot);
+	*slot_p = slot.next;
+	--n_items;
+	DeleteVarSize(&slot);
+}
+
+inline void
+TagPoolStripe::CollectStats(TagPoolStats &stats) noexcept
+{
+	const std::lock_guard<Mutex> protect(mutex);
+
+	if (buckets == nullptr)
+		return;
+
+	stats.buckets += mask + 1;
+
+	for (size_t i = 0; i <= mask; ++i) {
+		size_t chain_length = 0;
+
+		for (auto slot = buckets[i]; slot != nullptr;
+		     slot = slot->next) {
+			++chain_length;
+
+			const size_t size = slot->GetAllocatedSize();
+			++stats.items;
+			stats.references += slot->ref;
+			stats.bytes += size;
+			stats.bytes_saved += (slot->ref - 1) * size;
+		}
+
+		stats.max_chain_length = std::max(stats.max_chain_length,
+						  chain_length);
+	}
+}
+
+TagItem *
+tag_pool_get_item(TagType type, StringView value) noexcept
+{
+	const uint32_t hash = calc_hash(type, value);
+	auto &stripe = GetStripe(hash);
+
+	const std::lock_guard<Mutex> protect(stripe.mutex);
+	return stripe.Get(hash, type, value);
+}
+
+TagItem *
+tag_pool_dup_item(TagItem *item) noexcept
+{
+	TagPoolSlot &slot = *tag_item_to_slot(item);
+	auto &stripe = GetStripe(slot.hash);
+
+	const std::lock_guard<Mutex> protect(stripe.mutex);
+	return stripe.Dup(slot);
+}
+
+void
+tag_pool_put_item(TagItem *item) noexcept
+{
+	TagPoolSlot &slot = *tag_item_to_slot(item);
+	auto &stripe = GetStripe(slot.hash);
+
+	const std::lock_guard<Mutex> protect(stripe.mutex);
+	stripe.Put(slot);
+}
+
+TagPoolStats
+tag_pool_get_stats() noexcept
+{
+	TagPoolStats stats{};
+
+	for (auto &stripe : stripes)
+		stripe.CollectStats(stats);
+
+	return stats;
 }
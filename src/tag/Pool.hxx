@@ -21,13 +21,19 @@
 #define MPD_TAG_POOL_HXX
 
 #include "Type.h"
-#include "thread/Mutex.hxx"
 
-extern Mutex tag_pool_lock;
+#include <stddef.h>
 
 struct TagItem;
 struct StringView;
 
+/*
+ * The tag pool shares #TagItem objects with the same type and value.
+ * All functions are thread-safe; the pool is split into several
+ * independently locked stripes, so threads rarely wait for each
+ * other.
+ */
+
 TagItem *
 tag_pool_get_item(TagType type, StringView value) noexcept;
 
@@ -37,4 +43,44 @@ tag_pool_dup_item(TagItem *item) noexcept;
 void
 tag_pool_put_item(TagItem *item) noexcept;
 
+struct TagPoolStats {
+	/**
+	 * The number of distinct items in the pool.
+	 */
+	size_t items;
+
+	/**
+	 * The number of references to these items.
+	 */
+	size_t references;
+
+	/**
+	 * The number of bytes allocated for the items.
+	 */
+	size_t bytes;
+
+	/**
+	 * The number of bytes which would have been allocated
+	 * without the pool, minus #bytes.
+	 */
+	size_t bytes_saved;
+
+	/**
+	 * The number of hash table buckets.
+	 */
+	size_t buckets;
+
+	/**
+	 * The length of the longest hash chain.
+	 */
+	size_t max_chain_length;
+};
+
+/**
+ * Collect statistics about the tag pool.  This iterates over all
+ * items and is therefore rather expensive.
+ */
+TagPoolStats
+tag_pool_get_stats() noexcept;
+
 #endif
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "WorkerPool.hxx"
+#include "Name.hxx"
+
+#include <algorithm>
+
+#include <assert.h>
+
+WorkerPool::WorkerPool(const char *_name, unsigned n_threads) noexcept
+	:name(_name)
+{
+	for (unsigned i = 0; i < n_threads; ++i) {
+		threads.emplace_front(BIND_THIS_METHOD(ThreadFunc));
+
+		try {
+			threads.front().Start();
+		} catch (...) {
+			/* continue with the threads we have; the
+			   caller does the rest of the work */
+			threads.pop_front();
+			break;
+		}
+	}
+}
+
+WorkerPool::~WorkerPool() noexcept
+{
+	{
+		const std::lock_guard<Mutex> protect(mutex);
+		quit = true;
+		work_cond.notify_all();
+	}
+
+	for (auto &thread : threads)
+		thread.Join();
+}
+
+void
+WorkerPool::Run(Batch &batch) noexcept
+{
+	if (batch.n == 0)
+		return;
+
+	std::unique_lock<Mutex> lock(mutex);
+
+	if (!threads.empty()) {
+		queue.push_back(&batch);
+		work_cond.notify_all();
+	}
+
+	while (batch.next < batch.n) {
+		const unsigned i = batch.next++;
+		if (batch.next == batch.n && !threads.empty())
+			queue.erase(std::find(queue.begin(), queue.end(),
+					      &batch));
+
+		lock.unlock();
+		batch.function(batch.ctx, i);
+		lock.lock();
+
+		--batch.pending;
+	}
+
+	done_cond.wait(lock, [&batch]{ return batch.pending == 0; });
+}
+
+void
+WorkerPool::ThreadFunc() noexcept
+{
+	SetThreadName(name);
+
+	std::unique_lock<Mutex> lock(mutex);
+
+	while (true) {
+		work_cond.wait(lock, [this]{ return quit || !queue.empty(); });
+		if (quit)
+			break;
+
+		Batch &batch = *queue.front();
+		assert(batch.next < batch.n);
+
+		const unsigned i = batch.next++;
+		if (batch.next == batch.n)
+			queue.pop_front();
+
+		lock.unlock();
+		batch.function(batch.ctx, i);
+		lock.lock();
+
+		if (--batch.pending == 0)
+			done_cond.notify_all();
+	}
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_THREAD_WORKER_POOL_HXX
+#define MPD_THREAD_WORKER_POOL_HXX
+
+#include "Mutex.hxx"
+#include "Cond.hxx"
+#include "Thread.hxx"
+
+#include <forward_list>
+#include <list>
+
+/**
+ * A pool of threads which run the iterations of a loop in parallel.
+ * The calling thread does its share of the work, so without worker
+ * threads (e.g. on a single-core machine) everything runs serially
+ * in the caller.  Several threads may submit batches at the same
+ * time.
+ */
+class WorkerPool final {
+	struct Batch {
+		void (*function)(void *ctx, unsigned i) noexcept;
+		void *ctx;
+
+		const unsigned n;
+
+		/**
+		 * The next index which has not yet been started.
+		 * Protected by #mutex.
+		 */
+		unsigned next = 0;
+
+		/**
+		 * The number of indexes which have not yet finished.
+		 * Protected by #mutex.
+		 */
+		unsigned pending;
+
+		Batch(void (*_function)(void *, unsigned) noexcept,
+		      void *_ctx, unsigned _n) noexcept
+			:function(_function), ctx(_ctx), n(_n), pending(_n) {}
+	};
+
+	/**
+	 * The name of the worker threads; must be a string literal.
+	 */
+	const char *const name;
+
+	Mutex mutex;
+
+	/**
+	 * Signalled when a batch is submitted, or when the threads
+	 * shall quit.
+	 */
+	Cond work_cond;
+
+	/**
+	 * Signalled when a batch is finished.
+	 */
+	Cond done_cond;
+
+	/**
+	 * Batches which still have indexes which have not yet been
+	 * started.
+	 */
+	std::list<Batch *> queue;
+
+	bool quit = false;
+
+	std::forward_list<Thread> threads;
+
+public:
+	/**
+	 * Start the given number of threads.  If a thread cannot be
+	 * started, the pool continues with fewer threads.
+	 */
+	WorkerPool(const char *_name, unsigned n_threads) noexcept;
+
+	~WorkerPool() noexcept;
+
+	WorkerPool(const WorkerPool &) = delete;
+	WorkerPool &operator=(const WorkerPool &) = delete;
+
+	bool HasThreads() const noexcept {
+		return !threads.empty();
+	}
+
+	/**
+	 * Invoke f(i) for each i in [0, n) and return when all calls
+	 * have finished.  The calls may happen in parallel, in any
+	 * order.
+	 */
+	template<typename F>
+	void ForEach(unsigned n, F &f) noexcept {
+		Batch batch([](void *ctx, unsigned i) noexcept {
+				(*(F *)ctx)(i);
+			}, &f, n);
+		Run(batch);
+	}
+
+private:
+	void Run(Batch &batch) noexcept;
+
+	void ThreadFunc() noexcept;
+};
+
+#endif
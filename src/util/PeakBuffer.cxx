@@ -56,12 +56,32 @@ PeakBuffer::Read() const noexcept
 	return nullptr;
 }
 
+std::array<WritableBuffer<void>, 2>
+PeakBuffer::ReadAll() const noexcept
+{
+	std::array<WritableBuffer<void>, 2> result{nullptr, nullptr};
+
+	if (normal_buffer != nullptr)
+		result[0] = normal_buffer->Read().ToVoid();
+
+	if (peak_buffer != nullptr)
+		result[1] = peak_buffer->Read().ToVoid();
+
+	return result;
+}
+
 void
 PeakBuffer::Consume(size_t length) noexcept
 {
 	if (normal_buffer != nullptr && !normal_buffer->empty()) {
-		normal_buffer->Consume(length);
-		return;
+		const size_t available = normal_buffer->Read().size;
+		if (length <= available) {
+			normal_buffer->Consume(length);
+			return;
+		}
+
+		normal_buffer->Consume(available);
+		length -= available;
 	}
 
 	if (peak_buffer != nullptr && !peak_buffer->empty()) {
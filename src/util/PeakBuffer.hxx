@@ -22,6 +22,8 @@
 
 #include "Compiler.h"
 
+#include <array>
+
 #include <stddef.h>
 #include <stdint.h>
 
@@ -62,6 +64,18 @@ public:
 	gcc_pure
 	WritableBuffer<void> Read() const noexcept;
 
+	/**
+	 * Like Read(), but return both the normal and the peak
+	 * buffer, to allow writing both with one system call.  Each
+	 * of the two segments may be empty.
+	 */
+	gcc_pure
+	std::array<WritableBuffer<void>, 2> ReadAll() const noexcept;
+
+	/**
+	 * Consume data which was returned by Read() or ReadAll().
+	 * The length may span both segments returned by ReadAll().
+	 */
 	void Consume(size_t length) noexcept;
 
 	bool Append(const void *data, size_t length);
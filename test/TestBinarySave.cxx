@@ -0,0 +1,325 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Unit tests for the binary database format: a save/load round trip,
+ * and loading files with corrupt headers, records, offsets and
+ * duplicate directories.
+ */
+
+#include "db/plugins/simple/BinarySave.hxx"
+#include "db/plugins/simple/Directory.hxx"
+#include "db/plugins/simple/Song.hxx"
+#include "db/DatabaseLock.hxx"
+#include "tag/Builder.hxx"
+#include "util/StringBuffer.hxx"
+#include "fs/io/BufferedOutputStream.hxx"
+#include "fs/io/StringOutputStream.hxx"
+#include "util/ConstBuffer.hxx"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <string.h>
+
+/**
+ * Offsets of the first song's "format" and "channels" fields in a
+ * file created by MakeTree(): header (24 bytes), root directory (32
+ * bytes) and the first song's fields before them (32 bytes).
+ */
+static constexpr size_t FIRST_SONG_FORMAT = 24 + 32 + 32;
+static constexpr size_t FIRST_SONG_CHANNELS = FIRST_SONG_FORMAT + 1;
+
+static constexpr size_t TRAILER_SIZE = 40;
+
+static std::chrono::system_clock::time_point
+Time(unsigned t) noexcept
+{
+	return std::chrono::system_clock::from_time_t(t);
+}
+
+static void
+AddSong(Directory &directory, const char *name, const char *artist,
+	unsigned n)
+{
+	auto song = std::make_unique<Song>(name, directory);
+	song->mtime = Time(3000 + n);
+	song->audio_format = AudioFormat(44100, SampleFormat::S16, 2);
+
+	TagBuilder tag;
+	tag.SetDuration(SignedSongTime::FromMS(1000 * n));
+	tag.AddItem(TAG_ARTIST, artist);
+	tag.AddItem(TAG_TITLE, name);
+	song->tag = tag.Commit();
+
+	directory.AddSong(std::move(song));
+}
+
+/**
+ * Create a tree whose root contains one song (see
+ * #FIRST_SONG_FORMAT), and a few directories with shared tag values.
+ */
+static std::unique_ptr<Directory>
+MakeTree()
+{
+	std::unique_ptr<Directory> root(Directory::NewRoot());
+
+	const ScopeDatabaseLock protect;
+
+	AddSong(*root, "root.flac", "Foo", 1);
+
+	for (unsigned i = 0; i < 3; ++i) {
+		Directory &child =
+			*root->CreateChild(("dir" + std::to_string(i)).c_str());
+		child.mtime = Time(1000 + i);
+
+		AddSong(child, "a.flac", "Foo", 2);
+		AddSong(child, "b.flac", "Bar", 3);
+
+		auto song = std::make_unique<Song>("c.cue", child);
+		song->target = "c.flac";
+		song->start_time = SongTime::FromMS(1500);
+		song->end_time = SongTime::FromMS(9000);
+		child.AddSong(std::move(song));
+
+		child.playlists.push_back(PlaylistInfo("list.m3u", Time(2000)));
+
+		Directory &grandchild = *child.CreateChild("sub");
+		grandchild.mtime = Time(1100 + i);
+		AddSong(grandchild, "d.flac", "Foo", 4);
+	}
+
+	return root;
+}
+
+/**
+ * Describe the tree as a string, for comparisons.
+ */
+static void
+Dump(std::string &dest, const Directory &directory)
+{
+	dest += "D ";
+	dest += directory.GetPath();
+	dest += ' ';
+	dest += std::to_string(std::chrono::system_clock::to_time_t(directory.mtime));
+	dest += '\n';
+
+	for (const auto &playlist : directory.playlists) {
+		dest += "P ";
+		dest += playlist.name;
+		dest += '\n';
+	}
+
+	for (const auto &song : directory.songs) {
+		dest += "S ";
+		dest += song.filename;
+		dest += ' ';
+		dest += song.target;
+		dest += ' ';
+		dest += std::to_string(std::chrono::system_clock::to_time_t(song.mtime));
+		dest += ' ';
+		dest += ToString(song.audio_format).c_str();
+		dest += ' ';
+		dest += std::to_string(song.start_time.ToMS());
+		dest += '-';
+		dest += std::to_string(song.end_time.ToMS());
+		dest += ' ';
+		dest += std::to_string(song.tag.duration.ToMS());
+		dest += '\n';
+
+		for (const auto &item : song.tag) {
+			dest += "  ";
+			dest += std::to_string(item.type);
+			dest += '=';
+			dest += item.value;
+			dest += '\n';
+		}
+	}
+
+	for (const auto &child : directory.children)
+		Dump(dest, child);
+}
+
+static std::string
+Dump(const Directory &root)
+{
+	std::string result;
+	Dump(result, root);
+	return result;
+}
+
+static std::string
+Save(const Directory &root)
+{
+	StringOutputStream sos;
+	BufferedOutputStream bos(sos);
+	db_save_binary(bos, root);
+	bos.Flush();
+	return std::move(sos).GetValue();
+}
+
+static void
+Load(const std::string &data, Directory &root)
+{
+	db_load_binary({data.data(), data.size()}, root);
+}
+
+/**
+ * Load into a new tree which is discarded afterwards.
+ */
+static void
+Load(const std::string &data)
+{
+	std::unique_ptr<Directory> root(Directory::NewRoot());
+	Load(data, *root);
+}
+
+TEST(BinarySave, RoundTrip)
+{
+	const auto a = MakeTree();
+	const auto data = Save(*a);
+	EXPECT_TRUE(db_is_binary({data.data(), data.size()}));
+
+	std::unique_ptr<Directory> b(Directory::NewRoot());
+	Load(data, *b);
+	EXPECT_EQ(Dump(*a), Dump(*b));
+
+	/* saving the loaded tree creates the same file */
+	EXPECT_EQ(data, Save(*b));
+}
+
+TEST(BinarySave, CorruptHeader)
+{
+	const auto root = MakeTree();
+	const auto data = Save(*root);
+
+	/* text databases are not mistaken for binary ones */
+	const std::string text = "info_begin\nformat: 2\n";
+	EXPECT_FALSE(db_is_binary({text.data(), text.size()}));
+	EXPECT_FALSE(db_is_binary({data.data(), 4}));
+
+	auto corrupt = data;
+	corrupt[0] = 'X';
+	EXPECT_THROW(Load(corrupt), std::runtime_error);
+
+	/* unsupported format version */
+	corrupt = data;
+	corrupt[8] = 42;
+	EXPECT_THROW(Load(corrupt), std::runtime_error);
+
+	/* wrong byte order */
+	corrupt = data;
+	std::swap(corrupt[12], corrupt[15]);
+	EXPECT_THROW(Load(corrupt), std::runtime_error);
+
+	/* truncated anywhere */
+	for (size_t size = 0; size < data.size(); size += 7)
+		EXPECT_THROW(Load(data.substr(0, size)), std::runtime_error)
+			<< "size=" << size;
+}
+
+TEST(BinarySave, CorruptAudioFormat)
+{
+	const auto root = MakeTree();
+	const auto data = Save(*root);
+
+	ASSERT_EQ(uint8_t(SampleFormat::S16), uint8_t(data[FIRST_SONG_FORMAT]));
+	ASSERT_EQ(2, data[FIRST_SONG_CHANNELS]);
+
+	auto corrupt = data;
+	corrupt[FIRST_SONG_FORMAT] = char(0xff);
+	EXPECT_THROW(Load(corrupt), std::runtime_error);
+
+	corrupt = data;
+	corrupt[FIRST_SONG_CHANNELS] = 0;
+	EXPECT_THROW(Load(corrupt), std::runtime_error);
+
+	corrupt = data;
+	corrupt[FIRST_SONG_CHANNELS] = char(200);
+	EXPECT_THROW(Load(corrupt), std::runtime_error);
+}
+
+TEST(BinarySave, CorruptOffsets)
+{
+	const auto root = MakeTree();
+	const auto data = Save(*root);
+	const size_t trailer = data.size() - TRAILER_SIZE;
+
+	/* each 64 bit offset/size field in the trailer points
+	   outside of the file */
+	for (size_t offset = 0; offset < 24; offset += 8) {
+		auto corrupt = data;
+		const uint64_t value = data.size() * 2;
+		memcpy(&corrupt[trailer + offset], &value, sizeof(value));
+		EXPECT_THROW(Load(corrupt), std::runtime_error)
+			<< "offset=" << offset;
+	}
+
+	/* too many tag items */
+	auto corrupt = data;
+	const uint32_t n_items = UINT32_MAX;
+	memcpy(&corrupt[trailer + 24], &n_items, sizeof(n_items));
+	EXPECT_THROW(Load(corrupt), std::runtime_error);
+
+	/* the root directory claims more children than there are */
+	corrupt = data;
+	const uint32_t n_children = 1000;
+	memcpy(&corrupt[24 + 16], &n_children, sizeof(n_children));
+	EXPECT_THROW(Load(corrupt), std::runtime_error);
+
+	/* every other corruption must either be detected or yield
+	   some tree, but never crash */
+	for (size_t i = 0; i < data.size(); ++i) {
+		corrupt = data;
+		corrupt[i] ^= 0x81;
+
+		try {
+			Load(corrupt);
+		} catch (const std::runtime_error &) {
+		}
+	}
+}
+
+TEST(BinarySave, DuplicateDirectory)
+{
+	std::unique_ptr<Directory> root(Directory::NewRoot());
+
+	{
+		const ScopeDatabaseLock protect;
+		root->CreateChild("a");
+		root->CreateChild("b");
+	}
+
+	const auto data = Save(*root);
+	ASSERT_NO_THROW(Load(data));
+
+	/* the two children follow the root directory (24 + 32
+	   bytes); give the second one the name of the first one */
+	constexpr size_t FIRST_CHILD = 24 + 32;
+	constexpr size_t SECOND_CHILD = FIRST_CHILD + 32;
+	constexpr size_t NAME = 8;
+
+	auto corrupt = data;
+	memcpy(&corrupt[SECOND_CHILD + NAME], &data[FIRST_CHILD + NAME],
+	       sizeof(uint32_t));
+	EXPECT_THROW(Load(corrupt), std::runtime_error);
+}
@@ -0,0 +1,186 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Stress test for the shared/exclusive #db_mutex: several reader
+ * threads walk a directory tree while a writer thread modifies it
+ * continuously.  Each modification keeps the number of songs
+ * constant and stamps all directories with the same generation
+ * number, so a reader which sees a different song count or mixed
+ * generations has observed a partial modification.
+ */
+
+#include "db/plugins/simple/Directory.hxx"
+#include "db/plugins/simple/Song.hxx"
+#include "db/DatabaseLock.hxx"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stdio.h>
+
+static constexpr unsigned N_DIRECTORIES = 64;
+static constexpr unsigned N_SONGS = 16;
+static constexpr unsigned N_READERS = 4;
+static constexpr unsigned N_WALKS = 200;
+
+static std::chrono::system_clock::time_point
+Generation(unsigned i) noexcept
+{
+	return std::chrono::system_clock::time_point(std::chrono::seconds(i));
+}
+
+static void
+SetGeneration(Directory &root, unsigned generation) noexcept
+{
+	for (auto &child : root.children) {
+		child.mtime = Generation(generation);
+		for (auto &song : child.songs)
+			song.mtime = Generation(generation);
+	}
+}
+
+/**
+ * Replace one song in each directory and increment the generation.
+ */
+static void
+Modify(Directory &root, unsigned generation)
+{
+	for (auto &child : root.children) {
+		const auto old_song = child.RemoveSong(&child.songs.front());
+		auto name = "new " + std::to_string(generation);
+		child.AddSong(std::make_unique<Song>(std::move(name), child));
+	}
+
+	SetGeneration(root, generation);
+}
+
+/**
+ * Check the tree for consistency.
+ *
+ * @return the generation number
+ */
+static unsigned
+Check(const Directory &root)
+{
+	unsigned n_directories = 0, n_songs = 0;
+	const auto generation = root.children.front().mtime;
+
+	for (const auto &child : root.children) {
+		++n_directories;
+		EXPECT_EQ(child.mtime, generation);
+
+		for (const auto &song : child.songs) {
+			++n_songs;
+			EXPECT_EQ(&song.parent, &child);
+			EXPECT_EQ(song.mtime, generation);
+			EXPECT_EQ(child.FindSong(song.filename.c_str()), &song);
+		}
+
+		EXPECT_EQ(root.FindChild(child.GetName()), &child);
+	}
+
+	EXPECT_EQ(n_directories, N_DIRECTORIES);
+	EXPECT_EQ(n_songs, N_DIRECTORIES * N_SONGS);
+
+	return std::chrono::duration_cast<std::chrono::seconds>(generation.time_since_epoch()).count();
+}
+
+TEST(DatabaseLock, Stress)
+{
+	std::unique_ptr<Directory> root(Directory::NewRoot());
+
+	{
+		const ScopeDatabaseLock protect;
+
+		for (unsigned i = 0; i < N_DIRECTORIES; ++i) {
+			Directory &child =
+				*root->CreateChild(("dir " + std::to_string(i)).c_str());
+			for (unsigned j = 0; j < N_SONGS; ++j)
+				child.AddSong(std::make_unique<Song>("song " + std::to_string(j),
+								     child));
+		}
+
+		SetGeneration(*root, 0);
+	}
+
+	std::atomic_bool stop(false);
+	std::atomic_uint active_readers(0), max_active_readers(0);
+	unsigned n_modifications = 0;
+
+	std::thread writer([&](){
+		while (!stop) {
+			{
+				const ScopeDatabaseLock protect;
+				Modify(*root, ++n_modifications);
+			}
+
+			std::this_thread::yield();
+		}
+	});
+
+	std::vector<std::thread> readers;
+	for (unsigned i = 0; i < N_READERS; ++i) {
+		readers.emplace_back([&](){
+			unsigned last_generation = 0;
+
+			for (unsigned j = 0; j < N_WALKS; ++j) {
+				{
+					const ScopeDatabaseSharedLock protect;
+#ifndef NDEBUG
+					EXPECT_TRUE(holding_db_lock());
+					EXPECT_FALSE(holding_exclusive_db_lock());
+#endif
+
+					unsigned n = ++active_readers;
+					unsigned max = max_active_readers;
+					while (n > max &&
+					       !max_active_readers.compare_exchange_weak(max, n)) {}
+
+					const unsigned generation = Check(*root);
+					EXPECT_GE(generation, last_generation);
+					last_generation = generation;
+
+					--active_readers;
+				}
+
+				std::this_thread::yield();
+			}
+		});
+	}
+
+	for (auto &i : readers)
+		i.join();
+
+	stop = true;
+	writer.join();
+
+	const ScopeDatabaseLock protect;
+	EXPECT_EQ(Check(*root), n_modifications);
+	root.reset();
+
+	printf("%u modifications, up to %u concurrent readers\n",
+	       n_modifications, max_active_readers.load());
+}
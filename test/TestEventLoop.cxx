@@ -0,0 +1,201 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/*
+ * Unit tests for the #EventLoop's file descriptor monitoring with
+ * whichever PollGroup backend has been configured (e.g. io_uring
+ * with "-Dio_uring=true").
+ */
+
+#include "event/Loop.hxx"
+#include "event/SocketMonitor.hxx"
+#include "event/TimerEvent.hxx"
+#include "net/SocketDescriptor.hxx"
+#include "system/UniqueFileDescriptor.hxx"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+/**
+ * Break the #EventLoop after a timeout.
+ */
+class Timeout final {
+	EventLoop &loop;
+	TimerEvent timer;
+
+public:
+	bool expired = false;
+
+	Timeout(EventLoop &_loop, std::chrono::steady_clock::duration d) noexcept
+		:loop(_loop), timer(_loop, BIND_THIS_METHOD(OnTimeout)) {
+		timer.Schedule(d);
+	}
+
+private:
+	void OnTimeout() noexcept {
+		expired = true;
+		loop.Break();
+	}
+};
+
+/**
+ * Monitors the read end of a pipe.
+ */
+class PipeMonitor final : public SocketMonitor {
+	UniqueFileDescriptor r, w;
+
+	/**
+	 * Break the #EventLoop after this many callbacks.
+	 */
+	unsigned &countdown;
+
+public:
+	unsigned n_ready = 0;
+
+	/**
+	 * Consume the data in OnSocketReady()?  If not, the pipe
+	 * stays readable.
+	 */
+	bool consume = true;
+
+	PipeMonitor(EventLoop &_loop, unsigned &_countdown)
+		:SocketMonitor(_loop), countdown(_countdown) {
+		if (!UniqueFileDescriptor::CreatePipe(r, w))
+			throw std::runtime_error("Failed to create pipe");
+
+		Open(SocketDescriptor(r.Get()));
+	}
+
+	~PipeMonitor() noexcept {
+		Steal();
+	}
+
+	void MakeReadable() noexcept {
+		static constexpr char data = 'x';
+		(void)w.Write(&data, sizeof(data));
+	}
+
+protected:
+	bool OnSocketReady(unsigned flags) noexcept override {
+		EXPECT_NE(0u, flags & READ);
+
+		++n_ready;
+
+		if (consume) {
+			char buffer[16];
+			(void)r.Read(buffer, sizeof(buffer));
+			CancelRead();
+		}
+
+		if (--countdown == 0)
+			GetEventLoop().Break();
+
+		return true;
+	}
+};
+
+}
+
+TEST(EventLoop, PipeReadable)
+{
+	EventLoop loop;
+	unsigned countdown = 1;
+	PipeMonitor monitor(loop, countdown);
+
+	monitor.ScheduleRead();
+	monitor.MakeReadable();
+
+	Timeout timeout(loop, std::chrono::seconds(5));
+	loop.Run();
+
+	EXPECT_FALSE(timeout.expired);
+	EXPECT_EQ(1u, monitor.n_ready);
+}
+
+/**
+ * The callback is invoked again as long as the file descriptor is
+ * readable (level-triggered), i.e. one-shot requests are re-armed.
+ */
+TEST(EventLoop, LevelTriggered)
+{
+	EventLoop loop;
+	unsigned countdown = 3;
+	PipeMonitor monitor(loop, countdown);
+	monitor.consume = false;
+
+	monitor.ScheduleRead();
+	monitor.MakeReadable();
+
+	Timeout timeout(loop, std::chrono::seconds(5));
+	loop.Run();
+
+	EXPECT_FALSE(timeout.expired);
+	EXPECT_EQ(3u, monitor.n_ready);
+}
+
+TEST(EventLoop, Cancel)
+{
+	EventLoop loop;
+	unsigned countdown = 1;
+	PipeMonitor monitor(loop, countdown);
+
+	monitor.ScheduleRead();
+	monitor.Cancel();
+	monitor.MakeReadable();
+
+	Timeout timeout(loop, std::chrono::milliseconds(100));
+	loop.Run();
+
+	EXPECT_TRUE(timeout.expired);
+	EXPECT_EQ(0u, monitor.n_ready);
+}
+
+/**
+ * Register more file descriptors than the io_uring submission queue
+ * has entries, so it fills up and must be submitted early.
+ */
+TEST(EventLoop, Many)
+{
+	constexpr unsigned N = 600;
+
+	EventLoop loop;
+	unsigned countdown = N;
+
+	std::vector<std::unique_ptr<PipeMonitor>> monitors;
+	for (unsigned i = 0; i < N; ++i) {
+		monitors.emplace_back(std::make_unique<PipeMonitor>(loop, countdown));
+		monitors.back()->ScheduleRead();
+	}
+
+	for (auto &i : monitors)
+		i->MakeReadable();
+
+	Timeout timeout(loop, std::chrono::seconds(5));
+	loop.Run();
+
+	EXPECT_FALSE(timeout.expired);
+	for (const auto &i : monitors)
+		EXPECT_EQ(1u, i->n_ready);
+}
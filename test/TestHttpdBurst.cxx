@@ -0,0 +1,180 @@
+/*
+ * Unit tests for the burst of the "httpd" output plugin.
+ */
+
+#include "output/Interface.hxx"
+#include "output/OutputPlugin.hxx"
+#include "output/plugins/httpd/HttpdOutputPlugin.hxx"
+#include "config/Block.hxx"
+#include "event/Thread.hxx"
+#include "net/UniqueSocketDescriptor.hxx"
+#include "net/IPv4Address.hxx"
+#include "AudioFormat.hxx"
+#include "util/ScopeExit.hxx"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <poll.h>
+#include <string.h>
+
+using std::chrono::steady_clock;
+
+namespace {
+
+constexpr unsigned PORT = 38461;
+
+/**
+ * The backlog needs to be larger than what the kernel buffers for a
+ * client which doesn't read (see Connect()).
+ */
+constexpr size_t BACKLOG = 8 * 1024 * 1024;
+
+char silence[2 * 1024 * 1024];
+
+ConfigBlock
+MakeBlock() noexcept
+{
+	ConfigBlock block;
+	block.AddBlockParam("encoder", "wave");
+	block.AddBlockParam("port", std::to_string(PORT));
+	block.AddBlockParam("max_client_backlog", std::to_string(BACKLOG));
+	return block;
+}
+
+/**
+ * Play the given amount of silence (not in real time).
+ */
+void
+PlaySilence(AudioOutput &ao, size_t size)
+{
+	while (size > 0)
+		size -= ao.Play(silence, std::min(size, sizeof(silence)));
+}
+
+UniqueSocketDescriptor
+Connect()
+{
+	UniqueSocketDescriptor fd;
+	if (!fd.Create(AF_INET, SOCK_STREAM, 0))
+		throw std::runtime_error("Failed to create socket");
+
+	/* a small receive window, so the server can send only a
+	   small part of the burst until the client reads it */
+	const int rcvbuf = 4096;
+	fd.SetOption(SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+	if (!fd.Connect(IPv4Address(127, 0, 0, 1, PORT)))
+		throw std::runtime_error("Failed to connect");
+
+	static constexpr char request[] =
+		"GET / HTTP/1.1\r\n"
+		"Host: localhost\r\n"
+		"\r\n";
+	if (fd.Write(request, sizeof(request) - 1) < 0)
+		throw std::runtime_error("Failed to send request");
+
+	return fd;
+}
+
+/**
+ * Append what the server sends to #response, until it contains the
+ * given number of bytes or the timeout expires.
+ */
+void
+Receive(UniqueSocketDescriptor &fd, std::string &response,
+	size_t size, steady_clock::duration timeout) noexcept
+{
+	const auto until = steady_clock::now() + timeout;
+
+	while (response.size() < size) {
+		const auto remaining = until - steady_clock::now();
+		if (remaining <= steady_clock::duration::zero())
+			break;
+
+		struct pollfd pfd = {fd.Get(), POLLIN, 0};
+		const int ms = std::chrono::duration_cast<std::chrono::milliseconds>(remaining).count();
+		if (poll(&pfd, 1, std::max(ms, 1)) <= 0)
+			continue;
+
+		char buffer[65536];
+		const ssize_t nbytes = fd.Read(buffer,
+					       std::min(sizeof(buffer),
+							size - response.size()));
+		if (nbytes <= 0)
+			break;
+
+		response.append(buffer, nbytes);
+	}
+}
+
+}
+
+TEST(HttpdBurst, TooLarge)
+{
+	/* not started: the configuration is rejected before the
+	   EventLoop is used */
+	EventThread io_thread;
+
+	auto block = MakeBlock();
+	block.AddBlockParam("burst_size", std::to_string(BACKLOG));
+
+	EXPECT_THROW(ao_plugin_init(io_thread.GetEventLoop(),
+				    httpd_output_plugin, block),
+		     std::runtime_error);
+}
+
+/**
+ * A new client must get the whole burst, even if more data arrives
+ * before the burst has been sent.
+ */
+TEST(HttpdBurst, NewClient)
+{
+	EventThread io_thread;
+	io_thread.Start();
+
+	/* the default burst (half of the backlog) is smaller than
+	   this burst_time */
+	auto block = MakeBlock();
+	block.AddBlockParam("burst_time", "3600");
+
+	std::unique_ptr<AudioOutput> ao(ao_plugin_init(io_thread.GetEventLoop(),
+						       httpd_output_plugin,
+						       block));
+
+	ao->Enable();
+	AtScopeExit(&ao) { ao->Disable(); };
+
+	AudioFormat audio_format(44100, SampleFormat::S16, 2);
+	ao->Open(audio_format);
+	AtScopeExit(&ao) { ao->Close(); };
+
+	/* fill the burst buffer */
+	PlaySilence(*ao, BACKLOG);
+
+	auto fd = Connect();
+
+	/* wait until the server has begun to respond, i.e. the
+	   client is streaming; read only the response header */
+	std::string response;
+	size_t header_size;
+	while ((header_size = response.find("\r\n\r\n")) == response.npos) {
+		const size_t old_size = response.size();
+		Receive(fd, response, old_size + 1, std::chrono::seconds(5));
+		ASSERT_GT(response.size(), old_size);
+	}
+
+	header_size += 4;
+	response.erase(0, header_size);
+
+	/* more data arrives while most of the burst is still
+	   queued in the server */
+	PlaySilence(*ao, sizeof(silence));
+
+	Receive(fd, response, BACKLOG / 2, std::chrono::seconds(10));
+	EXPECT_GE(response.size(), BACKLOG / 2 - 32768);
+}
@@ -0,0 +1,298 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/*
+ * Unit tests for the index file of #InputCacheDisk: a save/load round
+ * trip, entries whose files have disappeared, and malformed index
+ * files.
+ */
+
+#include "input/cache/Disk.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "fs/DirectoryReader.hxx"
+#include "fs/FileSystem.hxx"
+#include "fs/io/FileOutputStream.hxx"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+static constexpr uint64_t MAX_SIZE = 1000;
+
+static AllocatedPath
+MakeTempDirectory()
+{
+	const auto path = testing::TempDir() + "mpd_test_input_cache_" +
+		std::to_string(getpid());
+	mkdir(path.c_str(), 0700);
+	return AllocatedPath::FromFS(path.c_str());
+}
+
+static void
+WriteFile(Path path, const std::string &contents)
+{
+	FileOutputStream fos(path);
+	fos.Write(contents.data(), contents.size());
+	fos.Commit();
+}
+
+class InputCacheDiskTest : public testing::Test {
+protected:
+	const AllocatedPath directory = MakeTempDirectory();
+
+	~InputCacheDiskTest() noexcept override {
+		{
+			DirectoryReader reader(directory);
+			while (reader.ReadEntry()) {
+				const Path name = reader.GetEntry();
+				if (name.c_str()[0] != '.')
+					RemoveFile(AllocatedPath::Build(directory, name));
+			}
+		}
+
+		rmdir(directory.c_str());
+	}
+
+	InputCacheDisk Open() {
+		return InputCacheDisk(AllocatedPath(directory), MAX_SIZE);
+	}
+
+	/**
+	 * Store a file of the given size where #InputCacheDisk
+	 * expects the contents of the given URI.
+	 */
+	void WriteCachedFile(const char *uri, size_t size) {
+		auto disk = Open();
+		WriteFile(disk.MakePath(uri), std::string(size, 'x'));
+	}
+
+	void WriteIndex(const std::string &index) {
+		WriteFile(AllocatedPath::Build(directory,
+						 PATH_LITERAL("index")),
+			  index);
+	}
+};
+
+TEST_F(InputCacheDiskTest, RoundTrip)
+{
+	WriteCachedFile("http://a/", 100);
+	WriteCachedFile("http://b/", 200);
+	WriteCachedFile("http://c/", 300);
+
+	std::string index;
+
+	{
+		auto disk = Open();
+		EXPECT_FALSE(disk.IsDirty());
+
+		disk.Add("http://a/", 100, "etag-a");
+		disk.Add("http://b/", 200, "etag-b");
+		disk.Add("http://c/", 300, "etag-c");
+		EXPECT_EQ(600u, disk.GetSize());
+
+		/* "a" becomes the most recently used one */
+		EXPECT_FALSE(disk.Lookup("http://a/").path.IsNull());
+
+		/* saved by the destructor */
+		EXPECT_TRUE(disk.IsDirty());
+	}
+
+	{
+		auto disk = Open();
+		EXPECT_FALSE(disk.IsDirty());
+		EXPECT_EQ(600u, disk.GetSize());
+
+		const auto b = disk.Lookup("http://b/");
+		EXPECT_EQ(disk.MakePath("http://b/"), b.path);
+		EXPECT_EQ(200u, b.size);
+		EXPECT_EQ("etag-b", b.validator);
+
+		index = disk.ExportIndex();
+		disk.WriteIndex(index);
+	}
+
+	/* the least recently used one comes first */
+	EXPECT_EQ("input_cache: 2\n"
+		  "entry: 300 http://c/\n"
+		  "validator: etag-c\n"
+		  "entry: 100 http://a/\n"
+		  "validator: etag-a\n"
+		  "entry: 200 http://b/\n"
+		  "validator: etag-b\n",
+		  index);
+
+	/* the index can be parsed again */
+	auto disk = Open();
+	EXPECT_EQ(index, disk.ExportIndex());
+}
+
+TEST_F(InputCacheDiskTest, MissingFile)
+{
+	WriteCachedFile("http://a/", 100);
+	WriteCachedFile("http://b/", 200);
+	WriteIndex("input_cache: 2\n"
+		   "entry: 100 http://a/\n"
+		   "validator: etag-a\n"
+		   "entry: 999 http://b/\n"
+		   "validator: etag-b\n"
+		   "entry: 300 http://c/\n"
+		   "validator: etag-c\n");
+
+	/* "b" has the wrong size and "c" does not exist */
+	auto disk = Open();
+	EXPECT_TRUE(disk.Contains("http://a/"));
+	EXPECT_FALSE(disk.Contains("http://b/"));
+	EXPECT_FALSE(disk.Contains("http://c/"));
+	EXPECT_EQ(100u, disk.GetSize());
+
+	/* the index will be rewritten without them */
+	EXPECT_TRUE(disk.IsDirty());
+}
+
+TEST_F(InputCacheDiskTest, Validator)
+{
+	WriteCachedFile("http://a/", 100);
+	WriteCachedFile("http://b/", 200);
+
+	/* a validator line is required, and it must not be empty */
+	for (const char *index : {
+			"input_cache: 2\n"
+			"entry: 100 http://a/\n"
+			"entry: 200 http://b/\n"
+			"validator: etag-b\n",
+
+			"input_cache: 2\n"
+			"entry: 100 http://a/\n"
+			"validator: \n",
+
+			"input_cache: 2\n"
+			"entry: 100 http://a/\n"
+			"etag-a\n",
+		}) {
+		WriteIndex(index);
+
+		auto disk = Open();
+		EXPECT_FALSE(disk.Contains("http://a/")) << index;
+		EXPECT_FALSE(disk.Contains("http://b/")) << index;
+		EXPECT_EQ(0u, disk.GetSize());
+	}
+
+	/* files which can't be stored in the index are deleted */
+	auto disk = Open();
+	disk.Add("http://a/", 100, "");
+	disk.Add("http://b/", 200, "etag\nb");
+	EXPECT_FALSE(disk.Contains("http://a/"));
+	EXPECT_FALSE(disk.Contains("http://b/"));
+	EXPECT_FALSE(FileExists(disk.MakePath("http://a/")));
+	EXPECT_FALSE(FileExists(disk.MakePath("http://b/")));
+}
+
+TEST_F(InputCacheDiskTest, FormatMismatch)
+{
+	WriteCachedFile("http://a/", 100);
+
+	for (const char *header : {
+			"input_cache: 1\n",
+			"input_cache: 3\n",
+			"input_cache: \n",
+			"input_cache 2\n",
+			"\n",
+		}) {
+		WriteIndex(std::string(header) +
+			   "entry: 100 http://a/\n"
+			   "validator: etag-a\n");
+
+		auto disk = Open();
+		EXPECT_FALSE(disk.Contains("http://a/")) << header;
+	}
+
+	/* an empty index file */
+	WriteIndex("");
+	EXPECT_FALSE(Open().Contains("http://a/"));
+}
+
+TEST_F(InputCacheDiskTest, Truncated)
+{
+	WriteCachedFile("http://a/", 100);
+	WriteCachedFile("http://b/", 200);
+
+	const std::string index = "input_cache: 2\n"
+		"entry: 100 http://a/\n"
+		"validator: etag-a\n"
+		"entry: 200 http://b/\n"
+		"validator: etag-b\n";
+
+	/* an entry is loaded if its validator line has at least one
+	   character; the last line may lack the newline */
+	const size_t a_complete = index.find("etag-a") + 1;
+	const size_t b_complete = index.find("etag-b") + 1;
+
+	for (size_t size = 0; size < index.size(); ++size) {
+		WriteIndex(index.substr(0, size));
+
+		auto disk = Open();
+		EXPECT_EQ(size >= a_complete, disk.Contains("http://a/"))
+			<< "size=" << size;
+		EXPECT_EQ(size >= b_complete, disk.Contains("http://b/"))
+			<< "size=" << size;
+	}
+}
+
+TEST_F(InputCacheDiskTest, CorruptLine)
+{
+	WriteCachedFile("http://a/", 100);
+	WriteCachedFile("http://b/", 200);
+
+	for (const char *line : {
+			"entry: x http://b/\n",
+			"entry: 200\n",
+			"entry: 200\thttp://b/\n",
+			"entry:200 http://b/\n",
+			"foo\n",
+			"\n",
+		}) {
+		WriteIndex(std::string("input_cache: 2\n"
+				       "entry: 100 http://a/\n"
+				       "validator: etag-a\n") +
+			   line +
+			   "validator: etag-b\n");
+
+		auto disk = Open();
+
+		/* entries before the corrupt line are kept */
+		EXPECT_TRUE(disk.Contains("http://a/")) << line;
+		EXPECT_FALSE(disk.Contains("http://b/")) << line;
+		EXPECT_EQ(100u, disk.GetSize()) << line;
+	}
+
+	/* the same entry twice: the second one is ignored */
+	WriteIndex("input_cache: 2\n"
+		   "entry: 100 http://a/\n"
+		   "validator: etag-a\n"
+		   "entry: 100 http://a/\n"
+		   "validator: etag-a2\n");
+
+	auto disk = Open();
+	EXPECT_EQ(100u, disk.GetSize());
+	EXPECT_EQ("etag-a", disk.Lookup("http://a/").validator);
+}
@@ -0,0 +1,335 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Unit tests for the journal of the "simple" database plugin: a
+ * round trip, a journal which was cut off in the middle of a
+ * transaction, and compaction into the database file.
+ */
+
+#include "db/plugins/simple/Journal.hxx"
+#include "db/plugins/simple/SimpleDatabasePlugin.hxx"
+#include "db/plugins/simple/Directory.hxx"
+#include "db/plugins/simple/Song.hxx"
+#include "db/DatabaseLock.hxx"
+#include "db/DatabaseListener.hxx"
+#include "event/Loop.hxx"
+#include "config/Block.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "fs/FileSystem.hxx"
+#include "fs/FileInfo.hxx"
+#include "fs/io/TextFile.hxx"
+#include "fs/io/FileOutputStream.hxx"
+#include "fs/io/BufferedOutputStream.hxx"
+#include "lib/icu/Init.hxx"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+#include <unistd.h>
+
+static std::string
+MakeTempPath(const char *name)
+{
+	return testing::TempDir() + "mpd_test_journal_" +
+		std::to_string(getpid()) + "_" + name;
+}
+
+/**
+ * Describe the tree as a string, for comparisons.
+ */
+static void
+Dump(std::string &dest, const Directory &directory)
+{
+	dest += "D ";
+	dest += directory.GetPath();
+	dest += ' ';
+	dest += std::to_string(std::chrono::system_clock::to_time_t(directory.mtime));
+	dest += '\n';
+
+	for (const auto &song : directory.songs) {
+		dest += "S ";
+		dest += song.filename;
+		dest += '\n';
+	}
+
+	for (const auto &child : directory.children)
+		Dump(dest, child);
+}
+
+static std::string
+Dump(Directory &root)
+{
+	const ScopeDatabaseLock protect;
+	root.Sort();
+
+	std::string result;
+	Dump(result, root);
+	return result;
+}
+
+static void
+AddSongs(Directory &directory, unsigned n)
+{
+	for (unsigned i = 0; i < n; ++i)
+		directory.AddSong(std::make_unique<Song>("song" + std::to_string(i) + ".flac",
+							 directory));
+}
+
+/**
+ * Create a tree with two levels of directories.
+ */
+static void
+Populate(Directory &root, unsigned n_directories)
+{
+	const ScopeDatabaseLock protect;
+
+	for (unsigned i = 0; i < n_directories; ++i) {
+		Directory &child =
+			*root.CreateChild(("dir" + std::to_string(i)).c_str());
+		child.mtime = std::chrono::system_clock::from_time_t(1000 + i);
+		AddSongs(child, 3);
+
+		Directory &grandchild = *child.CreateChild("sub");
+		grandchild.mtime = std::chrono::system_clock::from_time_t(2000 + i);
+		AddSongs(grandchild, 2);
+	}
+}
+
+/**
+ * Append one transaction to the journal file.
+ */
+static void
+Append(const AllocatedPath &path, Directory &root)
+{
+	FileOutputStream fos(path, FileOutputStream::Mode::APPEND_OR_CREATE);
+	BufferedOutputStream bos(fos);
+
+	{
+		const ScopeDatabaseLock protect;
+		journal_sort_modified(root);
+		journal_save(bos, root);
+	}
+
+	bos.Flush();
+	fos.Commit();
+}
+
+static bool
+Load(const AllocatedPath &path, Directory &root)
+{
+	TextFile file(path);
+	return journal_load(file, root);
+}
+
+static void
+Truncate(const AllocatedPath &path, off_t size)
+{
+	ASSERT_EQ(0, truncate(path.c_str(), size));
+}
+
+class NullDatabaseListener final : public DatabaseListener {
+public:
+	void OnDatabaseModified() noexcept override {}
+	void OnDatabaseSongRemoved(const char *) noexcept override {}
+};
+
+static std::unique_ptr<SimpleDatabase>
+CreateDatabase(const ConfigBlock &block)
+{
+	EventLoop event_loop;
+	NullDatabaseListener listener;
+	auto db = SimpleDatabase::Create(event_loop, event_loop,
+					 listener, block);
+	return std::unique_ptr<SimpleDatabase>((SimpleDatabase *)db.release());
+}
+
+/**
+ * Sorting the tree needs the ICU collator, which can be initialized
+ * only once per process.
+ */
+class Journal : public testing::Test {
+public:
+	static void SetUpTestSuite() {
+		IcuInit();
+	}
+
+	static void TearDownTestSuite() noexcept {
+		IcuFinish();
+	}
+};
+
+TEST_F(Journal, RoundTrip)
+{
+	const auto path = AllocatedPath::FromFS(MakeTempPath("roundtrip"));
+
+	std::unique_ptr<Directory> a(Directory::NewRoot());
+	Populate(*a, 4);
+	Append(path, *a);
+
+	/* the second transaction modifies one directory and deletes
+	   another one */
+	{
+		const ScopeDatabaseLock protect;
+
+		Directory &dir0 = *a->FindChild("dir0");
+		AddSongs(dir0, 5);
+		dir0.MarkModified();
+
+		a->FindChild("dir1")->Delete();
+	}
+
+	Append(path, *a);
+
+	std::unique_ptr<Directory> b(Directory::NewRoot());
+	EXPECT_TRUE(Load(path, *b));
+	EXPECT_EQ(Dump(*a), Dump(*b));
+
+	/* replaying the journal again is harmless */
+	EXPECT_TRUE(Load(path, *b));
+	EXPECT_EQ(Dump(*a), Dump(*b));
+
+	RemoveFile(path);
+}
+
+/**
+ * A transaction without a commit line (e.g. after a crash) must be
+ * discarded completely, wherever the journal was cut off.
+ */
+TEST_F(Journal, Truncated)
+{
+	const auto path = AllocatedPath::FromFS(MakeTempPath("truncated"));
+
+	std::unique_ptr<Directory> a(Directory::NewRoot());
+	Populate(*a, 3);
+	Append(path, *a);
+
+	const std::string first = Dump(*a);
+	const off_t first_size = FileInfo(path).GetSize();
+
+	{
+		const ScopeDatabaseLock protect;
+
+		for (auto &child : a->children) {
+			AddSongs(child, 4);
+			child.mtime = std::chrono::system_clock::from_time_t(5000);
+			child.MarkModified();
+		}
+	}
+
+	Append(path, *a);
+
+	const off_t full_size = FileInfo(path).GetSize();
+	const std::string second = Dump(*a);
+	ASSERT_NE(first, second);
+
+	/* without the trailing "journal_commit\n", the second
+	   transaction is still incomplete */
+	constexpr off_t COMMIT_SIZE = sizeof("journal_commit\n") - 1;
+
+	for (off_t size = full_size - COMMIT_SIZE; size > first_size;
+	     size -= 7) {
+		Truncate(path, size);
+
+		std::unique_ptr<Directory> b(Directory::NewRoot());
+		EXPECT_FALSE(Load(path, *b)) << "size=" << size;
+		EXPECT_EQ(first, Dump(*b)) << "size=" << size;
+	}
+
+	Truncate(path, first_size);
+
+	std::unique_ptr<Directory> b(Directory::NewRoot());
+	EXPECT_TRUE(Load(path, *b));
+	EXPECT_EQ(first, Dump(*b));
+
+	RemoveFile(path);
+}
+
+/**
+ * SimpleDatabase::Save() appends to the journal until it grows too
+ * large, then rewrites the database file and deletes the journal.
+ */
+TEST_F(Journal, Compaction)
+{
+	const auto db_path = MakeTempPath("db");
+	const auto journal_path = AllocatedPath::FromFS(db_path + ".journal");
+
+	ConfigBlock block;
+	block.AddBlockParam("path", db_path);
+	block.AddBlockParam("journal", "yes");
+	block.AddBlockParam("compress", "no");
+
+	std::string expected;
+
+	{
+		auto db = CreateDatabase(block);
+		db->Open();
+		Populate(db->GetRoot(), 16);
+
+		/* the first save writes the database file */
+		db->Save();
+		EXPECT_FALSE(FileExists(journal_path));
+
+		/* small changes are appended to the journal ... */
+		unsigned n_appended = 0;
+		for (unsigned i = 0; i < 100; ++i) {
+			{
+				const ScopeDatabaseLock protect;
+				Directory &dir = *db->GetRoot().FindChild("dir0");
+				dir.AddSong(std::make_unique<Song>("new" + std::to_string(i) + ".flac",
+								   dir));
+				dir.MarkModified();
+			}
+
+			db->Save();
+
+			if (!FileExists(journal_path))
+				/* ... until it was compacted */
+				break;
+
+			++n_appended;
+		}
+
+		EXPECT_GT(n_appended, 0u);
+		EXPECT_LT(n_appended, 100u);
+
+		/* one more change after the compaction */
+		{
+			const ScopeDatabaseLock protect;
+			db->GetRoot().FindChild("dir1")->Delete();
+		}
+
+		db->Save();
+		EXPECT_TRUE(FileExists(journal_path));
+
+		expected = Dump(db->GetRoot());
+		db->Close();
+	}
+
+	/* database file and journal contain everything */
+	auto db = CreateDatabase(block);
+	db->Open();
+	EXPECT_EQ(expected, Dump(db->GetRoot()));
+	db->Close();
+
+	RemoveFile(journal_path);
+	RemoveFile(AllocatedPath::FromFS(db_path.c_str()));
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/*
+ * Stress tests for #MusicPipe with one producer and one consumer
+ * thread.
+ */
+
+#include "MusicPipe.hxx"
+#include "MusicBuffer.hxx"
+#include "MusicChunk.hxx"
+#include "AudioFormat.hxx"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+static constexpr AudioFormat audio_format(44100, SampleFormat::S16, 2);
+
+static void
+Produce(MusicBuffer &buffer, MusicPipe &pipe, unsigned n_chunks) noexcept
+{
+	for (unsigned i = 0; i < n_chunks; ++i) {
+		auto chunk = buffer.Allocate();
+		while (!chunk) {
+			/* the buffer is full; wait for the consumer */
+			std::this_thread::yield();
+			chunk = buffer.Allocate();
+		}
+
+		auto w = chunk->Write(audio_format, SongTime::zero(), 0);
+		*(unsigned *)w.data = i;
+		chunk->Expand(audio_format, sizeof(i));
+
+		pipe.Push(std::move(chunk));
+	}
+}
+
+/**
+ * The consumer may rely on !IsEmpty() meaning that Shift() returns a
+ * chunk (see PlayerControl's PlayNextChunk()), and chunks arrive in
+ * order.
+ */
+TEST(MusicPipe, ShiftAfterNotEmpty)
+{
+	constexpr unsigned N = 200000;
+
+	MusicBuffer buffer(16, 4096);
+	MusicPipe pipe;
+
+	std::thread producer(Produce, std::ref(buffer), std::ref(pipe), N);
+
+	unsigned n_null = 0, n_disorder = 0;
+	for (unsigned i = 0; i < N;) {
+		if (pipe.IsEmpty()) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		auto chunk = pipe.Shift();
+		if (!chunk) {
+			++n_null;
+			continue;
+		}
+
+		if (*(const unsigned *)chunk->data != i)
+			++n_disorder;
+
+		++i;
+	}
+
+	producer.join();
+
+	EXPECT_EQ(0u, n_null);
+	EXPECT_EQ(0u, n_disorder);
+	EXPECT_TRUE(pipe.IsEmpty());
+	EXPECT_EQ(nullptr, pipe.Shift());
+}
+
+/**
+ * A third thread which only observes the pipe (like an output
+ * thread) never sees a chunk at the head of a pipe which claims to
+ * be empty.
+ */
+TEST(MusicPipe, PeekImpliesNotEmpty)
+{
+	constexpr unsigned N = 100000;
+
+	MusicBuffer buffer(16, 4096);
+	MusicPipe pipe;
+
+	std::atomic_bool done{false};
+	std::atomic_uint n_inconsistent{0};
+	std::thread observer([&](){
+			while (!done.load(std::memory_order_acquire)) {
+				const bool peeked = pipe.Peek() != nullptr;
+				if (peeked && pipe.IsEmpty())
+					++n_inconsistent;
+
+				std::this_thread::yield();
+			}
+		});
+
+	std::thread producer(Produce, std::ref(buffer), std::ref(pipe), N);
+
+	for (unsigned i = 0; i < N;) {
+		if (pipe.Shift())
+			++i;
+		else
+			std::this_thread::yield();
+	}
+
+	producer.join();
+	done.store(true, std::memory_order_release);
+	observer.join();
+
+	EXPECT_EQ(0u, n_inconsistent.load());
+}
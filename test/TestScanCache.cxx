@@ -0,0 +1,284 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/*
+ * Unit tests for #ScanCache: hits, misses, invalidation by size and
+ * modification time, appending to the file and pruning.
+ */
+
+#include "db/update/ScanCache.hxx"
+#include "db/plugins/simple/Directory.hxx"
+#include "db/plugins/simple/Song.hxx"
+#include "storage/FileInfo.hxx"
+#include "tag/Builder.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "fs/FileSystem.hxx"
+#include "fs/FileInfo.hxx"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+#include <unistd.h>
+
+static constexpr uint64_t DEVICE = 42, OTHER_DEVICE = 43;
+
+static AllocatedPath
+MakeTempPath()
+{
+	const auto path = testing::TempDir() + "mpd_test_scan_cache_" +
+		std::to_string(getpid());
+	return AllocatedPath::FromFS(path.c_str());
+}
+
+static StorageFileInfo
+MakeInfo(uint64_t inode, uint64_t size = 1000, unsigned mtime = 5000,
+	 uint64_t device = DEVICE) noexcept
+{
+	StorageFileInfo info(StorageFileInfo::Type::REGULAR);
+	info.size = size;
+	info.mtime = std::chrono::system_clock::from_time_t(mtime);
+	info.device = device;
+	info.inode = inode;
+	return info;
+}
+
+/**
+ * Create a song with a distinct title and audio format.
+ */
+static std::unique_ptr<Song>
+MakeSong(Directory &directory, unsigned n)
+{
+	auto song = std::make_unique<Song>("song.flac", directory);
+	song->audio_format = AudioFormat(44100 * n, SampleFormat::S16, 2);
+
+	TagBuilder tag;
+	tag.SetDuration(SignedSongTime::FromMS(1000 * n));
+	tag.AddItem(TAG_TITLE, ("Title " + std::to_string(n)).c_str());
+	song->tag = tag.Commit();
+	return song;
+}
+
+static const char *
+GetTitle(const Song &song) noexcept
+{
+	return song.tag.GetValue(TAG_TITLE);
+}
+
+class ScanCacheTest : public testing::Test {
+protected:
+	const AllocatedPath path = MakeTempPath();
+	std::unique_ptr<Directory> root{Directory::NewRoot()};
+
+	~ScanCacheTest() noexcept override {
+		if (FileExists(path))
+			RemoveFile(path);
+	}
+
+	/**
+	 * Look up a file in a new #ScanCache instance, i.e. from
+	 * the file.
+	 *
+	 * @return the title, or nullptr on a miss
+	 */
+	std::string Lookup(const StorageFileInfo &info) {
+		ScanCache cache{AllocatedPath(path)};
+		Song song("song.flac", *root);
+		if (!cache.Lookup(info, song))
+			return "(miss)";
+
+		return GetTitle(song);
+	}
+
+	uint64_t GetFileSize() const {
+		return FileInfo(path).GetSize();
+	}
+};
+
+TEST_F(ScanCacheTest, HitMiss)
+{
+	ScanCache cache{AllocatedPath(path)};
+
+	Song song("song.flac", *root);
+	EXPECT_FALSE(cache.Lookup(MakeInfo(1), song));
+	EXPECT_EQ(0u, cache.GetHits());
+	EXPECT_EQ(1u, cache.GetMisses());
+
+	cache.Put(MakeInfo(1), *MakeSong(*root, 1));
+	cache.Put(MakeInfo(2), *MakeSong(*root, 2));
+
+	/* files without an inode number are not cached */
+	cache.Put(MakeInfo(0), *MakeSong(*root, 3));
+	EXPECT_FALSE(cache.Lookup(MakeInfo(0), song));
+
+	EXPECT_TRUE(cache.Lookup(MakeInfo(2), song));
+	EXPECT_STREQ("Title 2", GetTitle(song));
+	EXPECT_EQ(AudioFormat(88200, SampleFormat::S16, 2), song.audio_format);
+	EXPECT_EQ(2000, song.tag.duration.ToMS());
+	EXPECT_EQ(MakeInfo(2).mtime, song.mtime);
+	EXPECT_EQ(1u, cache.GetHits());
+
+	/* the same inode on another device */
+	EXPECT_FALSE(cache.Lookup(MakeInfo(2, 1000, 5000, OTHER_DEVICE),
+				  song));
+
+	cache.Flush();
+
+	/* reloaded from the file */
+	EXPECT_EQ("Title 1", Lookup(MakeInfo(1)));
+	EXPECT_EQ("Title 2", Lookup(MakeInfo(2)));
+	EXPECT_EQ("(miss)", Lookup(MakeInfo(3)));
+}
+
+TEST_F(ScanCacheTest, Invalidate)
+{
+	{
+		ScanCache cache{AllocatedPath(path)};
+		cache.Put(MakeInfo(1), *MakeSong(*root, 1));
+		cache.Flush();
+	}
+
+	EXPECT_EQ("Title 1", Lookup(MakeInfo(1)));
+
+	/* modified size */
+	EXPECT_EQ("(miss)", Lookup(MakeInfo(1, 1001)));
+
+	/* modified mtime */
+	EXPECT_EQ("(miss)", Lookup(MakeInfo(1, 1000, 5001)));
+
+	/* the file was scanned again */
+	{
+		ScanCache cache{AllocatedPath(path)};
+		cache.Put(MakeInfo(1, 1000, 5001), *MakeSong(*root, 2));
+		cache.Flush();
+	}
+
+	EXPECT_EQ("(miss)", Lookup(MakeInfo(1)));
+	EXPECT_EQ("Title 2", Lookup(MakeInfo(1, 1000, 5001)));
+}
+
+/**
+ * Flush() appends only new entries, and rewrites the file once most
+ * of it is obsolete.
+ */
+TEST_F(ScanCacheTest, Append)
+{
+	constexpr unsigned N = 100;
+
+	{
+		ScanCache cache{AllocatedPath(path)};
+		for (unsigned i = 1; i <= N; ++i)
+			cache.Put(MakeInfo(i), *MakeSong(*root, i));
+		cache.Flush();
+	}
+
+	const auto initial_size = GetFileSize();
+
+	/* nothing modified: the file is not touched */
+	{
+		ScanCache cache{AllocatedPath(path)};
+		Song song("song.flac", *root);
+		EXPECT_TRUE(cache.Lookup(MakeInfo(1), song));
+		cache.Flush();
+	}
+
+	EXPECT_EQ(initial_size, GetFileSize());
+
+	/* one new entry is appended */
+	{
+		ScanCache cache{AllocatedPath(path)};
+		cache.Put(MakeInfo(N + 1), *MakeSong(*root, N + 1));
+		cache.Flush();
+	}
+
+	const auto appended_size = GetFileSize();
+	EXPECT_GT(appended_size, initial_size);
+	EXPECT_LT(appended_size, initial_size + initial_size / 10);
+
+	/* replace each entry once; when the file contains twice as
+	   many records as entries, it is rewritten */
+	uint64_t previous_size = appended_size;
+	bool rewritten = false;
+	for (unsigned i = 1; i <= N + 1; ++i) {
+		{
+			ScanCache cache{AllocatedPath(path)};
+			cache.Put(MakeInfo(i, 2000), *MakeSong(*root, 1000 + i));
+			cache.Flush();
+		}
+
+		const auto size = GetFileSize();
+		if (size < previous_size)
+			rewritten = true;
+		previous_size = size;
+	}
+
+	EXPECT_TRUE(rewritten);
+
+	for (unsigned i = 1; i <= N + 1; ++i) {
+		EXPECT_EQ("(miss)", Lookup(MakeInfo(i)));
+		EXPECT_EQ("Title " + std::to_string(1000 + i),
+			  Lookup(MakeInfo(i, 2000)));
+	}
+}
+
+TEST_F(ScanCacheTest, Prune)
+{
+	{
+		ScanCache cache{AllocatedPath(path)};
+		cache.Put(MakeInfo(1), *MakeSong(*root, 1));
+		cache.Put(MakeInfo(2), *MakeSong(*root, 2));
+		cache.Put(MakeInfo(3, 1000, 5000, OTHER_DEVICE),
+			  *MakeSong(*root, 3));
+		cache.Flush();
+	}
+
+	/* a walk which reads no file does not load the cache, and
+	   does not prune */
+	{
+		ScanCache cache{AllocatedPath(path)};
+		cache.Touch(MakeInfo(1));
+		cache.Prune();
+		cache.Flush();
+	}
+
+	EXPECT_EQ("Title 2", Lookup(MakeInfo(2)));
+
+	/* file 2 has been deleted; file 4 is new */
+	{
+		ScanCache cache{AllocatedPath(path)};
+		cache.Touch(MakeInfo(1));
+		cache.Touch(MakeInfo(4));
+
+		Song song("song.flac", *root);
+		EXPECT_FALSE(cache.Lookup(MakeInfo(4), song));
+		cache.Put(MakeInfo(4), *MakeSong(*root, 4));
+
+		cache.Prune();
+		cache.Flush();
+	}
+
+	EXPECT_EQ("Title 1", Lookup(MakeInfo(1)));
+	EXPECT_EQ("(miss)", Lookup(MakeInfo(2)));
+	EXPECT_EQ("Title 4", Lookup(MakeInfo(4)));
+
+	/* no file on this device was visited */
+	EXPECT_EQ("Title 3", Lookup(MakeInfo(3, 1000, 5000, OTHER_DEVICE)));
+}
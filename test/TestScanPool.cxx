@@ -0,0 +1,256 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/*
+ * Unit tests for #ScanPool, the thread pool which loads song files
+ * during a database update.  Song::LoadFile() is replaced by a stub
+ * which recognizes file names instead of decoding files.
+ */
+
+#include "db/update/ScanPool.hxx"
+#include "db/plugins/simple/Directory.hxx"
+#include "db/plugins/simple/Song.hxx"
+#include "db/DatabaseLock.hxx"
+#include "storage/StorageInterface.hxx"
+#include "fs/AllocatedPath.hxx"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <string.h>
+
+namespace {
+
+std::atomic_uint n_loading, max_loading, n_loaded;
+
+class NullStorage final : public Storage {
+public:
+	StorageFileInfo GetInfo(const char *, bool) override {
+		throw std::runtime_error("Not implemented");
+	}
+
+	std::unique_ptr<StorageDirectoryReader> OpenDirectory(const char *) override {
+		throw std::runtime_error("Not implemented");
+	}
+
+	std::string MapUTF8(const char *uri_utf8) const noexcept override {
+		return uri_utf8;
+	}
+
+	const char *MapToRelativeUTF8(const char *) const noexcept override {
+		return nullptr;
+	}
+};
+
+}
+
+/**
+ * Files called "error*" fail to load, "unknown*" are not recognized
+ * and "slow*" take a while.
+ */
+SongPtr
+Song::LoadFile(Storage &, const char *path_utf8, Directory &parent)
+{
+	const unsigned n = ++n_loading;
+	unsigned max = max_loading;
+	while (n > max && !max_loading.compare_exchange_weak(max, n)) {}
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(strncmp(path_utf8, "slow", 4) == 0
+							      ? 50 : 1));
+
+	--n_loading;
+	++n_loaded;
+
+	if (strncmp(path_utf8, "error", 5) == 0)
+		throw std::runtime_error(path_utf8);
+
+	if (strncmp(path_utf8, "unknown", 7) == 0)
+		return nullptr;
+
+	return std::make_unique<Song>(path_utf8, parent);
+}
+
+static void
+ResetCounters() noexcept
+{
+	n_loading = max_loading = n_loaded = 0;
+}
+
+/**
+ * Every submitted job is returned exactly once, with its result.
+ */
+TEST(ScanPool, AllJobs)
+{
+	ResetCounters();
+
+	std::unique_ptr<Directory> root(Directory::NewRoot());
+	Directory *a, *b;
+	{
+		const ScopeDatabaseLock protect;
+		a = root->CreateChild("a");
+		b = root->CreateChild("b");
+	}
+
+	Song existing("existing", *b);
+
+	NullStorage storage;
+	ScanPool pool(storage, 4);
+
+	constexpr unsigned N = 200;
+	static constexpr const char *prefixes[] = {
+		"song", "error", "unknown",
+	};
+
+	std::map<std::string, ScanPool::Job *> found;
+	ScanPool::JobList collected;
+
+	const auto Collect = [&](ScanPool::JobList &&jobs){
+		for (auto &job : jobs)
+			EXPECT_TRUE(found.emplace(job.name, &job).second)
+				<< job.name;
+
+		collected.splice(collected.end(), jobs);
+	};
+
+	for (unsigned i = 0; i < N; ++i) {
+		const auto name = prefixes[i % 3] + std::to_string(i);
+		Directory &directory = i % 2 == 0 ? *a : *b;
+		Song *song = i % 5 == 0 && &directory == b ? &existing : nullptr;
+		pool.Submit(directory, song, name.c_str(), StorageFileInfo());
+
+		Collect(pool.TakeDone());
+	}
+
+	Collect(pool.WaitAll());
+
+	EXPECT_TRUE(pool.TakeDone().empty());
+	EXPECT_EQ(N, found.size());
+	EXPECT_EQ(N, n_loaded);
+	EXPECT_GT(max_loading, 1u);
+	EXPECT_LE(max_loading, 4u);
+
+	for (unsigned i = 0; i < N; ++i) {
+		const auto name = prefixes[i % 3] + std::to_string(i);
+		auto f = found.find(name);
+		ASSERT_NE(f, found.end()) << name;
+
+		const auto &job = *f->second;
+		EXPECT_EQ(i % 2 == 0 ? a : b, &job.directory);
+		EXPECT_EQ(i % 5 == 0 && i % 2 != 0 ? &existing : nullptr,
+			  job.song);
+
+		switch (i % 3) {
+		case 0:
+			EXPECT_FALSE(job.error);
+			ASSERT_TRUE(job.result);
+			EXPECT_EQ(name, job.result->filename);
+			EXPECT_EQ(&job.directory, &job.result->parent);
+			break;
+
+		case 1:
+			EXPECT_TRUE(job.error);
+			EXPECT_FALSE(job.result);
+			break;
+
+		case 2:
+			EXPECT_FALSE(job.error);
+			EXPECT_FALSE(job.result);
+			break;
+		}
+	}
+}
+
+/**
+ * Jobs which have not been started when the pool is destroyed are
+ * discarded.
+ */
+TEST(ScanPool, Discard)
+{
+	ResetCounters();
+
+	std::unique_ptr<Directory> root(Directory::NewRoot());
+	NullStorage storage;
+
+	{
+		ScanPool pool(storage, 1);
+
+		for (unsigned i = 0; i < 4; ++i)
+			pool.Submit(*root, nullptr,
+				    ("slow" + std::to_string(i)).c_str(),
+				    StorageFileInfo());
+	}
+
+	EXPECT_LT(n_loaded, 4u);
+}
+
+#ifndef NDEBUG
+
+/**
+ * Directories and songs are referenced by a job until it has been
+ * collected.
+ */
+TEST(ScanPool, IsReferenced)
+{
+	ResetCounters();
+
+	std::unique_ptr<Directory> root(Directory::NewRoot());
+	Directory *a, *b, *c;
+	{
+		const ScopeDatabaseLock protect;
+		a = root->CreateChild("a");
+		b = a->CreateChild("b");
+		c = root->CreateChild("c");
+	}
+
+	Song song("song", *b), other("other", *b);
+
+	NullStorage storage;
+	ScanPool pool(storage, 2);
+
+	pool.Submit(*b, &song, "slow", StorageFileInfo());
+
+	EXPECT_TRUE(pool.IsReferenced(*root));
+	EXPECT_TRUE(pool.IsReferenced(*a));
+	EXPECT_TRUE(pool.IsReferenced(*b));
+	EXPECT_FALSE(pool.IsReferenced(*c));
+	EXPECT_TRUE(pool.IsReferenced(song));
+	EXPECT_FALSE(pool.IsReferenced(other));
+
+	/* a finished job which has not been collected yet */
+	while (n_loaded == 0)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	EXPECT_TRUE(pool.IsReferenced(*b));
+	EXPECT_TRUE(pool.IsReferenced(song));
+
+	EXPECT_EQ(1u, pool.WaitAll().size());
+
+	EXPECT_FALSE(pool.IsReferenced(*root));
+	EXPECT_FALSE(pool.IsReferenced(song));
+}
+
+#endif
@@ -0,0 +1,121 @@
+/*
+ * Unit tests for class SharedFilterResults.
+ */
+
+#include "output/SharedFilterResults.hxx"
+#include "MusicChunk.hxx"
+
+#include <gtest/gtest.h>
+
+#include <new>
+#include <thread>
+
+#include <string.h>
+
+namespace {
+
+struct ChunkSlot {
+	alignas(MusicChunk) uint8_t slot[MIN_CHUNK_SIZE];
+	MusicChunk *const chunk;
+
+	ChunkSlot() noexcept
+		:chunk(new(slot) MusicChunk(sizeof(slot))) {}
+
+	~ChunkSlot() noexcept {
+		chunk->~MusicChunk();
+	}
+};
+
+constexpr AudioFormat format(44100, SampleFormat::S16, 2);
+
+}
+
+TEST(SharedFilterResults, Unshared)
+{
+	ChunkSlot a;
+	SharedFilterResults results;
+	ConstBuffer<void> data = nullptr;
+
+	/* a single user doesn't need to share anything */
+	results.AddUser();
+	EXPECT_EQ(results.Begin(*a.chunk, format, ReplayGainMode::OFF, data),
+		  SharedFilterResults::Result::UNSHARED);
+	results.RemoveUser();
+}
+
+TEST(SharedFilterResults, Basic)
+{
+	ChunkSlot a, b;
+	SharedFilterResults results;
+	results.AddUser();
+	results.AddUser();
+
+	ConstBuffer<void> data = nullptr;
+	EXPECT_EQ(results.Begin(*a.chunk, format, ReplayGainMode::TRACK, data),
+		  SharedFilterResults::Result::COMPUTE);
+
+	/* the published copy must not depend on the filter's buffer */
+	char filtered[] = "abcd";
+	results.Commit(*a.chunk, {filtered, sizeof(filtered)});
+	memset(filtered, 0, sizeof(filtered));
+
+	EXPECT_EQ(results.Begin(*a.chunk, format, ReplayGainMode::TRACK, data),
+		  SharedFilterResults::Result::HIT);
+	EXPECT_EQ(data.size, 5u);
+	EXPECT_STREQ((const char *)data.data, "abcd");
+
+	/* mismatching parameters */
+	EXPECT_EQ(results.Begin(*a.chunk, format, ReplayGainMode::ALBUM, data),
+		  SharedFilterResults::Result::UNSHARED);
+
+	/* unmodified chunk data is not copied */
+	EXPECT_EQ(results.Begin(*b.chunk, format, ReplayGainMode::TRACK, data),
+		  SharedFilterResults::Result::COMPUTE);
+	results.Commit(*b.chunk, {b.chunk->data, 4});
+	EXPECT_EQ(results.Begin(*b.chunk, format, ReplayGainMode::TRACK, data),
+		  SharedFilterResults::Result::HIT);
+	EXPECT_EQ(data.data, b.chunk->data);
+
+	results.Forget(*a.chunk);
+	EXPECT_EQ(results.Begin(*a.chunk, format, ReplayGainMode::TRACK, data),
+		  SharedFilterResults::Result::COMPUTE);
+	results.Abort(*a.chunk);
+	EXPECT_EQ(results.Begin(*a.chunk, format, ReplayGainMode::TRACK, data),
+		  SharedFilterResults::Result::COMPUTE);
+
+	results.Clear();
+	results.RemoveUser();
+	results.RemoveUser();
+}
+
+TEST(SharedFilterResults, Wait)
+{
+	ChunkSlot a;
+	SharedFilterResults results;
+	results.AddUser();
+	results.AddUser();
+
+	ConstBuffer<void> data = nullptr;
+	ASSERT_EQ(results.Begin(*a.chunk, format, ReplayGainMode::OFF, data),
+		  SharedFilterResults::Result::COMPUTE);
+
+	/* the second output waits until the first one has
+	   published its result */
+	SharedFilterResults::Result result;
+	ConstBuffer<void> data2 = nullptr;
+	std::thread thread([&]{
+		result = results.Begin(*a.chunk, format,
+				       ReplayGainMode::OFF, data2);
+	});
+
+	static const char filtered[] = "xyz";
+	results.Commit(*a.chunk, {filtered, sizeof(filtered)});
+	thread.join();
+
+	EXPECT_EQ(result, SharedFilterResults::Result::HIT);
+	EXPECT_STREQ((const char *)data2.data, "xyz");
+
+	results.Clear();
+	results.RemoveUser();
+	results.RemoveUser();
+}
@@ -0,0 +1,363 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/*
+ * Unit tests for #TagIndex: "find" and "list" on a database with the
+ * index must return the same results as on one without it, also
+ * after songs have been added, removed and modified; and filters
+ * which the index cannot answer must fall back to a full scan.
+ */
+
+#include "db/plugins/simple/TagIndex.hxx"
+#include "db/plugins/simple/SimpleDatabasePlugin.hxx"
+#include "db/plugins/simple/Directory.hxx"
+#include "db/plugins/simple/Song.hxx"
+#include "db/DatabaseLock.hxx"
+#include "db/DatabaseListener.hxx"
+#include "db/Selection.hxx"
+#include "song/Filter.hxx"
+#include "song/LightSong.hxx"
+#include "tag/Builder.hxx"
+#include "tag/Tag.hxx"
+#include "config/Block.hxx"
+#include "event/Loop.hxx"
+#include "lib/icu/Init.hxx"
+#include "util/ConstBuffer.hxx"
+#include "util/RecursiveMap.hxx"
+
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <string.h>
+#include <unistd.h>
+
+class NullDatabaseListener final : public DatabaseListener {
+public:
+	void OnDatabaseModified() noexcept override {}
+	void OnDatabaseSongRemoved(const char *) noexcept override {}
+};
+
+static std::unique_ptr<SimpleDatabase>
+OpenDatabase(bool tag_index)
+{
+	/* the file does not exist; the database starts empty */
+	const auto path = testing::TempDir() + "mpd_test_tag_index_" +
+		std::to_string(getpid());
+
+	ConfigBlock block;
+	block.AddBlockParam("path", path);
+	block.AddBlockParam("tag_index", tag_index ? "yes" : "no");
+
+	EventLoop event_loop;
+	NullDatabaseListener listener;
+	auto db = SimpleDatabase::Create(event_loop, event_loop,
+					 listener, block);
+	std::unique_ptr<SimpleDatabase> result((SimpleDatabase *)db.release());
+	result->Open();
+	return result;
+}
+
+static Tag
+MakeSongTag(unsigned i)
+{
+	TagBuilder tag;
+
+	/* some songs have no artist, some have the same one twice */
+	if (i % 7 != 0)
+		tag.AddItem(TAG_ARTIST, ("Artist " + std::to_string(i % 5)).c_str());
+	if (i % 11 == 0)
+		tag.AddItem(TAG_ARTIST, ("Artist " + std::to_string(i % 5)).c_str());
+
+	tag.AddItem(TAG_ALBUM, ("Album " + std::to_string(i % 6)).c_str());
+
+	/* the others fall back to the artist */
+	if (i % 2 == 0)
+		tag.AddItem(TAG_ALBUM_ARTIST, ("Artist " + std::to_string(i % 3)).c_str());
+
+	tag.AddItem(TAG_GENRE, i % 3 == 0 ? "Jazz" : "Rock");
+
+	/* not indexed */
+	tag.AddItem(TAG_TITLE, ("Title " + std::to_string(i)).c_str());
+
+	return tag.Commit();
+}
+
+static void
+AddSongs(Directory &root, unsigned begin, unsigned end)
+{
+	const ScopeDatabaseLock protect;
+
+	for (unsigned i = begin; i < end; ++i) {
+		Directory &directory =
+			*root.MakeChild(("d" + std::to_string(i % 4)).c_str())
+			->MakeChild(("s" + std::to_string(i % 3)).c_str());
+
+		auto song = std::make_unique<Song>("f" + std::to_string(i) + ".flac",
+						   directory);
+		song->tag = MakeSongTag(i);
+		directory.AddSong(std::move(song));
+	}
+}
+
+static void
+ForEachSong(Directory &directory, const std::function<void(Song &)> &f)
+{
+	directory.ForEachSongSafe(f);
+
+	for (auto &child : directory.children)
+		ForEachSong(child, f);
+}
+
+/**
+ * Remove every third song.
+ */
+static void
+RemoveSongs(Directory &root)
+{
+	const ScopeDatabaseLock protect;
+
+	unsigned n = 0;
+	ForEachSong(root, [&n](Song &song){
+			if (n++ % 3 == 0)
+				song.parent.RemoveSong(&song);
+		});
+}
+
+/**
+ * Replace the tags of every other song, as the update does.
+ */
+static void
+ModifySongs(Directory &root)
+{
+	const ScopeDatabaseLock protect;
+
+	unsigned n = 0;
+	ForEachSong(root, [&n](Song &song){
+			if (n++ % 2 != 0)
+				return;
+
+			const Tag old_tag(song.tag);
+			song.tag = MakeSongTag(n * 13 + 1);
+			song.parent.ReindexSong(song, old_tag);
+		});
+}
+
+static SongFilter
+ParseFilter(const char *expression, bool fold_case=false)
+{
+	SongFilter filter;
+	filter.Parse({&expression, 1}, fold_case);
+	filter.Optimize();
+	return filter;
+}
+
+static std::vector<std::string>
+Find(const Database &db, const char *uri, const SongFilter &filter)
+{
+	std::vector<std::string> result;
+	db.Visit(DatabaseSelection(uri, true, &filter),
+		 [&result](const LightSong &song){
+			 result.emplace_back(song.GetURI());
+		 });
+	return result;
+}
+
+static void
+Flatten(std::vector<std::string> &dest, const std::string &prefix,
+	const RecursiveMap<std::string> &map)
+{
+	for (const auto &i : map) {
+		const auto key = prefix + "/" + i.first;
+		dest.push_back(key);
+		Flatten(dest, key, i.second);
+	}
+}
+
+static std::vector<std::string>
+List(const Database &db, std::vector<TagType> tag_types,
+     const SongFilter *filter)
+{
+	const DatabaseSelection selection("", true, filter);
+	const auto map = db.CollectUniqueTags(selection,
+					      {tag_types.data(), tag_types.size()});
+
+	std::vector<std::string> result;
+	Flatten(result, std::string(), map);
+	return result;
+}
+
+static constexpr const char *filters[] = {
+	/* can be answered by the index */
+	"(Artist == \"Artist 1\")",
+	"(Album == \"Album 3\")",
+	"(Genre == \"Jazz\")",
+	"(AlbumArtist == \"Artist 2\")",
+	"(Artist == \"nonexistent\")",
+	"((Artist == \"Artist 1\") AND (Album == \"Album 1\"))",
+	"((Artist == \"Artist 1\") AND (Title == \"Title 6\"))",
+	"((Artist == \"Artist 1\") AND (Artist == \"Artist 2\"))",
+
+	/* full scan */
+	"(Artist contains \"1\")",
+	"(!(Artist == \"Artist 1\"))",
+	"(Artist != \"Artist 1\")",
+	"(Artist == \"\")",
+	"(Title == \"Title 5\")",
+	"((Artist != \"Artist 1\") AND (Genre contains \"ock\"))",
+};
+
+/**
+ * Compare the results of the two databases.
+ */
+static void
+Compare(const Database &indexed, const Database &plain)
+{
+	for (const char *expression : filters) {
+		const auto filter = ParseFilter(expression);
+
+		EXPECT_EQ(Find(plain, "", filter), Find(indexed, "", filter))
+			<< expression;
+		EXPECT_EQ(Find(plain, "d1", filter),
+			  Find(indexed, "d1", filter))
+			<< expression;
+
+		const auto folded = ParseFilter(expression, true);
+		EXPECT_EQ(Find(plain, "", folded), Find(indexed, "", folded))
+			<< expression;
+
+		EXPECT_EQ(List(plain, {TAG_ALBUM}, &filter),
+			  List(indexed, {TAG_ALBUM}, &filter))
+			<< expression;
+	}
+
+	const std::vector<std::vector<TagType>> lists = {
+		{TAG_ARTIST},
+		{TAG_ALBUM_ARTIST},
+		{TAG_ALBUM_ARTIST, TAG_ALBUM},
+		{TAG_GENRE, TAG_ARTIST, TAG_ALBUM},
+		{TAG_TITLE},
+	};
+
+	for (const auto &tag_types : lists)
+		EXPECT_EQ(List(plain, tag_types, nullptr),
+			  List(indexed, tag_types, nullptr));
+}
+
+class TagIndexTest : public testing::Test {
+public:
+	static void SetUpTestSuite() {
+		IcuInit();
+	}
+
+	static void TearDownTestSuite() noexcept {
+		IcuFinish();
+	}
+};
+
+TEST_F(TagIndexTest, Consistency)
+{
+	auto indexed = OpenDatabase(true);
+	auto plain = OpenDatabase(false);
+
+	for (auto *db : {indexed.get(), plain.get()})
+		AddSongs(db->GetRoot(), 0, 100);
+
+	ASSERT_FALSE(Find(*plain, "", ParseFilter(filters[0])).empty());
+	Compare(*indexed, *plain);
+
+	/* added after the index was built */
+	for (auto *db : {indexed.get(), plain.get()})
+		AddSongs(db->GetRoot(), 100, 150);
+	Compare(*indexed, *plain);
+
+	for (auto *db : {indexed.get(), plain.get()})
+		RemoveSongs(db->GetRoot());
+	Compare(*indexed, *plain);
+
+	for (auto *db : {indexed.get(), plain.get()})
+		ModifySongs(db->GetRoot());
+	Compare(*indexed, *plain);
+
+	for (auto *db : {indexed.get(), plain.get()}) {
+		const ScopeDatabaseLock protect;
+		db->GetRoot().FindChild("d2")->Delete();
+	}
+	Compare(*indexed, *plain);
+
+	indexed->Close();
+	plain->Close();
+}
+
+/**
+ * Check which filters the index can answer, and that it finds the
+ * right songs.
+ */
+TEST_F(TagIndexTest, Fallback)
+{
+	TagIndex index(TagIndex::DefaultMask());
+
+	std::unique_ptr<Directory> root(Directory::NewRoot());
+	AddSongs(*root, 0, 60);
+
+	const ScopeDatabaseLock protect;
+	index.Build(*root);
+
+	for (const char *expression : filters) {
+		const auto filter = ParseFilter(expression);
+		const bool exact = strstr(expression, "Title") == nullptr ||
+			strstr(expression, "Artist 1") != nullptr;
+		const bool indexed = expression[1] != '!' &&
+			strstr(expression, "!=") == nullptr &&
+			strstr(expression, "contains") == nullptr &&
+			strstr(expression, "\"\"") == nullptr &&
+			exact;
+
+		std::vector<std::string> found;
+		EXPECT_EQ(indexed,
+			  index.VisitSongs(*root, filter,
+					   [&found](const LightSong &song){
+						   found.emplace_back(song.GetURI());
+					   }))
+			<< expression;
+
+		if (!indexed)
+			continue;
+
+		std::vector<std::string> expected;
+		root->Walk(true, &filter, VisitDirectory(),
+			   [&expected](const LightSong &song){
+				   expected.emplace_back(song.GetURI());
+			   },
+			   VisitPlaylist());
+		EXPECT_EQ(expected, found) << expression;
+	}
+
+	/* a case-insensitive comparison can't use the index */
+	EXPECT_FALSE(index.VisitSongs(*root,
+				      ParseFilter(filters[0], true),
+				      [](const LightSong &){}));
+
+	index.Clear();
+	root.reset();
+}
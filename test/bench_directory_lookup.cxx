@@ -0,0 +1,141 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Micro-benchmark for Directory::FindChild(), Directory::FindSong()
+ * and Directory::LookupDirectory() on a synthetic tree with one flat
+ * directory containing many sub directories (e.g. thousands of album
+ * folders below one artist), with about one million entries in total.
+ *
+ * Usage: bench_directory_lookup [N_DIRECTORIES [N_SONGS]]
+ */
+
+#include "db/plugins/simple/Directory.hxx"
+#include "db/plugins/simple/Song.hxx"
+#include "db/DatabaseLock.hxx"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using Clock = std::chrono::steady_clock;
+
+static double
+Seconds(Clock::time_point start) noexcept
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static std::string
+MakeName(const char *prefix, unsigned i)
+{
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%s %06u", prefix, i);
+	return buffer;
+}
+
+/**
+ * The old implementation of Directory::FindChild(), for comparison.
+ */
+static const Directory *
+LinearFindChild(const Directory &directory, const char *name) noexcept
+{
+	for (const auto &child : directory.children)
+		if (strcmp(child.GetName(), name) == 0)
+			return &child;
+
+	return nullptr;
+}
+
+int
+main(int argc, char **argv)
+{
+	const unsigned n_directories = argc > 1
+		? strtoul(argv[1], nullptr, 10)
+		: 20000;
+	const unsigned n_songs = argc > 2
+		? strtoul(argv[2], nullptr, 10)
+		: 50;
+
+	const ScopeDatabaseLock protect;
+
+	std::unique_ptr<Directory> root(Directory::NewRoot());
+	Directory &artist = *root->CreateChild("Artist");
+
+	std::vector<std::string> album_names, song_names;
+	for (unsigned i = 0; i < n_directories; ++i)
+		album_names.emplace_back(MakeName("Album", i));
+	for (unsigned i = 0; i < n_songs; ++i)
+		song_names.emplace_back(MakeName("Track", i) + ".flac");
+
+	auto start = Clock::now();
+	for (const auto &album_name : album_names) {
+		Directory &album = *artist.MakeChild(album_name.c_str());
+		for (const auto &song_name : song_names)
+			if (album.FindSong(song_name.c_str()) == nullptr)
+				album.AddSong(std::make_unique<Song>(song_name,
+								     album));
+	}
+
+	printf("build %u directories with %u songs each: %.3f s\n",
+	       n_directories, n_songs, Seconds(start));
+
+	start = Clock::now();
+	unsigned found = 0;
+	for (const auto &album_name : album_names)
+		found += artist.FindChild(album_name.c_str()) != nullptr;
+	printf("FindChild x %u: %.3f s (found %u)\n",
+	       n_directories, Seconds(start), found);
+
+	start = Clock::now();
+	found = 0;
+	for (const auto &album_name : album_names) {
+		const auto uri = "Artist/" + album_name + "/" +
+			song_names.back();
+		const auto r = root->LookupDirectory(uri.c_str());
+		if (r.uri != nullptr)
+			found += r.directory->FindSong(r.uri) != nullptr;
+	}
+	printf("LookupDirectory+FindSong x %u: %.3f s (found %u)\n",
+	       n_directories, Seconds(start), found);
+
+	/* the linear search is much slower; try only a sample */
+	const unsigned n_sample = std::min(n_directories, 200u);
+	start = Clock::now();
+	found = 0;
+	for (unsigned i = 0; i < n_sample; ++i)
+		found += LinearFindChild(artist,
+					 album_names[n_directories - 1 - i].c_str()) != nullptr;
+	printf("linear FindChild x %u: %.3f s (found %u)\n",
+	       n_sample, Seconds(start), found);
+
+	start = Clock::now();
+	while (!artist.children.empty())
+		artist.children.front().Delete();
+	printf("delete %u directories: %.3f s\n",
+	       n_directories, Seconds(start));
+
+	return EXIT_SUCCESS;
+}
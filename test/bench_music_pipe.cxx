@@ -0,0 +1,250 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Contention benchmark for #MusicBuffer and #MusicPipe: replays the
+ * chunk traffic of a playing MPD.  A "decoder" thread allocates and
+ * fills chunks and pushes them into the decoder pipe, a "player"
+ * thread moves them to the output pipe and returns them to the
+ * buffer after all "output" threads have consumed them (like
+ * MultipleOutputs::CheckPipe()).
+ *
+ * It reports the CPU time per second of audio for each chunk size
+ * (see "audio_buffer_chunk_size"); without CHUNK_SIZE, all power of
+ * two sizes from 4 kB to 256 kB are measured.
+ *
+ * Usage: bench_music_pipe [N_OUTPUTS [AUDIO_SECONDS [BUFFER_SIZE [CHUNK_SIZE]]]]
+ */
+
+#include "MusicBuffer.hxx"
+#include "MusicPipe.hxx"
+#include "MusicChunk.hxx"
+#include "AudioFormat.hxx"
+#include "util/StringBuffer.hxx"
+#include "output/SharedPipeConsumer.hxx"
+#include "thread/Mutex.hxx"
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <list>
+#include <thread>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr AudioFormat audio_format(384000, SampleFormat::S32, 8);
+
+struct Output {
+	Mutex mutex;
+	SharedPipeConsumer consumer;
+
+	/**
+	 * Cleared while the player removes the tail chunk, see
+	 * AudioOutputControl::LockClearTailChunk().
+	 */
+	bool allow_play = true;
+
+	uint64_t n_bytes = 0, checksum = 0;
+
+	explicit Output(const MusicPipe &pipe) noexcept {
+		consumer.Init(pipe);
+	}
+
+	void Run(const std::atomic<bool> &done) noexcept {
+		while (true) {
+			const MusicChunk *chunk;
+
+			{
+				const std::lock_guard<Mutex> protect(mutex);
+				chunk = allow_play ? consumer.Get() : nullptr;
+			}
+
+			if (chunk == nullptr) {
+				if (done.load(std::memory_order_acquire))
+					break;
+
+				std::this_thread::yield();
+				continue;
+			}
+
+			/* "play" the chunk */
+			for (size_t i = 0; i < chunk->length; i += 64)
+				checksum += chunk->data[i];
+			n_bytes += chunk->length;
+
+			const std::lock_guard<Mutex> protect(mutex);
+			consumer.Consume(*chunk);
+		}
+	}
+};
+
+static void
+RunDecoder(MusicBuffer &buffer, MusicPipe &pipe, unsigned n_chunks) noexcept
+{
+	for (unsigned i = 0; i < n_chunks; ++i) {
+		auto chunk = buffer.Allocate();
+		while (!chunk) {
+			/* the buffer is full; wait for the player */
+			std::this_thread::yield();
+			chunk = buffer.Allocate();
+		}
+
+		auto w = chunk->Write(audio_format, SongTime::zero(), 0);
+		memset(w.data, i, w.size);
+		chunk->Expand(audio_format, w.size);
+
+		pipe.Push(std::move(chunk));
+	}
+}
+
+/**
+ * Remove all chunks from the output pipe which have been consumed
+ * by all outputs.
+ */
+static void
+CheckPipe(MusicPipe &pipe, std::list<Output> &outputs) noexcept
+{
+	const MusicChunk *chunk;
+	while ((chunk = pipe.Peek()) != nullptr) {
+		for (auto &o : outputs) {
+			const std::lock_guard<Mutex> protect(o.mutex);
+			if (!o.consumer.IsConsumed(*chunk))
+				return;
+		}
+
+		const bool is_tail = chunk->next == nullptr;
+		if (is_tail) {
+			for (auto &o : outputs) {
+				const std::lock_guard<Mutex> protect(o.mutex);
+				o.consumer.ClearTail(*chunk);
+				o.allow_play = false;
+			}
+		}
+
+		pipe.Shift();
+
+		if (is_tail) {
+			for (auto &o : outputs) {
+				const std::lock_guard<Mutex> protect(o.mutex);
+				o.allow_play = true;
+			}
+		}
+	}
+}
+
+static void
+RunPlayer(MusicPipe &decoder_pipe, MusicPipe &output_pipe,
+	  std::list<Output> &outputs, unsigned n_chunks) noexcept
+{
+	for (unsigned i = 0; i < n_chunks;) {
+		auto chunk = decoder_pipe.Shift();
+		if (chunk) {
+			output_pipe.Push(std::move(chunk));
+			++i;
+		} else
+			std::this_thread::yield();
+
+		CheckPipe(output_pipe, outputs);
+	}
+
+	while (!output_pipe.IsEmpty()) {
+		std::this_thread::yield();
+		CheckPipe(output_pipe, outputs);
+	}
+}
+
+static void
+Run(unsigned n_outputs, double audio_seconds,
+    size_t buffer_size, size_t chunk_size) noexcept
+{
+	MusicBuffer buffer(buffer_size / chunk_size, chunk_size);
+	MusicPipe decoder_pipe, output_pipe;
+
+	const size_t chunk_capacity = buffer.GetChunkCapacity();
+	const unsigned n_chunks =
+		audio_format.TimeToSize(std::chrono::duration<double>(audio_seconds))
+		/ chunk_capacity;
+
+	std::list<Output> outputs;
+	for (unsigned i = 0; i < n_outputs; ++i)
+		outputs.emplace_back(output_pipe);
+
+	std::atomic<bool> done{false};
+
+	const auto start = Clock::now();
+	const std::clock_t start_cpu = std::clock();
+
+	std::list<std::thread> threads;
+	for (auto &o : outputs)
+		threads.emplace_back([&o, &done]{ o.Run(done); });
+
+	std::thread decoder([&]{
+		RunDecoder(buffer, decoder_pipe, n_chunks);
+	});
+
+	RunPlayer(decoder_pipe, output_pipe, outputs, n_chunks);
+	done.store(true, std::memory_order_release);
+
+	decoder.join();
+	for (auto &t : threads)
+		t.join();
+
+	const double s = std::chrono::duration<double>(Clock::now() - start).count();
+	const double cpu = double(std::clock() - start_cpu) / CLOCKS_PER_SEC;
+
+	uint64_t n_bytes = 0, checksum = 0;
+	for (const auto &o : outputs) {
+		n_bytes += o.n_bytes;
+		checksum += o.checksum;
+	}
+
+	const double played_seconds =
+		audio_format.SizeToTime<std::chrono::duration<double>>(n_bytes / n_outputs).count();
+
+	printf("%6zu kB %8u chunks %8.3f s %9.0f chunks/s %8.3f ms CPU/audio-s (%llx)\n",
+	       chunk_size / 1024, n_chunks, s, n_chunks / s,
+	       cpu * 1000 / played_seconds,
+	       (unsigned long long)checksum);
+}
+
+int
+main(int argc, char **argv)
+{
+	const unsigned n_outputs = argc > 1 ? strtoul(argv[1], nullptr, 10) : 2;
+	const double audio_seconds = argc > 2 ? strtod(argv[2], nullptr) : 60;
+	const size_t buffer_size = argc > 3
+		? strtoul(argv[3], nullptr, 10)
+		: 64 * 1024 * 1024;
+	const size_t chunk_size = argc > 4 ? strtoul(argv[4], nullptr, 10) : 0;
+
+	printf("%u outputs, %s, %zu kB buffer\n", n_outputs,
+	       ToString(audio_format).c_str(), buffer_size / 1024);
+
+	if (chunk_size > 0)
+		Run(n_outputs, audio_seconds, buffer_size, chunk_size);
+	else
+		for (size_t i = MIN_CHUNK_SIZE; i <= 256 * 1024; i *= 2)
+			Run(n_outputs, audio_seconds, buffer_size, i);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,183 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*
+ * Micro-benchmark for the #PcmConvertKernels: checks that the
+ * results of all kernel sets supported by this CPU are bit-exact
+ * with the generic implementation, and reports their throughput in
+ * million samples per second.
+ *
+ * Usage: bench_pcm_convert [N_SAMPLES [N_ITERATIONS]]
+ */
+
+#include "pcm/ConvertKernels.hxx"
+#include "util/ConstBuffer.hxx"
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using Clock = std::chrono::steady_clock;
+
+static double
+Seconds(Clock::time_point start) noexcept
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static size_t n_samples = 4096 * 6;
+static unsigned n_iterations = 2000;
+static bool failed = false;
+
+struct TestData {
+	std::vector<int16_t> s16;
+	std::vector<int32_t> s24, s32;
+	std::vector<float> f;
+	std::vector<uint8_t> packed;
+
+	explicit TestData(size_t n)
+		:s16(n), s24(n), s32(n), f(n), packed(n * 3) {
+		std::minstd_rand engine;
+		std::uniform_real_distribution<float> dis(-1.2, 1.2);
+
+		for (size_t i = 0; i < n; ++i) {
+			const auto r = engine();
+			s16[i] = int16_t(r);
+			s32[i] = int32_t(r << 1);
+			s24[i] = s32[i] >> 8;
+			f[i] = dis(engine);
+		}
+
+		/* the edge cases of the float conversion */
+		f[0] = 1;
+		f[1] = -1;
+		f[2] = 0.99999994f;
+
+		for (auto &i : packed)
+			i = uint8_t(engine());
+	}
+
+	const void *Get(const int16_t *) const noexcept {
+		return s16.data();
+	}
+
+	const void *Get(const uint16_t *) const noexcept {
+		return s16.data();
+	}
+
+	const void *Get(const int32_t *) const noexcept {
+		return s32.data();
+	}
+
+	const void *Get(const uint32_t *) const noexcept {
+		return s32.data();
+	}
+
+	const void *Get(const float *) const noexcept {
+		return f.data();
+	}
+
+	const void *Get(const uint8_t *) const noexcept {
+		return packed.data();
+	}
+};
+
+/**
+ * @param n the number of samples (or frames) passed to the kernel
+ * @param dest_size the number of destination values per sample (or
+ * frame)
+ */
+template<typename D, typename S>
+static void
+Run(const TestData &data, const char *name,
+    void (*PcmConvertKernels::*f)(D *, const S *, size_t) noexcept,
+    size_t n, size_t dest_size=1, const void *src=nullptr)
+{
+	if (src == nullptr)
+		src = data.Get((const S *)nullptr);
+
+	std::vector<D> expected(n * dest_size), actual(n * dest_size);
+	(pcm_convert_kernels_generic.*f)(expected.data(), (const S *)src, n);
+
+	for (const auto *k : GetSupportedPcmConvertKernels()) {
+		memset(actual.data(), 0, actual.size() * sizeof(D));
+		(k->*f)(actual.data(), (const S *)src, n);
+		const bool ok = memcmp(expected.data(), actual.data(),
+				       actual.size() * sizeof(D)) == 0;
+		if (!ok)
+			failed = true;
+
+		const auto start = Clock::now();
+		for (unsigned i = 0; i < n_iterations; ++i)
+			(k->*f)(actual.data(), (const S *)src, n);
+		const double s = Seconds(start);
+
+		printf("%-8s %-14s %9.1f Msamples/s%s\n",
+		       k->name, name,
+		       double(n * dest_size) * n_iterations / s / 1e6,
+		       ok ? "" : "  MISMATCH");
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	if (argc > 1)
+		n_samples = strtoul(argv[1], nullptr, 10);
+	if (argc > 2)
+		n_iterations = strtoul(argv[2], nullptr, 10);
+
+	/* odd sizes exercise the non-vectorized tail */
+	n_samples |= 1;
+
+	const TestData data(n_samples);
+	const size_t n = n_samples;
+
+	Run(data, "s16_to_s24", &PcmConvertKernels::s16_to_s24, n);
+	Run(data, "s16_to_s32", &PcmConvertKernels::s16_to_s32, n);
+	Run(data, "s24_to_s32", &PcmConvertKernels::s24_to_s32, n, 1,
+	    data.s24.data());
+	Run(data, "s32_to_s24", &PcmConvertKernels::s32_to_s24, n);
+	Run(data, "s16_to_float", &PcmConvertKernels::s16_to_float, n);
+	Run(data, "s24_to_float", &PcmConvertKernels::s24_to_float, n, 1,
+	    data.s24.data());
+	Run(data, "s32_to_float", &PcmConvertKernels::s32_to_float, n);
+	Run(data, "float_to_s16", &PcmConvertKernels::float_to_s16, n);
+	Run(data, "float_to_s24", &PcmConvertKernels::float_to_s24, n);
+	Run(data, "float_to_s32", &PcmConvertKernels::float_to_s32, n);
+	Run(data, "pack_24", &PcmConvertKernels::pack_24, n, 3,
+	    data.s24.data());
+	Run(data, "unpack_24", &PcmConvertKernels::unpack_24, n);
+	Run(data, "reverse_16", &PcmConvertKernels::reverse_16, n);
+	Run(data, "reverse_32", &PcmConvertKernels::reverse_32, n);
+	Run(data, "alsa_51_16", &PcmConvertKernels::alsa_51_16, n / 6, 6);
+	Run(data, "alsa_51_32", &PcmConvertKernels::alsa_51_32, n / 6, 6);
+	Run(data, "alsa_71_16", &PcmConvertKernels::alsa_71_16, n / 8, 8);
+	Run(data, "alsa_71_32", &PcmConvertKernels::alsa_71_32, n / 8, 8);
+
+	if (failed) {
+		fprintf(stderr, "Results differ from the generic implementation\n");
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Benchmark for #PcmDsd: reports the realtime factor (duration of
+ * the audio divided by the processing time) for several DSD rates,
+ * channel counts and decimation ratios.  "serial" converts each
+ * channel with its own mono #PcmDsd on the calling thread, "parallel"
+ * converts all channels at once, which uses the #WorkerPool returned
+ * by GetPcmDsdPool().
+ *
+ * Usage: bench_pcm_dsd [SECONDS]
+ */
+
+#include "config.h"
+#include "pcm/PcmDsd.hxx"
+#include "util/ConstBuffer.hxx"
+
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using Clock = std::chrono::steady_clock;
+
+static double
+Seconds(Clock::time_point start) noexcept
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/**
+ * The number of DSD frames (bytes per channel) passed to each
+ * ToFloat() call; this is what a decoder typically submits.
+ */
+static constexpr size_t CHUNK_FRAMES = 4096;
+
+static double duration = 10;
+
+static double
+RunParallel(const std::vector<uint8_t> &src, unsigned channels,
+	    unsigned ratio, size_t n_chunks)
+{
+	PcmDsd dsd;
+	dsd.SetRatio(ratio);
+
+	const size_t chunk_size = CHUNK_FRAMES * channels;
+
+	const auto start = Clock::now();
+	for (size_t i = 0; i < n_chunks; ++i)
+		dsd.ToFloat(channels, {src.data() + (i % 16) * chunk_size,
+				       chunk_size});
+	return Seconds(start);
+}
+
+static double
+RunSerial(const std::vector<uint8_t> &src, unsigned channels,
+	  unsigned ratio, size_t n_chunks)
+{
+	const auto dsd = std::make_unique<PcmDsd[]>(channels);
+	for (unsigned c = 0; c < channels; ++c)
+		dsd[c].SetRatio(ratio);
+
+	const size_t chunk_size = CHUNK_FRAMES * channels;
+	std::vector<uint8_t> mono(CHUNK_FRAMES);
+
+	const auto start = Clock::now();
+	for (size_t i = 0; i < n_chunks; ++i) {
+		const uint8_t *chunk = src.data() + (i % 16) * chunk_size;
+
+		for (unsigned c = 0; c < channels; ++c) {
+			for (size_t j = 0; j < CHUNK_FRAMES; ++j)
+				mono[j] = chunk[j * channels + c];
+
+			dsd[c].ToFloat(1, {mono.data(), CHUNK_FRAMES});
+		}
+	}
+	return Seconds(start);
+}
+
+int
+main(int argc, char **argv)
+{
+	if (argc > 1)
+		duration = strtod(argv[1], nullptr);
+
+	std::minstd_rand engine;
+	std::vector<uint8_t> src(16 * CHUNK_FRAMES * 8);
+	for (auto &i : src)
+		i = uint8_t(engine());
+
+	printf("%-7s %-3s %-6s %-9s %10s %10s\n",
+	       "rate", "ch", "ratio", "pcm_rate", "serial", "parallel");
+
+	for (unsigned dsd = 64; dsd <= 512; dsd *= 2) {
+		/* DSD64 is 2.8224 MHz, i.e. 352800 bytes per second
+		   per channel */
+		const unsigned dsd_rate = 352800 * dsd / 64;
+		const size_t n_chunks = size_t(duration * dsd_rate) /
+			CHUNK_FRAMES;
+		const double seconds = double(n_chunks * CHUNK_FRAMES) /
+			dsd_rate;
+
+		for (unsigned channels : {2u, 6u}) {
+			for (unsigned ratio = PcmDsd::MIN_RATIO;
+			     ratio <= PcmDsd::MAX_RATIO; ratio *= 2) {
+				const unsigned pcm_rate = dsd_rate * 8 / ratio;
+				if (pcm_rate < 44100)
+					break;
+
+				const double s = RunSerial(src, channels,
+							   ratio, n_chunks);
+				const double p = RunParallel(src, channels,
+							     ratio, n_chunks);
+
+				printf("DSD%-4u %-3u %-6u %-9u %9.1fx %9.1fx\n",
+				       dsd, channels, ratio, pcm_rate,
+				       seconds / s, seconds / p);
+			}
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
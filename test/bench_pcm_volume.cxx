@@ -0,0 +1,148 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*
+ * Micro-benchmark for the #PcmVolumeKernels: reports the throughput
+ * of the volume and mix kernels of all kernel sets supported by this
+ * CPU, in million samples per second.
+ *
+ * Usage: bench_pcm_volume [N_SAMPLES [N_ITERATIONS]]
+ */
+
+#include "pcm/VolumeKernels.hxx"
+#include "pcm/Volume.hxx"
+#include "util/ConstBuffer.hxx"
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using Clock = std::chrono::steady_clock;
+
+static double
+Seconds(Clock::time_point start) noexcept
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+template<typename T, typename F>
+static void
+Run(const char *kernels_name, const char *name,
+    std::vector<T> &a, unsigned n_iterations, F &&f)
+{
+	const auto start = Clock::now();
+	for (unsigned i = 0; i < n_iterations; ++i)
+		f();
+	const double s = Seconds(start);
+
+	/* print a sample to keep the compiler from discarding the
+	   results */
+	printf("%-8s %-12s %8.1f Msamples/s (%d)\n",
+	       kernels_name, name,
+	       double(a.size()) * n_iterations / s / 1e6,
+	       int(a[a.size() / 2]));
+}
+
+int
+main(int argc, char **argv)
+{
+	const size_t n_samples = argc > 1
+		? strtoul(argv[1], nullptr, 10)
+		: 4096;
+	const unsigned n_iterations = argc > 2
+		? strtoul(argv[2], nullptr, 10)
+		: 20000;
+
+	std::minstd_rand engine;
+
+	std::vector<int16_t> s16_src(n_samples), s16_dest(n_samples);
+	std::vector<int32_t> s32_src(n_samples), s32_dest(n_samples);
+	std::vector<int32_t> s24_src(n_samples), s24_dest(n_samples);
+	std::vector<float> f_src(n_samples), f_dest(n_samples);
+
+	for (size_t i = 0; i < n_samples; ++i) {
+		const auto r = engine();
+		s16_src[i] = int16_t(r);
+		s32_src[i] = int32_t(r);
+		s24_src[i] = int32_t(r << 8) >> 8;
+		f_src[i] = int16_t(r) / 32768.f;
+	}
+
+	constexpr int volume = PCM_VOLUME_1 * 3 / 4;
+	constexpr int volume2 = PCM_VOLUME_1 - volume;
+	const float fvolume = pcm_volume_to_float(volume);
+	const float fvolume2 = pcm_volume_to_float(volume2);
+
+	for (const auto *k : GetSupportedPcmVolumeKernels()) {
+		PcmDither dither;
+		auto &lanes = dither.GetLanes();
+
+		Run(k->name, "s16", s16_dest, n_iterations, [&]{
+				k->s16(lanes, s16_dest.data(), s16_src.data(),
+				       n_samples, volume);
+			});
+
+		Run(k->name, "s16_to_s24", s24_dest, n_iterations, [&]{
+				k->s16_to_s24(s24_dest.data(), s16_src.data(),
+					      n_samples, volume);
+			});
+
+		Run(k->name, "s24", s24_dest, n_iterations, [&]{
+				k->s24(lanes, s24_dest.data(), s24_src.data(),
+				       n_samples, volume);
+			});
+
+		Run(k->name, "s32", s32_dest, n_iterations, [&]{
+				k->s32(lanes, s32_dest.data(), s32_src.data(),
+				       n_samples, volume);
+			});
+
+		Run(k->name, "float", f_dest, n_iterations, [&]{
+				k->fl(f_dest.data(), f_src.data(),
+				      n_samples, fvolume);
+			});
+
+		Run(k->name, "add_s16", s16_dest, n_iterations, [&]{
+				k->add_s16(lanes, s16_dest.data(),
+					   s16_src.data(), n_samples,
+					   volume, volume2);
+			});
+
+		Run(k->name, "add_s24", s24_dest, n_iterations, [&]{
+				k->add_s24(lanes, s24_dest.data(),
+					   s24_src.data(), n_samples,
+					   volume, volume2);
+			});
+
+		Run(k->name, "add_s32", s32_dest, n_iterations, [&]{
+				k->add_s32(lanes, s32_dest.data(),
+					   s32_src.data(), n_samples,
+					   volume, volume2);
+			});
+
+		Run(k->name, "add_float", f_dest, n_iterations, [&]{
+				k->add_fl(f_dest.data(), f_src.data(),
+					  n_samples, fvolume, fvolume2);
+			});
+	}
+
+	return EXIT_SUCCESS;
+}
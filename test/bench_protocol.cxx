@@ -0,0 +1,203 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/*
+ * A protocol throughput benchmark: it connects to a running MPD on
+ * 127.0.0.1 and sends batches of pipelined "status", "currentsong"
+ * and "playlistinfo" commands (without "command_list_begin"), and
+ * measures how many commands per second the server completes.
+ *
+ * Usage: bench_protocol PORT [BATCH] [ROUNDS]
+ */
+
+#include "net/UniqueSocketDescriptor.hxx"
+#include "net/IPv4Address.hxx"
+#include "util/PrintException.hxx"
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using std::chrono::steady_clock;
+
+static constexpr char batch_commands[] =
+	"status\n"
+	"currentsong\n"
+	"playlistinfo\n";
+
+static constexpr unsigned COMMANDS_PER_BATCH = 3;
+
+/**
+ * Parses the server's responses and counts the completed commands.
+ */
+class ResponseCounter {
+	std::string line;
+
+public:
+	unsigned n_ok = 0, n_ack = 0;
+
+	uint64_t n_bytes = 0;
+
+	unsigned GetCompleted() const noexcept {
+		return n_ok + n_ack;
+	}
+
+	void Feed(const char *data, size_t length) noexcept {
+		n_bytes += length;
+
+		while (length > 0) {
+			const char *newline = (const char *)
+				memchr(data, '\n', length);
+			if (newline == nullptr) {
+				line.append(data, length);
+				break;
+			}
+
+			line.append(data, newline);
+			OnLine();
+			line.clear();
+
+			length -= newline + 1 - data;
+			data = newline + 1;
+		}
+	}
+
+private:
+	void OnLine() noexcept {
+		if (line == "OK")
+			++n_ok;
+		else if (line.compare(0, 4, "ACK ") == 0)
+			++n_ack;
+	}
+};
+
+static UniqueSocketDescriptor
+Connect(unsigned port)
+{
+	UniqueSocketDescriptor fd;
+	if (!fd.Create(AF_INET, SOCK_STREAM, 0))
+		throw std::runtime_error("Failed to create socket");
+
+	if (!fd.Connect(IPv4Address(127, 0, 0, 1, port)))
+		throw std::runtime_error("Failed to connect");
+
+	/* read the greeting (SocketDescriptor::Read() does not
+	   block) */
+	if (fd.WaitReadable(10000) <= 0)
+		throw std::runtime_error("Timeout");
+
+	char buffer[256];
+	ssize_t nbytes = fd.Read(buffer, sizeof(buffer) - 1);
+	if (nbytes <= 0)
+		throw std::runtime_error("Failed to read the greeting");
+
+	buffer[nbytes] = 0;
+	if (strncmp(buffer, "OK MPD ", 7) != 0)
+		throw std::runtime_error("Not an MPD server");
+
+	fd.SetNonBlocking();
+	return fd;
+}
+
+/**
+ * Send the request and read responses until the given number of
+ * commands have been completed.  Sending and receiving are
+ * interleaved, because the server may fill the socket buffer before
+ * it has received the whole request.
+ */
+static void
+RunRound(SocketDescriptor fd, const std::string &request,
+	 ResponseCounter &counter, unsigned expected)
+{
+	size_t position = 0;
+
+	while (counter.GetCompleted() < expected) {
+		struct pollfd pfd = {fd.Get(), POLLIN, 0};
+		if (position < request.length())
+			pfd.events |= POLLOUT;
+
+		if (poll(&pfd, 1, 10000) <= 0)
+			throw std::runtime_error("Timeout");
+
+		if (pfd.revents & POLLOUT) {
+			ssize_t nbytes = fd.Write(request.data() + position,
+						  request.length() - position);
+			if (nbytes < 0)
+				throw std::runtime_error("Failed to send");
+
+			position += nbytes;
+		}
+
+		if (pfd.revents & (POLLIN|POLLHUP|POLLERR)) {
+			static char buffer[65536];
+			ssize_t nbytes = fd.Read(buffer, sizeof(buffer));
+			if (nbytes == 0)
+				throw std::runtime_error("Connection closed");
+
+			if (nbytes > 0)
+				counter.Feed(buffer, nbytes);
+		}
+	}
+}
+
+int main(int argc, char **argv)
+try {
+	if (argc < 2 || argc > 4) {
+		fprintf(stderr, "Usage: bench_protocol PORT [BATCH] [ROUNDS]\n");
+		return EXIT_FAILURE;
+	}
+
+	const unsigned port = strtoul(argv[1], nullptr, 10);
+	const unsigned batch = argc > 2 ? strtoul(argv[2], nullptr, 10) : 100;
+	const unsigned rounds = argc > 3 ? strtoul(argv[3], nullptr, 10) : 100;
+
+	std::string request;
+	for (unsigned i = 0; i < batch; ++i)
+		request += batch_commands;
+
+	auto fd = Connect(port);
+
+	ResponseCounter counter;
+
+	const auto start = steady_clock::now();
+
+	for (unsigned i = 1; i <= rounds; ++i)
+		RunRound(fd, request, counter,
+			 i * batch * COMMANDS_PER_BATCH);
+
+	const double seconds =
+		std::chrono::duration<double>(steady_clock::now() - start).count();
+
+	const unsigned n = counter.GetCompleted();
+	printf("%u commands (%u failed) in %.3f s\n",
+	       n, counter.n_ack, seconds);
+	printf("%.0f commands/s, %.1f MB/s received\n",
+	       n / seconds, counter.n_bytes / 1048576. / seconds);
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
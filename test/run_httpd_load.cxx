@@ -0,0 +1,266 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/*
+ * A load test for the "httpd" output plugin: it streams silence to
+ * many simulated HTTP clients, some of which read the stream as fast
+ * as possible, and some of which read much slower than the stream's
+ * bit rate (and are therefore skipped by the server).
+ */
+
+#include "output/Interface.hxx"
+#include "output/OutputPlugin.hxx"
+#include "output/plugins/httpd/HttpdOutputPlugin.hxx"
+#include "config/Block.hxx"
+#include "event/Thread.hxx"
+#include "net/UniqueSocketDescriptor.hxx"
+#include "net/IPv4Address.hxx"
+#include "AudioFormat.hxx"
+#include "util/ScopeExit.hxx"
+#include "util/PrintException.hxx"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include <poll.h>
+#include <sys/resource.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using std::chrono::steady_clock;
+
+struct LoadClient {
+	UniqueSocketDescriptor fd;
+
+	/**
+	 * The maximum number of bytes per second this client reads;
+	 * 0 means unlimited.
+	 */
+	size_t rate;
+
+	uint64_t received = 0;
+
+	bool closed = false;
+
+	LoadClient(UniqueSocketDescriptor &&_fd, size_t _rate) noexcept
+		:fd(std::move(_fd)), rate(_rate) {}
+
+	/**
+	 * How many bytes may this client read now?
+	 */
+	size_t GetBudget(steady_clock::duration elapsed) const noexcept {
+		if (rate == 0)
+			return SIZE_MAX;
+
+		const double seconds =
+			std::chrono::duration<double>(elapsed).count();
+		const uint64_t allowed = uint64_t(seconds * rate);
+		return allowed > received
+			? size_t(allowed - received)
+			: 0;
+	}
+
+	void Read(size_t budget) noexcept {
+		static char buffer[65536];
+
+		ssize_t nbytes = fd.Read(buffer,
+					 std::min(budget, sizeof(buffer)));
+		if (nbytes <= 0)
+			closed = true;
+		else
+			received += nbytes;
+	}
+};
+
+static UniqueSocketDescriptor
+ConnectClient(unsigned port)
+{
+	UniqueSocketDescriptor fd;
+	if (!fd.Create(AF_INET, SOCK_STREAM, 0))
+		throw std::runtime_error("Failed to create socket");
+
+	if (!fd.Connect(IPv4Address(127, 0, 0, 1, port)))
+		throw std::runtime_error("Failed to connect");
+
+	static constexpr char request[] =
+		"GET / HTTP/1.1\r\n"
+		"Host: localhost\r\n"
+		"\r\n";
+	if (fd.Write(request, sizeof(request) - 1) < 0)
+		throw std::runtime_error("Failed to send request");
+
+	fd.SetNonBlocking();
+	return fd;
+}
+
+/**
+ * Read from all clients (within their budget) until the given
+ * timeout expires.
+ */
+static void
+ServiceClients(std::vector<LoadClient> &clients,
+	       steady_clock::time_point start,
+	       steady_clock::duration timeout) noexcept
+{
+	const auto until = steady_clock::now() + timeout;
+
+	std::vector<struct pollfd> pfds;
+	std::vector<LoadClient *> polled;
+
+	do {
+		const auto elapsed = steady_clock::now() - start;
+
+		pfds.clear();
+		polled.clear();
+		for (auto &c : clients) {
+			if (c.closed || c.GetBudget(elapsed) == 0)
+				continue;
+
+			pfds.push_back({c.fd.Get(), POLLIN, 0});
+			polled.push_back(&c);
+		}
+
+		int ms = std::chrono::duration_cast<std::chrono::milliseconds>(until - steady_clock::now()).count();
+		if (ms < 1)
+			ms = 1;
+		/* wake up regularly to refill the slow clients'
+		   budget */
+		if (ms > 50)
+			ms = 50;
+
+		if (poll(pfds.data(), pfds.size(), ms) <= 0)
+			continue;
+
+		for (size_t i = 0; i < pfds.size(); ++i)
+			if (pfds[i].revents != 0)
+				polled[i]->Read(polled[i]->GetBudget(elapsed));
+	} while (steady_clock::now() < until);
+}
+
+static void
+PrintResult(const char *name, const std::vector<LoadClient> &clients,
+	    size_t rate, double seconds) noexcept
+{
+	unsigned n = 0, n_closed = 0;
+	uint64_t total = 0;
+
+	for (const auto &c : clients) {
+		if (c.rate != rate)
+			continue;
+
+		++n;
+		if (c.closed)
+			++n_closed;
+		total += c.received;
+	}
+
+	if (n == 0)
+		return;
+
+	printf("%s clients: %u (%u closed), average %.1f kB/s\n",
+	       name, n, n_closed, total / 1024. / n / seconds);
+}
+
+int main(int argc, char **argv)
+try {
+	if (argc < 2 || argc > 5) {
+		fprintf(stderr, "Usage: run_httpd_load PORT [FAST] [SLOW] [SECONDS]\n");
+		return EXIT_FAILURE;
+	}
+
+	const unsigned port = strtoul(argv[1], nullptr, 10);
+	const unsigned n_fast = argc > 2 ? strtoul(argv[2], nullptr, 10) : 200;
+	const unsigned n_slow = argc > 3 ? strtoul(argv[3], nullptr, 10) : 200;
+	const unsigned seconds = argc > 4 ? strtoul(argv[4], nullptr, 10) : 10;
+
+	AudioFormat audio_format(44100, SampleFormat::S16, 2);
+	const size_t byte_rate =
+		audio_format.sample_rate * audio_format.GetFrameSize();
+
+	/* the slow clients read at a quarter of the stream's bit
+	   rate */
+	const size_t slow_rate = byte_rate / 4;
+
+	EventThread io_thread;
+	io_thread.Start();
+
+	ConfigBlock block;
+	block.AddBlockParam("encoder", "wave");
+	block.AddBlockParam("port", std::to_string(port));
+	block.AddBlockParam("max_clients", "0");
+
+	std::unique_ptr<AudioOutput> ao(ao_plugin_init(io_thread.GetEventLoop(),
+						       httpd_output_plugin,
+						       block));
+
+	ao->Enable();
+	AtScopeExit(&ao) { ao->Disable(); };
+
+	ao->Open(audio_format);
+	AtScopeExit(&ao) { ao->Close(); };
+
+	std::vector<LoadClient> clients;
+	clients.reserve(n_fast + n_slow);
+	for (unsigned i = 0; i < n_fast + n_slow; ++i)
+		clients.emplace_back(ConnectClient(port),
+				     i < n_fast ? 0 : slow_rate);
+
+	struct rusage ru_start;
+	getrusage(RUSAGE_SELF, &ru_start);
+
+	/* play silence in real time */
+
+	static char silence[4096];
+	const auto start = steady_clock::now();
+	const auto end = start + std::chrono::seconds(seconds);
+
+	while (steady_clock::now() < end) {
+		const auto delay = ao->Delay();
+		if (delay > steady_clock::duration::zero())
+			ServiceClients(clients, start, delay);
+		else
+			ao->Play(silence, sizeof(silence));
+	}
+
+	struct rusage ru_end;
+	getrusage(RUSAGE_SELF, &ru_end);
+
+	const double elapsed =
+		std::chrono::duration<double>(steady_clock::now() - start).count();
+
+	printf("stream: %.1f kB/s\n", byte_rate / 1024.);
+	PrintResult("fast", clients, 0, elapsed);
+	PrintResult("slow", clients, slow_rate, elapsed);
+
+	const auto cpu_us = [](const struct rusage &ru){
+		return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000. +
+			ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+	};
+
+	printf("CPU time: %.2f s (server and clients)\n",
+	       (cpu_us(ru_end) - cpu_us(ru_start)) / 1e6);
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
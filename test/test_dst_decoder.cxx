@@ -0,0 +1,244 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Decodes a synthetic DST stream with dst_decoder_t at different
+ * worker thread limits, verifies that the frames are returned in
+ * order and identical to a serial decode, and reports the number of
+ * frames decoded per second.
+ */
+
+#include <dst_decoder_mpd.h>
+#include <dst_decoder_pool.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <stdio.h>
+#include <string.h>
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr int CHANNELS = 2;
+static constexpr int SAMPLERATE = 2822400;
+static constexpr int FRAMERATE = 75;
+static constexpr size_t DSD_FRAME_SIZE = SAMPLERATE / 8 / FRAMERATE * CHANNELS;
+
+/**
+ * The decoder fails unless it has consumed (nearly) all of the
+ * arithmetic coded data; it reads zeroes past the end, therefore a
+ * short frame always succeeds.  The decoding work does not depend
+ * on the frame size.
+ */
+static constexpr size_t DST_FRAME_SIZE = 1024;
+static constexpr unsigned N_FRAMES = 32;
+static constexpr unsigned N_SLOTS = 8;
+
+class BitWriter {
+	std::vector<uint8_t> data;
+	unsigned n_bits = 0;
+
+public:
+	void Put(unsigned value, unsigned n) {
+		while (n-- > 0) {
+			if (n_bits % 8 == 0)
+				data.push_back(0);
+
+			if ((value >> n) & 1)
+				data.back() |= 0x80 >> (n_bits % 8);
+
+			++n_bits;
+		}
+	}
+
+	std::vector<uint8_t> Finish(size_t size) {
+		while (data.size() < size)
+			Put(0, 1);
+		data.resize(size);
+		return std::move(data);
+	}
+};
+
+/**
+ * Generate a DST coded frame with one prediction filter of the
+ * maximum order and one probability table for all channels,
+ * followed by random arithmetic coded data.  The decoder produces
+ * noise, but it does all the work of a real frame.
+ */
+static std::vector<uint8_t>
+MakeFrame(std::minstd_rand &engine)
+{
+	BitWriter w;
+
+	/* DST coded */
+	w.Put(1, 1);
+
+	/* segmentation: Ptables as filters, one segment for all
+	   channels */
+	w.Put(1, 1);
+	w.Put(1, 1);
+	w.Put(1, 1);
+
+	/* mapping: Ptables as filters, same for all channels, no
+	   half probabilities */
+	w.Put(1, 1);
+	w.Put(1, 1);
+	for (int i = 0; i < CHANNELS; ++i)
+		w.Put(0, 1);
+
+	/* one uncoded filter of order 128 */
+	w.Put(127, 7);
+	w.Put(0, 1);
+	for (unsigned i = 0; i < 128; ++i)
+		w.Put(engine() % 64, 9);
+
+	/* one uncoded probability table with 64 entries near 1/2,
+	   so each decoded bit consumes nearly one bit of the
+	   arithmetic code */
+	w.Put(63, 6);
+	w.Put(0, 1);
+	for (unsigned i = 0; i < 64; ++i)
+		w.Put(96 + engine() % 32, 7);
+
+	/* the arithmetic coded data must begin with a zero bit */
+	w.Put(0, 1);
+	for (size_t i = 0; i < DST_FRAME_SIZE; ++i)
+		w.Put(engine() % 256, 8);
+
+	return w.Finish(DST_FRAME_SIZE);
+}
+
+static double
+Seconds(Clock::time_point start) noexcept
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+class DstDecoderTest : public ::testing::Test {
+protected:
+	std::vector<std::vector<uint8_t>> frames;
+	std::vector<std::vector<uint8_t>> expected;
+
+	void SetUp() override {
+		std::minstd_rand engine;
+		for (unsigned i = 0; i < N_FRAMES; ++i)
+			frames.push_back(MakeFrame(engine));
+
+		auto d = std::make_unique<CDSTDecoder>();
+		ASSERT_EQ(0, d->init(CHANNELS, (SAMPLERATE / 44100) / (FRAMERATE / 75)));
+
+		const auto start = Clock::now();
+		for (auto &frame : frames) {
+			std::vector<uint8_t> dsd(DSD_FRAME_SIZE);
+			ASSERT_EQ(0, d->decode(frame.data(), frame.size() * 8,
+					       dsd.data()));
+			expected.push_back(std::move(dsd));
+		}
+
+		printf("serial:    %7.1f frames/s\n",
+		       N_FRAMES / Seconds(start));
+	}
+};
+
+TEST_F(DstDecoderTest, Pool)
+{
+	for (unsigned n_threads : {1u, 2u, 4u}) {
+		dst_decoder_pool_t::configure(n_threads, false);
+
+		dst_decoder_t decoder(N_SLOTS);
+		ASSERT_EQ(0, decoder.init(CHANNELS, SAMPLERATE, FRAMERATE));
+
+		/* the same buffer layout as the decoder plugins */
+		std::vector<uint8_t> dst_buf(N_SLOTS * DST_FRAME_SIZE);
+		std::vector<uint8_t> dsd_buf(N_SLOTS * DSD_FRAME_SIZE);
+
+		unsigned n_output = 0;
+		auto check = [&](const uint8_t *dsd_data, size_t dsd_size){
+			ASSERT_LT(n_output, N_FRAMES);
+			ASSERT_EQ(DSD_FRAME_SIZE, dsd_size);
+			EXPECT_EQ(0, memcmp(expected[n_output].data(),
+					    dsd_data, dsd_size));
+			++n_output;
+		};
+
+		const auto start = Clock::now();
+
+		for (const auto &frame : frames) {
+			const int slot_nr = decoder.get_slot_nr();
+			uint8_t *dst_data = dst_buf.data() + slot_nr * DST_FRAME_SIZE;
+			uint8_t *dsd_data = dsd_buf.data() + slot_nr * DSD_FRAME_SIZE;
+			size_t dsd_size = 0;
+
+			memcpy(dst_data, frame.data(), frame.size());
+			decoder.decode(dst_data, frame.size(),
+				       &dsd_data, &dsd_size);
+			if (dsd_size > 0)
+				check(dsd_data, dsd_size);
+		}
+
+		/* flush the frames which are still in flight */
+		for (;;) {
+			uint8_t *dsd_data = nullptr;
+			size_t dsd_size = 0;
+			decoder.decode(nullptr, 0, &dsd_data, &dsd_size);
+			if (dsd_size == 0)
+				break;
+
+			check(dsd_data, dsd_size);
+		}
+
+		const double seconds = Seconds(start);
+
+		EXPECT_EQ(N_FRAMES, n_output);
+		EXPECT_LE(dst_decoder_pool_t::get()->get_thread_count(),
+			  n_threads);
+
+		printf("%u thread%s: %7.1f frames/s\n",
+		       n_threads, n_threads > 1 ? "s" : " ",
+		       N_FRAMES / seconds);
+	}
+
+	dst_decoder_pool_t::configure(0, false);
+}
+
+TEST_F(DstDecoderTest, Cancel)
+{
+	/* destroying a decoder with frames in flight must not crash
+	   or hang */
+	dst_decoder_t decoder(N_SLOTS);
+	ASSERT_EQ(0, decoder.init(CHANNELS, SAMPLERATE, FRAMERATE));
+
+	std::vector<uint8_t> dst_buf(N_SLOTS * DST_FRAME_SIZE);
+	std::vector<uint8_t> dsd_buf(N_SLOTS * DSD_FRAME_SIZE);
+
+	for (unsigned i = 0; i < N_SLOTS / 2; ++i) {
+		const int slot_nr = decoder.get_slot_nr();
+		uint8_t *dst_data = dst_buf.data() + slot_nr * DST_FRAME_SIZE;
+		uint8_t *dsd_data = dsd_buf.data() + slot_nr * DSD_FRAME_SIZE;
+		size_t dsd_size = 0;
+
+		memcpy(dst_data, frames[i].data(), DST_FRAME_SIZE);
+		decoder.decode(dst_data, DST_FRAME_SIZE, &dsd_data, &dsd_size);
+		EXPECT_EQ(0u, dsd_size);
+	}
+}
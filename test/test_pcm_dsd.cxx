@@ -0,0 +1,100 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#ifdef ENABLE_DSD
+
+#include "pcm/PcmDsd.hxx"
+#include "util/ConstBuffer.hxx"
+#include "test_pcm_util.hxx"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+TEST(PcmTest, DsdFindRatio)
+{
+	/* DSD64 */
+	EXPECT_EQ(8u, PcmDsd::FindRatio(352800, 352800));
+	EXPECT_EQ(8u, PcmDsd::FindRatio(352800, 192000));
+	EXPECT_EQ(16u, PcmDsd::FindRatio(352800, 176400));
+	EXPECT_EQ(32u, PcmDsd::FindRatio(352800, 88200));
+	EXPECT_EQ(32u, PcmDsd::FindRatio(352800, 48000));
+	EXPECT_EQ(64u, PcmDsd::FindRatio(352800, 44100));
+
+	/* DSD512 */
+	EXPECT_EQ(128u, PcmDsd::FindRatio(2822400, 176400));
+	EXPECT_EQ(256u, PcmDsd::FindRatio(2822400, 88200));
+	EXPECT_EQ(256u, PcmDsd::FindRatio(2822400, 44100));
+}
+
+TEST(PcmTest, DsdDcGain)
+{
+	/* all bits set is the maximum positive DC level */
+	static constexpr size_t N = 8192;
+	std::vector<uint8_t> src(N * 2, 0xff);
+
+	PcmDsd reference, decimated;
+	decimated.SetRatio(32);
+
+	ConstBuffer<float> r, d;
+	for (unsigned i = 0; i < 4; ++i) {
+		r = reference.ToFloat(2, {src.data(), src.size()});
+		d = decimated.ToFloat(2, {src.data(), src.size()});
+	}
+
+	ASSERT_EQ(N * 2, r.size);
+	ASSERT_EQ(N * 2 / 4, d.size);
+	EXPECT_NEAR(r.back(), d.back(), 1e-4);
+}
+
+TEST(PcmTest, DsdParallel)
+{
+	/* a buffer which is large enough to be converted by the
+	   thread pool, with an odd number of frames */
+	static constexpr unsigned CHANNELS = 6;
+	static constexpr size_t N = 4099;
+	const auto src = TestDataBuffer<uint8_t, N * CHANNELS>();
+
+	PcmDsd all;
+	all.SetRatio(32);
+
+	PcmDsd single[CHANNELS];
+	for (auto &i : single)
+		i.SetRatio(32);
+
+	for (unsigned i = 0; i < 3; ++i) {
+		const auto d = all.ToFloat(CHANNELS, {src.begin(), src.size()});
+
+		for (unsigned c = 0; c < CHANNELS; ++c) {
+			std::vector<uint8_t> mono(N);
+			for (size_t j = 0; j < N; ++j)
+				mono[j] = src[j * CHANNELS + c];
+
+			const auto s = single[c].ToFloat(1, {mono.data(), N});
+			ASSERT_EQ(d.size, s.size * CHANNELS);
+
+			for (size_t j = 0; j < s.size; ++j)
+				EXPECT_EQ(s[j], d[j * CHANNELS + c]);
+		}
+	}
+}
+
+#endif
@@ -22,9 +22,14 @@
 #include "pcm/Dither.hxx"
 #include "pcm/Buffer.hxx"
 #include "pcm/SampleFormat.hxx"
+#include "pcm/ConvertKernels.hxx"
+#include "util/ConstBuffer.hxx"
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <vector>
+
 TEST(PcmTest, Format8To16)
 {
 	constexpr size_t N = 509;
@@ -159,3 +164,91 @@ TEST(PcmTest, FormatFloat32)
 	for (size_t i = 4; i < N; ++i)
 		EXPECT_NEAR(src[i], d[i], error);
 }
+
+/**
+ * Compare one function of all kernel sets supported by this CPU with
+ * the generic implementation.
+ */
+template<typename D, typename S>
+static void
+TestConvertKernel(void (*PcmConvertKernels::*f)(D *, const S *,
+						size_t) noexcept,
+		  const S *src, size_t n, size_t dest_size=1)
+{
+	std::vector<D> expected(n * dest_size), actual(n * dest_size);
+	(pcm_convert_kernels_generic.*f)(expected.data(), src, n);
+
+	for (const auto *k : GetSupportedPcmConvertKernels()) {
+		(k->*f)(actual.data(), src, n);
+		EXPECT_EQ(expected, actual) << k->name;
+	}
+}
+
+TEST(PcmTest, ConvertKernels)
+{
+	constexpr size_t N = 509;
+	const auto s16 = TestDataBuffer<int16_t, N>();
+	const auto s24 = TestDataBuffer<int32_t, N>(RandomInt24());
+	const auto s32 = TestDataBuffer<int32_t, N>();
+	const auto packed = TestDataBuffer<uint8_t, N * 3>();
+
+	std::array<float, N> f;
+	RandomFloat g;
+	for (auto &i : f)
+		i = g() * 1.2f;
+
+	/* the edges of the float to integer conversion */
+	f[0] = 1;
+	f[1] = -1;
+	f[2] = 0.99999994f;
+
+	TestConvertKernel(&PcmConvertKernels::s16_to_s24, s16.begin(), N);
+	TestConvertKernel(&PcmConvertKernels::s16_to_s32, s16.begin(), N);
+	TestConvertKernel(&PcmConvertKernels::s24_to_s32, s24.begin(), N);
+	TestConvertKernel(&PcmConvertKernels::s32_to_s24, s32.begin(), N);
+	TestConvertKernel(&PcmConvertKernels::s16_to_float, s16.begin(), N);
+	TestConvertKernel(&PcmConvertKernels::s24_to_float, s24.begin(), N);
+	TestConvertKernel(&PcmConvertKernels::s32_to_float, s32.begin(), N);
+	TestConvertKernel(&PcmConvertKernels::float_to_s16, f.data(), N);
+	TestConvertKernel(&PcmConvertKernels::float_to_s24, f.data(), N);
+	TestConvertKernel(&PcmConvertKernels::float_to_s32, f.data(), N);
+	TestConvertKernel(&PcmConvertKernels::pack_24, s24.begin(), N, 3);
+	TestConvertKernel(&PcmConvertKernels::unpack_24, packed.begin(), N);
+	TestConvertKernel(&PcmConvertKernels::reverse_16,
+			  (const uint16_t *)s16.begin(), N);
+	TestConvertKernel(&PcmConvertKernels::reverse_32,
+			  (const uint32_t *)s32.begin(), N);
+	TestConvertKernel(&PcmConvertKernels::alsa_51_16, s16.begin(), N / 6, 6);
+	TestConvertKernel(&PcmConvertKernels::alsa_51_32, s32.begin(), N / 6, 6);
+	TestConvertKernel(&PcmConvertKernels::alsa_71_16, s16.begin(), N / 8, 8);
+	TestConvertKernel(&PcmConvertKernels::alsa_71_32, s32.begin(), N / 8, 8);
+}
+
+/**
+ * Check that every kernel set this CPU can run is in the list, so
+ * the ConvertKernels test compares all of them with the generic
+ * implementation.
+ */
+TEST(PcmTest, ConvertKernelsSupported)
+{
+	const auto kernels = GetSupportedPcmConvertKernels();
+	ASSERT_FALSE(kernels.empty());
+	EXPECT_EQ(&pcm_convert_kernels_generic, kernels.front());
+	EXPECT_EQ(kernels.back(), &GetPcmConvertKernels());
+
+#ifdef PCM_CONVERT_KERNELS_X86
+	const auto contains = [&kernels](const PcmConvertKernels &k){
+		return std::find(kernels.begin(), kernels.end(), &k) !=
+			kernels.end();
+	};
+
+	EXPECT_EQ(__builtin_cpu_supports("sse2") != 0,
+		  contains(pcm_convert_kernels_sse2));
+	EXPECT_EQ(__builtin_cpu_supports("avx2") != 0,
+		  contains(pcm_convert_kernels_avx2));
+#endif
+
+#ifdef PCM_CONVERT_KERNELS_NEON
+	EXPECT_EQ(&pcm_convert_kernels_neon, kernels.back());
+#endif
+}
@@ -23,6 +23,10 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+
+#include <string.h>
+
 TEST(PcmTest, Pack24)
 {
 	constexpr unsigned N = 509;
@@ -87,3 +91,18 @@ TEST(PcmTest, Unpack24BE)
 		EXPECT_EQ(s, dest[i]);
 	}
 }
+
+TEST(PcmTest, Pack24InPlace)
+{
+	constexpr unsigned N = 509;
+	const auto src = TestDataBuffer<int32_t, N>(RandomInt24());
+
+	uint8_t expected[N * 3];
+	pcm_pack_24(expected, src.begin(), src.end());
+
+	int32_t buffer[N];
+	std::copy(src.begin(), src.end(), buffer);
+	pcm_pack_24((uint8_t *)buffer, buffer, buffer + N);
+
+	EXPECT_EQ(0, memcmp(expected, buffer, sizeof(expected)));
+}
@@ -19,6 +19,7 @@
 
 #include "pcm/Volume.hxx"
 #include "pcm/Traits.hxx"
+#include "pcm/VolumeKernels.hxx"
 #include "util/ConstBuffer.hxx"
 #include "test_pcm_util.hxx"
 
@@ -158,3 +159,151 @@ TEST(PcmTest, VolumeFloat)
 
 	pv.Close();
 }
+
+/**
+ * Compare the results of all kernel sets supported by this CPU with
+ * the generic implementation.  Integer results must be identical.
+ */
+template<typename T, typename G>
+static void
+TestKernels(G g,
+	    void (*PcmVolumeKernels::*volume)(PcmDither::Lanes &,
+					      T *, const T *, size_t,
+					      int) noexcept,
+	    void (*PcmVolumeKernels::*add)(PcmDither::Lanes &,
+					   T *, const T *, size_t,
+					   int, int) noexcept)
+{
+	constexpr size_t N = 509;
+	const auto a = TestDataBuffer<T, N>(g);
+	const auto b = TestDataBuffer<T, N>(g);
+
+	const auto &generic = pcm_volume_kernels_generic;
+
+	for (const auto *k : GetSupportedPcmVolumeKernels()) {
+		for (int v : {0, int(PCM_VOLUME_1 / 3),
+				int(PCM_VOLUME_1 - 1), int(PCM_VOLUME_1),
+				int(PCM_VOLUME_1 * 2)}) {
+			/* odd sizes exercise the non-vectorized tail */
+			for (size_t n : {N, N - 8, size_t(3)}) {
+				PcmDither d1, d2;
+				T expected[N], actual[N];
+
+				/* call twice to check that the dither
+				   state is carried over */
+				(generic.*volume)(d1.GetLanes(), expected, a, n, v);
+				(generic.*volume)(d1.GetLanes(), expected, a, n, v);
+				(k->*volume)(d2.GetLanes(), actual, a, n, v);
+				(k->*volume)(d2.GetLanes(), actual, a, n, v);
+				EXPECT_EQ(0, memcmp(expected, actual,
+						    n * sizeof(T)))
+					<< k->name << " volume=" << v
+					<< " n=" << n;
+
+				std::copy_n(&a[0], n, expected);
+				std::copy_n(&a[0], n, actual);
+				(generic.*add)(d1.GetLanes(), expected, b, n,
+					       v, int(PCM_VOLUME_1) - v);
+				(k->*add)(d2.GetLanes(), actual, b, n,
+					  v, int(PCM_VOLUME_1) - v);
+				EXPECT_EQ(0, memcmp(expected, actual,
+						    n * sizeof(T)))
+					<< k->name << " add volume=" << v
+					<< " n=" << n;
+			}
+		}
+	}
+}
+
+TEST(PcmTest, VolumeKernels16)
+{
+	TestKernels<int16_t>(RandomInt<int16_t>(),
+			     &PcmVolumeKernels::s16,
+			     &PcmVolumeKernels::add_s16);
+}
+
+TEST(PcmTest, VolumeKernels24)
+{
+	TestKernels<int32_t>(RandomInt24(),
+			     &PcmVolumeKernels::s24,
+			     &PcmVolumeKernels::add_s24);
+}
+
+TEST(PcmTest, VolumeKernels32)
+{
+	TestKernels<int32_t>(RandomInt<int32_t>(),
+			     &PcmVolumeKernels::s32,
+			     &PcmVolumeKernels::add_s32);
+}
+
+TEST(PcmTest, VolumeKernels16to24)
+{
+	constexpr size_t N = 509;
+	const auto src = TestDataBuffer<int16_t, N>();
+
+	int32_t expected[N], actual[N];
+	pcm_volume_kernels_generic.s16_to_s24(expected, src, N,
+					      PCM_VOLUME_1 / 3);
+
+	for (const auto *k : GetSupportedPcmVolumeKernels()) {
+		k->s16_to_s24(actual, src, N, PCM_VOLUME_1 / 3);
+		EXPECT_EQ(0, memcmp(expected, actual, sizeof(actual)))
+			<< k->name;
+	}
+}
+
+TEST(PcmTest, VolumeKernelsFloat)
+{
+	constexpr size_t N = 509;
+	const auto a = TestDataBuffer<float, N>(RandomFloat());
+	const auto b = TestDataBuffer<float, N>(RandomFloat());
+
+	float expected[N], actual[N];
+	pcm_volume_kernels_generic.fl(expected, a, N, 0.3f);
+
+	for (const auto *k : GetSupportedPcmVolumeKernels()) {
+		k->fl(actual, a, N, 0.3f);
+		for (size_t i = 0; i < N; ++i)
+			EXPECT_NEAR(expected[i], actual[i], 1e-6) << k->name;
+	}
+
+	std::copy_n(&a[0], N, expected);
+	pcm_volume_kernels_generic.add_fl(expected, b, N, 0.3f, 0.7f);
+
+	for (const auto *k : GetSupportedPcmVolumeKernels()) {
+		std::copy_n(&a[0], N, actual);
+		k->add_fl(actual, b, N, 0.3f, 0.7f);
+		for (size_t i = 0; i < N; ++i)
+			EXPECT_NEAR(expected[i], actual[i], 1e-6) << k->name;
+	}
+}
+
+/**
+ * Check that every kernel set this CPU can run is in the list, so the
+ * tests above compare all of them with the generic implementation.
+ */
+TEST(PcmTest, VolumeKernelsSupported)
+{
+	const auto kernels = GetSupportedPcmVolumeKernels();
+	ASSERT_FALSE(kernels.empty());
+	EXPECT_EQ(&pcm_volume_kernels_generic, kernels.front());
+	EXPECT_EQ(kernels.back(), &GetPcmVolumeKernels());
+
+#ifdef PCM_VOLUME_KERNELS_X86
+	const auto contains = [&kernels](const PcmVolumeKernels &k){
+		return std::find(kernels.begin(), kernels.end(), &k) !=
+			kernels.end();
+	};
+
+	EXPECT_EQ(__builtin_cpu_supports("sse2") != 0,
+		  contains(pcm_volume_kernels_sse2));
+	EXPECT_EQ(__builtin_cpu_supports("sse4.1") != 0,
+		  contains(pcm_volume_kernels_sse41));
+	EXPECT_EQ(__builtin_cpu_supports("avx2") != 0,
+		  contains(pcm_volume_kernels_avx2));
+#endif
+
+#ifdef PCM_VOLUME_KERNELS_NEON
+	EXPECT_EQ(&pcm_volume_kernels_neon, kernels.back());
+#endif
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright 2003-2019 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "lib/isocache/SectorCache.hxx"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <string.h>
+
+namespace {
+
+/**
+ * An in-memory "file" which counts the handler calls.
+ */
+class MemoryFile final : public SectorCacheHandler {
+	std::vector<uint8_t> data;
+
+public:
+	unsigned n_reads = 0;
+
+	/**
+	 * The number of following handler calls which fail after
+	 * half of the requested size (simulating an I/O error).
+	 */
+	unsigned n_short_reads = 0;
+
+	/**
+	 * The number of following handler calls which fail without
+	 * reading anything.
+	 */
+	unsigned n_failed_reads = 0;
+
+	explicit MemoryFile(size_t size) {
+		std::minstd_rand engine;
+		data.resize(size);
+		for (auto &i : data)
+			i = uint8_t(engine());
+	}
+
+	size_t size() const noexcept {
+		return data.size();
+	}
+
+	const uint8_t *at(size_t offset) const noexcept {
+		return data.data() + offset;
+	}
+
+	size_t OnSectorCacheRead(uint64_t offset,
+				 void *dest, size_t size) noexcept override {
+		++n_reads;
+
+		if (offset >= data.size())
+			return 0;
+
+		if (n_failed_reads > 0) {
+			--n_failed_reads;
+			return 0;
+		}
+
+		size = std::min<size_t>(size, data.size() - offset);
+		if (n_short_reads > 0) {
+			--n_short_reads;
+			size /= 2;
+		}
+
+		memcpy(dest, data.data() + offset, size);
+		return size;
+	}
+};
+
+}
+
+TEST(SectorCache, RandomAccess)
+{
+	/* not a multiple of the block size */
+	MemoryFile file(1024 * 1024 + 1234);
+	SectorCache cache(file, 64 * SectorCache::BLOCK_SIZE);
+	cache.Start(file.size());
+
+	std::minstd_rand engine;
+	std::vector<uint8_t> buffer(16384);
+
+	for (unsigned i = 0; i < 1000; ++i) {
+		const size_t offset = engine() % (file.size() + 100);
+		const size_t size = engine() % buffer.size();
+		const size_t expected = offset < file.size()
+			? std::min(size, file.size() - offset)
+			: 0;
+
+		ASSERT_EQ(expected, cache.Read(offset, buffer.data(), size));
+		ASSERT_EQ(0, memcmp(file.at(offset), buffer.data(), expected));
+	}
+}
+
+TEST(SectorCache, Sequential)
+{
+	MemoryFile file(8 * 1024 * 1024);
+	SectorCache cache(file, 1024 * 1024);
+	cache.Start(file.size());
+
+	/* read SACD physical sectors, which are not aligned to the
+	   block size */
+	constexpr size_t SECTOR_SIZE = 2064;
+	uint8_t buffer[SECTOR_SIZE];
+
+	unsigned n_sectors = 0;
+	size_t offset = 0;
+	while (true) {
+		const size_t nbytes = cache.Read(offset, buffer, sizeof(buffer));
+		ASSERT_EQ(std::min(sizeof(buffer), file.size() - offset), nbytes);
+		ASSERT_EQ(0, memcmp(file.at(offset), buffer, nbytes));
+
+		offset += nbytes;
+		++n_sectors;
+
+		if (n_sectors == 4) {
+			/* the access is sequential now; wait for the
+			   read-ahead thread */
+			const auto timeout = std::chrono::steady_clock::now() +
+				std::chrono::seconds(10);
+			while (cache.GetStats().prefetched == 0 &&
+			       std::chrono::steady_clock::now() < timeout)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+			ASSERT_GT(cache.GetStats().prefetched, 0u);
+		}
+
+		if (nbytes < sizeof(buffer))
+			break;
+	}
+
+	cache.Stop();
+
+	const auto stats = cache.GetStats();
+	EXPECT_GT(stats.GetHitRatio(), 0.9);
+
+	EXPECT_LT(file.n_reads, n_sectors / 10);
+
+	printf("%.2f%% hits, %u reads for %u sectors\n",
+	       100 * stats.GetHitRatio(), file.n_reads, n_sectors);
+}
+
+/**
+ * A short read in the middle of the file is an error, not the end of
+ * the file; it is retried, and the partial data is not cached.
+ */
+TEST(SectorCache, ShortRead)
+{
+	MemoryFile file(256 * 1024);
+	SectorCache cache(file, 64 * SectorCache::BLOCK_SIZE);
+	cache.Start(file.size());
+
+	uint8_t buffer[8192];
+	const size_t offset = 100000;
+
+	/* a short read is retried */
+	file.n_short_reads = 1;
+	ASSERT_EQ(sizeof(buffer), cache.Read(offset, buffer, sizeof(buffer)));
+	ASSERT_EQ(0, memcmp(file.at(offset), buffer, sizeof(buffer)));
+
+	/* one failure is retried as well */
+	const size_t offset2 = 150000;
+	file.n_failed_reads = 1;
+	ASSERT_EQ(sizeof(buffer), cache.Read(offset2, buffer, sizeof(buffer)));
+	ASSERT_EQ(0, memcmp(file.at(offset2), buffer, sizeof(buffer)));
+
+	/* a persistent error is reported with a short result */
+	const size_t offset3 = 200000;
+	file.n_failed_reads = 2;
+	EXPECT_EQ(0u, cache.Read(offset3, buffer, sizeof(buffer)));
+
+	/* ... but the following blocks are not considered beyond
+	   the end of the file */
+	ASSERT_EQ(sizeof(buffer), cache.Read(offset3, buffer, sizeof(buffer)));
+	ASSERT_EQ(0, memcmp(file.at(offset3), buffer, sizeof(buffer)));
+
+	/* the end of the file is still detected */
+	ASSERT_EQ(1000u, cache.Read(file.size() - 1000, buffer, sizeof(buffer)));
+	ASSERT_EQ(0u, cache.Read(file.size(), buffer, sizeof(buffer)));
+}